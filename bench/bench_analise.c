@@ -0,0 +1,202 @@
+// Benchmark da análise de peças: custo por peça da análise em lotes (máscaras SSE2 e
+// escalares) contra uma versão direta peça a peça, e o custo que --analise acrescenta a
+// gerarPeca(). Confere que as três análises chegam exatamente aos mesmos histogramas.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_analise.c -o bench/bench_analise
+// Execução:
+//   ./bench/bench_analise [--json] [--pecas N] [--repeticoes N] [--semente N] [--saco]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: peças por repetição e número de repetições
+#define PECAS_PADRAO 8000000
+#define REPETICOES_PADRAO 7
+
+/**
+ * @brief Referência: a mesma análise, uma peça por vez, sem lotes nem máscaras.
+ */
+void analisar_direto(AnalisePecas *analise, const Peca *pecas, long long n) {
+    long long k;
+    for (k = 0; k < n; k++) {
+        long long posicao = analise->pecas + k;
+        int t = 0;
+        while (TIPOS_PECA[t] != pecas[k].nome) t++;
+        analise->por_tipo[t]++;
+        if (analise->ultima[t] >= 0) {
+            analise_anotar(analise->intervalos[t], &analise->maior_intervalo[t], posicao - analise->ultima[t]);
+        }
+        analise->ultima[t] = posicao;
+        if (t != analise->tipo_sequencia) {
+            if (analise->tipo_sequencia >= 0) {
+                analise_anotar(analise->sequencias[analise->tipo_sequencia],
+                               &analise->maior_sequencia[analise->tipo_sequencia],
+                               posicao - analise->inicio_sequencia);
+            }
+            analise->tipo_sequencia = t;
+            analise->inicio_sequencia = posicao;
+        }
+    }
+    analise->pecas += n;
+}
+
+/**
+ * @brief Compara os resultados de duas análises (contagens, histogramas e posições).
+ */
+int mesmas_analises(const AnalisePecas *a, const AnalisePecas *b) {
+    int t;
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        if (analise_maior(a->intervalos[t], a->maior_intervalo[t]) !=
+                analise_maior(b->intervalos[t], b->maior_intervalo[t]) ||
+            analise_maior(a->sequencias[t], a->maior_sequencia[t]) !=
+                analise_maior(b->sequencias[t], b->maior_sequencia[t])) {
+            return 0;
+        }
+    }
+    return a->pecas == b->pecas && memcmp(a->por_tipo, b->por_tipo, sizeof(a->por_tipo)) == 0 &&
+           memcmp(a->intervalos, b->intervalos, sizeof(a->intervalos)) == 0 &&
+           memcmp(a->sequencias, b->sequencias, sizeof(a->sequencias)) == 0 &&
+           memcmp(a->ultima, b->ultima, sizeof(a->ultima)) == 0 && a->tipo_sequencia == b->tipo_sequencia &&
+           a->inicio_sequencia == b->inicio_sequencia;
+}
+
+int main(int argc, char *argv[]) {
+    long long pecas = PECAS_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    ModoGerador modo = GERADOR_UNIFORME;
+    int json = 0;
+    Peca *sequencia;
+    AnalisePecas *simd, *escalar, *direta;
+    double *ns_simd, *ns_escalar, *ns_direta, *ns_sem, *ns_com;
+    int iguais = 1;
+    long long k;
+    int i, r;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--pecas") == 0 && i + 1 < argc) {
+            pecas = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--saco") == 0) {
+            modo = GERADOR_SACO;
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--pecas N] [--repeticoes N] [--semente N] [--saco]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pecas < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --pecas e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+
+    // A sequência é gerada antes, para medir só a análise
+    sequencia = malloc(pecas * sizeof(Peca));
+    simd = malloc(sizeof(AnalisePecas));
+    escalar = malloc(sizeof(AnalisePecas));
+    direta = malloc(sizeof(AnalisePecas));
+    ns_simd = malloc(repeticoes * sizeof(double));
+    ns_escalar = malloc(repeticoes * sizeof(double));
+    ns_direta = malloc(repeticoes * sizeof(double));
+    ns_sem = malloc(repeticoes * sizeof(double));
+    ns_com = malloc(repeticoes * sizeof(double));
+    if (sequencia == NULL || simd == NULL || escalar == NULL || direta == NULL || ns_simd == NULL ||
+        ns_escalar == NULL || ns_direta == NULL || ns_sem == NULL || ns_com == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+    gerador_inicializar(&gerador_padrao, semente, 0, modo);
+    for (k = 0; k < pecas; k++) {
+        sequencia[k] = gerarPeca();
+    }
+
+    for (r = 0; r < repeticoes; r++) {
+        uint64_t t0, t1;
+        uint64_t soma = 0;
+
+        // 1. Análise em lotes com as máscaras SSE2 (o caminho usado pelo jogo)
+        analise_iniciar(simd, 0);
+        t0 = ler_ns();
+        analise_consumir(simd, sequencia, (int)pecas);
+        analise_processar_lote(simd);
+        t1 = ler_ns();
+        ns_simd[r] = (double)(t1 - t0) / pecas;
+
+        // 2. Os mesmos lotes com as máscaras montadas peça a peça
+        analise_iniciar(escalar, 0);
+        escalar->usar_simd = 0;
+        t0 = ler_ns();
+        analise_consumir(escalar, sequencia, (int)pecas);
+        analise_processar_lote(escalar);
+        t1 = ler_ns();
+        ns_escalar[r] = (double)(t1 - t0) / pecas;
+
+        // 3. Referência direta, sem lotes
+        analise_iniciar(direta, 0);
+        t0 = ler_ns();
+        analisar_direto(direta, sequencia, pecas);
+        t1 = ler_ns();
+        ns_direta[r] = (double)(t1 - t0) / pecas;
+
+        iguais &= mesmas_analises(simd, direta) && mesmas_analises(escalar, direta);
+
+        // 4. gerarPeca() sem e com a análise ligada
+        gerador_inicializar(&gerador_padrao, semente, 0, modo);
+        t0 = ler_ns();
+        for (k = 0; k < pecas; k++) soma += (uint64_t)gerarPeca().nome;
+        t1 = ler_ns();
+        ns_sem[r] = (double)(t1 - t0) / pecas;
+
+        gerador_inicializar(&gerador_padrao, semente, 0, modo);
+        analise_iniciar(simd, 0);
+        analise_ativa = simd;
+        t0 = ler_ns();
+        for (k = 0; k < pecas; k++) soma -= (uint64_t)gerarPeca().nome;
+        t1 = ler_ns();
+        analise_ativa = NULL;
+        analise_processar_lote(simd);
+        ns_com[r] = (double)(t1 - t0) / pecas;
+
+        iguais &= (soma == 0) && mesmas_analises(simd, direta);
+    }
+
+    qsort(ns_simd, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_escalar, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_direta, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_sem, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_com, repeticoes, sizeof(double), comparar_double);
+    if (json) {
+        printf("{\"pecas\":%lld,\"modo\":\"%s\",\"ns_por_peca_simd\":%.3f,\"ns_por_peca_escalar\":%.3f,"
+               "\"ns_por_peca_direta\":%.3f,\"ns_gerarPeca\":%.3f,\"ns_gerarPeca_com_analise\":%.3f,"
+               "\"bytes_de_estado\":%zu,\"qui_quadrado\":%.3f,\"iguais\":%s}\n",
+               pecas, modo == GERADOR_SACO ? "saco" : "uniforme", ns_simd[repeticoes / 2],
+               ns_escalar[repeticoes / 2], ns_direta[repeticoes / 2], ns_sem[repeticoes / 2],
+               ns_com[repeticoes / 2], sizeof(AnalisePecas), analise_qui_quadrado(direta),
+               iguais ? "true" : "false");
+    } else {
+        printf("%lld pecas por repeticao (%s), mediana de %d repeticoes, estado fixo de %zu bytes\n", pecas,
+               modo == GERADOR_SACO ? "saco" : "uniforme", repeticoes, sizeof(AnalisePecas));
+        printf("Lotes com SSE2:       %8.3f ns/peca\n", ns_simd[repeticoes / 2]);
+        printf("Lotes escalares:      %8.3f ns/peca\n", ns_escalar[repeticoes / 2]);
+        printf("Peca a peca:          %8.3f ns/peca\n", ns_direta[repeticoes / 2]);
+        printf("gerarPeca sem analise: %7.3f ns/peca | com analise: %.3f ns/peca\n", ns_sem[repeticoes / 2],
+               ns_com[repeticoes / 2]);
+        printf("Resultados identicos nos tres modos: %s\n", iguais ? "sim" : "NAO");
+    }
+
+    free(sequencia);
+    free(simd);
+    free(escalar);
+    free(direta);
+    free(ns_simd);
+    free(ns_escalar);
+    free(ns_direta);
+    free(ns_sem);
+    free(ns_com);
+    return iguais ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Benchmark da biblioteca pela API pública (tetris.h): aplica as ações de um arquivo de
+// replay a um TetrisJogo, uma chamada por ação (tetris_executar) e em blocos
+// (tetris_executar_varias), e mostra o tempo por ação e o hash final, que deve ser o mesmo
+// "Hash do estado" de ./tetris --semente N --replay arquivo. Ao contrário dos outros
+// benchmarks, não inclui tetris.c: é ligado à biblioteca, como um programa de fora. O
+// Makefile também o usa como treino do PGO da biblioteca.
+//
+// Compilação (pelo Makefile, para a configuração escolhida):
+//   make CONFIG=release build/release/bench_api
+// Execução:
+//   ./build/release/bench_api [--json] [--semente N] [--repeticoes N] arquivo_de_acoes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../tetris.h"
+
+// Ações por chamada de tetris_executar_varias
+#define ACOES_POR_BLOCO 4096
+#define REPETICOES_PADRAO 3
+
+/**
+ * @brief Lê o relógio monotônico em nanossegundos.
+ */
+uint64_t ler_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * @brief Comparação de doubles para qsort.
+ */
+int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Lê as ações de um arquivo de replay (um número por linha) até a opção 0 ou o fim.
+ * Linhas sem número são ignoradas, como no replay do executável.
+ * @param n Recebe o número de ações lidas.
+ * @return int8_t* As ações, ou NULL em caso de erro.
+ */
+int8_t *ler_acoes(const char *caminho, long long *n) {
+    FILE *entrada = fopen(caminho, "rb");
+    int8_t *acoes = NULL;
+    long long capacidade = 0;
+    char linha[64];
+
+    *n = 0;
+    if (entrada == NULL) return NULL;
+    while (fgets(linha, sizeof(linha), entrada) != NULL) {
+        char *fim;
+        long valor = strtol(linha, &fim, 10);
+        if (fim == linha) continue;
+        if (valor == 0) break;
+        if (*n == capacidade) {
+            int8_t *maior;
+            capacidade = capacidade ? 2 * capacidade : 1 << 20;
+            maior = realloc(acoes, capacidade);
+            if (maior == NULL) {
+                free(acoes);
+                fclose(entrada);
+                return NULL;
+            }
+            acoes = maior;
+        }
+        // Fora de 1 a 5 é uma opção inválida, que não muda o estado
+        acoes[(*n)++] = (int8_t)(valor >= 1 && valor <= 5 ? valor : -1);
+    }
+    fclose(entrada);
+    return acoes;
+}
+
+int main(int argc, char *argv[]) {
+    const char *caminho = NULL;
+    uint64_t semente = 9;
+    int repeticoes = REPETICOES_PADRAO;
+    int json = 0;
+    int8_t *acoes;
+    long long n, k;
+    double *ns_chamada, *ns_bloco;
+    uint64_t hash_chamada = 0, hash_bloco = 0;
+    int i, r;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && caminho == NULL) {
+            caminho = argv[i];
+        } else {
+            caminho = NULL;
+            break;
+        }
+    }
+    if (caminho == NULL || repeticoes < 1) {
+        fprintf(stderr, "Uso: %s [--json] [--semente N] [--repeticoes N] arquivo_de_acoes\n", argv[0]);
+        return 1;
+    }
+    if (tetris_versao_api() != TETRIS_API_VERSAO) {
+        fprintf(stderr, "ERRO: A biblioteca tem a API %d; este programa espera a %d.\n", tetris_versao_api(),
+                TETRIS_API_VERSAO);
+        return 1;
+    }
+
+    acoes = ler_acoes(caminho, &n);
+    ns_chamada = malloc(repeticoes * sizeof(double));
+    ns_bloco = malloc(repeticoes * sizeof(double));
+    if (acoes == NULL || n == 0 || ns_chamada == NULL || ns_bloco == NULL) {
+        fprintf(stderr, "ERRO: Nao foi possivel ler as acoes de '%s'.\n", caminho);
+        return 1;
+    }
+
+    for (r = 0; r < repeticoes; r++) {
+        TetrisJogo *jogo;
+        uint64_t t0, t1;
+
+        // 1. Uma chamada por ação
+        jogo = tetris_criar(semente, TETRIS_GERADOR_UNIFORME, 0);
+        if (jogo == NULL) {
+            fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+            return 1;
+        }
+        t0 = ler_ns();
+        for (k = 0; k < n; k++) tetris_executar(jogo, acoes[k]);
+        t1 = ler_ns();
+        ns_chamada[r] = (double)(t1 - t0) / n;
+        hash_chamada = tetris_hash(jogo);
+        tetris_liberar(jogo);
+
+        // 2. Em blocos
+        jogo = tetris_criar(semente, TETRIS_GERADOR_UNIFORME, 0);
+        if (jogo == NULL) {
+            fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+            return 1;
+        }
+        t0 = ler_ns();
+        for (k = 0; k < n; k += ACOES_POR_BLOCO) {
+            tetris_executar_varias(jogo, acoes + k, (int)(n - k < ACOES_POR_BLOCO ? n - k : ACOES_POR_BLOCO), NULL);
+        }
+        t1 = ler_ns();
+        ns_bloco[r] = (double)(t1 - t0) / n;
+        hash_bloco = tetris_hash(jogo);
+        tetris_liberar(jogo);
+    }
+    qsort(ns_chamada, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_bloco, repeticoes, sizeof(double), comparar_double);
+
+    if (json) {
+        printf("{\"acoes\":%lld,\"ns_por_acao_chamada\":%.2f,\"ns_por_acao_bloco\":%.2f,\"hash\":\"%016llx\","
+               "\"iguais\":%s}\n", n, ns_chamada[repeticoes / 2], ns_bloco[repeticoes / 2],
+               (unsigned long long)hash_bloco, hash_chamada == hash_bloco ? "true" : "false");
+    } else {
+        printf("%lld acoes pela API (fila %d, pilha %d), mediana de %d repeticoes\n", n, tetris_capacidade_fila(),
+               tetris_capacidade_pilha(), repeticoes);
+        printf("Uma chamada por acao: %8.2f ns/acao\n", ns_chamada[repeticoes / 2]);
+        printf("Blocos de %d acoes: %8.2f ns/acao\n", ACOES_POR_BLOCO, ns_bloco[repeticoes / 2]);
+        printf("Hash do estado: %016llx\n", (unsigned long long)hash_bloco);
+    }
+    free(acoes);
+    free(ns_chamada);
+    free(ns_bloco);
+    return hash_chamada == hash_bloco ? 0 : 1;
+}
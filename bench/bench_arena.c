@@ -0,0 +1,220 @@
+// Benchmark da arena de sessões: rotatividade longa (conexões entrando e saindo) com
+// registros do tamanho de ClienteServidor, comparando a arena com calloc/free.
+// Mede ns por criação + destruição, a memória residente ao longo da rodada, o custo de
+// arena_resetar e confere que todo handle liberado é recusado por arena_obter.
+// A memória é medida a partir do início de cada fase; a fase do calloc pode reaproveitar
+// páginas que a arena devolveu, então o que importa é a estabilidade de cada linha.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_arena.c -o bench/bench_arena
+// Execução:
+//   ./bench/bench_arena [--json] [--operacoes N] [--vivas N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: operações (criar ou destruir) e sessões vivas em média
+#define OPERACOES_PADRAO 20000000
+#define VIVAS_PADRAO 20000
+// Amostras de memória residente ao longo da rodada
+#define AMOSTRAS_MEMORIA 10
+
+/**
+ * @brief Memória residente do processo em KiB (VmRSS de /proc/self/status), ou -1.
+ */
+long ler_rss_kib() {
+    char linha[256];
+    long kib = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f == NULL) return -1;
+    while (fgets(linha, sizeof(linha), f) != NULL) {
+        if (strncmp(linha, "VmRSS:", 6) == 0) {
+            kib = strtol(linha + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return kib;
+}
+
+/**
+ * @brief Inicializa o registro como servidor_aceitar faz com uma conexão nova (sem o gerador).
+ */
+void iniciar_registro(ClienteServidor *c, long long k) {
+    memset(c, 0, sizeof(*c));
+    c->fd = (int)k;
+    inicializar_fila(&c->fila);
+    inicializar_pilha(&c->pilha);
+}
+
+/**
+ * @brief Decide a próxima operação: cria com mais chance quando há poucas sessões vivas.
+ * @return int 1 para criar, 0 para destruir.
+ */
+int deve_criar(uint64_t r, long long vivas, long long alvo) {
+    if (vivas == 0) return 1;
+    if (vivas >= 2 * alvo) return 0;
+    return (long long)(r % (uint64_t)(2 * alvo)) >= vivas;
+}
+
+int main(int argc, char *argv[]) {
+    long long operacoes = OPERACOES_PADRAO;
+    long long alvo = VIVAS_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    GeradorPecas aleatorio;
+    ArenaSessoes arena;
+    HandleSessao *handles;
+    ClienteServidor **ponteiros;
+    EstatisticasArena estatisticas;
+    long rss_arena[AMOSTRAS_MEMORIA], rss_malloc[AMOSTRAS_MEMORIA];
+    long rss_inicio;
+    uint32_t slots_meio = 0;
+    double ns_arena, ns_malloc, ns_reset, ns_liberar_um;
+    long long vivas, k, recusados = 0, conferidos = 0, soma = 0;
+    uint64_t t0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--operacoes") == 0 && i + 1 < argc) {
+            operacoes = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--vivas") == 0 && i + 1 < argc) {
+            alvo = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--operacoes N] [--vivas N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (operacoes < AMOSTRAS_MEMORIA || alvo < 1) {
+        fprintf(stderr, "ERRO: --operacoes (>= %d) e --vivas devem ser positivos.\n", AMOSTRAS_MEMORIA);
+        return 1;
+    }
+
+    handles = malloc(2 * alvo * sizeof(HandleSessao));
+    ponteiros = malloc(2 * alvo * sizeof(ClienteServidor *));
+    if (handles == NULL || ponteiros == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+
+    // 1. Arena: destrói uma sessão viva qualquer e confere que o seu handle foi recusado.
+    // A memória residente é medida em relação ao início de cada fase
+    arena_criar(&arena, sizeof(ClienteServidor));
+    rss_inicio = ler_rss_kib();
+    gerador_inicializar(&aleatorio, semente, 0, GERADOR_UNIFORME);
+    vivas = 0;
+    t0 = ler_ns();
+    for (k = 0; k < operacoes; k++) {
+        uint64_t r = gerador_proximo_u64(&aleatorio);
+        if (deve_criar(r >> 32, vivas, alvo)) {
+            ClienteServidor *c;
+            HandleSessao h = arena_alocar(&arena, (void **)&c);
+            if (h == HANDLE_NULO) {
+                fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+                return 1;
+            }
+            iniciar_registro(c, k);
+            c->handle = h;
+            handles[vivas++] = h;
+        } else {
+            long long j = (long long)((uint32_t)r % (uint64_t)vivas);
+            HandleSessao h = handles[j];
+            ClienteServidor *c = arena_obter(&arena, h);
+            soma += c->fd;
+            arena_liberar(&arena, h);
+            handles[j] = handles[--vivas];
+            // Uma a cada 64 destruições, o handle antigo é usado de novo (deve ser recusado)
+            if ((r & 63) == 0) {
+                conferidos++;
+                if (arena_obter(&arena, h) == NULL && !arena_liberar(&arena, h)) recusados++;
+            }
+        }
+        if ((k + 1) % (operacoes / AMOSTRAS_MEMORIA) == 0 && (k + 1) / (operacoes / AMOSTRAS_MEMORIA) <= AMOSTRAS_MEMORIA) {
+            rss_arena[(k + 1) / (operacoes / AMOSTRAS_MEMORIA) - 1] = ler_rss_kib() - rss_inicio;
+        }
+        if (k == operacoes / 2) slots_meio = arena.estatisticas.slots;
+    }
+    ns_arena = (double)(ler_ns() - t0) / operacoes;
+
+    // Reset em bloco das sessões vivas, comparado com liberar uma a uma
+    t0 = ler_ns();
+    arena_resetar(&arena);
+    ns_reset = (double)(ler_ns() - t0);
+    for (k = 0; k < vivas; k++) {
+        if (arena_obter(&arena, handles[k]) != NULL) recusados = -1; // Handle sobreviveu ao reset
+    }
+    {
+        long long n = vivas;
+        for (k = 0; k < n; k++) {
+            ClienteServidor *c;
+            handles[k] = arena_alocar(&arena, (void **)&c);
+        }
+        t0 = ler_ns();
+        for (k = 0; k < n; k++) arena_liberar(&arena, handles[k]);
+        ns_liberar_um = n ? (double)(ler_ns() - t0) : 0.0;
+    }
+    estatisticas = arena.estatisticas;
+    arena_destruir(&arena);
+
+    // 2. calloc/free com a mesma sequência de operações (como servidor_aceitar fazia)
+    gerador_inicializar(&aleatorio, semente, 0, GERADOR_UNIFORME);
+    rss_inicio = ler_rss_kib();
+    vivas = 0;
+    t0 = ler_ns();
+    for (k = 0; k < operacoes; k++) {
+        uint64_t r = gerador_proximo_u64(&aleatorio);
+        if (deve_criar(r >> 32, vivas, alvo)) {
+            ClienteServidor *c = calloc(1, sizeof(ClienteServidor));
+            if (c == NULL) {
+                fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+                return 1;
+            }
+            iniciar_registro(c, k);
+            ponteiros[vivas++] = c;
+        } else {
+            long long j = (long long)((uint32_t)r % (uint64_t)vivas);
+            soma -= ponteiros[j]->fd;
+            free(ponteiros[j]);
+            ponteiros[j] = ponteiros[--vivas];
+        }
+        if ((k + 1) % (operacoes / AMOSTRAS_MEMORIA) == 0 && (k + 1) / (operacoes / AMOSTRAS_MEMORIA) <= AMOSTRAS_MEMORIA) {
+            rss_malloc[(k + 1) / (operacoes / AMOSTRAS_MEMORIA) - 1] = ler_rss_kib() - rss_inicio;
+        }
+    }
+    ns_malloc = (double)(ler_ns() - t0) / operacoes;
+    for (k = 0; k < vivas; k++) free(ponteiros[k]);
+
+    if (json) {
+        printf("{\"operacoes\":%lld,\"vivas_alvo\":%lld,\"ns_arena\":%.2f,\"ns_malloc\":%.2f,"
+               "\"ns_reset\":%.0f,\"ns_liberar_uma_a_uma\":%.0f,\"slots_meio\":%u,\"slots_fim\":%u,"
+               "\"pico\":%u,\"bytes_reservados\":%zu,\"rss_kib_arena\":[%ld,%ld],\"rss_kib_malloc\":[%ld,%ld],"
+               "\"handles_conferidos\":%lld,\"handles_recusados\":%lld,\"verificacao\":%lld}\n",
+               operacoes, alvo, ns_arena, ns_malloc, ns_reset, ns_liberar_um, slots_meio,
+               estatisticas.slots, estatisticas.pico, estatisticas.bytes_reservados,
+               rss_arena[0], rss_arena[AMOSTRAS_MEMORIA - 1], rss_malloc[0], rss_malloc[AMOSTRAS_MEMORIA - 1],
+               conferidos, recusados, soma);
+    } else {
+        printf("%lld operacoes, ~%lld sessoes vivas, registros de %zu bytes (slot de %zu)\n",
+               operacoes, alvo, sizeof(ClienteServidor), arena.tamanho_slot);
+        printf("Arena:       %8.2f ns/operacao\n", ns_arena);
+        printf("calloc/free: %8.2f ns/operacao\n", ns_malloc);
+        printf("arena_resetar de %lld sessoes: %.0f ns (liberar uma a uma: %.0f ns)\n", vivas, ns_reset, ns_liberar_um);
+        printf("Slots: %u na metade, %u no fim (pico de %u em uso, %zu bytes reservados, %u blocos)\n",
+               slots_meio, estatisticas.slots, estatisticas.pico, estatisticas.bytes_reservados,
+               estatisticas.blocos);
+        printf("Memoria residente acrescentada (KiB) ao longo da rodada:\n  arena:  ");
+        for (i = 0; i < AMOSTRAS_MEMORIA; i++) printf(" %ld", rss_arena[i]);
+        printf("\n  calloc: ");
+        for (i = 0; i < AMOSTRAS_MEMORIA; i++) printf(" %ld", rss_malloc[i]);
+        printf("\nHandles liberados usados de novo: %lld, recusados: %lld (%lld handles recusados no total)\n",
+               conferidos, recusados, estatisticas.handles_invalidos);
+    }
+
+    free(handles);
+    free(ponteiros);
+    return recusados == conferidos ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Benchmark do avaliador de jogadas: confere as características SIMD contra a versão
+// escalar em tabuleiros de uma partida real e mede as posições avaliadas por segundo
+// com 1 e 2 peças de profundidade, com 1 thread e com T threads (o pool do avaliador, criado
+// uma vez por partida), e o ganho de T threads sobre 1.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_avaliador.c -o bench/bench_avaliador
+// Execução:
+//   ./bench/bench_avaliador [--json] [--jogadas N] [--threads T] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: jogadas da partida medida
+#define JOGADAS_PADRAO 2000
+
+/**
+ * @brief Resultado de uma partida do bot: vazão, pontuação acumulada (para comparar
+ * execuções) e linhas removidas.
+ */
+typedef struct {
+    double posicoes_por_s;
+    double us_por_jogada;
+    double soma_pontuacoes;
+    long long linhas;
+} ResultadoAvaliador;
+
+/**
+ * @brief Joga uma partida de 'jogadas' peças com o avaliador e mede a vazão.
+ * Cada partida recomeça do mesmo gerador semeado, para que sejam comparáveis. O pool é
+ * criado fora do tempo medido, como em executar_avaliador.
+ * @param divergencias Acumula os tabuleiros em que SIMD e escalar discordam.
+ */
+ResultadoAvaliador jogar(int jogadas, int profundidade, int num_threads, uint64_t semente, long long *divergencias) {
+    ResultadoAvaliador resultado = {0.0, 0.0, 0.0, 0};
+    FilaCircular fila;
+    Pilha pilha;
+    Tabuleiro tabuleiro;
+    PoolAvaliador pool;
+    long long posicoes = 0;
+    uint64_t tempo = 0;
+    int k;
+
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    inicializar_tabuleiro(&tabuleiro);
+    preencher_fila_inicial(&fila);
+    despachar_opcao(&fila, &pilha, 2);
+    avaliador_pool_iniciar(&pool, num_threads);
+
+    for (k = 0; k < jogadas; k++) {
+        JogadaAvaliada jogada;
+        CaracteristicasTabuleiro simd, escalar;
+        const RotacaoPeca *rotacao;
+        uint64_t t0 = ler_ns();
+        int ok = avaliar_jogadas(&tabuleiro, &fila, &pilha, &PESOS_PADRAO, profundidade, &pool, &jogada);
+
+        tempo += ler_ns() - t0;
+        if (!ok) break;
+        posicoes += jogada.posicoes;
+        resultado.soma_pontuacoes += jogada.pontuacao;
+        if (jogada.usar_reserva) despachar_opcao(&fila, &pilha, 4);
+        rotacao = &ROTACOES_PECA[indice_tipo_peca(jogada.peca)][jogada.rotacao];
+        tabuleiro_colocar(&tabuleiro, rotacao, jogada.coluna, tabuleiro_soltar(&tabuleiro, rotacao, jogada.coluna));
+        despachar_opcao(&fila, &pilha, 1);
+
+        calcular_caracteristicas(&tabuleiro, &simd);
+        calcular_caracteristicas_escalar(&tabuleiro, &escalar);
+        if (simd.altura_total != escalar.altura_total || simd.buracos != escalar.buracos ||
+            simd.irregularidade != escalar.irregularidade) {
+            (*divergencias)++;
+        }
+    }
+
+    avaliador_pool_encerrar(&pool);
+
+    resultado.posicoes_por_s = posicoes / (tempo / 1e9);
+    resultado.us_por_jogada = tempo / 1e3 / k;
+    resultado.linhas = tabuleiro.linhas_limpas;
+    return resultado;
+}
+
+/**
+ * @brief Mede a vazão das características (SIMD ou escalar) em tabuleiros aleatórios.
+ * @return double Milhões de tabuleiros por segundo.
+ */
+double medir_caracteristicas(void (*calcular)(const Tabuleiro *, CaracteristicasTabuleiro *),
+                             const Tabuleiro *tabuleiros, int n, long long *soma) {
+    const int repeticoes = 200;
+    uint64_t t0 = ler_ns();
+    int r, k;
+
+    for (r = 0; r < repeticoes; r++) {
+        for (k = 0; k < n; k++) {
+            CaracteristicasTabuleiro c;
+            calcular(&tabuleiros[k], &c);
+            *soma += c.altura_total + c.buracos + c.irregularidade;
+        }
+    }
+    return (double)repeticoes * n / ((ler_ns() - t0) / 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    int jogadas = JOGADAS_PADRAO;
+    int num_threads = 4;
+    uint64_t semente = 2024;
+    int json = 0;
+    long long divergencias = 0;
+    long long soma_simd = 0, soma_escalar = 0;
+    Tabuleiro *aleatorios;
+    GeradorPecas aleatorio;
+    ResultadoAvaliador r[4];
+    double m_simd, m_escalar;
+    int deterministico;
+    int i, k;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--jogadas") == 0 && i + 1 < argc) {
+            jogadas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--jogadas N] [--threads T] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (jogadas < 1 || num_threads < 1) {
+        fprintf(stderr, "ERRO: --jogadas e --threads devem ser positivos.\n");
+        return 1;
+    }
+
+    // 1. Características em tabuleiros aleatórios (com buracos e colunas de todas as alturas)
+    aleatorios = malloc(4096 * sizeof(Tabuleiro));
+    if (aleatorios == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+    gerador_inicializar(&aleatorio, semente, 1, GERADOR_UNIFORME);
+    for (k = 0; k < 4096; k++) {
+        CaracteristicasTabuleiro simd, escalar;
+        int altura = (int)(gerador_proximo_u64(&aleatorio) % (ALTURA_TABULEIRO + 1));
+        int y;
+        inicializar_tabuleiro(&aleatorios[k]);
+        for (y = 0; y < altura; y++) {
+            aleatorios[k].linhas[y] |= (uint16_t)(gerador_proximo_u64(&aleatorio) & LINHA_CHEIA);
+        }
+        aleatorios[k].altura = altura;
+        calcular_caracteristicas(&aleatorios[k], &simd);
+        calcular_caracteristicas_escalar(&aleatorios[k], &escalar);
+        if (simd.altura_total != escalar.altura_total || simd.buracos != escalar.buracos ||
+            simd.irregularidade != escalar.irregularidade) {
+            divergencias++;
+        }
+    }
+    m_escalar = medir_caracteristicas(calcular_caracteristicas_escalar, aleatorios, 4096, &soma_escalar);
+    m_simd = medir_caracteristicas(calcular_caracteristicas, aleatorios, 4096, &soma_simd);
+    if (soma_simd != soma_escalar) divergencias++;
+
+    // 2. Partidas do bot: profundidade 1 e 2, com 1 e T threads
+    modo_silencioso = 1;
+    r[0] = jogar(jogadas, 1, 1, semente, &divergencias);
+    r[1] = jogar(jogadas, 1, num_threads, semente, &divergencias);
+    r[2] = jogar(jogadas, 2, 1, semente, &divergencias);
+    r[3] = jogar(jogadas, 2, num_threads, semente, &divergencias);
+    modo_silencioso = 0;
+    // O número de threads não pode mudar as jogadas escolhidas
+    deterministico = r[0].soma_pontuacoes == r[1].soma_pontuacoes && r[2].soma_pontuacoes == r[3].soma_pontuacoes;
+
+    if (json) {
+        printf("{\"caracteristicas_milhoes_por_s\":{\"escalar\":%.1f,\"simd\":%.1f},", m_escalar, m_simd);
+        printf("\"profundidade_1\":{\"1_thread\":%.0f,\"%d_threads\":%.0f,\"ganho\":%.2f,\"linhas\":%lld},",
+               r[0].posicoes_por_s, num_threads, r[1].posicoes_por_s, r[0].us_por_jogada / r[1].us_por_jogada, r[0].linhas);
+        printf("\"profundidade_2\":{\"1_thread\":%.0f,\"%d_threads\":%.0f,\"ganho\":%.2f,\"linhas\":%lld},",
+               r[2].posicoes_por_s, num_threads, r[3].posicoes_por_s, r[2].us_por_jogada / r[3].us_por_jogada, r[2].linhas);
+        printf("\"divergencias\":%lld,\"deterministico\":%s}\n", divergencias, deterministico ? "true" : "false");
+    } else {
+        printf("Caracteristicas (milhoes de tabuleiros/s): escalar %.1f | SIMD %.1f (%.2fx)\n",
+               m_escalar, m_simd, m_simd / m_escalar);
+        printf("%d jogadas por partida, posicoes avaliadas por segundo:\n", jogadas);
+        for (k = 0; k < 4; k++) {
+            printf("  profundidade %d, %2d thread(s): %12.0f posicoes/s  %10.2f us/jogada  %lld linhas\n",
+                   k < 2 ? 1 : 2, k % 2 ? num_threads : 1, r[k].posicoes_por_s, r[k].us_por_jogada, r[k].linhas);
+        }
+        // A profundidade 1 não usa o pool: o ganho dela mostra só o ruído da medição
+        printf("Ganho de %d threads sobre 1: profundidade 1 %.2fx | profundidade 2 %.2fx\n",
+               num_threads, r[0].us_por_jogada / r[1].us_por_jogada, r[2].us_por_jogada / r[3].us_por_jogada);
+        printf("SIMD igual ao escalar: %s | Mesmas jogadas com 1 e %d threads: %s\n",
+               divergencias ? "NAO" : "sim", num_threads, deterministico ? "sim" : "NAO");
+    }
+
+    free(aleatorios);
+    return divergencias == 0 && deterministico ? 0 : 1;
+}
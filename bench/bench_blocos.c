@@ -0,0 +1,254 @@
+// Benchmark das operações em bloco: troca de k peças entre a fila e a pilha, rotação da
+// fila e inversão da pilha (trechos contíguos, troca invertida com SSE2 e memcpy) contra
+// os laços peça a peça equivalentes. Antes de medir, confere as duas versões (estado e
+// conteúdo dos arrays) em uma sequência aleatória de operações.
+//
+// Compilação (otimizada; as capacidades maiores mostram melhor a diferença):
+//   gcc -O2 -march=native -pthread -DMAX_FILA=64 -DMAX_PILHA=16 bench/bench_blocos.c -o bench/bench_blocos
+// Execução:
+//   ./bench/bench_blocos [--json] [--operacoes N] [--repeticoes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: operações por medição e repetições
+#define OPERACOES_PADRAO 2000000
+#define REPETICOES_PADRAO 7
+// Operações da conferência
+#define OPERACOES_CONFERENCIA 200000
+
+/**
+ * @brief Referência: a troca de k peças uma a uma, como a troca múltipla original.
+ */
+int trocar_elementos(FilaCircular *fila, Pilha *pilha, int k) {
+    int i;
+    if (k < 1 || k > fila->tamanho_atual || k > pilha->topo + 1) return 0;
+    for (i = 0; i < k; i++) {
+        int indice_fila = (fila->inicio + i) % MAX_FILA;
+        int indice_pilha = pilha->topo - i;
+        Peca temp = fila->itens[indice_fila];
+        fila->itens[indice_fila] = pilha->itens[indice_pilha];
+        pilha->itens[indice_pilha] = temp;
+    }
+    return 1;
+}
+
+/**
+ * @brief Referência: a rotação como r dequeue + enqueue, peça a peça.
+ */
+int rotacionar_elementos(FilaCircular *fila, int r) {
+    int n = fila->tamanho_atual;
+    int i;
+    if (n == 0) return 0;
+    r %= n;
+    if (r < 0) r += n;
+    for (i = 0; i < r; i++) {
+        Peca p = fila->itens[fila->inicio];
+        fila->itens[fila->inicio].nome = '\0';
+        fila->itens[fila->inicio].id = -1;
+        fila->inicio = (fila->inicio + 1) % MAX_FILA;
+        fila->itens[fila->fim] = p;
+        fila->fim = (fila->fim + 1) % MAX_FILA;
+    }
+    return 1;
+}
+
+/**
+ * @brief Referência: a inversão da pilha trocando as pontas, peça a peça.
+ */
+void inverter_elementos(Pilha *pilha) {
+    int i, j;
+    // j < MAX_PILHA só diz ao compilador que topo está no array (sempre verdade)
+    for (i = 0, j = pilha->topo; i < j && j < MAX_PILHA; i++, j--) {
+        Peca temp = pilha->itens[i];
+        pilha->itens[i] = pilha->itens[j];
+        pilha->itens[j] = temp;
+    }
+}
+
+/**
+ * @brief Estado aleatório: fila com 'tamanho' peças a partir de um início aleatório e
+ * pilha com 'altura' peças; as posições livres ficam vazias, como após dequeue/pop.
+ */
+void sortear_estado(FilaCircular *fila, Pilha *pilha, GeradorPecas *g, int tamanho, int altura) {
+    int i;
+    inicializar_fila(fila);
+    inicializar_pilha(pilha);
+    fila->inicio = fila->fim = (int)(gerador_proximo_u64(g) % MAX_FILA);
+    for (i = 0; i < tamanho; i++) {
+        Peca p = {TIPOS_PECA[gerador_proximo_u64(g) & 3], (int)(gerador_proximo_u64(g) % 100000)};
+        enqueue(fila, p);
+    }
+    for (i = 0; i < altura; i++) {
+        Peca p = {TIPOS_PECA[gerador_proximo_u64(g) & 3], (int)(gerador_proximo_u64(g) % 100000)};
+        push(pilha, p);
+    }
+}
+
+/**
+ * @brief Compara as filas e as pilhas campo a campo, inclusive as posições vazias
+ * (memcmp compararia também os bytes de preenchimento de Peca).
+ */
+int mesmo_estado(const FilaCircular *fila, const Pilha *pilha, const FilaCircular *fila_ref, const Pilha *pilha_ref) {
+    int i;
+    if (fila->inicio != fila_ref->inicio || fila->fim != fila_ref->fim ||
+        fila->tamanho_atual != fila_ref->tamanho_atual || pilha->topo != pilha_ref->topo) {
+        return 0;
+    }
+    for (i = 0; i < MAX_FILA; i++) {
+        if (fila->itens[i].nome != fila_ref->itens[i].nome || fila->itens[i].id != fila_ref->itens[i].id) return 0;
+    }
+    for (i = 0; i < MAX_PILHA; i++) {
+        if (pilha->itens[i].nome != pilha_ref->itens[i].nome || pilha->itens[i].id != pilha_ref->itens[i].id) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Conferência: operações aleatórias nas duas versões, comparando os arrays inteiros.
+ */
+long long conferir(uint64_t semente) {
+    GeradorPecas g;
+    FilaCircular fila, fila_ref;
+    Pilha pilha, pilha_ref;
+    long long divergencias = 0;
+    int k;
+
+    gerador_inicializar(&g, semente, 3, GERADOR_UNIFORME);
+    sortear_estado(&fila, &pilha, &g, MAX_FILA, MAX_PILHA);
+    fila_ref = fila;
+    pilha_ref = pilha;
+    for (k = 0; k < OPERACOES_CONFERENCIA; k++) {
+        uint64_t x = gerador_proximo_u64(&g);
+        int operacao = (int)(x % 5);
+        int parametro = (int)((x >> 8) % (MAX_FILA + 3)) - 1;
+
+        if (operacao == 0) {
+            divergencias += fila_trocar_pilha(&fila, &pilha, parametro) != trocar_elementos(&fila_ref, &pilha_ref, parametro);
+        } else if (operacao == 1) {
+            divergencias += fila_rotacionar(&fila, parametro - MAX_FILA / 2) != rotacionar_elementos(&fila_ref, parametro - MAX_FILA / 2);
+        } else if (operacao == 2) {
+            pilha_inverter(&pilha);
+            inverter_elementos(&pilha_ref);
+        } else if (operacao == 3) {
+            // Muda os tamanhos de vez em quando, para cobrir filas e pilhas parciais
+            sortear_estado(&fila, &pilha, &g, (int)((x >> 16) % (MAX_FILA + 1)), (int)((x >> 24) % (MAX_PILHA + 1)));
+            fila_ref = fila;
+            pilha_ref = pilha;
+        } else {
+            Peca p;
+            if (dequeue(&fila, &p)) { dequeue(&fila_ref, &p); enqueue(&fila, p); enqueue(&fila_ref, p); }
+        }
+        divergencias += !mesmo_estado(&fila, &pilha, &fila_ref, &pilha_ref);
+    }
+    return divergencias;
+}
+
+int main(int argc, char *argv[]) {
+    long long operacoes = OPERACOES_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    FilaCircular fila;
+    Pilha pilha;
+    GeradorPecas g;
+    double *ns_bloco, *ns_elementos;
+    long long divergencias;
+    // Casos medidos: troca de k (k = 1, 3, metade e o máximo), rotação da fila quase cheia
+    // (cópia) e cheia (só índices), e inversão da pilha cheia
+    int casos_k[] = {1, 3, MAX_PILHA / 2, MAX_FILA < MAX_PILHA ? MAX_FILA : MAX_PILHA};
+    int c, i, r;
+    long long k;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--operacoes") == 0 && i + 1 < argc) {
+            operacoes = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--operacoes N] [--repeticoes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (operacoes < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --operacoes e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+    ns_bloco = malloc(repeticoes * sizeof(double));
+    ns_elementos = malloc(repeticoes * sizeof(double));
+    if (ns_bloco == NULL || ns_elementos == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    divergencias = conferir(semente);
+    gerador_inicializar(&g, semente, 5, GERADOR_UNIFORME);
+
+    if (!json) {
+        printf("MAX_FILA %d, MAX_PILHA %d, %lld operacoes por medicao, mediana de %d repeticoes\n", MAX_FILA, MAX_PILHA,
+               operacoes, repeticoes);
+        printf("%-22s %12s %14s %10s\n", "operacao", "bloco ns", "elementos ns", "aceleracao");
+    }
+    for (c = 0; c < 7; c++) {
+        char nome[40];
+        int parametro = c < 4 ? casos_k[c] : 0;
+        int repetido = 0;
+        for (i = 0; i < c && c < 4; i++) repetido |= (casos_k[i] == parametro);
+        if (c < 4 && (parametro < 1 || repetido)) continue;
+
+        for (r = 0; r < repeticoes; r++) {
+            int modo;
+            for (modo = 0; modo < 2; modo++) {
+                uint64_t t0, t1;
+                // A rotação da fila quase cheia precisa copiar; a da fila cheia só move os índices.
+                // Rotacionar por (n + 1) / 2 faz o intervalo dar a volta no array na maioria das vezes.
+                sortear_estado(&fila, &pilha, &g, c == 4 && MAX_FILA > 1 ? MAX_FILA - 1 : MAX_FILA, MAX_PILHA);
+                t0 = ler_ns();
+                if (c < 4) {
+                    // Trocar duas vezes volta ao estado inicial; cada troca conta
+                    if (modo == 0) for (k = 0; k < operacoes; k++) fila_trocar_pilha(&fila, &pilha, parametro);
+                    else for (k = 0; k < operacoes; k++) trocar_elementos(&fila, &pilha, parametro);
+                } else if (c < 6) {
+                    int passo = (fila.tamanho_atual + 1) / 2;
+                    if (modo == 0) for (k = 0; k < operacoes; k++) fila_rotacionar(&fila, passo);
+                    else for (k = 0; k < operacoes; k++) rotacionar_elementos(&fila, passo);
+                } else {
+                    if (modo == 0) for (k = 0; k < operacoes; k++) pilha_inverter(&pilha);
+                    else for (k = 0; k < operacoes; k++) inverter_elementos(&pilha);
+                }
+                t1 = ler_ns();
+                (modo == 0 ? ns_bloco : ns_elementos)[r] = (double)(t1 - t0) / operacoes;
+            }
+        }
+        qsort(ns_bloco, repeticoes, sizeof(double), comparar_double);
+        qsort(ns_elementos, repeticoes, sizeof(double), comparar_double);
+
+        if (c < 4) snprintf(nome, sizeof(nome), "troca k=%d", parametro);
+        else if (c == 4) snprintf(nome, sizeof(nome), "rotacao (%d pecas)", MAX_FILA - 1);
+        else if (c == 5) snprintf(nome, sizeof(nome), "rotacao (fila cheia)");
+        else snprintf(nome, sizeof(nome), "inversao (%d pecas)", MAX_PILHA);
+        if (json) {
+            printf("{\"operacao\":\"%s\",\"max_fila\":%d,\"max_pilha\":%d,\"ns_bloco\":%.2f,\"ns_elementos\":%.2f,"
+                   "\"aceleracao\":%.2f}\n", nome, MAX_FILA, MAX_PILHA, ns_bloco[repeticoes / 2],
+                   ns_elementos[repeticoes / 2], ns_elementos[repeticoes / 2] / ns_bloco[repeticoes / 2]);
+        } else {
+            printf("%-22s %12.2f %14.2f %9.2fx\n", nome, ns_bloco[repeticoes / 2], ns_elementos[repeticoes / 2],
+                   ns_elementos[repeticoes / 2] / ns_bloco[repeticoes / 2]);
+        }
+    }
+
+    if (json) {
+        printf("{\"divergencias\":%lld}\n", divergencias);
+    } else {
+        printf("Conferencia com os lacos peca a peca (%d operacoes aleatorias): %lld divergencias\n",
+               OPERACOES_CONFERENCIA, divergencias);
+    }
+    free(ns_bloco);
+    free(ns_elementos);
+    return divergencias ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+// Benchmark do checkpoint da tabela de sessões: pausa do corte (cópia só dos blocos
+// alterados) com uma parte das sessões alterada a cada intervalo, contra a cópia da tabela
+// inteira; tempo da gravação em fundo; e tempo para retomar a tabela de um arquivo
+// (mapear o slot) contra ler o slot inteiro com read(). Confere, sessão a sessão, que a
+// tabela retomada é igual à tabela do momento do último corte.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_checkpoint.c -o bench/bench_checkpoint
+// Execução:
+//   ./bench/bench_checkpoint [--json] [--sessoes N] [--cortes N] [--arquivo caminho] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: sessões na tabela e cortes medidos por fração de sessões alteradas
+#define SESSOES_PADRAO 1000000
+#define CORTES_PADRAO 9
+#define ARQUIVO_PADRAO "/tmp/bench_checkpoint.bin"
+
+// Frações das sessões alteradas entre dois cortes (em milésimos)
+static const int FRACOES_ALTERADAS[] = {1, 10, 100, 1000};
+#define NUM_FRACOES ((int)(sizeof(FRACOES_ALTERADAS) / sizeof(FRACOES_ALTERADAS[0])))
+
+/**
+ * @brief Compara uma sessão das duas tabelas, campo a campo.
+ */
+int mesma_sessao(const TabelaSessoes *a, const TabelaSessoes *b, int s) {
+    size_t f = (size_t)s * MAX_FILA, p = (size_t)s * MAX_PILHA;
+    return a->inicio[s] == b->inicio[s] && a->fim[s] == b->fim[s] && a->tamanho_atual[s] == b->tamanho_atual[s] &&
+           a->topo[s] == b->topo[s] && memcmp(a->fila_nome + f, b->fila_nome + f, MAX_FILA) == 0 &&
+           memcmp(a->fila_id + f, b->fila_id + f, MAX_FILA * sizeof(int)) == 0 &&
+           memcmp(a->pilha_nome + p, b->pilha_nome + p, MAX_PILHA) == 0 &&
+           memcmp(a->pilha_id + p, b->pilha_id + p, MAX_PILHA * sizeof(int)) == 0;
+}
+
+/**
+ * @brief Aplica uma ação aleatória (1 a 5) a 'quantidade' sessões aleatórias.
+ */
+void alterar_sessoes(TabelaSessoes *tabela, GeradorPecas *politica, int quantidade) {
+    int k;
+    for (k = 0; k < quantidade; k++) {
+        uint64_t x = gerador_proximo_u64(politica);
+        tabela_executar_opcao(tabela, (int)(x % tabela->quantidade), 1 + (int)((x >> 32) % 5));
+    }
+}
+
+/**
+ * @brief Copia a tabela inteira para 'copia' (o corte sem o controle de blocos alterados).
+ */
+void copiar_tabela(TabelaSessoes *tabela, unsigned char *copia) {
+    unsigned char *arrays[NUM_ARRAYS_CHECKPOINT];
+    int a;
+    tabela_arrays(tabela, arrays);
+    for (a = 0; a < NUM_ARRAYS_CHECKPOINT; a++) {
+        size_t bytes = (size_t)tabela->quantidade * BYTES_SESSAO_CHECKPOINT[a];
+        memcpy(copia, arrays[a], bytes);
+        copia += bytes;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int num_sessoes = SESSOES_PADRAO;
+    int cortes = CORTES_PADRAO;
+    const char *caminho = ARQUIVO_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    TabelaSessoes tabela, retomada, referencia;
+    GeradorPecas politica;
+    Checkpoint checkpoint;
+    RegistroCheckpoint registro;
+    unsigned char *copia;
+    double *us_corte, *us_cheia, *ms_gravacao;
+    double us_mapear = 0.0, us_ler = 0.0;
+    long long divergencias = 0;
+    int i, f, c, s;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            num_sessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cortes") == 0 && i + 1 < argc) {
+            cortes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--arquivo") == 0 && i + 1 < argc) {
+            caminho = argv[++i];
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--sessoes N] [--cortes N] [--arquivo caminho] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_sessoes < 1 || cortes < 1) {
+        fprintf(stderr, "ERRO: --sessoes e --cortes devem ser positivos.\n");
+        return 1;
+    }
+
+    us_corte = malloc(cortes * sizeof(double));
+    us_cheia = malloc(cortes * sizeof(double));
+    ms_gravacao = malloc(cortes * sizeof(double));
+    copia = malloc((size_t)num_sessoes * tabela_bytes_por_sessao());
+    if (us_corte == NULL || us_cheia == NULL || ms_gravacao == NULL || copia == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+
+    unlink(caminho);
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    gerador_inicializar(&politica, semente, 1, GERADOR_UNIFORME);
+    if (!criar_tabela_sessoes(&tabela, num_sessoes) || !checkpoint_abrir(&checkpoint, caminho, num_sessoes) ||
+        !checkpoint_iniciar(&checkpoint, &tabela)) {
+        fprintf(stderr, "ERRO: Nao foi possivel criar a tabela ou o checkpoint '%s'.\n", caminho);
+        return 1;
+    }
+    // Os dois primeiros cortes gravam a tabela inteira nos dois slots
+    checkpoint_cortar(&checkpoint, 0, 0);
+    checkpoint_esperar(&checkpoint);
+    checkpoint_cortar(&checkpoint, 0, 0);
+    checkpoint_esperar(&checkpoint);
+
+    if (!json) {
+        printf("%d sessoes (%.1f MiB na tabela), blocos de %d sessoes, mediana de %d cortes\n", num_sessoes,
+               num_sessoes * (double)tabela_bytes_por_sessao() / (1024.0 * 1024.0), SESSOES_POR_BLOCO_CHECKPOINT, cortes);
+        printf("%-10s %12s %14s %12s %14s\n", "alteradas", "corte us", "copia cheia us", "aceleracao", "gravacao ms");
+    }
+    for (f = 0; f < NUM_FRACOES; f++) {
+        int alteradas = (int)((long long)num_sessoes * FRACOES_ALTERADAS[f] / 1000);
+        if (alteradas < 1) alteradas = 1;
+        for (c = 0; c < cortes; c++) {
+            uint64_t t0, t1, gravacao_antes = checkpoint.ns_gravacao_total;
+
+            alterar_sessoes(&tabela, &politica, alteradas);
+            t0 = ler_ns();
+            checkpoint_cortar(&checkpoint, 0, 0);
+            t1 = ler_ns();
+            us_corte[c] = (t1 - t0) / 1e3;
+            checkpoint_esperar(&checkpoint);
+            ms_gravacao[c] = (checkpoint.ns_gravacao_total - gravacao_antes) / 1e6;
+
+            t0 = ler_ns();
+            copiar_tabela(&tabela, copia);
+            t1 = ler_ns();
+            us_cheia[c] = (t1 - t0) / 1e3;
+        }
+        qsort(us_corte, cortes, sizeof(double), comparar_double);
+        qsort(us_cheia, cortes, sizeof(double), comparar_double);
+        qsort(ms_gravacao, cortes, sizeof(double), comparar_double);
+        if (json) {
+            printf("{\"sessoes\":%d,\"alteradas\":%d,\"us_corte\":%.1f,\"us_copia_cheia\":%.1f,\"aceleracao\":%.2f,"
+                   "\"ms_gravacao\":%.2f}\n", num_sessoes, alteradas, us_corte[cortes / 2], us_cheia[cortes / 2],
+                   us_cheia[cortes / 2] / us_corte[cortes / 2], ms_gravacao[cortes / 2]);
+        } else {
+            printf("%-10d %12.1f %14.1f %11.2fx %14.2f\n", alteradas, us_corte[cortes / 2], us_cheia[cortes / 2],
+                   us_cheia[cortes / 2] / us_corte[cortes / 2], ms_gravacao[cortes / 2]);
+        }
+    }
+
+    // Retomada: o último corte já foi gravado; a tabela em memória é a referência
+    checkpoint_fechar(&checkpoint, 0, 0);
+    for (c = 0; c < 2; c++) {
+        Checkpoint leitura;
+        uint64_t t0, t1;
+        if (!checkpoint_abrir(&leitura, caminho, num_sessoes)) return 1;
+        t0 = ler_ns();
+        if (c == 0) {
+            // Mapear o slot mais novo
+            if (!checkpoint_retomar(&leitura, &retomada, &registro)) {
+                fprintf(stderr, "ERRO: O checkpoint '%s' nao tem um slot valido.\n", caminho);
+                return 1;
+            }
+        } else {
+            // Ler o slot inteiro para arrays próprios
+            CabecalhoCheckpoint *cab = leitura.cabecalho;
+            int slot = leitura.versao_slot[1] > leitura.versao_slot[0] ? 1 : 0;
+            off_t inicio = (off_t)(TAMANHO_CABECALHO_CHECKPOINT + (size_t)slot * cab->tamanho_slot);
+            unsigned char *arrays[NUM_ARRAYS_CHECKPOINT];
+            int a;
+            criar_tabela_sessoes(&referencia, num_sessoes);
+            tabela_arrays(&referencia, arrays);
+            for (a = 0; a < NUM_ARRAYS_CHECKPOINT; a++) {
+                size_t bytes = (size_t)num_sessoes * BYTES_SESSAO_CHECKPOINT[a];
+                if (pread(leitura.fd, arrays[a], bytes, inicio + (off_t)cab->deslocamentos[a]) != (ssize_t)bytes) {
+                    fprintf(stderr, "ERRO: Falha ao ler o checkpoint '%s'.\n", caminho);
+                    return 1;
+                }
+            }
+        }
+        t1 = ler_ns();
+        *(c == 0 ? &us_mapear : &us_ler) = (t1 - t0) / 1e3;
+        munmap(leitura.mapa, leitura.tamanho_mapa);
+        close(leitura.fd);
+    }
+    for (s = 0; s < num_sessoes; s++) {
+        divergencias += !mesma_sessao(&tabela, &retomada, s) + !mesma_sessao(&tabela, &referencia, s);
+    }
+
+    if (json) {
+        printf("{\"us_retomar_mapeando\":%.1f,\"us_retomar_lendo\":%.1f,\"divergencias\":%lld}\n", us_mapear, us_ler,
+               divergencias);
+    } else {
+        printf("Retomar: mapeando o slot %.1f us | lendo o slot inteiro %.1f us\n", us_mapear, us_ler);
+        printf("Tabela retomada igual a do ultimo corte, sessao a sessao: %s\n", divergencias ? "NAO" : "sim");
+    }
+
+    liberar_tabela_sessoes(&tabela);
+    liberar_tabela_sessoes(&retomada);
+    liberar_tabela_sessoes(&referencia);
+    unlink(caminho);
+    free(us_corte);
+    free(us_cheia);
+    free(ms_gravacao);
+    free(copia);
+    return divergencias ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+// Benchmark do estado compacto: memória por sessão, custo de codificar/decodificar/hash
+// e vazão das ações sobre uma população grande de sessões, comparando FilaCircular +
+// Pilha, a tabela SoA e o EstadoCompacto de 128 bits. As três formas devem terminar no
+// mesmo hash combinado.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_compacto.c -o bench/bench_compacto
+// Execução:
+//   ./bench/bench_compacto [--json] [--sessoes N] [--rodadas R] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: sessões da população e ações aplicadas a cada uma
+#define SESSOES_PADRAO (1 << 20)
+#define RODADAS_PADRAO 16
+
+/**
+ * @brief Forma de guardar as sessões medida em uma passada.
+ */
+typedef enum {
+    FORMA_ESTRUTURAS,  // Um FilaCircular e um Pilha por sessão
+    FORMA_TABELA,      // TabelaSessoes (structure of arrays)
+    FORMA_COMPACTA     // Um EstadoCompacto por sessão
+} FormaSessao;
+
+static const char *const NOMES_FORMA[] = {"estruturas", "tabela_soa", "compacto"};
+
+/**
+ * @brief Resultado de uma passada: ns por ação, hash combinado e bytes de estado por sessão.
+ */
+typedef struct {
+    double ns_por_acao;
+    uint64_t hash;
+    size_t bytes_por_sessao;
+} ResultadoCompacto;
+
+/**
+ * @brief Ação (1 a 5) da sessão s na rodada r: um hash fixo, igual para as três formas.
+ */
+int acao_da_rodada(int r, int s) {
+    uint64_t x = ((uint64_t)r << 32 | (uint32_t)s) * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 29;
+    return 1 + (int)(((x * 0xBF58476D1CE4E5B9ULL) >> 32) % 5);
+}
+
+/**
+ * @brief Cria a população, aplica 'rodadas' ações a cada sessão (rodada a rodada, em
+ * rodízio, como um servidor com muitos jogadores) e devolve o hash combinado.
+ * Cada sessão tem seu próprio gerador (fluxo s), guardado à parte nas três formas.
+ */
+ResultadoCompacto medir(FormaSessao forma, int num_sessoes, int rodadas, uint64_t semente) {
+    ResultadoCompacto resultado = {0.0, 0, 0};
+    GeradorPecas *geradores = malloc((size_t)num_sessoes * sizeof(GeradorPecas));
+    FilaCircular *filas = NULL;
+    Pilha *pilhas = NULL;
+    EstadoCompacto *compactos = NULL;
+    TabelaSessoes tabela;
+    FilaCircular fila;
+    Pilha pilha;
+    uint64_t t0, t1;
+    int r, s;
+
+    memset(&tabela, 0, sizeof(tabela));
+    if (forma == FORMA_ESTRUTURAS) {
+        filas = malloc((size_t)num_sessoes * sizeof(FilaCircular));
+        pilhas = malloc((size_t)num_sessoes * sizeof(Pilha));
+        resultado.bytes_por_sessao = sizeof(FilaCircular) + sizeof(Pilha);
+    } else if (forma == FORMA_COMPACTA) {
+        compactos = malloc((size_t)num_sessoes * sizeof(EstadoCompacto));
+        resultado.bytes_por_sessao = sizeof(EstadoCompacto);
+    } else {
+        resultado.bytes_por_sessao = tabela_bytes_por_sessao();
+    }
+    if (geradores == NULL || (forma == FORMA_ESTRUTURAS && (filas == NULL || pilhas == NULL)) ||
+        (forma == FORMA_COMPACTA && compactos == NULL)) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        exit(1);
+    }
+
+    // Estado inicial: cada sessão preenche a fila com o seu gerador
+    for (s = 0; s < num_sessoes; s++) {
+        gerador_inicializar(&geradores[s], semente, (uint64_t)s, GERADOR_UNIFORME);
+    }
+    if (forma == FORMA_TABELA) {
+        // criar_tabela_sessoes gera as filas com gerarPeca: troca o gerador ativo a cada sessão
+        if (!criar_tabela_sessoes(&tabela, num_sessoes)) {
+            fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+            exit(1);
+        }
+        for (s = 0; s < num_sessoes; s++) {
+            int k;
+            gerador_ativo = &geradores[s];
+            for (k = 0; k < MAX_FILA; k++) {
+                Peca p = gerarPeca();
+                tabela.fila_nome[(size_t)s * MAX_FILA + k] = p.nome;
+                tabela.fila_id[(size_t)s * MAX_FILA + k] = p.id;
+            }
+        }
+    } else {
+        for (s = 0; s < num_sessoes; s++) {
+            gerador_ativo = &geradores[s];
+            inicializar_fila(&fila);
+            inicializar_pilha(&pilha);
+            preencher_fila_inicial(&fila);
+            if (forma == FORMA_ESTRUTURAS) {
+                filas[s] = fila;
+                pilhas[s] = pilha;
+            } else {
+                compactar_estado(&fila, &pilha, geradores[s].proximo_id, &compactos[s]);
+            }
+        }
+    }
+
+    t0 = ler_ns();
+    for (r = 0; r < rodadas; r++) {
+        for (s = 0; s < num_sessoes; s++) {
+            int opcao = acao_da_rodada(r, s);
+            gerador_ativo = &geradores[s];
+            if (forma == FORMA_ESTRUTURAS) {
+                despachar_opcao(&filas[s], &pilhas[s], opcao);
+            } else if (forma == FORMA_TABELA) {
+                tabela_executar_opcao(&tabela, s, opcao);
+            } else {
+                compacto_executar_opcao(&compactos[s], opcao);
+            }
+        }
+    }
+    t1 = ler_ns();
+    resultado.ns_por_acao = (double)(t1 - t0) / ((double)rodadas * num_sessoes);
+
+    // Hash combinado, sempre sobre a forma completa (decodificada quando preciso)
+    for (s = 0; s < num_sessoes; s++) {
+        gerador_ativo = &geradores[s];
+        if (forma == FORMA_ESTRUTURAS) {
+            fila = filas[s];
+            pilha = pilhas[s];
+        } else if (forma == FORMA_TABELA) {
+            tabela_carregar_sessao(&tabela, s, &fila, &pilha);
+        } else if (!descompactar_estado(&compactos[s], &fila, &pilha)) {
+            fprintf(stderr, "AVISO: A sessao %d saturou uma idade.\n", s);
+        }
+        resultado.hash += hash_estado(&fila, &pilha) * (2 * (uint64_t)s + 1);
+    }
+    gerador_ativo = &gerador_padrao;
+
+    liberar_tabela_sessoes(&tabela);
+    free(filas);
+    free(pilhas);
+    free(compactos);
+    free(geradores);
+    return resultado;
+}
+
+/**
+ * @brief Mede codificar + decodificar e os dois hashes em estados de uma partida real.
+ * @param ns_codificar Recebe ns por compactar_estado + descompactar_estado.
+ * @param ns_hash Recebe ns por hash_estado.
+ * @param ns_hash_compacto Recebe ns por hash_compacto.
+ * @return int 1 se todos os estados voltaram idênticos, 0 caso contrário.
+ */
+int medir_codificacao(uint64_t semente, double *ns_codificar, double *ns_hash, double *ns_hash_compacto) {
+    enum { NUM_ESTADOS = 4096, REPETICOES = 256 };
+    FilaCircular *filas = malloc(NUM_ESTADOS * sizeof(FilaCircular));
+    Pilha *pilhas = malloc(NUM_ESTADOS * sizeof(Pilha));
+    EstadoCompacto *compactos = malloc(NUM_ESTADOS * sizeof(EstadoCompacto));
+    FilaCircular fila;
+    Pilha pilha;
+    uint64_t soma = 0, t0;
+    int ok = 1;
+    int k, r;
+
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+    for (k = 0; k < NUM_ESTADOS; k++) {
+        EstadoCompacto e, direto = {0, 0};
+        FilaCircular f;
+        Pilha p;
+        int opcao = acao_da_rodada(k, 0);
+        despachar_opcao(&fila, &pilha, opcao);
+        filas[k] = fila;
+        pilhas[k] = pilha;
+        compactos[k] = direto;
+        // O estado decodificado tem o mesmo hash, e recodificá-lo dá as mesmas palavras
+        compactar_estado(&fila, &pilha, gerador_padrao.proximo_id, &e);
+        descompactar_estado(&e, &f, &p);
+        compactar_estado(&f, &p, gerador_padrao.proximo_id, &direto);
+        if (hash_estado(&f, &p) != hash_estado(&fila, &pilha) || !compactos_iguais(&e, &direto)) ok = 0;
+        compactos[k] = e;
+    }
+
+    t0 = ler_ns();
+    for (r = 0; r < REPETICOES; r++) {
+        for (k = 0; k < NUM_ESTADOS; k++) {
+            EstadoCompacto e;
+            compactar_estado(&filas[k], &pilhas[k], gerador_padrao.proximo_id, &e);
+            descompactar_estado(&e, &fila, &pilha);
+            soma += (uint64_t)pilha.topo + (uint64_t)fila.itens[0].id;
+        }
+    }
+    *ns_codificar = (double)(ler_ns() - t0) / (REPETICOES * NUM_ESTADOS);
+
+    t0 = ler_ns();
+    for (r = 0; r < REPETICOES; r++) {
+        for (k = 0; k < NUM_ESTADOS; k++) soma += hash_estado(&filas[k], &pilhas[k]);
+    }
+    *ns_hash = (double)(ler_ns() - t0) / (REPETICOES * NUM_ESTADOS);
+
+    t0 = ler_ns();
+    for (r = 0; r < REPETICOES; r++) {
+        for (k = 0; k < NUM_ESTADOS; k++) soma += hash_compacto(&compactos[k]);
+    }
+    *ns_hash_compacto = (double)(ler_ns() - t0) / (REPETICOES * NUM_ESTADOS);
+
+    if (soma == 42) printf(" "); // Impede que o compilador descarte os laços medidos
+    free(filas);
+    free(pilhas);
+    free(compactos);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int num_sessoes = SESSOES_PADRAO;
+    int rodadas = RODADAS_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    ResultadoCompacto resultados[3];
+    double ns_codificar, ns_hash, ns_hash_compacto;
+    int codificacao_ok, iguais;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            num_sessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rodadas") == 0 && i + 1 < argc) {
+            rodadas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--sessoes N] [--rodadas R] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_sessoes < 1 || rodadas < 1) {
+        fprintf(stderr, "ERRO: --sessoes e --rodadas devem ser positivos.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    codificacao_ok = medir_codificacao(semente, &ns_codificar, &ns_hash, &ns_hash_compacto);
+    for (i = 0; i < 3; i++) {
+        resultados[i] = medir((FormaSessao)i, num_sessoes, rodadas, semente);
+    }
+    modo_silencioso = 0;
+    iguais = resultados[1].hash == resultados[0].hash && resultados[2].hash == resultados[0].hash;
+
+    if (json) {
+        printf("{\"sessoes\":%d,\"rodadas\":%d,\"ns_codificar_decodificar\":%.2f,\"ns_hash_estado\":%.2f,"
+               "\"ns_hash_compacto\":%.2f,\"formas\":[", num_sessoes, rodadas, ns_codificar, ns_hash, ns_hash_compacto);
+        for (i = 0; i < 3; i++) {
+            printf("%s{\"forma\":\"%s\",\"bytes_por_sessao\":%zu,\"ns_por_acao\":%.2f,\"hash\":\"%016llx\"}",
+                   i ? "," : "", NOMES_FORMA[i], resultados[i].bytes_por_sessao, resultados[i].ns_por_acao,
+                   (unsigned long long)resultados[i].hash);
+        }
+        printf("],\"identicos\":%s}\n", codificacao_ok && iguais ? "true" : "false");
+    } else {
+        printf("Codificar + decodificar: %.2f ns | hash_estado: %.2f ns | hash_compacto: %.2f ns\n",
+               ns_codificar, ns_hash, ns_hash_compacto);
+        printf("%d sessoes x %d acoes em rodizio (cada sessao com gerador proprio):\n", num_sessoes, rodadas);
+        printf("%-12s %10s %12s %10s   %s\n", "forma", "bytes", "MB (estado)", "ns/acao", "hash");
+        for (i = 0; i < 3; i++) {
+            printf("%-12s %10zu %12.1f %10.2f   %016llx\n", NOMES_FORMA[i], resultados[i].bytes_por_sessao,
+                   resultados[i].bytes_por_sessao * (double)num_sessoes / 1e6, resultados[i].ns_por_acao,
+                   (unsigned long long)resultados[i].hash);
+        }
+        printf("Estados identicos nas tres formas: %s\n", codificacao_ok && iguais ? "sim" : "NAO");
+    }
+    return codificacao_ok && iguais ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// Benchmark das sessões em corrotinas: custo de uma troca de contexto (swapcontext) contra
+// a passagem de vez entre duas threads (mutex + variável de condição), memória por sessão
+// suspensa (registro + páginas de pilha tocadas), e vazão/latência do agendador com N
+// sessões esperando comandos. Confere que o resultado das sessões é o mesmo do simulador.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_corrotinas.c -o bench/bench_corrotinas
+// Execução:
+//   ./bench/bench_corrotinas [--json] [--sessoes N] [--acoes M] [--threads T] [--trocas N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: sessões, ações por sessão, threads do agendador e trocas medidas
+#define SESSOES_PADRAO 10000
+#define ACOES_PADRAO 100
+#define TROCAS_PADRAO 1000000
+
+// --- Troca de contexto entre a thread e uma corrotina ---
+
+ucontext_t contexto_principal, contexto_eco;
+long long trocas_eco;
+
+/**
+ * @brief Corrotina que só devolve o controle, 'trocas_eco' vezes.
+ */
+void corrotina_eco() {
+    long long k;
+    for (k = 0; k < trocas_eco; k++) swapcontext(&contexto_eco, &contexto_principal);
+}
+
+/**
+ * @brief ns por troca (ida ou volta) entre a thread e uma corrotina.
+ */
+double medir_swapcontext(long long trocas) {
+    static unsigned char pilha[TAMANHO_PILHA_CORROTINA];
+    uint64_t t0, t1;
+    long long k;
+
+    trocas_eco = trocas;
+    getcontext(&contexto_eco);
+    contexto_eco.uc_stack.ss_sp = pilha;
+    contexto_eco.uc_stack.ss_size = sizeof(pilha);
+    contexto_eco.uc_link = &contexto_principal;
+    makecontext(&contexto_eco, corrotina_eco, 0);
+    t0 = ler_ns();
+    for (k = 0; k <= trocas; k++) swapcontext(&contexto_principal, &contexto_eco);
+    t1 = ler_ns();
+    return (double)(t1 - t0) / (2.0 * trocas);
+}
+
+// --- Passagem de vez entre duas threads ---
+
+typedef struct {
+    pthread_mutex_t trava;
+    pthread_cond_t sinal;
+    int vez;          // 0: thread principal; 1: a outra
+    long long trocas;
+} PingPong;
+
+/**
+ * @brief Thread que espera a vez, devolve a vez, 'trocas' vezes.
+ */
+void *thread_eco(void *arg) {
+    PingPong *p = arg;
+    long long k;
+    pthread_mutex_lock(&p->trava);
+    for (k = 0; k < p->trocas; k++) {
+        while (p->vez != 1) pthread_cond_wait(&p->sinal, &p->trava);
+        p->vez = 0;
+        pthread_cond_signal(&p->sinal);
+    }
+    pthread_mutex_unlock(&p->trava);
+    return NULL;
+}
+
+/**
+ * @brief ns por passagem de vez (ida ou volta) entre duas threads.
+ */
+double medir_threads(long long trocas) {
+    PingPong p;
+    pthread_t outra;
+    uint64_t t0, t1;
+    long long k;
+
+    pthread_mutex_init(&p.trava, NULL);
+    pthread_cond_init(&p.sinal, NULL);
+    p.vez = 0;
+    p.trocas = trocas;
+    pthread_create(&outra, NULL, thread_eco, &p);
+    t0 = ler_ns();
+    pthread_mutex_lock(&p.trava);
+    for (k = 0; k < trocas; k++) {
+        p.vez = 1;
+        pthread_cond_signal(&p.sinal);
+        while (p.vez != 0) pthread_cond_wait(&p.sinal, &p.trava);
+    }
+    pthread_mutex_unlock(&p.trava);
+    t1 = ler_ns();
+    pthread_join(outra, NULL);
+    pthread_mutex_destroy(&p.trava);
+    pthread_cond_destroy(&p.sinal);
+    return (double)(t1 - t0) / (2.0 * trocas);
+}
+
+int main(int argc, char *argv[]) {
+    ConfigSimulacao config = {SESSOES_PADRAO, ACOES_PADRAO, 2024, GERADOR_UNIFORME, {1, 1, 1, 1, 1}, 2, 0};
+    long long trocas = TROCAS_PADRAO;
+    int json = 0;
+    PoolCorrotinas pool;
+    Simulador simulador;
+    EstatisticasSimulacao total, referencia;
+    GeradorPecas *politicas;
+    double ns_swap, ns_threads, ns_comando;
+    size_t pilha_residente = 0;
+    uint64_t t0, t1;
+    long long rodada;
+    int i, k, suspensas;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            config.num_sessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--acoes") == 0 && i + 1 < argc) {
+            config.acoes_por_sessao = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trocas") == 0 && i + 1 < argc) {
+            trocas = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            config.semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--sessoes N] [--acoes M] [--threads T] [--trocas N] [--semente N]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (config.num_sessoes < 1 || config.acoes_por_sessao < 1 || config.num_threads < 1 ||
+        config.num_threads > MAX_THREADS_SIMULACAO || trocas < 1) {
+        fprintf(stderr, "ERRO: --sessoes, --acoes, --threads e --trocas devem ser positivos.\n");
+        return 1;
+    }
+
+    // 1. Trocas de contexto
+    ns_swap = medir_swapcontext(trocas);
+    ns_threads = medir_threads(trocas / 10 + 1);
+
+    // 2. Referência: as mesmas sessões no simulador, sem corrotinas
+    memset(&simulador, 0, sizeof(simulador));
+    memset(&referencia, 0, sizeof(referencia));
+    simulador_preparar_pesos(&simulador, &config);
+    modo_silencioso = 1;
+    for (i = 0; i < config.num_sessoes; i++) simular_sessao(&simulador, i, &referencia);
+
+    // 3. O agendador: primeiro todas as sessões chegam à espera do primeiro comando
+    politicas = malloc(config.num_sessoes * sizeof(GeradorPecas));
+    if (politicas == NULL || !pool_corrotinas_iniciar(&pool, &config, 0)) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+    for (i = 0; i < config.num_sessoes; i++) {
+        gerador_inicializar(&politicas[i], config.semente, 2 * (uint64_t)i + 3, GERADOR_UNIFORME);
+    }
+    do {
+        sched_yield();
+        for (i = suspensas = 0; i < config.num_sessoes; i++) {
+            suspensas += !atomic_load(&pool_corrotinas_sessao(&pool, i)->na_fila);
+        }
+    } while (suspensas < config.num_sessoes);
+    for (k = 0; k < pool.num_agendadores; k++) pilha_residente += agendador_bytes_pilha_residentes(&pool.agendadores[k]);
+
+    t0 = ler_ns();
+    for (rodada = 0; rodada <= config.acoes_por_sessao; rodada++) {
+        for (i = 0; i < config.num_sessoes; i++) {
+            int opcao = rodada < config.acoes_por_sessao ? sortear_opcao(&pool.simulador, &politicas[i]) : 0;
+            pool_corrotinas_enviar(&pool, i, (int8_t)opcao);
+        }
+    }
+    pool_corrotinas_encerrar(&pool, &total, json ? NULL : stdout);
+    t1 = ler_ns();
+    modo_silencioso = 0;
+    ns_comando = (double)(t1 - t0) / ((double)config.num_sessoes * (config.acoes_por_sessao + 1));
+
+    {
+        int iguais = total.hash == referencia.hash && total.pecas_geradas == referencia.pecas_geradas &&
+                     total.descartes == referencia.descartes &&
+                     memcmp(total.acoes, referencia.acoes, sizeof(total.acoes)) == 0 &&
+                     memcmp(total.rejeitadas, referencia.rejeitadas, sizeof(total.rejeitadas)) == 0;
+        double bytes_sessao = sizeof(SessaoCorrotina) + (double)pilha_residente / config.num_sessoes;
+
+        if (json) {
+            printf("{\"ns_swapcontext\":%.1f,\"ns_troca_threads\":%.1f,\"sessoes\":%d,\"acoes\":%lld,\"threads\":%d,"
+                   "\"ns_por_comando\":%.1f,\"bytes_por_sessao_suspensa\":%.0f,\"bytes_registro\":%zu,"
+                   "\"bytes_pilha_reservados\":%d,\"iguais\":%s}\n",
+                   ns_swap, ns_threads, config.num_sessoes, config.acoes_por_sessao, pool.num_agendadores, ns_comando,
+                   bytes_sessao, sizeof(SessaoCorrotina), TAMANHO_PILHA_CORROTINA, iguais ? "true" : "false");
+        } else {
+            printf("Troca de contexto: swapcontext %.1f ns | entre threads (mutex + cond) %.1f ns (%.1fx)\n",
+                   ns_swap, ns_threads, ns_threads / ns_swap);
+            printf("%d sessoes suspensas: %.0f bytes por sessao (%zu de registro + %.0f de pilha tocada)\n",
+                   config.num_sessoes, bytes_sessao, sizeof(SessaoCorrotina),
+                   (double)pilha_residente / config.num_sessoes);
+            printf("Agendador: %.1f ns por comando (%lld comandos por sessao, %d threads)\n", ns_comando,
+                   config.acoes_por_sessao + 1, pool.num_agendadores);
+            printf("Resultado igual ao do simulador: %s\n", iguais ? "sim" : "NAO");
+        }
+        free(politicas);
+        return iguais ? 0 : 1;
+    }
+}
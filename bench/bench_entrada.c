@@ -0,0 +1,248 @@
+// Benchmark da entrada do loop interativo: o loop antigo (scanf("%d") + limpar_buffer())
+// contra o LeitorComandos (read() em blocos, com e sem o caminho rápido SSE2), sobre um
+// arquivo de comandos gerado (100 MiB por padrão) com alguns formatos fora do comum
+// (espaços, sinais, vários dígitos, lixo e linhas vazias). Mede só a leitura e o loop
+// completo (leitura + executar_opcao) e confere que as três leituras veem a mesma
+// sequência de resultados e chegam ao mesmo estado final.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_entrada.c -o bench/bench_entrada
+// Execução:
+//   ./bench/bench_entrada [--json] [--megabytes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Tamanho padrão do arquivo de comandos, em MiB
+#define MEGABYTES_PADRAO 100
+
+// Linhas fora do formato "d\n" (uma a cada N, em média)
+#define LINHAS_RARAS 32
+
+static const char *const LINHAS_INCOMUNS[] = {
+    "  3\n", "+4\n", "-0002\n", "12\n", "x\n", "\n", "5 resto da linha\n", "-\n", "\t1\t\n", "abc 2\n",
+};
+#define NUM_INCOMUNS ((int)(sizeof(LINHAS_INCOMUNS) / sizeof(LINHAS_INCOMUNS[0])))
+
+/**
+ * @brief O que uma leitura viu: comandos, falhas e uma soma de verificação da sequência.
+ */
+typedef struct {
+    long long numeros;
+    long long falhas;
+    uint64_t sequencia;
+    uint64_t hash_final;
+    double segundos;
+} ResultadoEntrada;
+
+/**
+ * @brief Acrescenta um evento (número lido ou falha) à soma de verificação.
+ */
+uint64_t anotar(uint64_t h, int lido, int opcao) {
+    return (h ^ (uint64_t)(lido ? (uint32_t)opcao : 0xFFFFFFFFu)) * 1099511628211ULL;
+}
+
+/**
+ * @brief Gera o arquivo de comandos (termina com "0\n", já que o loop antigo só para na opção 0).
+ * @return int 1 em caso de sucesso, 0 em caso de erro.
+ */
+int gerar_arquivo(const char *caminho, long long bytes, uint64_t semente) {
+    GeradorPecas aleatorio;
+    FILE *f = fopen(caminho, "wb");
+    char *bloco = malloc(1 << 20);
+    size_t n = 0;
+    long long escritos = 0;
+
+    if (f == NULL || bloco == NULL) {
+        if (f != NULL) fclose(f);
+        free(bloco);
+        return 0;
+    }
+    gerador_inicializar(&aleatorio, semente, 7, GERADOR_UNIFORME);
+    while (escritos < bytes) {
+        uint64_t r = gerador_proximo_u64(&aleatorio);
+        if (r % LINHAS_RARAS == 0) {
+            const char *linha = LINHAS_INCOMUNS[(r >> 8) % NUM_INCOMUNS];
+            size_t tamanho = strlen(linha);
+            memcpy(bloco + n, linha, tamanho);
+            n += tamanho;
+        } else {
+            bloco[n++] = (char)('1' + (r >> 8) % 5);
+            bloco[n++] = '\n';
+        }
+        if (n > (1 << 20) - 64) {
+            fwrite(bloco, 1, n, f);
+            escritos += (long long)n;
+            n = 0;
+        }
+    }
+    memcpy(bloco + n, "0\n", 2);
+    fwrite(bloco, 1, n + 2, f);
+    free(bloco);
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Prepara uma sessão nova com o mesmo gerador, para os loops completos.
+ */
+void nova_sessao(FilaCircular *fila, Pilha *pilha, uint64_t semente) {
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    inicializar_fila(fila);
+    inicializar_pilha(pilha);
+    preencher_fila_inicial(fila);
+}
+
+/**
+ * @brief O loop antigo: scanf("%d") + limpar_buffer(), lendo o arquivo pela stdin.
+ * @param executar 0 para só ler, 1 para também executar cada opção.
+ */
+ResultadoEntrada medir_scanf(const char *caminho, int executar, uint64_t semente) {
+    ResultadoEntrada r = {0, 0, 0, 0, 0.0};
+    FilaCircular fila;
+    Pilha pilha;
+    int opcao = -1;
+    uint64_t t0;
+
+    if (freopen(caminho, "rb", stdin) == NULL) {
+        fprintf(stderr, "ERRO: Nao foi possivel abrir '%s'.\n", caminho);
+        exit(1);
+    }
+    nova_sessao(&fila, &pilha, semente);
+    t0 = ler_ns();
+    while (opcao != 0) {
+        if (scanf("%d", &opcao) != 1) {
+            r.falhas++;
+            r.sequencia = anotar(r.sequencia, 0, 0);
+            limpar_buffer();
+            opcao = -1;
+            continue;
+        }
+        limpar_buffer();
+        r.numeros++;
+        r.sequencia = anotar(r.sequencia, 1, opcao);
+        if (executar) executar_opcao(&fila, &pilha, opcao);
+    }
+    r.segundos = (ler_ns() - t0) / 1e9;
+    r.hash_final = hash_estado(&fila, &pilha);
+    return r;
+}
+
+/**
+ * @brief O loop novo: LeitorComandos sobre o descritor do arquivo.
+ * @param executar 0 para só ler, 1 para também executar cada opção.
+ * @param usar_simd 0 para forçar o caminho rápido escalar.
+ */
+ResultadoEntrada medir_leitor(const char *caminho, int executar, int usar_simd, uint64_t semente) {
+    ResultadoEntrada r = {0, 0, 0, 0, 0.0};
+    LeitorComandos leitor;
+    FilaCircular fila;
+    Pilha pilha;
+    int opcao = -1;
+    uint64_t t0;
+    int fd = open(caminho, O_RDONLY);
+
+    if (fd < 0 || !leitor_criar(&leitor, fd)) {
+        fprintf(stderr, "ERRO: Nao foi possivel abrir '%s'.\n", caminho);
+        exit(1);
+    }
+    leitor.usar_simd = usar_simd;
+    nova_sessao(&fila, &pilha, semente);
+    t0 = ler_ns();
+    while (opcao != 0) {
+        if (leitor_proxima_opcao(&leitor, &opcao) != 1) {
+            r.falhas++;
+            r.sequencia = anotar(r.sequencia, 0, 0);
+            opcao = -1;
+            continue;
+        }
+        r.numeros++;
+        r.sequencia = anotar(r.sequencia, 1, opcao);
+        if (executar) executar_opcao(&fila, &pilha, opcao);
+    }
+    r.segundos = (ler_ns() - t0) / 1e9;
+    r.hash_final = hash_estado(&fila, &pilha);
+    leitor_liberar(&leitor);
+    close(fd);
+    return r;
+}
+
+/**
+ * @brief Imprime uma linha de resultado (texto ou JSON).
+ */
+void imprimir(const char *caso, const char *modo, ResultadoEntrada r, double megabytes, int json) {
+    if (json) {
+        printf("{\"caso\":\"%s\",\"modo\":\"%s\",\"segundos\":%.3f,\"mb_por_s\":%.1f,\"ns_por_comando\":%.2f,"
+               "\"numeros\":%lld,\"falhas\":%lld,\"sequencia\":\"%016llx\",\"hash\":\"%016llx\"}\n",
+               caso, modo, r.segundos, megabytes / r.segundos, r.segundos * 1e9 / (r.numeros + r.falhas),
+               r.numeros, r.falhas, (unsigned long long)r.sequencia, (unsigned long long)r.hash_final);
+    } else {
+        printf("%-14s %-14s %8.3f %10.1f %10.2f   %016llx\n", caso, modo, r.segundos, megabytes / r.segundos,
+               r.segundos * 1e9 / (r.numeros + r.falhas), (unsigned long long)r.sequencia);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long long megabytes = MEGABYTES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    char caminho[] = "/tmp/bench_entrada_XXXXXX";
+    ResultadoEntrada r[6];
+    int iguais = 1;
+    int fd, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--megabytes") == 0 && i + 1 < argc) {
+            megabytes = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--megabytes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (megabytes < 1) {
+        fprintf(stderr, "ERRO: --megabytes deve ser positivo.\n");
+        return 1;
+    }
+
+    fd = mkstemp(caminho);
+    if (fd < 0 || !gerar_arquivo(caminho, megabytes << 20, semente)) {
+        fprintf(stderr, "ERRO: Nao foi possivel gerar o arquivo de comandos.\n");
+        return 1;
+    }
+    close(fd);
+
+    modo_silencioso = 1;
+    r[0] = medir_scanf(caminho, 0, semente);
+    r[1] = medir_leitor(caminho, 0, 0, semente);
+    r[2] = medir_leitor(caminho, 0, 1, semente);
+    r[3] = medir_scanf(caminho, 1, semente);
+    r[4] = medir_leitor(caminho, 1, 0, semente);
+    r[5] = medir_leitor(caminho, 1, 1, semente);
+    modo_silencioso = 0;
+    unlink(caminho);
+
+    for (i = 1; i < 6; i++) {
+        iguais &= (r[i].sequencia == r[0].sequencia && r[i].numeros == r[0].numeros && r[i].falhas == r[0].falhas);
+    }
+    iguais &= (r[4].hash_final == r[3].hash_final && r[5].hash_final == r[3].hash_final);
+
+    if (!json) {
+        printf("Arquivo de %lld MiB: %lld numeros, %lld entradas invalidas\n", megabytes, r[0].numeros, r[0].falhas);
+        printf("%-14s %-14s %8s %10s %10s   %s\n", "caso", "modo", "s", "MiB/s", "ns/cmd", "sequencia");
+    }
+    imprimir("so leitura", "scanf", r[0], (double)megabytes, json);
+    imprimir("so leitura", "read+escalar", r[1], (double)megabytes, json);
+    imprimir("so leitura", "read+sse2", r[2], (double)megabytes, json);
+    imprimir("loop completo", "scanf", r[3], (double)megabytes, json);
+    imprimir("loop completo", "read+escalar", r[4], (double)megabytes, json);
+    imprimir("loop completo", "read+sse2", r[5], (double)megabytes, json);
+    if (!json) {
+        printf("Speedup (so leitura): %.1fx | Speedup (loop completo): %.1fx\n",
+               r[0].segundos / r[2].segundos, r[3].segundos / r[5].segundos);
+        printf("Mesma sequencia e mesmo estado final nos tres modos: %s\n", iguais ? "sim" : "NAO");
+    }
+    return iguais ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+// Microbenchmarks das estruturas (fila circular e pilha) e das ações de troca.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_estruturas.c -o bench/bench_estruturas
+// Execução:
+//   ./bench/bench_estruturas                 (tabela legível)
+//   ./bench/bench_estruturas --json          (uma linha JSON por caso, para comparação automática)
+//   ./bench/bench_estruturas --csv           (CSV com cabeçalho)
+//   ./bench/bench_estruturas --repeticoes 201 --lote 20000
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Número padrão de repetições de cada caso (a mediana e o p99 são calculados sobre elas)
+#define REPETICOES_PADRAO 101
+// Número padrão de operações por repetição
+#define LOTE_PADRAO 10000
+
+// Evita que o compilador descarte os resultados das operações medidas
+volatile int sumidouro;
+
+// Impede que o compilador mova acessos à memória através deste ponto
+#define BARREIRA() __asm__ volatile("" ::: "memory")
+
+/**
+ * @brief Formatos de saída do benchmark.
+ */
+typedef enum {
+    SAIDA_TEXTO,
+    SAIDA_JSON,
+    SAIDA_CSV
+} FormatoSaida;
+
+/**
+ * @brief Contexto compartilhado pelos casos: estruturas já preparadas e ações sorteadas.
+ */
+typedef struct {
+    FilaCircular fila;
+    Pilha pilha;
+    Peca peca;
+    int *acoes;      // Códigos de ação (1 a 5) sorteados para as misturas aleatórias
+    int num_acoes;
+    int cursor;      // Próxima ação a consumir de 'acoes'
+} ContextoBench;
+
+/**
+ * @brief Um caso de benchmark: prepara o estado e executa 'lote' operações.
+ */
+typedef struct {
+    const char *nome;
+    void (*preparar)(ContextoBench *ctx);
+    void (*executar)(ContextoBench *ctx, int lote);
+} CasoBench;
+
+// --- Preparação dos estados ---
+
+void preparar_cheia(ContextoBench *ctx) {
+    inicializar_fila(&ctx->fila);
+    inicializar_pilha(&ctx->pilha);
+    preencher_fila_inicial(&ctx->fila);
+    // Pilha com uma peça: troca simples possível, push e pop não saturam
+    push(&ctx->pilha, gerarPeca());
+    ctx->peca = gerarPeca();
+}
+
+void preparar_pilha_cheia(ContextoBench *ctx) {
+    preparar_cheia(ctx);
+    while (!pilha_cheia(&ctx->pilha)) {
+        push(&ctx->pilha, gerarPeca());
+    }
+}
+
+void preparar_vazias(ContextoBench *ctx) {
+    inicializar_fila(&ctx->fila);
+    inicializar_pilha(&ctx->pilha);
+    ctx->peca = gerarPeca();
+}
+
+void preparar_fila_cheia_pilha_vazia(ContextoBench *ctx) {
+    inicializar_fila(&ctx->fila);
+    inicializar_pilha(&ctx->pilha);
+    preencher_fila_inicial(&ctx->fila);
+    ctx->peca = gerarPeca();
+}
+
+// --- Casos em regime permanente ---
+// Cada operação é seguida do ajuste mínimo do contador que a desfaz (uma instrução),
+// para que o estado fique estável sem medir também a operação inversa.
+
+void executar_enqueue(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        ctx->fila.tamanho_atual = MAX_FILA - 1; // Há sempre uma vaga; 'fim' gira pela fila
+        sumidouro = enqueue(&ctx->fila, ctx->peca);
+        BARREIRA();
+    }
+}
+
+void executar_dequeue(ContextoBench *ctx, int lote) {
+    Peca removida;
+    int i;
+    for (i = 0; i < lote; i++) {
+        ctx->fila.tamanho_atual = MAX_FILA; // Fila sempre cheia; 'inicio' gira pela fila
+        sumidouro = dequeue(&ctx->fila, &removida);
+        BARREIRA();
+    }
+}
+
+void executar_frente_da_fila(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = frente_da_fila(&ctx->fila).id;
+        BARREIRA();
+    }
+}
+
+void executar_push(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        ctx->pilha.topo = MAX_PILHA - 2; // Há sempre uma vaga no topo
+        sumidouro = push(&ctx->pilha, ctx->peca);
+        BARREIRA();
+    }
+}
+
+void executar_pop(ContextoBench *ctx, int lote) {
+    Peca removida;
+    int i;
+    for (i = 0; i < lote; i++) {
+        ctx->pilha.topo = 0; // Sempre uma peça no topo
+        sumidouro = pop(&ctx->pilha, &removida);
+        BARREIRA();
+    }
+}
+
+void executar_topo_da_pilha(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = topo_da_pilha(&ctx->pilha).id;
+        BARREIRA();
+    }
+}
+
+void executar_troca_simples(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        acao_troca_simples(&ctx->fila, &ctx->pilha);
+        BARREIRA();
+    }
+}
+
+void executar_troca_multipla(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        acao_troca_multipla(&ctx->fila, &ctx->pilha);
+        BARREIRA();
+    }
+}
+
+// --- Casos de borda (fila/pilha cheia ou vazia) ---
+// O estado de borda é fixo: a operação falha e não altera nada.
+
+void executar_enqueue_cheia(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = enqueue(&ctx->fila, ctx->peca);
+        BARREIRA();
+    }
+}
+
+void executar_dequeue_vazia(ContextoBench *ctx, int lote) {
+    Peca removida;
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = dequeue(&ctx->fila, &removida);
+        BARREIRA();
+    }
+}
+
+void executar_push_cheia(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = push(&ctx->pilha, ctx->peca);
+        BARREIRA();
+    }
+}
+
+void executar_pop_vazia(ContextoBench *ctx, int lote) {
+    Peca removida;
+    int i;
+    for (i = 0; i < lote; i++) {
+        sumidouro = pop(&ctx->pilha, &removida);
+        BARREIRA();
+    }
+}
+
+// --- Misturas aleatórias de ações ---
+
+void executar_mistura(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        executar_opcao(&ctx->fila, &ctx->pilha, ctx->acoes[ctx->cursor]);
+        if (++ctx->cursor == ctx->num_acoes) ctx->cursor = 0;
+        BARREIRA();
+    }
+}
+
+void executar_mistura_trocas(ContextoBench *ctx, int lote) {
+    int i;
+    for (i = 0; i < lote; i++) {
+        // Só as duas trocas, sorteadas a partir da mesma sequência
+        if (ctx->acoes[ctx->cursor] & 1) {
+            acao_troca_simples(&ctx->fila, &ctx->pilha);
+        } else {
+            acao_troca_multipla(&ctx->fila, &ctx->pilha);
+        }
+        if (++ctx->cursor == ctx->num_acoes) ctx->cursor = 0;
+        BARREIRA();
+    }
+}
+
+/**
+ * @brief Mede um caso: 'repeticoes' medições de 'lote' operações cada, e imprime
+ * a mediana e o p99 de ns/op e ciclos/op no formato pedido.
+ */
+void medir_caso(CasoBench *caso, ContextoBench *ctx, int repeticoes, int lote, FormatoSaida formato) {
+    double *ns_op = malloc(repeticoes * sizeof(double));
+    double *ciclos_op = malloc(repeticoes * sizeof(double));
+    int r;
+    int indice_p99 = (int)(0.99 * (repeticoes - 1) + 0.5);
+
+    caso->preparar(ctx);
+    caso->executar(ctx, lote); // Aquecimento (caches e preditor de desvios)
+
+    for (r = 0; r < repeticoes; r++) {
+        uint64_t t0, t1, c0, c1;
+        caso->preparar(ctx);
+        t0 = ler_ns();
+        c0 = ler_ciclos();
+        caso->executar(ctx, lote);
+        c1 = ler_ciclos();
+        t1 = ler_ns();
+        ns_op[r] = (double)(t1 - t0) / lote;
+        ciclos_op[r] = (double)(c1 - c0) / lote;
+    }
+
+    qsort(ns_op, repeticoes, sizeof(double), comparar_double);
+    qsort(ciclos_op, repeticoes, sizeof(double), comparar_double);
+
+    switch (formato) {
+        case SAIDA_TEXTO:
+            printf("%-28s %10.2f %10.2f %12.2f %12.2f\n", caso->nome,
+                   ns_op[repeticoes / 2], ns_op[indice_p99],
+                   ciclos_op[repeticoes / 2], ciclos_op[indice_p99]);
+            break;
+        case SAIDA_JSON:
+            printf("{\"caso\":\"%s\",\"max_fila\":%d,\"max_pilha\":%d,\"lote\":%d,\"repeticoes\":%d,"
+                   "\"ns_op_mediana\":%.3f,\"ns_op_p99\":%.3f,\"ciclos_op_mediana\":%.3f,\"ciclos_op_p99\":%.3f}\n",
+                   caso->nome, MAX_FILA, MAX_PILHA, lote, repeticoes,
+                   ns_op[repeticoes / 2], ns_op[indice_p99],
+                   ciclos_op[repeticoes / 2], ciclos_op[indice_p99]);
+            break;
+        case SAIDA_CSV:
+            printf("%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f\n", caso->nome, MAX_FILA, MAX_PILHA, lote, repeticoes,
+                   ns_op[repeticoes / 2], ns_op[indice_p99],
+                   ciclos_op[repeticoes / 2], ciclos_op[indice_p99]);
+            break;
+    }
+
+    free(ns_op);
+    free(ciclos_op);
+}
+
+int main(int argc, char *argv[]) {
+    CasoBench casos[] = {
+        {"enqueue",                 preparar_cheia,                  executar_enqueue},
+        {"dequeue",                 preparar_cheia,                  executar_dequeue},
+        {"frente_da_fila",          preparar_cheia,                  executar_frente_da_fila},
+        {"push",                    preparar_cheia,                  executar_push},
+        {"pop",                     preparar_cheia,                  executar_pop},
+        {"topo_da_pilha",           preparar_cheia,                  executar_topo_da_pilha},
+        {"acao_troca_simples",      preparar_cheia,                  executar_troca_simples},
+        {"acao_troca_multipla",     preparar_pilha_cheia,            executar_troca_multipla},
+        {"enqueue/fila_cheia",      preparar_cheia,                  executar_enqueue_cheia},
+        {"dequeue/fila_vazia",      preparar_vazias,                 executar_dequeue_vazia},
+        {"frente_da_fila/vazia",    preparar_vazias,                 executar_frente_da_fila},
+        {"push/pilha_cheia",        preparar_pilha_cheia,            executar_push_cheia},
+        {"pop/pilha_vazia",         preparar_vazias,                 executar_pop_vazia},
+        {"topo_da_pilha/vazia",     preparar_vazias,                 executar_topo_da_pilha},
+        {"troca_simples/pilha_vazia", preparar_fila_cheia_pilha_vazia, executar_troca_simples},
+        {"troca_multipla/pilha_curta", preparar_cheia,               executar_troca_multipla},
+        {"mistura/acoes_1a5",       preparar_cheia,                  executar_mistura},
+        {"mistura/trocas",          preparar_pilha_cheia,            executar_mistura_trocas},
+    };
+    int num_casos = sizeof(casos) / sizeof(casos[0]);
+    int repeticoes = REPETICOES_PADRAO;
+    int lote = LOTE_PADRAO;
+    FormatoSaida formato = SAIDA_TEXTO;
+    ContextoBench ctx;
+    GeradorPecas sorteio;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            formato = SAIDA_JSON;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            formato = SAIDA_CSV;
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lote") == 0 && i + 1 < argc) {
+            lote = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Uso: %s [--json | --csv] [--repeticoes N] [--lote N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (repeticoes < 1 || lote < 1) {
+        fprintf(stderr, "ERRO: --repeticoes e --lote devem ser positivos.\n");
+        return 1;
+    }
+
+    // Nenhuma ação imprime durante a medição; a semente é fixa para resultados comparáveis
+    modo_silencioso = 1;
+    gerador_inicializar(&gerador_padrao, 12345, 0, GERADOR_UNIFORME);
+
+    // Sequência fixa de ações aleatórias (1 a 5) para as misturas
+    gerador_inicializar(&sorteio, 12345, 1, GERADOR_UNIFORME);
+    ctx.num_acoes = 1 << 16;
+    ctx.acoes = malloc(ctx.num_acoes * sizeof(int));
+    ctx.cursor = 0;
+    for (i = 0; i < ctx.num_acoes; i++) {
+        ctx.acoes[i] = 1 + (int)(((unsigned __int128)gerador_proximo_u64(&sorteio) * 5) >> 64);
+    }
+
+    if (formato == SAIDA_TEXTO) {
+        printf("MAX_FILA=%d MAX_PILHA=%d, %d repeticoes de %d operacoes\n", MAX_FILA, MAX_PILHA, repeticoes, lote);
+        printf("%-28s %10s %10s %12s %12s\n", "caso", "ns/op med", "ns/op p99", "ciclos med", "ciclos p99");
+    } else if (formato == SAIDA_CSV) {
+        printf("caso,max_fila,max_pilha,lote,repeticoes,ns_op_mediana,ns_op_p99,ciclos_op_mediana,ciclos_op_p99\n");
+    }
+
+    for (i = 0; i < num_casos; i++) {
+        medir_caso(&casos[i], &ctx, repeticoes, lote, formato);
+    }
+
+    free(ctx.acoes);
+    return 0;
+}
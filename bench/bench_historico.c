@@ -0,0 +1,237 @@
+// Benchmark do histórico de ações: custo do registro no caminho quente de executar_opcao,
+// custo de desfazer/refazer/voltar e uma conferência em passeio aleatório (ações,
+// desfazer, refazer e voltar até a ação k), comparando cada estado revisitado com a
+// impressão digital guardada quando ele foi alcançado pela primeira vez.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_historico.c -o bench/bench_historico
+// Execução:
+//   ./bench/bench_historico [--json] [--acoes N] [--repeticoes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: ações por repetição e número de repetições
+#define ACOES_PADRAO 5000000
+#define REPETICOES_PADRAO 5
+// Passos do passeio aleatório de conferência (por modo do gerador)
+#define PASSOS_CONFERENCIA 200000
+
+/**
+ * @brief Impressão digital da sessão: fila, pilha, gerador inteiro e tabuleiro.
+ */
+uint64_t impressao_digital(FilaCircular *fila, Pilha *pilha, const Tabuleiro *tabuleiro) {
+    const GeradorPecas *g = gerador_ativo;
+    uint64_t h = hash_estado(fila, pilha);
+    int k;
+
+    for (k = 0; k < 4; k++) h = (h ^ g->estado[k]) * 0x100000001B3ULL;
+    h = (h ^ g->bits ^ ((uint64_t)g->bits_restantes << 56) ^ g->sorteios) * 0x100000001B3ULL;
+    h = (h ^ (uint64_t)g->restantes_saco ^ (uint64_t)g->saco[0] << 8) * 0x100000001B3ULL;
+    for (k = 0; k < ALTURA_TABULEIRO; k++) h = (h ^ tabuleiro->linhas[k]) * 0x100000001B3ULL;
+    return (h ^ (uint64_t)tabuleiro->pecas) * 0x100000001B3ULL;
+}
+
+/**
+ * @brief Ação (1 a 5) do passo k de uma sequência fixa.
+ */
+int acao_do_passo(uint64_t k) {
+    uint64_t x = (k + 1) * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 31;
+    return 1 + (int)(((x * 0xBF58476D1CE4E5B9ULL) >> 40) % 5);
+}
+
+/**
+ * @brief Mede ns por ação de executar_opcao, com ou sem histórico ativo.
+ */
+double medir_acoes(long long acoes, int repeticoes, uint64_t semente, int com_historico) {
+    double *amostras = malloc(repeticoes * sizeof(double));
+    HistoricoAcoes *historico = malloc(sizeof(HistoricoAcoes));
+    double mediana;
+    int r;
+
+    for (r = 0; r < repeticoes; r++) {
+        FilaCircular fila;
+        Pilha pilha;
+        uint64_t t0;
+        long long k;
+
+        gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+        inicializar_fila(&fila);
+        inicializar_pilha(&pilha);
+        preencher_fila_inicial(&fila);
+        historico_criar(historico, 0);
+        historico_ativo = com_historico ? historico : NULL;
+
+        t0 = ler_ns();
+        for (k = 0; k < acoes; k++) {
+            executar_opcao(&fila, &pilha, acao_do_passo((uint64_t)k));
+        }
+        amostras[r] = (double)(ler_ns() - t0) / acoes;
+        historico_ativo = NULL;
+        historico_liberar(historico);
+    }
+    qsort(amostras, repeticoes, sizeof(double), comparar_double);
+    mediana = amostras[repeticoes / 2];
+    free(amostras);
+    free(historico);
+    return mediana;
+}
+
+/**
+ * @brief Mede desfazer e refazer o anel inteiro, repetidas vezes.
+ * @param ns_desfazer Recebe ns por desfazer.
+ * @param ns_refazer Recebe ns por refazer.
+ * @param ns_voltar Recebe ns por ação percorrida em historico_voltar_ate.
+ */
+void medir_desfazer(uint64_t semente, double *ns_desfazer, double *ns_refazer, double *ns_voltar) {
+    const int ciclos = 20000;
+    HistoricoAcoes *historico = malloc(sizeof(HistoricoAcoes));
+    FilaCircular fila;
+    Pilha pilha;
+    uint64_t t_desfazer = 0, t_refazer = 0, t_voltar = 0, t0;
+    long long desfeitas = 0, refeitas = 0;
+    int c, k;
+
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+    historico_criar(historico, 0);
+    historico_ativo = historico;
+    for (k = 0; k < 4 * CAPACIDADE_HISTORICO; k++) {
+        executar_opcao(&fila, &pilha, acao_do_passo((uint64_t)k));
+    }
+
+    for (c = 0; c < ciclos; c++) {
+        t0 = ler_ns();
+        while (historico_desfazer(historico, &fila, &pilha)) desfeitas++;
+        t_desfazer += ler_ns() - t0;
+        t0 = ler_ns();
+        while (historico_refazer(historico, &fila, &pilha)) refeitas++;
+        t_refazer += ler_ns() - t0;
+        t0 = ler_ns();
+        historico_voltar_ate(historico, &fila, &pilha, historico->primeira);
+        historico_voltar_ate(historico, &fila, &pilha, historico->ultima);
+        t_voltar += ler_ns() - t0;
+    }
+    *ns_desfazer = (double)t_desfazer / desfeitas;
+    *ns_refazer = (double)t_refazer / refeitas;
+    *ns_voltar = (double)t_voltar / (desfeitas + refeitas);
+    historico_ativo = NULL;
+    historico_liberar(historico);
+    free(historico);
+}
+
+/**
+ * @brief Passeio aleatório com ações, desfazer, refazer e voltar, com tabuleiro ativo.
+ * Cada estado n alcançado por uma ação guarda sua impressão digital; sempre que o
+ * histórico volta a n, a impressão digital tem de ser a mesma.
+ * @return long long O número de estados revisitados que não conferiram.
+ */
+long long conferir(uint64_t semente, ModoGerador modo, long long *revisitas) {
+    HistoricoAcoes *historico = malloc(sizeof(HistoricoAcoes));
+    uint64_t *digitais = malloc((PASSOS_CONFERENCIA + 1) * sizeof(uint64_t));
+    GeradorPecas politica;
+    FilaCircular fila;
+    Pilha pilha;
+    Tabuleiro tabuleiro;
+    long long erros = 0;
+    int p;
+
+    gerador_inicializar(&gerador_padrao, semente, 0, modo);
+    gerador_inicializar(&politica, semente, 1, GERADOR_UNIFORME);
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    inicializar_tabuleiro(&tabuleiro);
+    preencher_fila_inicial(&fila);
+    tabuleiro_ativo = &tabuleiro;
+    historico_criar(historico, 1);
+    historico_ativo = historico;
+    digitais[0] = impressao_digital(&fila, &pilha, &tabuleiro);
+
+    for (p = 0; p < PASSOS_CONFERENCIA; p++) {
+        uint64_t r = gerador_proximo_u64(&politica);
+        int tipo = (int)(r % 100);
+        int revisitou = 1;
+
+        if (tipo < 60) {
+            long long antes = historico->atual;
+            executar_opcao(&fila, &pilha, 1 + (int)((r >> 8) % 5));
+            revisitou = 0;
+            if (historico->atual != antes) digitais[historico->atual] = impressao_digital(&fila, &pilha, &tabuleiro);
+        } else if (tipo < 78) {
+            executar_opcao(&fila, &pilha, OPCAO_DESFAZER);
+        } else if (tipo < 96) {
+            executar_opcao(&fila, &pilha, OPCAO_REFAZER);
+        } else {
+            long long faixa = historico->ultima - historico->primeira + 1;
+            historico_voltar_ate(historico, &fila, &pilha, historico->primeira + (long long)((r >> 8) % (uint64_t)faixa));
+        }
+        if (revisitou) {
+            (*revisitas)++;
+            if (impressao_digital(&fila, &pilha, &tabuleiro) != digitais[historico->atual]) erros++;
+        }
+    }
+
+    historico_ativo = NULL;
+    tabuleiro_ativo = NULL;
+    historico_liberar(historico);
+    free(historico);
+    free(digitais);
+    return erros;
+}
+
+int main(int argc, char *argv[]) {
+    long long acoes = ACOES_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    double sem, com, ns_desfazer, ns_refazer, ns_voltar;
+    long long erros, revisitas = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--acoes") == 0 && i + 1 < argc) {
+            acoes = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--acoes N] [--repeticoes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (acoes < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --acoes e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    sem = medir_acoes(acoes, repeticoes, semente, 0);
+    com = medir_acoes(acoes, repeticoes, semente, 1);
+    medir_desfazer(semente, &ns_desfazer, &ns_refazer, &ns_voltar);
+    erros = conferir(semente, GERADOR_UNIFORME, &revisitas) + conferir(semente, GERADOR_SACO, &revisitas);
+    modo_silencioso = 0;
+
+    if (json) {
+        printf("{\"acoes\":%lld,\"ns_sem_historico\":%.2f,\"ns_com_historico\":%.2f,\"sobrecarga\":%.3f,"
+               "\"ns_desfazer\":%.2f,\"ns_refazer\":%.2f,\"ns_voltar_por_acao\":%.2f,\"bytes_por_entrada\":%zu,"
+               "\"capacidade\":%d,\"revisitas\":%lld,\"erros\":%lld}\n",
+               acoes, sem, com, com / sem - 1.0, ns_desfazer, ns_refazer, ns_voltar, sizeof(DeltaAcao),
+               CAPACIDADE_HISTORICO, revisitas, erros);
+    } else {
+        printf("%lld acoes por repeticao, mediana de %d repeticoes\n", acoes, repeticoes);
+        printf("executar_opcao sem historico: %8.2f ns/acao\n", sem);
+        printf("executar_opcao com historico: %8.2f ns/acao (%+.1f%%)\n", com, 100.0 * (com / sem - 1.0));
+        printf("Desfazer: %.2f ns | Refazer: %.2f ns | Voltar ate k: %.2f ns por acao percorrida\n",
+               ns_desfazer, ns_refazer, ns_voltar);
+        printf("Memoria: %zu bytes por entrada x %d entradas = %zu bytes por sessao (sem tabuleiro)\n",
+               sizeof(DeltaAcao), CAPACIDADE_HISTORICO, sizeof(HistoricoAcoes));
+        printf("Conferencia: %lld estados revisitados, %lld divergencias\n", revisitas, erros);
+    }
+    return erros == 0 ? 0 : 1;
+}
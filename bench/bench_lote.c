@@ -0,0 +1,182 @@
+// Benchmark das ações em lote na tabela de sessões: a mesma ação aplicada a todas as
+// sessões de uma vez (tabela_executar_lote) contra tabela_executar_opcao sessão a sessão.
+// Antes de medir, confere sessão a sessão (fila, pilha, contadores, resultados e peças
+// geradas) os dois caminhos em uma sequência aleatória de ações sobre blocos aleatórios.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_lote.c -o bench/bench_lote
+// Execução:
+//   ./bench/bench_lote [--json] [--sessoes N] [--rodadas N] [--repeticoes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: sessões na tabela, rodadas (uma ação para todas) e repetições
+#define SESSOES_PADRAO 4096
+#define RODADAS_PADRAO 400
+#define REPETICOES_PADRAO 5
+// Rodadas da conferência
+#define RODADAS_CONFERENCIA 20000
+
+/**
+ * @brief Compara uma sessão das duas tabelas, campo a campo.
+ */
+int mesma_sessao(const TabelaSessoes *a, const TabelaSessoes *b, int s) {
+    size_t f = (size_t)s * MAX_FILA, p = (size_t)s * MAX_PILHA;
+    return a->inicio[s] == b->inicio[s] && a->fim[s] == b->fim[s] && a->tamanho_atual[s] == b->tamanho_atual[s] &&
+           a->topo[s] == b->topo[s] && memcmp(a->fila_nome + f, b->fila_nome + f, MAX_FILA) == 0 &&
+           memcmp(a->fila_id + f, b->fila_id + f, MAX_FILA * sizeof(int)) == 0 &&
+           memcmp(a->pilha_nome + p, b->pilha_nome + p, MAX_PILHA) == 0 &&
+           memcmp(a->pilha_id + p, b->pilha_id + p, MAX_PILHA * sizeof(int)) == 0;
+}
+
+/**
+ * @brief Conferência: ações aleatórias (inclusive 0 e inválidas) sobre blocos aleatórios,
+ * nas duas tabelas, cada uma com seu gerador. Devolve o número de divergências.
+ */
+long long conferir(int num_sessoes, uint64_t semente, ModoGerador modo) {
+    TabelaSessoes lote, escalar;
+    GeradorPecas gerador_lote, gerador_escalar, politica;
+    int8_t *resultados = malloc(num_sessoes);
+    long long divergencias = 0;
+    int r, s;
+
+    gerador_inicializar(&gerador_lote, semente, 0, modo);
+    gerador_escalar = gerador_lote;
+    gerador_inicializar(&politica, semente, 1, GERADOR_UNIFORME);
+    gerador_ativo = &gerador_lote;
+    criar_tabela_sessoes(&lote, num_sessoes);
+    gerador_ativo = &gerador_escalar;
+    criar_tabela_sessoes(&escalar, num_sessoes);
+
+    for (r = 0; r < RODADAS_CONFERENCIA; r++) {
+        uint64_t x = gerador_proximo_u64(&politica);
+        int opcao = (int)(x % 8) - 1; // -1 a 6: inclui as inválidas
+        int primeira = (int)((x >> 8) % num_sessoes);
+        int quantidade = (int)((x >> 24) % (num_sessoes - primeira + 1));
+        int efeito, efeito_escalar = 0;
+
+        gerador_ativo = &gerador_lote;
+        efeito = tabela_executar_lote(&lote, primeira, quantidade, opcao, resultados);
+        gerador_ativo = &gerador_escalar;
+        for (s = primeira; s < primeira + quantidade; s++) {
+            ResultadoAcao resultado = tabela_executar_opcao(&escalar, s, opcao);
+            divergencias += (resultado != resultados[s - primeira]);
+            efeito_escalar += (resultado == ACAO_REALIZADA || resultado == ACAO_DESCARTADA);
+        }
+        divergencias += (opcao >= 0 && opcao <= 5 && efeito != efeito_escalar);
+        divergencias += (gerador_lote.proximo_id != gerador_escalar.proximo_id);
+    }
+    for (s = 0; s < num_sessoes; s++) divergencias += !mesma_sessao(&lote, &escalar, s);
+    divergencias += memcmp(&gerador_lote, &gerador_escalar, sizeof(GeradorPecas)) != 0;
+
+    gerador_ativo = &gerador_padrao;
+    liberar_tabela_sessoes(&lote);
+    liberar_tabela_sessoes(&escalar);
+    free(resultados);
+    return divergencias;
+}
+
+int main(int argc, char *argv[]) {
+    int num_sessoes = SESSOES_PADRAO;
+    int rodadas = RODADAS_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    TabelaSessoes tabela;
+    int8_t *resultados;
+    double *ns_lote, *ns_escalar;
+    long long divergencias;
+    int opcao, i, r, k, s;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            num_sessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rodadas") == 0 && i + 1 < argc) {
+            rodadas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--sessoes N] [--rodadas N] [--repeticoes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_sessoes < 1 || rodadas < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --sessoes, --rodadas e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+
+    resultados = malloc(num_sessoes);
+    ns_lote = malloc(repeticoes * sizeof(double));
+    ns_escalar = malloc(repeticoes * sizeof(double));
+    if (resultados == NULL || ns_lote == NULL || ns_escalar == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+
+    divergencias = conferir(num_sessoes, semente, GERADOR_UNIFORME) + conferir(num_sessoes, semente, GERADOR_SACO);
+
+    if (!json) {
+        printf("%d sessoes, %d rodadas por medicao, mediana de %d repeticoes\n", num_sessoes, rodadas, repeticoes);
+        printf("%-6s %14s %14s %10s\n", "acao", "lote ns/sess", "escalar ns/sess", "aceleracao");
+    }
+    // Cada ação é medida sozinha, e também alternada com a que a desfaz (2 com 3), para
+    // que as sessões não fiquem todas presas na mesma pré-condição
+    for (opcao = 1; opcao <= 6; opcao++) {
+        for (r = 0; r < repeticoes; r++) {
+            uint64_t t0, t1;
+            int modo;
+            for (modo = 0; modo < 2; modo++) {
+                gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+                if (!criar_tabela_sessoes(&tabela, num_sessoes)) {
+                    fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+                    return 1;
+                }
+                // Metade das sessões começa com 3 peças na reserva
+                for (s = 0; s < num_sessoes; s += 2) {
+                    for (k = 0; k < 3; k++) tabela_executar_opcao(&tabela, s, 2);
+                }
+                t0 = ler_ns();
+                for (k = 0; k < rodadas; k++) {
+                    int acao = opcao <= 5 ? opcao : (k & 1 ? 3 : 2);
+                    if (modo == 0) {
+                        tabela_executar_lote(&tabela, 0, num_sessoes, acao, resultados);
+                    } else {
+                        for (s = 0; s < num_sessoes; s++) resultados[s] = (int8_t)tabela_executar_opcao(&tabela, s, acao);
+                    }
+                }
+                t1 = ler_ns();
+                (modo == 0 ? ns_lote : ns_escalar)[r] = (double)(t1 - t0) / ((double)rodadas * num_sessoes);
+                liberar_tabela_sessoes(&tabela);
+            }
+        }
+        qsort(ns_lote, repeticoes, sizeof(double), comparar_double);
+        qsort(ns_escalar, repeticoes, sizeof(double), comparar_double);
+        if (json) {
+            printf("{\"acao\":\"%s\",\"sessoes\":%d,\"ns_por_sessao_lote\":%.3f,\"ns_por_sessao_escalar\":%.3f,"
+                   "\"aceleracao\":%.2f}\n", opcao <= 5 ? (const char[]){(char)('0' + opcao), '\0'} : "2+3",
+                   num_sessoes, ns_lote[repeticoes / 2], ns_escalar[repeticoes / 2],
+                   ns_escalar[repeticoes / 2] / ns_lote[repeticoes / 2]);
+        } else {
+            printf("%-6s %14.3f %14.3f %9.2fx\n", opcao <= 5 ? (const char[]){(char)('0' + opcao), '\0'} : "2+3",
+                   ns_lote[repeticoes / 2], ns_escalar[repeticoes / 2],
+                   ns_escalar[repeticoes / 2] / ns_lote[repeticoes / 2]);
+        }
+    }
+
+    if (json) {
+        printf("{\"divergencias\":%lld}\n", divergencias);
+    } else {
+        printf("Conferencia sessao a sessao (%d rodadas em blocos aleatorios, nos dois modos do gerador): %lld divergencias\n",
+               RODADAS_CONFERENCIA, divergencias);
+    }
+
+    free(resultados);
+    free(ns_lote);
+    free(ns_escalar);
+    return divergencias ? 1 : 0;
+}
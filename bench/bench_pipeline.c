@@ -0,0 +1,155 @@
+// Benchmark de vazão do canal de peças (thread produtora + thread do jogo)
+// comparado com a geração síncrona de gerarPeca().
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_pipeline.c -o bench/bench_pipeline
+// Execução:
+//   ./bench/bench_pipeline [--json] [--pecas N] [--repeticoes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: peças consumidas por repetição e número de repetições
+#define PECAS_PADRAO 10000000
+#define REPETICOES_PADRAO 7
+
+/**
+ * @brief Resultado de uma medição: mediana de ns por peça e soma de verificação da sequência.
+ */
+typedef struct {
+    double ns_por_peca;
+    uint64_t verificacao;
+} ResultadoPipeline;
+
+/**
+ * @brief Consome 'n' peças com gerarPeca() e devolve uma soma de verificação da sequência.
+ */
+uint64_t consumir_pecas(long long n) {
+    uint64_t h = 0;
+    long long k;
+    for (k = 0; k < n; k++) {
+        Peca p = gerarPeca();
+        h = (h * 31) + (uint64_t)p.nome * 1000003u + (uint64_t)p.id;
+    }
+    return h;
+}
+
+/**
+ * @brief Executa 'n' vezes a ação "jogar peça" e devolve o hash do estado final.
+ */
+uint64_t jogar_pecas(long long n) {
+    FilaCircular fila;
+    Pilha pilha;
+    long long k;
+
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+    for (k = 0; k < n; k++) {
+        acao_jogar_peca(&fila);
+    }
+    return hash_estado(&fila, &pilha);
+}
+
+/**
+ * @brief Mede uma carga de trabalho 'repeticoes' vezes, com ou sem o canal de peças.
+ * Cada repetição recomeça do mesmo gerador semeado, para que as sequências sejam comparáveis.
+ */
+ResultadoPipeline medir(uint64_t (*carga)(long long), long long pecas, int repeticoes,
+                        uint64_t semente, int com_canal) {
+    ResultadoPipeline resultado = {0.0, 0};
+    double *amostras = malloc(repeticoes * sizeof(double));
+    int r;
+
+    for (r = 0; r < repeticoes; r++) {
+        uint64_t t0, t1;
+        gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+        if (com_canal) {
+            canal_ativo = canal_criar(&gerador_padrao);
+            if (canal_ativo == NULL) {
+                fprintf(stderr, "ERRO: Nao foi possivel iniciar a thread produtora.\n");
+                exit(1);
+            }
+        }
+
+        t0 = ler_ns();
+        resultado.verificacao = carga(pecas);
+        t1 = ler_ns();
+        amostras[r] = (double)(t1 - t0) / pecas;
+
+        if (com_canal) {
+            canal_destruir(canal_ativo);
+            canal_ativo = NULL;
+        }
+    }
+
+    qsort(amostras, repeticoes, sizeof(double), comparar_double);
+    resultado.ns_por_peca = amostras[repeticoes / 2];
+    free(amostras);
+    return resultado;
+}
+
+/**
+ * @brief Imprime uma linha de resultado (texto ou JSON).
+ */
+void imprimir(const char *caso, const char *modo, ResultadoPipeline r, int json) {
+    if (json) {
+        printf("{\"caso\":\"%s\",\"modo\":\"%s\",\"ns_por_peca\":%.3f,\"milhoes_por_s\":%.2f,\"verificacao\":\"%016llx\"}\n",
+               caso, modo, r.ns_por_peca, 1e3 / r.ns_por_peca, (unsigned long long)r.verificacao);
+    } else {
+        printf("%-16s %-10s %10.2f %12.2f   %016llx\n", caso, modo, r.ns_por_peca,
+               1e3 / r.ns_por_peca, (unsigned long long)r.verificacao);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long long pecas = PECAS_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    ResultadoPipeline sincrono, canal;
+    int deterministico = 1;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--pecas") == 0 && i + 1 < argc) {
+            pecas = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--pecas N] [--repeticoes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pecas < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --pecas e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    if (!json) {
+        printf("%lld pecas por repeticao, mediana de %d repeticoes\n", pecas, repeticoes);
+        printf("%-16s %-10s %10s %12s   %s\n", "caso", "modo", "ns/peca", "milhoes/s", "verificacao");
+    }
+
+    sincrono = medir(consumir_pecas, pecas, repeticoes, semente, 0);
+    canal = medir(consumir_pecas, pecas, repeticoes, semente, 1);
+    imprimir("gerarPeca", "sincrono", sincrono, json);
+    imprimir("gerarPeca", "canal", canal, json);
+    deterministico &= (sincrono.verificacao == canal.verificacao);
+
+    sincrono = medir(jogar_pecas, pecas, repeticoes, semente, 0);
+    canal = medir(jogar_pecas, pecas, repeticoes, semente, 1);
+    imprimir("acao_jogar_peca", "sincrono", sincrono, json);
+    imprimir("acao_jogar_peca", "canal", canal, json);
+    deterministico &= (sincrono.verificacao == canal.verificacao);
+
+    if (!json) {
+        printf("Sequencias identicas nos dois modos: %s\n", deterministico ? "sim" : "NAO");
+    }
+    return deterministico ? 0 : 1;
+}
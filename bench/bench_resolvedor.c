@@ -0,0 +1,139 @@
+// Benchmark do resolvedor de sequências: joga uma partida aleatória e, a cada jogada,
+// procura a menor sequência para vários alvos (como um bot ou uma dica faria).
+// Mede a latência por busca e confere cada sequência aplicando-a a uma cópia do estado.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_resolvedor.c -o bench/bench_resolvedor
+// Execução:
+//   ./bench/bench_resolvedor [--json] [--jogadas N] [--threads T] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: jogadas da partida (uma rodada de buscas por jogada)
+#define JOGADAS_PADRAO 2000
+
+// Alvos procurados a cada jogada
+static const char *const ALVOS[] = {"I", "T", "LO", "TLI", "OOT", "IOTL"};
+#define NUM_ALVOS ((int)(sizeof(ALVOS) / sizeof(ALVOS[0])))
+
+/**
+ * @brief Aplica a sequência a cópias da fila e da pilha e confere se o alvo ficou na frente.
+ */
+int conferir_sequencia(const FilaCircular *fila, const Pilha *pilha, const int *acoes, int n, const char *alvo) {
+    FilaCircular f = *fila;
+    Pilha p = *pilha;
+    int k;
+    for (k = 0; k < n; k++) despachar_opcao(&f, &p, acoes[k]);
+    for (k = 0; alvo[k] != '\0'; k++) {
+        if (k >= f.tamanho_atual || f.itens[INDICE_FILA(f.inicio + k)].nome != alvo[k]) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int jogadas = JOGADAS_PADRAO;
+    int num_threads = 4;
+    uint64_t semente = 2024;
+    int json = 0;
+    Resolvedor sequencial, paralelo;
+    FilaCircular fila;
+    Pilha pilha;
+    GeradorPecas politica;
+    double *amostras;
+    long long buscas = 0, encontradas = 0, estados = 0, comprimento = 0;
+    int erros = 0;
+    double t_paralelo_total = 0.0, t_sequencial_total = 0.0;
+    int i, j;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--jogadas") == 0 && i + 1 < argc) {
+            jogadas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--jogadas N] [--threads T] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (jogadas < 1) {
+        fprintf(stderr, "ERRO: --jogadas deve ser positivo.\n");
+        return 1;
+    }
+
+    amostras = malloc((size_t)jogadas * NUM_ALVOS * sizeof(double));
+    if (amostras == NULL || !resolvedor_criar(&sequencial, 1) || !resolvedor_criar(&paralelo, num_threads)) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    gerador_inicializar(&politica, semente, 1, GERADOR_UNIFORME);
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+
+    for (i = 0; i < jogadas; i++) {
+        uint64_t estado = empacotar_estado(&fila, &pilha);
+        GeradorPecas salvo = gerador_padrao;
+
+        for (j = 0; j < NUM_ALVOS; j++) {
+            int acoes[PROFUNDIDADE_MAXIMA_RESOLVEDOR];
+            int acoes_paralelo[PROFUNDIDADE_MAXIMA_RESOLVEDOR];
+            uint64_t t0 = ler_ns();
+            int n = resolver_sequencia(&sequencial, estado, ALVOS[j], acoes);
+            uint64_t t1 = ler_ns();
+            int n_paralelo = resolver_sequencia(&paralelo, estado, ALVOS[j], acoes_paralelo);
+            uint64_t t2 = ler_ns();
+
+            amostras[buscas++] = (t1 - t0) / 1e3;
+            t_sequencial_total += (t1 - t0) / 1e3;
+            t_paralelo_total += (t2 - t1) / 1e3;
+            estados += sequencial.visitados;
+            // As duas buscas devem achar sequências do mesmo tamanho, e ambas devem funcionar
+            if (n != n_paralelo) erros++;
+            if (n >= 0) {
+                encontradas++;
+                comprimento += n;
+                if (!conferir_sequencia(&fila, &pilha, acoes, n, ALVOS[j]) ||
+                    !conferir_sequencia(&fila, &pilha, acoes_paralelo, n_paralelo, ALVOS[j])) {
+                    erros++;
+                }
+                gerador_padrao = salvo; // A conferência não pode mudar as peças da partida
+            }
+        }
+
+        despachar_opcao(&fila, &pilha, 1 + (int)(gerador_proximo_u64(&politica) % 5));
+    }
+    modo_silencioso = 0;
+
+    qsort(amostras, buscas, sizeof(double), comparar_double);
+    if (json) {
+        printf("{\"buscas\":%lld,\"encontradas\":%lld,\"comprimento_medio\":%.2f,\"estados_medios\":%.1f,"
+               "\"us_mediana\":%.2f,\"us_p99\":%.2f,\"us_max\":%.2f,\"us_medio_1_thread\":%.2f,"
+               "\"us_medio_%d_threads\":%.2f,\"erros\":%d}\n",
+               buscas, encontradas, encontradas ? (double)comprimento / encontradas : 0.0,
+               (double)estados / buscas, amostras[buscas / 2], amostras[(long long)(buscas * 0.99)],
+               amostras[buscas - 1], t_sequencial_total / buscas, num_threads, t_paralelo_total / buscas, erros);
+    } else {
+        printf("%lld buscas (%d jogadas x %d alvos), %lld com solucao, %.2f acoes em media\n",
+               buscas, jogadas, NUM_ALVOS, encontradas, encontradas ? (double)comprimento / encontradas : 0.0);
+        printf("Estados visitados por busca: %.1f em media\n", (double)estados / buscas);
+        printf("Latencia (1 thread, us): mediana %.2f | p99 %.2f | max %.2f | media %.2f\n",
+               amostras[buscas / 2], amostras[(long long)(buscas * 0.99)], amostras[buscas - 1],
+               t_sequencial_total / buscas);
+        printf("Latencia media com %d threads (niveis >= %d estados em paralelo): %.2f us\n",
+               num_threads, LIMIAR_PARALELO_RESOLVEDOR, t_paralelo_total / buscas);
+        printf("Sequencias conferidas e do mesmo tamanho nos dois modos: %s\n", erros ? "NAO" : "sim");
+    }
+
+    resolvedor_liberar(&sequencial);
+    resolvedor_liberar(&paralelo);
+    free(amostras);
+    return erros ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+// Benchmark do tabuleiro em bitboard: vazão de tabuleiro_jogar (que testa todas as
+// rotações e colunas antes de colocar a peça) e de quedas isoladas (tabuleiro_soltar).
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native -pthread bench/bench_tabuleiro.c -o bench/bench_tabuleiro
+// Execução:
+//   ./bench/bench_tabuleiro [--json] [--pecas N] [--repeticoes N] [--semente N]
+
+#define TETRIS_SEM_MAIN
+#include "../tetris.c"
+
+// Valores padrão: peças por repetição e número de repetições
+#define PECAS_PADRAO 2000000
+#define REPETICOES_PADRAO 7
+
+int main(int argc, char *argv[]) {
+    long long pecas = PECAS_PADRAO;
+    int repeticoes = REPETICOES_PADRAO;
+    uint64_t semente = 2024;
+    int json = 0;
+    char *tipos;
+    double *ns_jogar, *ns_soltar;
+    Tabuleiro tabuleiro;
+    long long quedas_por_repeticao = 0;
+    long long linhas = 0, fins = 0;
+    uint64_t verificacao = 0;
+    long long k;
+    int i, r;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--pecas") == 0 && i + 1 < argc) {
+            pecas = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--repeticoes") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Uso: %s [--json] [--pecas N] [--repeticoes N] [--semente N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (pecas < 1 || repeticoes < 1) {
+        fprintf(stderr, "ERRO: --pecas e --repeticoes devem ser positivos.\n");
+        return 1;
+    }
+
+    // A sequência de peças é gerada antes, para medir só o tabuleiro
+    tipos = malloc(pecas);
+    ns_jogar = malloc(repeticoes * sizeof(double));
+    ns_soltar = malloc(repeticoes * sizeof(double));
+    if (tipos == NULL || ns_jogar == NULL || ns_soltar == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente.\n");
+        return 1;
+    }
+    gerador_inicializar(&gerador_padrao, semente, 0, GERADOR_UNIFORME);
+    for (k = 0; k < pecas; k++) {
+        tipos[k] = gerarPeca().nome;
+    }
+    for (i = 0; i < NUM_TIPOS_PECA; i++) {
+        for (r = 0; r < NUM_ROTACOES[i]; r++) {
+            quedas_por_repeticao += LARGURA_TABULEIRO - ROTACOES_PECA[i][r].largura + 1;
+        }
+    }
+
+    for (r = 0; r < repeticoes; r++) {
+        uint64_t t0, t1;
+        uint64_t soma = 0;
+
+        // 1. Partida completa: escolhe a posição e coloca cada peça
+        inicializar_tabuleiro(&tabuleiro);
+        t0 = ler_ns();
+        for (k = 0; k < pecas; k++) {
+            tabuleiro_jogar(&tabuleiro, tipos[k]);
+        }
+        t1 = ler_ns();
+        ns_jogar[r] = (double)(t1 - t0) / pecas;
+        linhas = tabuleiro.linhas_limpas;
+        fins = tabuleiro.fins_de_jogo;
+
+        // 2. Só quedas: todas as rotações e colunas de um tipo sobre o tabuleiro final
+        t0 = ler_ns();
+        for (k = 0; k < pecas; k++) {
+            int tipo = indice_tipo_peca(tipos[k]);
+            int rot = (int)(k % NUM_ROTACOES[tipo]);
+            const RotacaoPeca *rotacao = &ROTACOES_PECA[tipo][rot];
+            soma += (uint64_t)tabuleiro_soltar(&tabuleiro, rotacao, (int)(k % (LARGURA_TABULEIRO - rotacao->largura + 1)));
+        }
+        t1 = ler_ns();
+        ns_soltar[r] = (double)(t1 - t0) / pecas;
+        verificacao = soma;
+    }
+
+    qsort(ns_jogar, repeticoes, sizeof(double), comparar_double);
+    qsort(ns_soltar, repeticoes, sizeof(double), comparar_double);
+    if (json) {
+        printf("{\"pecas\":%lld,\"ns_por_peca\":%.2f,\"milhoes_de_pecas_por_s\":%.2f,"
+               "\"ns_por_queda\":%.2f,\"milhoes_de_quedas_por_s\":%.2f,\"linhas_removidas\":%lld,"
+               "\"fins_de_jogo\":%lld,\"verificacao\":%llu}\n",
+               pecas, ns_jogar[repeticoes / 2], 1e3 / ns_jogar[repeticoes / 2],
+               ns_soltar[repeticoes / 2], 1e3 / ns_soltar[repeticoes / 2], linhas, fins,
+               (unsigned long long)verificacao);
+    } else {
+        printf("%lld pecas por repeticao, mediana de %d repeticoes\n", pecas, repeticoes);
+        printf("tabuleiro_jogar:  %8.2f ns/peca   %8.2f milhoes de pecas/s (%lld posicoes somando os 4 tipos)\n",
+               ns_jogar[repeticoes / 2], 1e3 / ns_jogar[repeticoes / 2], quedas_por_repeticao);
+        printf("tabuleiro_soltar: %8.2f ns/queda  %8.2f milhoes de quedas/s\n",
+               ns_soltar[repeticoes / 2], 1e3 / ns_soltar[repeticoes / 2]);
+        printf("Linhas removidas: %lld | Fins de jogo: %lld | Verificacao: %llu\n",
+               linhas, fins, (unsigned long long)verificacao);
+    }
+
+    free(tipos);
+    free(ns_jogar);
+    free(ns_soltar);
+    return 0;
+}
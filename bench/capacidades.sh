@@ -0,0 +1,36 @@
+#!/bin/sh
+# Compila e executa os microbenchmarks para várias capacidades de fila/pilha,
+# cada uma com o índice circular especializado (máscara ou subtração sem desvio)
+# e com o '%' original (-DFILA_USAR_MODULO), para comparar o ganho.
+#
+# Uso: ./bench/capacidades.sh [argumentos extras para o benchmark]
+# Saída: CSV na stdout, com a coluna 'indice' indicando a variante.
+
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O2 -march=native"}
+# Sempre presentes, como no Makefile: tetris.c usa pthreads
+COMUNS="-std=gnu11 -Wall -Wextra -pthread"
+BIN=$(mktemp -d)
+trap 'rm -rf "$BIN"' EXIT
+
+# Pares "MAX_FILA MAX_PILHA": o padrão do jogo, potências de 2 e tamanhos quaisquer
+CONFIGURACOES="5:3 1:1 4:2 7:3 8:4 13:5 16:8 31:12 32:16 64:16"
+
+echo "indice,caso,max_fila,max_pilha,lote,repeticoes,ns_op_mediana,ns_op_p99,ciclos_op_mediana,ciclos_op_p99"
+for cfg in $CONFIGURACOES; do
+    fila=${cfg%:*}
+    pilha=${cfg#*:}
+    for variante in especializado modulo; do
+        extra=""
+        if [ "$variante" = modulo ]; then
+            extra="-DFILA_USAR_MODULO"
+        fi
+        saida="$BIN/bench_${fila}_${pilha}_${variante}"
+        $CC $COMUNS $CFLAGS -DMAX_FILA="$fila" -DMAX_PILHA="$pilha" $extra \
+            "$DIR/bench_estruturas.c" -o "$saida"
+        "$saida" --csv "$@" | tail -n +2 | sed "s/^/$variante,/"
+    done
+done
@@ -0,0 +1,286 @@
+// Gerador de carga para o modo servidor (--servidor): abre muitas conexões no socket
+// Unix, envia ações aleatórias (1 a 5) em cada uma e mede a latência de cada resposta.
+//
+// Compilação (otimizada):
+//   gcc -O2 -march=native bench/carga_servidor.c -o bench/carga_servidor
+// Execução (com o servidor já rodando, de preferência com --quieto):
+//   ./tetris --quieto --servidor /tmp/tetris.sock &
+//   ./bench/carga_servidor --socket /tmp/tetris.sock [--conexoes C] [--ativas A] [--acoes N]
+//                          [--janela W] [--semente N] [--json]
+// Com --ativas A, só as A primeiras conexões enviam ações; as demais ficam abertas e ociosas,
+// como jogadores conectados que não estão jogando (a latência medida é a das ativas).
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+
+// Valores padrão: conexões simultâneas, ações por conexão e comandos em voo por conexão
+#define CONEXOES_PADRAO 10000
+#define ACOES_PADRAO 100
+#define JANELA_PADRAO 1
+// Limite de comandos em voo por conexão (tamanho do anel de tempos de envio)
+#define MAX_JANELA 64
+// Eventos tratados por chamada a epoll_wait
+#define MAX_EVENTOS 512
+
+/**
+ * @brief Uma conexão de teste: quantos comandos já foram enviados e respondidos e os
+ * instantes de envio dos comandos em voo (em ordem, já que o servidor responde em ordem).
+ */
+typedef struct {
+    int fd;
+    int enviados;
+    int respondidos;
+    int inicio_linha;          // O próximo byte recebido começa uma linha
+    uint64_t envio[MAX_JANELA]; // Anel com os instantes de envio dos comandos em voo
+} ConexaoCarga;
+
+/**
+ * @brief Lê o relógio monotônico em nanossegundos.
+ */
+uint64_t ler_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * @brief Comparação de uint64_t para qsort.
+ */
+int comparar_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Gerador xorshift64 das ações enviadas (não precisa ser o mesmo do jogo).
+ */
+uint64_t proximo_aleatorio(uint64_t *estado) {
+    uint64_t x = *estado;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *estado = x;
+    return x;
+}
+
+/**
+ * @brief Envia 'quantidade' comandos aleatórios em uma única escrita e anota os instantes.
+ * @return int 1 em caso de sucesso, 0 se a escrita falhou.
+ */
+int enviar_comandos(ConexaoCarga *c, int quantidade, uint64_t *aleatorio) {
+    char linha[2 * MAX_JANELA];
+    uint64_t agora;
+    int k;
+
+    for (k = 0; k < quantidade; k++) {
+        linha[2 * k] = (char)('1' + proximo_aleatorio(aleatorio) % 5);
+        linha[2 * k + 1] = '\n';
+    }
+    agora = ler_ns();
+    for (k = 0; k < quantidade; k++) {
+        c->envio[(c->enviados + k) % MAX_JANELA] = agora;
+    }
+    c->enviados += quantidade;
+    return write(c->fd, linha, 2 * quantidade) == 2 * quantidade;
+}
+
+/**
+ * @brief Abre uma conexão bloqueante (espera se a fila de conexões do servidor estiver
+ * cheia) e a torna não bloqueante.
+ * @return int O descritor, ou -1 em caso de erro.
+ */
+int conectar(const struct sockaddr_un *endereco) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (const struct sockaddr *)endereco, sizeof(*endereco)) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    const char *caminho = NULL;
+    int num_conexoes = CONEXOES_PADRAO;
+    int ativas = -1;
+    int acoes = ACOES_PADRAO;
+    int janela = JANELA_PADRAO;
+    uint64_t aleatorio = 2024;
+    int json = 0;
+    struct sockaddr_un endereco;
+    struct rlimit limite;
+    struct epoll_event eventos[MAX_EVENTOS];
+    ConexaoCarga *conexoes;
+    uint64_t *latencias;
+    long long total_latencias = 0;
+    long long esperadas;
+    int abertas = 0;
+    int epoll_fd;
+    uint64_t t_conexao, t_inicio, t_fim;
+    char bloco[65536];
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            caminho = argv[++i];
+        } else if (strcmp(argv[i], "--conexoes") == 0 && i + 1 < argc) {
+            num_conexoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ativas") == 0 && i + 1 < argc) {
+            ativas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--acoes") == 0 && i + 1 < argc) {
+            acoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--janela") == 0 && i + 1 < argc) {
+            janela = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            aleatorio = strtoull(argv[++i], NULL, 10) | 1; // xorshift não aceita estado 0
+        } else {
+            caminho = NULL;
+            break;
+        }
+    }
+    if (ativas < 0 || ativas > num_conexoes) ativas = num_conexoes;
+    if (caminho == NULL || num_conexoes < 1 || ativas < 1 || acoes < 1 || janela < 1 || janela > MAX_JANELA ||
+        strlen(caminho) >= sizeof(endereco.sun_path)) {
+        fprintf(stderr, "Uso: %s --socket caminho [--conexoes C] [--ativas A] [--acoes N] [--janela W (1 a %d)] "
+                        "[--semente N] [--json]\n", argv[0], MAX_JANELA);
+        return 1;
+    }
+
+    // Uma conexão = um descritor: usa o limite máximo permitido
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    strcpy(endereco.sun_path, caminho);
+
+    esperadas = (long long)ativas * acoes;
+    conexoes = calloc(num_conexoes, sizeof(ConexaoCarga));
+    latencias = malloc(esperadas * sizeof(uint64_t));
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (conexoes == NULL || latencias == NULL || epoll_fd < 0) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para %d conexoes.\n", num_conexoes);
+        return 1;
+    }
+
+    // 1. Abre todas as conexões antes de medir (a sessão de cada uma já fica criada no servidor)
+    t_conexao = ler_ns();
+    for (i = 0; i < num_conexoes; i++) {
+        struct epoll_event ev;
+        ConexaoCarga *c = &conexoes[i];
+        c->fd = conectar(&endereco);
+        if (c->fd < 0) {
+            fprintf(stderr, "ERRO: Conexao %d falhou: %s\n", i, strerror(errno));
+            return 1;
+        }
+        c->inicio_linha = 1;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+    }
+    t_inicio = ler_ns();
+
+    // 2. Cada conexão mantém até 'janela' comandos em voo até completar 'acoes' respostas
+    for (i = 0; i < ativas; i++) {
+        int primeiro = janela < acoes ? janela : acoes;
+        if (!enviar_comandos(&conexoes[i], primeiro, &aleatorio)) {
+            fprintf(stderr, "ERRO: Falha ao enviar para a conexao %d.\n", i);
+            return 1;
+        }
+    }
+    abertas = ativas;
+
+    while (abertas > 0) {
+        int n = epoll_wait(epoll_fd, eventos, MAX_EVENTOS, -1);
+        int k;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return 1;
+        }
+        for (k = 0; k < n; k++) {
+            ConexaoCarga *c = eventos[k].data.ptr;
+            ssize_t lidos = read(c->fd, bloco, sizeof(bloco));
+            uint64_t agora;
+            int novas = 0;
+            ssize_t b;
+
+            if (lidos <= 0) {
+                if (lidos < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                fprintf(stderr, "ERRO: O servidor fechou uma conexao antes do fim.\n");
+                return 1;
+            }
+            // Cada resposta termina com uma linha "= R"; as demais linhas (modo verboso) são ignoradas
+            agora = ler_ns();
+            for (b = 0; b < lidos; b++) {
+                if (c->inicio_linha && bloco[b] == '=') {
+                    latencias[total_latencias++] = agora - c->envio[c->respondidos % MAX_JANELA];
+                    c->respondidos++;
+                    novas++;
+                }
+                c->inicio_linha = (bloco[b] == '\n');
+            }
+
+            if (c->respondidos == acoes) {
+                close(c->fd);
+                abertas--;
+            } else if (novas > 0 && c->enviados < acoes) {
+                int faltam = acoes - c->enviados;
+                if (!enviar_comandos(c, novas < faltam ? novas : faltam, &aleatorio)) {
+                    fprintf(stderr, "ERRO: Falha ao enviar comandos.\n");
+                    return 1;
+                }
+            }
+        }
+    }
+    t_fim = ler_ns();
+
+    qsort(latencias, total_latencias, sizeof(uint64_t), comparar_u64);
+    {
+        double segundos = (t_fim - t_inicio) / 1e9;
+        double conexao_ms = (t_inicio - t_conexao) / 1e6;
+        double p50 = latencias[total_latencias / 2] / 1e3;
+        double p99 = latencias[(long long)(total_latencias * 0.99)] / 1e3;
+        double p999 = latencias[(long long)(total_latencias * 0.999)] / 1e3;
+        double maximo = latencias[total_latencias - 1] / 1e3;
+        double vazao = total_latencias / segundos;
+
+        if (json) {
+            printf("{\"conexoes\":%d,\"ativas\":%d,\"acoes_por_conexao\":%d,\"janela\":%d,\"respostas\":%lld,"
+                   "\"segundos\":%.3f,\"conexao_ms\":%.1f,\"acoes_por_s\":%.0f,"
+                   "\"latencia_us\":{\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}}\n",
+                   num_conexoes, ativas, acoes, janela, total_latencias, segundos, conexao_ms, vazao,
+                   p50, p99, p999, maximo);
+        } else {
+            printf("Conexoes: %d (abertas em %.1f ms), %d ativas com %d acoes cada, janela de %d\n",
+                   num_conexoes, conexao_ms, ativas, acoes, janela);
+            printf("Respostas: %lld em %.3f s (%.0f acoes/s)\n", total_latencias, segundos, vazao);
+            printf("Latencia (us): p50 %.1f | p99 %.1f | p99.9 %.1f | max %.1f\n", p50, p99, p999, maximo);
+        }
+    }
+
+    for (i = ativas; i < num_conexoes; i++) {
+        close(conexoes[i].fd);
+    }
+    free(latencias);
+    free(conexoes);
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#!/bin/sh
+# Compila as configurações do Makefile (debug, release, lto e pgo) e mede cada uma no
+# mesmo arquivo de ações: o replay do executável (--replay) e a API da biblioteca
+# (bench_api, uma chamada por ação). Mostra a mediana de algumas execuções e a
+# aceleração sobre o debug (a receita antiga, -O0 -g) e sobre o release, e confere que
+# todas as configurações chegam ao mesmo hash do estado.
+#
+# Uso: ./bench/configuracoes.sh arquivo_de_acoes [repeticoes]   (ou: make bench)
+
+set -e
+
+ACOES=$1
+REPETICOES=${2:-5}
+SEMENTE=9
+CONFIGURACOES="debug release lto pgo"
+
+if [ -z "$ACOES" ] || [ ! -f "$ACOES" ]; then
+    echo "Uso: $0 arquivo_de_acoes [repeticoes]" >&2
+    exit 1
+fi
+
+for cfg in $CONFIGURACOES; do
+    make -s CONFIG="$cfg" "build/$cfg/tetris" "build/$cfg/bench_api" > /dev/null
+done
+
+# Mediana de uma lista de números (um por linha)
+mediana() {
+    sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+# Segundos do replay, da linha "Tempo: X s" que o executável escreve na stderr
+tempo_replay() {
+    "build/$1/tetris" --semente $SEMENTE --replay "$ACOES" 2>&1 > /dev/null | awk '/^Tempo:/ { print $2 }'
+}
+
+hash_replay() {
+    "build/$1/tetris" --semente $SEMENTE --replay "$ACOES" 2> /dev/null | awk '/^Hash do estado:/ { print $4 }'
+}
+
+# ns por ação da API (uma chamada por ação) e o hash, da saída JSON do bench_api
+medir_api() {
+    "build/$1/bench_api" --json --semente $SEMENTE --repeticoes "$REPETICOES" "$ACOES" |
+        sed 's/.*"ns_por_acao_chamada":\([0-9.]*\).*"hash":"\([0-9a-f]*\)".*/\1 \2/'
+}
+
+printf "%-8s %10s %10s %10s %12s %10s %10s %18s\n" "config" "replay s" "x debug" "x release" "API ns/acao" "x debug" \
+    "x release" "hash"
+referencia=""
+for cfg in $CONFIGURACOES; do
+    s=$(i=0; while [ $i -lt "$REPETICOES" ]; do tempo_replay "$cfg"; i=$((i + 1)); done | mediana)
+    set -- $(medir_api "$cfg")
+    api=$1
+    hash_api=$2
+    hash=$(hash_replay "$cfg")
+    if [ "$cfg" = debug ]; then s_debug=$s; api_debug=$api; fi
+    if [ "$cfg" = release ]; then s_release=$s; api_release=$api; fi
+    if [ -z "$referencia" ]; then referencia=$hash; fi
+    if [ "$hash" != "$referencia" ] || [ "$hash_api" != "$referencia" ]; then
+        echo "ERRO: $cfg chegou a outro hash (replay $hash, API $hash_api; esperado $referencia)." >&2
+        exit 1
+    fi
+    awk -v c="$cfg" -v s="$s" -v sd="$s_debug" -v sr="${s_release:-$s}" -v a="$api" -v ad="$api_debug" \
+        -v ar="${api_release:-$api}" -v h="$hash" \
+        'BEGIN { printf "%-8s %10.3f %9.2fx %9.2fx %12.2f %9.2fx %9.2fx %18s\n", c, s, sd / s, sr / s, a, ad / a, ar / a, h }'
+done
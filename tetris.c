@@ -1,19 +1,112 @@
+#define _GNU_SOURCE    // accept4 e SOCK_NONBLOCK/SOCK_CLOEXEC (modo servidor).
 #include <stdio.h>   // Inclui a biblioteca padrao de entrada e saida (printf, scanf, fgets, etc.)
-#include <stdlib.h>  // Inclui a biblioteca padrao (malloc, calloc, free, rand, srand) para alocacao dinamica e numeros aleatorios.
+#include <stdlib.h>  // Inclui a biblioteca padrao (malloc, calloc, free) para alocacao dinamica.
 #include <string.h>  // Inclui a biblioteca para manipulacao de strings (strcspn, strcpy, strcmp).
 #include <unistd.h>  // Biblioteca para manipulacao do tempo(sleep), simula tempo de espera.
-#include <time.h>    // Inclui a biblioteca para manipulacao de tempo (time), usada para inicializar o rand().
+#include <time.h>    // Inclui a biblioteca para manipulacao de tempo (time), usada como semente padrao do gerador.
+#include <stddef.h>  // offsetof, usado para somar os contadores da instrumentacao.
+#include <stdint.h>  // Tipos inteiros de largura fixa (uint64_t), usados no hash do estado.
+#include <stdarg.h>  // Argumentos variaveis (va_list), usados para formatar mensagens em buffers.
+#include <errno.h>   // Codigos de erro (EINTR), usados nas escritas com write().
+#include <pthread.h> // Threads (pthread_create, pthread_join), usadas pelo produtor de pecas.
+#include <sched.h>   // sched_yield, para ceder a CPU enquanto o canal de pecas esta cheio/vazio.
+#include <stdatomic.h> // Operacoes atomicas (acquire/release) do canal de pecas sem trava.
+#include <fcntl.h>     // open(), usado para mapear o diario de acoes.
+#include <sys/mman.h>  // mmap/munmap, leitura do diario de acoes direto da memoria.
+#include <sys/stat.h>  // fstat, tamanho do arquivo do diario.
+#include <signal.h>    // sigwait/pthread_sigmask, despejo das estatisticas com SIGUSR1.
+#include <sys/socket.h>   // Sockets do modo servidor.
+#include <sys/un.h>       // sockaddr_un, enderecos de sockets Unix.
+#include <sys/epoll.h>    // epoll, multiplexacao das conexoes do servidor.
+#include <sys/eventfd.h>  // eventfd, aviso de parada para os lacos do servidor.
+#include <sys/resource.h> // setrlimit, limite de descritores (uma conexao = um descritor).
+#include <ucontext.h>      // getcontext/makecontext/swapcontext, sessoes em corrotinas.
+#include "tetris.h"        // API publica da biblioteca (implementada no fim deste arquivo).
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc, contador de ciclos do processador.
+#endif
 
 
 // --- Definições de Estruturas e Constantes ---
 
-// Define a capacidade máxima da Fila de Peças (5)
+// Define a capacidade máxima da Fila de Peças (5). Pode ser trocada na compilação
+// com -DMAX_FILA=N (de 1 a 64) para as variantes com prévia maior ou menor.
+#ifndef MAX_FILA
 #define MAX_FILA 5
-// Define a capacidade máxima da Pilha de Reserva (3)
+#endif
+// Define a capacidade máxima da Pilha de Reserva (3). Pode ser trocada na compilação
+// com -DMAX_PILHA=N (de 1 a 16).
+#ifndef MAX_PILHA
 #define MAX_PILHA 3
+#endif
 
-// Variável global para gerar IDs únicos para as peças
-int proximo_id = 0;
+#if MAX_FILA < 1 || MAX_FILA > 64
+#error "MAX_FILA deve estar entre 1 e 64"
+#endif
+#if MAX_PILHA < 1 || MAX_PILHA > 16
+#error "MAX_PILHA deve estar entre 1 e 16"
+#endif
+
+// Reduz um índice no intervalo [0, 2 * MAX_FILA) para uma posição válida da fila circular.
+// Substitui o '% MAX_FILA' (uma divisão inteira) no caminho crítico:
+//  - capacidade potência de 2: uma máscara de bits;
+//  - demais capacidades: subtrai MAX_FILA sem desvio quando o índice passou do fim.
+// Compilar com -DFILA_USAR_MODULO volta ao '%' original (para comparação nos benchmarks).
+// O argumento é avaliado mais de uma vez: use apenas expressões sem efeitos colaterais.
+#if defined(FILA_USAR_MODULO)
+#define INDICE_FILA(i) ((i) % MAX_FILA)
+#elif (MAX_FILA & (MAX_FILA - 1)) == 0
+#define INDICE_FILA(i) ((i) & (MAX_FILA - 1))
+#else
+#define INDICE_FILA(i) ((i) - (MAX_FILA & -((i) >= MAX_FILA)))
+#endif
+
+// Número de tipos de peças ('I', 'O', 'T', 'L'); potência de 2, cada tipo cabe em 2 bits
+#define NUM_TIPOS_PECA 4
+
+// Tipos de peças disponíveis, indexados pelo código de 2 bits sorteado pelo gerador
+const char TIPOS_PECA[NUM_TIPOS_PECA] = {'I', 'O', 'T', 'L'};
+
+// O inverso de TIPOS_PECA, indexado pelo caractere: código + 1 de cada tipo (0 = não é um
+// tipo), lido por indice_tipo_peca sem percorrer TIPOS_PECA
+const unsigned char CODIGO_TIPO_PECA[256] = {['I'] = 1, ['O'] = 2, ['T'] = 3, ['L'] = 4};
+
+/**
+ * @brief Buffer de texto que cresce conforme necessário.
+ *
+ * dados: Conteúdo (sempre terminado em '\0' quando tamanho > 0).
+ * tamanho: Número de bytes usados.
+ * capacidade: Número de bytes alocados.
+ */
+typedef struct {
+    char *dados;
+    size_t tamanho;
+    size_t capacidade;
+} BufferSaida;
+
+// Quando diferente de zero, suprime toda a saída de console das ações (modo headless/replay)
+int modo_silencioso = 0;
+
+// Quando não é NULL, as mensagens das ações são acumuladas neste buffer em vez de
+// irem direto para a stdout (usado pelo renderizador para montar o quadro inteiro).
+_Thread_local BufferSaida *saida_mensagens = NULL;
+
+// Imprime uma mensagem de console apenas se o modo silencioso estiver desligado.
+// É uma macro (e não uma função) para que, no modo silencioso, o custo seja só um teste.
+// Na biblioteca (-DTETRIS_BIBLIOTECA) as ações nunca imprimem: a macro não gera código.
+#if defined(TETRIS_BIBLIOTECA)
+#define MENSAGEM(...) do { } while (0)
+#else
+#define MENSAGEM(...) do { \
+        if (!modo_silencioso) { \
+            if (saida_mensagens != NULL) buffer_printf(saida_mensagens, __VA_ARGS__); \
+            else printf(__VA_ARGS__); \
+        } \
+    } while (0)
+#endif
+
+// Tamanho do bloco lido de uma vez do arquivo de ações no modo replay (1 MiB)
+#define TAMANHO_BLOCO_REPLAY (1 << 20)
 
 /**
  * @brief Estrutura que representa uma Peça do Tetris.
@@ -52,6 +145,55 @@ typedef struct {
     int topo;
 } Pilha;
 
+/**
+ * @brief Resultado de uma ação do jogo (retornado pelas funções acao_* e executar_opcao).
+ */
+typedef enum {
+    ACAO_INVALIDA = -1,  // Código de opção fora do intervalo 0 a 5
+    ACAO_REJEITADA = 0,  // Pré-condição não atendida (fila/pilha vazia ou curta); nada mudou
+    ACAO_REALIZADA = 1,  // Ação executada
+    ACAO_DESCARTADA = 2  // Reservar com a pilha cheia: a peça saiu da fila e foi descartada
+} ResultadoAcao;
+
+/**
+ * @brief Modos de sorteio do gerador de peças.
+ *
+ * GERADOR_UNIFORME: cada peça tem tipo independente e uniforme entre os 4 tipos.
+ * GERADOR_SACO: os 4 tipos são embaralhados em um "saco" e entregues um a um;
+ *               quando o saco esvazia, um novo é embaralhado (sem secas longas).
+ * GERADOR_ROTEIRO: o tipo da próxima peça é definido de fora, em saco[0]
+ *               (usado para reproduzir as peças gravadas em um diário de ações).
+ */
+typedef enum {
+    GERADOR_UNIFORME,
+    GERADOR_SACO,
+    GERADOR_ROTEIRO
+} ModoGerador;
+
+/**
+ * @brief Estado de um gerador de peças (um por sessão).
+ *
+ * estado: Estado do PRNG xoshiro256**.
+ * bits / bits_restantes: Bits aleatórios ainda não consumidos; no modo uniforme cada
+ *   sorteio de 64 bits rende 32 peças (2 bits cada), tanto em gerarPeca quanto em gerarPecas,
+ *   de modo que as duas formas produzem exatamente a mesma sequência.
+ * proximo_id: ID da próxima peça gerada por esta sessão.
+ * modo: Modo de sorteio (uniforme ou saco).
+ * saco / restantes_saco: Saco embaralhado atual e quantas peças ainda restam nele.
+ * sorteios: Quantos valores de 64 bits o xoshiro já produziu (o histórico de ações usa a
+ *   diferença para voltar o gerador com gerador_voltar_u64).
+ */
+typedef struct {
+    uint64_t estado[4];
+    uint64_t sorteios;
+    uint64_t bits;
+    int bits_restantes;
+    int proximo_id;
+    ModoGerador modo;
+    char saco[NUM_TIPOS_PECA];
+    int restantes_saco;
+} GeradorPecas;
+
 // --- Funções de Utilitário e Limpeza ---
 
 /**
@@ -82,532 +224,7952 @@ void limpar_array_pecas(Peca array[], int tamanho) {
     }
 }
 
-// --- Funções de Peças e Inicialização ---
-
 /**
- * @brief Gera uma nova peça com um tipo aleatório e um ID único.
- * @return Peca A nova peça gerada.
+ * @brief Garante espaço para mais 'extra' bytes (e o '\0' final) no buffer.
+ * @param buffer Ponteiro para o buffer.
+ * @param extra Número de bytes que serão acrescentados.
+ * @return int 1 se há espaço, 0 se faltou memória.
  */
-Peca gerarPeca() {
-    Peca nova_peca;
-    // Array de tipos de peças disponíveis
-    char tipos[] = {'I', 'O', 'T', 'L'};
-    int num_tipos = sizeof(tipos) / sizeof(tipos[0]);
+int buffer_reservar(BufferSaida *buffer, size_t extra) {
+    size_t necessario = buffer->tamanho + extra + 1;
+    if (necessario > buffer->capacidade) {
+        size_t nova = buffer->capacidade ? buffer->capacidade : 256;
+        char *dados;
+        while (nova < necessario) nova *= 2;
+        dados = realloc(buffer->dados, nova);
+        if (dados == NULL) return 0;
+        buffer->dados = dados;
+        buffer->capacidade = nova;
+    }
+    return 1;
+}
 
-    // Escolhe um tipo de forma pseudo-aleatória
-    int indice_aleatorio = rand() % num_tipos;
-    nova_peca.nome = tipos[indice_aleatorio];
+/**
+ * @brief Acrescenta bytes ao final do buffer.
+ * @param buffer Ponteiro para o buffer.
+ * @param dados Bytes a acrescentar.
+ * @param n Número de bytes.
+ */
+void buffer_anexar(BufferSaida *buffer, const char *dados, size_t n) {
+    if (!buffer_reservar(buffer, n)) return;
+    memcpy(buffer->dados + buffer->tamanho, dados, n);
+    buffer->tamanho += n;
+    buffer->dados[buffer->tamanho] = '\0';
+}
 
-    // Atribui o ID único e incrementa o contador global
-    nova_peca.id = proximo_id;
-    proximo_id++;
+/**
+ * @brief Acrescenta texto formatado (como printf) ao final do buffer.
+ * @param buffer Ponteiro para o buffer.
+ * @param formato Formato no estilo printf.
+ */
+void buffer_printf(BufferSaida *buffer, const char *formato, ...) {
+    va_list args;
+    int n;
 
-    return nova_peca;
+    // Primeira tentativa no espaço que já existe; se não couber, cresce e formata de novo
+    if (!buffer_reservar(buffer, 128)) return;
+    va_start(args, formato);
+    n = vsnprintf(buffer->dados + buffer->tamanho, buffer->capacidade - buffer->tamanho, formato, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n >= buffer->capacidade - buffer->tamanho) {
+        if (!buffer_reservar(buffer, (size_t)n)) return;
+        va_start(args, formato);
+        vsnprintf(buffer->dados + buffer->tamanho, buffer->capacidade - buffer->tamanho, formato, args);
+        va_end(args);
+    }
+    buffer->tamanho += (size_t)n;
 }
 
 /**
- * @brief Inicializa a Fila Circular.
- * @param fila Ponteiro para a estrutura da fila.
+ * @brief Esvazia o buffer, mantendo a memória alocada para reuso.
+ * @param buffer Ponteiro para o buffer.
  */
-void inicializar_fila(FilaCircular *fila) {
-    fila->inicio = 0;          // O início aponta para a posição 0
-    fila->fim = 0;             // O fim (próxima posição livre) aponta para a posição 0
-    fila->tamanho_atual = 0;   // A fila começa vazia
-    limpar_array_pecas(fila->itens, MAX_FILA); // Limpa o array de itens
+void buffer_limpar(BufferSaida *buffer) {
+    buffer->tamanho = 0;
+    if (buffer->dados != NULL) buffer->dados[0] = '\0';
 }
 
 /**
- * @brief Inicializa a Pilha.
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Libera a memória do buffer.
+ * @param buffer Ponteiro para o buffer.
  */
-void inicializar_pilha(Pilha *pilha) {
-    pilha->topo = -1; // -1 indica que a pilha está vazia (o topo não aponta para nenhum elemento)
-    limpar_array_pecas(pilha->itens, MAX_PILHA); // Limpa o array de itens
+void buffer_liberar(BufferSaida *buffer) {
+    free(buffer->dados);
+    buffer->dados = NULL;
+    buffer->tamanho = 0;
+    buffer->capacidade = 0;
 }
 
 /**
- * @brief Preenche a fila com peças iniciais até a capacidade máxima.
- * @param fila Ponteiro para a estrutura da fila.
+ * @brief Escreve todos os bytes em um descritor de arquivo, repetindo em escritas parciais.
+ * @param fd Descritor de arquivo.
+ * @param dados Bytes a escrever.
+ * @param n Número de bytes.
+ * @return int 1 se tudo foi escrito, 0 em caso de erro.
  */
-void preencher_fila_inicial(FilaCircular *fila) {
-    printf("\n------------------------------------------------------\n");
-    printf("\n               *****ByteBros*****\n");
-    printf("\n------------------------------------------------------\n");
-    sleep(2.5);
-    printf("\n------------------------------------------------------\n");
-    printf("\n            ##### Tetris Stack #####\n");
-    printf("\n------------------------------------------------------\n");
-    sleep(2);
-
-    printf("\n--- Inicializando a Fila de Pecas ---\n");
-    while (fila->tamanho_atual < MAX_FILA) {
-        Peca nova = gerarPeca();
-        // Simula o enqueue (inserir)
-        fila->itens[fila->fim] = nova;
-        fila->fim = (fila->fim + 1) % MAX_FILA; // Move o 'fim' de forma circular
-        fila->tamanho_atual++;
-        printf("Peca [%c %d] adicionada.\n", nova.nome, nova.id);
+int escrever_tudo(int fd, const char *dados, size_t n) {
+    while (n > 0) {
+        ssize_t escritos = write(fd, dados, n);
+        if (escritos < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        dados += escritos;
+        n -= (size_t)escritos;
     }
+    return 1;
 }
 
-// --- Funções de Fila Circular (Queue) ---
-
 /**
- * @brief Verifica se a fila está cheia.
- * @param fila Ponteiro para a estrutura da fila.
- * @return int 1 se cheia, 0 caso contrário.
+ * @brief Lê o contador de ciclos do processador (0 se não houver um disponível).
+ * @return uint64_t Ciclos de referência do TSC.
  */
-int fila_cheia(FilaCircular *fila) {
-    // A fila está cheia se o tamanho atual for igual ao tamanho máximo
-    return fila->tamanho_atual == MAX_FILA;
+uint64_t ler_ciclos() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
 }
 
 /**
- * @brief Verifica se a fila está vazia.
- * @param fila Ponteiro para a estrutura da fila.
- * @return int 1 se vazia, 0 caso contrário.
+ * @brief Lê o relógio monotônico em nanossegundos.
  */
-int fila_vazia(FilaCircular *fila) {
-    // A fila está vazia se o tamanho atual for zero
-    return fila->tamanho_atual == 0;
+uint64_t ler_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
 }
 
 /**
- * @brief Insere uma peça no final da fila (enqueue).
- * @param fila Ponteiro para a estrutura da fila.
- * @param peca A peça a ser inserida.
- * @return int 1 se a inserção foi bem-sucedida, 0 caso contrário (fila cheia).
+ * @brief Comparação de doubles para qsort (as medianas e percentis dos benchmarks).
  */
-int enqueue(FilaCircular *fila, Peca peca) {
-    if (fila_cheia(fila)) {
-        // Não deve ocorrer neste programa, pois a fila será sempre mantida cheia,
-        // mas é um bom princípio de programação.
-        // printf("ERRO: Fila cheia. Nao e possivel inserir a peca [%c %d].\n", peca.nome, peca.id);
-        return 0;
-    }
-
-    // Insere a peça na posição de 'fim'
-    fila->itens[fila->fim] = peca;
-    // Move o 'fim' para a próxima posição livre de forma circular
-    fila->fim = (fila->fim + 1) % MAX_FILA;
-    // Incrementa o tamanho da fila
-    fila->tamanho_atual++;
-    return 1;
+int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
 }
 
-/**
- * @brief Remove a peça da frente da fila (dequeue).
- * @param fila Ponteiro para a estrutura da fila.
- * @param peca_removida Ponteiro para onde a peça removida será copiada.
- * @return int 1 se a remoção foi bem-sucedida, 0 caso contrário (fila vazia).
- */
-int dequeue(FilaCircular *fila, Peca *peca_removida) {
-    if (fila_vazia(fila)) {
-        printf("ERRO: Fila vazia. Nao e possivel remover pecas.\n");
-        return 0;
-    }
+// --- Instrumentação (Contadores e Histogramas) ---
+//
+// Compilando com -DTETRIS_INSTRUMENTACAO, cada ação conta chamadas, rejeições e descartes,
+// as primitivas contam as falhas (fila/pilha cheia ou vazia), e a latência de cada ação
+// (em ciclos) vai para um histograma com baldes em potências de 2. Sem a flag, todas as
+// macros INSTRUMENTAR_* viram nada e o código de instrumentação nem é compilado.
+// As estatísticas são despejadas na saída do programa e ao receber SIGUSR1.
 
-    // Copia a peça da frente da fila
-    *peca_removida = fila->itens[fila->inicio];
+#ifdef TETRIS_INSTRUMENTACAO
 
-    // "Limpa" a posição de início (opcional, mas boa prática para visualização)
-    fila->itens[fila->inicio].nome = '\0';
-    fila->itens[fila->inicio].id = -1;
+// Baldes do histograma de latência: o balde b conta as ações que levaram [2^b, 2^(b+1)) ciclos
+#define NUM_BALDES_LATENCIA 40
 
-    // Move o 'inicio' para a próxima peça de forma circular
-    fila->inicio = (fila->inicio + 1) % MAX_FILA;
-    // Decrementa o tamanho da fila
-    fila->tamanho_atual--;
-    return 1;
-}
+/**
+ * @brief Contadores de uma thread (somados com os das outras threads no despejo).
+ */
+typedef struct EstatisticasInstrumentacao {
+    long long chamadas[6];         // Chamadas de cada opção (0 a 5)
+    long long rejeitadas[6];       // Ações cuja pré-condição falhou
+    long long descartes;           // Reservas com a pilha cheia (peça descartada)
+    long long opcoes_invalidas;    // Códigos fora do intervalo 0 a 5
+    long long enqueue_fila_cheia;  // Falhas das primitivas
+    long long dequeue_fila_vazia;
+    long long push_pilha_cheia;
+    long long pop_pilha_vazia;
+    long long troca_simples_fila_vazia;    // Motivos de rejeição das trocas
+    long long troca_simples_pilha_vazia;
+    long long troca_multipla_fila_curta;
+    long long troca_multipla_pilha_curta;
+    long long ciclos_total[6];     // Soma dos ciclos de cada opção
+    long long latencia[6][NUM_BALDES_LATENCIA];
+    struct EstatisticasInstrumentacao *proxima; // Lista de todas as threads
+} EstatisticasInstrumentacao;
+
+// Contadores da thread atual (alocados no primeiro uso) e lista de todas as threads
+_Thread_local EstatisticasInstrumentacao *instrumentacao_local = NULL;
+EstatisticasInstrumentacao *instrumentacao_threads = NULL;
+pthread_mutex_t instrumentacao_trava = PTHREAD_MUTEX_INITIALIZER;
+// Arquivo do despejo em JSON (NULL = stderr, logo após o texto)
+const char *instrumentacao_arquivo_json = NULL;
 
 /**
- * @brief Retorna a peça da frente da fila sem removê-la (peek).
- * @param fila Ponteiro para a estrutura da fila.
- * @return Peca A peça da frente. Retorna uma peça com nome '\0' se a fila estiver vazia.
+ * @brief Aloca os contadores da thread atual e os registra na lista global.
+ * Os contadores nunca são liberados, para continuarem válidos depois que a thread termina.
+ * @return EstatisticasInstrumentacao* Os contadores da thread.
  */
-Peca frente_da_fila(FilaCircular *fila) {
-    if (fila_vazia(fila)) {
-        // Retorna uma peça vazia
-        Peca vazia = {'\0', -1};
-        return vazia;
-    }
-    // Retorna a peça no índice de 'inicio'
-    return fila->itens[fila->inicio];
+EstatisticasInstrumentacao *instrumentacao_registrar_thread() {
+    static EstatisticasInstrumentacao descarte; // Usado se faltar memória
+    EstatisticasInstrumentacao *e = calloc(1, sizeof(EstatisticasInstrumentacao));
+    if (e == NULL) return &descarte;
+    pthread_mutex_lock(&instrumentacao_trava);
+    e->proxima = instrumentacao_threads;
+    instrumentacao_threads = e;
+    pthread_mutex_unlock(&instrumentacao_trava);
+    instrumentacao_local = e;
+    return e;
 }
 
-// --- Funções de Pilha (Stack) ---
+// Contadores da thread atual (registrando-os no primeiro uso)
+#define INSTRUMENTACAO_LOCAL() \
+    (instrumentacao_local != NULL ? instrumentacao_local : instrumentacao_registrar_thread())
+// Incrementa um contador da thread atual
+#define INSTRUMENTAR(campo) (INSTRUMENTACAO_LOCAL()->campo++)
+// Marca o início de uma ação (declara a variável com os ciclos iniciais)
+#define INSTRUMENTAR_INICIO(var) uint64_t var = ler_ciclos()
+// Registra uma ação concluída: chamada, resultado e latência desde 'inicio'
+#define INSTRUMENTAR_ACAO(opcao, resultado, inicio) instrumentacao_registrar_acao((opcao), (resultado), (inicio))
 
 /**
- * @brief Verifica se a pilha está cheia.
- * @param pilha Ponteiro para a estrutura da pilha.
- * @return int 1 se cheia, 0 caso contrário.
+ * @brief Registra uma ação concluída nos contadores da thread atual.
+ * @param opcao Código da ação.
+ * @param resultado Resultado da ação.
+ * @param inicio Contador de ciclos no início da ação.
  */
-int pilha_cheia(Pilha *pilha) {
-    // A pilha está cheia se o topo for igual ao índice máximo (MAX_PILHA - 1)
-    return pilha->topo == MAX_PILHA - 1;
+void instrumentacao_registrar_acao(int opcao, ResultadoAcao resultado, uint64_t inicio) {
+    EstatisticasInstrumentacao *e = INSTRUMENTACAO_LOCAL();
+    uint64_t ciclos = ler_ciclos() - inicio;
+    int balde = ciclos ? 63 - __builtin_clzll(ciclos) : 0;
+
+    if (resultado == ACAO_INVALIDA || opcao < 0 || opcao > 5) {
+        e->opcoes_invalidas++;
+        return;
+    }
+    if (balde >= NUM_BALDES_LATENCIA) balde = NUM_BALDES_LATENCIA - 1;
+    e->chamadas[opcao]++;
+    e->rejeitadas[opcao] += (resultado == ACAO_REJEITADA);
+    e->descartes += (resultado == ACAO_DESCARTADA);
+    e->ciclos_total[opcao] += (long long)ciclos;
+    e->latencia[opcao][balde]++;
 }
 
 /**
- * @brief Verifica se a pilha está vazia.
- * @param pilha Ponteiro para a estrutura da pilha.
- * @return int 1 se vazia, 0 caso contrário.
+ * @brief Soma os contadores de todas as threads.
+ * @param total Estrutura que recebe a soma.
  */
-int pilha_vazia(Pilha *pilha) {
-    // A pilha está vazia se o topo for -1
-    return pilha->topo == -1;
+void instrumentacao_somar(EstatisticasInstrumentacao *total) {
+    EstatisticasInstrumentacao *e;
+    long long *destino = (long long *)total;
+    size_t campos = offsetof(EstatisticasInstrumentacao, proxima) / sizeof(long long);
+    size_t k;
+
+    memset(total, 0, sizeof(*total));
+    pthread_mutex_lock(&instrumentacao_trava);
+    for (e = instrumentacao_threads; e != NULL; e = e->proxima) {
+        const long long *origem = (const long long *)e;
+        for (k = 0; k < campos; k++) {
+            destino[k] += origem[k];
+        }
+    }
+    pthread_mutex_unlock(&instrumentacao_trava);
 }
 
 /**
- * @brief Insere uma peça no topo da pilha (push).
- * @param pilha Ponteiro para a estrutura da pilha.
- * @param peca A peça a ser inserida.
- * @return int 1 se a inserção foi bem-sucedida, 0 caso contrário (pilha cheia).
+ * @brief Estima um percentil de latência (limite superior do balde) a partir do histograma.
  */
-int push(Pilha *pilha, Peca peca) {
-    if (pilha_cheia(pilha)) {
-        printf("AVISO: Pilha de reserva cheia. Nao e possivel reservar a peca [%c %d].\n", peca.nome, peca.id);
-        return 0;
+unsigned long long instrumentacao_percentil(const long long *baldes, long long total, double fracao) {
+    long long alvo = (long long)(fracao * total);
+    long long acumulado = 0;
+    int b;
+    for (b = 0; b < NUM_BALDES_LATENCIA; b++) {
+        acumulado += baldes[b];
+        if (acumulado > alvo) return 1ULL << (b + 1);
     }
-
-    // Incrementa o topo
-    pilha->topo++;
-    // Insere a peça na nova posição do topo
-    pilha->itens[pilha->topo] = peca;
-    return 1;
+    return 1ULL << NUM_BALDES_LATENCIA;
 }
 
 /**
- * @brief Remove a peça do topo da pilha (pop).
- * @param pilha Ponteiro para a estrutura da pilha.
- * @param peca_removida Ponteiro para onde a peça removida será copiada.
- * @return int 1 se a remoção foi bem-sucedida, 0 caso contrário (pilha vazia).
+ * @brief Despeja as estatísticas: texto na stderr e JSON no arquivo configurado (ou na stderr).
  */
-int pop(Pilha *pilha, Peca *peca_removida) {
-    if (pilha_vazia(pilha)) {
-        printf("AVISO: Pilha de reserva vazia. Nao ha pecas para usar.\n");
-        return 0;
-    }
+void instrumentacao_despejar() {
+    EstatisticasInstrumentacao t;
+    FILE *json = stderr;
+    int i, b;
 
-    // Copia a peça do topo da pilha
-    *peca_removida = pilha->itens[pilha->topo];
+    instrumentacao_somar(&t);
 
-    // "Limpa" a posição do topo (opcional, mas boa prática)
-    pilha->itens[pilha->topo].nome = '\0';
-    pilha->itens[pilha->topo].id = -1;
+    fprintf(stderr, "\n--- Estatisticas das Acoes ---\n");
+    fprintf(stderr, "Opcao | chamadas   | rejeitadas | ciclos medios | p50 <=  | p99 <=\n");
+    for (i = 0; i <= 5; i++) {
+        if (t.chamadas[i] == 0) continue;
+        fprintf(stderr, "  %d   | %-10lld | %-10lld | %-13.1f | %-8llu | %llu\n", i, t.chamadas[i], t.rejeitadas[i],
+                (double)t.ciclos_total[i] / t.chamadas[i],
+                instrumentacao_percentil(t.latencia[i], t.chamadas[i], 0.50),
+                instrumentacao_percentil(t.latencia[i], t.chamadas[i], 0.99));
+    }
+    fprintf(stderr, "Descartes (pilha cheia): %lld | Opcoes invalidas: %lld\n", t.descartes, t.opcoes_invalidas);
+    fprintf(stderr, "Falhas: enqueue/fila cheia %lld, dequeue/fila vazia %lld, push/pilha cheia %lld, pop/pilha vazia %lld\n",
+            t.enqueue_fila_cheia, t.dequeue_fila_vazia, t.push_pilha_cheia, t.pop_pilha_vazia);
+    fprintf(stderr, "Trocas rejeitadas: simples (fila vazia %lld, pilha vazia %lld), multipla (fila curta %lld, pilha curta %lld)\n",
+            t.troca_simples_fila_vazia, t.troca_simples_pilha_vazia,
+            t.troca_multipla_fila_curta, t.troca_multipla_pilha_curta);
 
-    // Decrementa o topo
-    pilha->topo--;
-    return 1;
+    if (instrumentacao_arquivo_json != NULL) {
+        json = fopen(instrumentacao_arquivo_json, "w");
+        if (json == NULL) {
+            fprintf(stderr, "ERRO: Nao foi possivel gravar '%s'.\n", instrumentacao_arquivo_json);
+            return;
+        }
+    }
+    fprintf(json, "{\"acoes\":{");
+    for (i = 0; i <= 5; i++) {
+        fprintf(json, "%s\"%d\":{\"chamadas\":%lld,\"rejeitadas\":%lld,\"ciclos_total\":%lld,\"histograma_log2_ciclos\":[",
+                i ? "," : "", i, t.chamadas[i], t.rejeitadas[i], t.ciclos_total[i]);
+        for (b = 0; b < NUM_BALDES_LATENCIA; b++) {
+            fprintf(json, "%s%lld", b ? "," : "", t.latencia[i][b]);
+        }
+        fprintf(json, "]}");
+    }
+    fprintf(json, "},\"descartes\":%lld,\"opcoes_invalidas\":%lld,"
+                  "\"falhas\":{\"enqueue_fila_cheia\":%lld,\"dequeue_fila_vazia\":%lld,\"push_pilha_cheia\":%lld,"
+                  "\"pop_pilha_vazia\":%lld,\"troca_simples_fila_vazia\":%lld,\"troca_simples_pilha_vazia\":%lld,"
+                  "\"troca_multipla_fila_curta\":%lld,\"troca_multipla_pilha_curta\":%lld}}\n",
+            t.descartes, t.opcoes_invalidas, t.enqueue_fila_cheia, t.dequeue_fila_vazia, t.push_pilha_cheia,
+            t.pop_pilha_vazia, t.troca_simples_fila_vazia, t.troca_simples_pilha_vazia,
+            t.troca_multipla_fila_curta, t.troca_multipla_pilha_curta);
+    if (json != stderr) fclose(json);
 }
 
 /**
- * @brief Retorna a peça do topo da pilha sem removê-la (peek).
- * @param pilha Ponteiro para a estrutura da pilha.
- * @return Peca A peça do topo. Retorna uma peça com nome '\0' se a pilha estiver vazia.
+ * @brief Thread que espera SIGUSR1 e despeja as estatísticas a cada sinal.
+ * (O despejo roda fora do tratador de sinal, então pode usar stdio com segurança.)
  */
-Peca topo_da_pilha(Pilha *pilha) {
-    if (pilha_vazia(pilha)) {
-        // Retorna uma peça vazia
-        Peca vazia = {'\0', -1};
-        return vazia;
+void *instrumentacao_esperar_sinal(void *arg) {
+    sigset_t *sinais = arg;
+    int sinal;
+    for (;;) {
+        if (sigwait(sinais, &sinal) == 0 && sinal == SIGUSR1) {
+            instrumentacao_despejar();
+        }
     }
-    // Retorna a peça no índice de 'topo'
-    return pilha->itens[pilha->topo];
+    return NULL;
 }
 
-// --- Funções de Visualização ---
-
 /**
- * @brief Exibe o estado atual da Fila Circular e da Pilha.
- * @param fila Ponteiro para a estrutura da fila.
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Prepara o despejo por sinal. Deve ser chamada antes de criar outras threads,
+ * para que todas herdem o SIGUSR1 bloqueado e só a thread de despejo o receba.
+ * @param arquivo_json Arquivo do despejo em JSON (NULL = stderr).
  */
-void exibir_estado_atual(FilaCircular *fila, Pilha *pilha) {
-    int i;
+void instrumentacao_iniciar(const char *arquivo_json) {
+    static sigset_t sinais;
+    pthread_t thread;
 
-    printf("\n------------------------------------------------------\n");
-    printf("Estado Atual:\n");
+    instrumentacao_arquivo_json = arquivo_json;
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sinais, NULL);
+    if (pthread_create(&thread, NULL, instrumentacao_esperar_sinal, &sinais) == 0) {
+        pthread_detach(thread);
+    }
+}
 
-    // --- Visualização da Fila ---
-    printf("Fila de pecas (%d/%d): ", fila->tamanho_atual, MAX_FILA);
+#define INSTRUMENTACAO_INICIAR(arquivo_json) instrumentacao_iniciar(arquivo_json)
+#define INSTRUMENTACAO_DESPEJAR() instrumentacao_despejar()
 
-    if (fila_vazia(fila)) {
-        printf("Vazia\n");
-    } else {
-        // Percorre o array da fila do início ao fim (índice a índice)
-        for (i = 0; i < MAX_FILA; i++) {
-            // Verifica se a posição atual (i) é a de início da fila
-            if (i == fila->inicio && fila->tamanho_atual > 0) {
-                printf(" -> "); // Indicador do "início" (frente)
-            }
+#else // Sem instrumentação: nada é compilado
 
-            // A forma mais correta de percorrer os elementos ativos da fila circular
-            // seria: (fila->inicio + k) % MAX_FILA, onde k vai de 0 a tamanho_atual - 1.
-            // Para simplificar a visualização do array subjacente (como no exemplo),
-            // percorreremos o array completo e mostraremos apenas as posições válidas
-            // (e a posição no array).
+#define INSTRUMENTAR(campo) ((void)0)
+#define INSTRUMENTAR_INICIO(var) ((void)0)
+#define INSTRUMENTAR_ACAO(opcao, resultado, inicio) ((void)0)
+#define INSTRUMENTACAO_INICIAR(arquivo_json) ((void)(arquivo_json))
+#define INSTRUMENTACAO_DESPEJAR() ((void)0)
 
-            // Se o elemento na posição for válido (nome não é nulo)
-            if (fila->itens[i].nome != '\0') {
-                printf("[%c %d] ", fila->itens[i].nome, fila->itens[i].id);
-            } else {
-                // Mostra um marcador de posição vazia (se houver, o que só deve ocorrer
-                // em casos extremos ou após uma limpeza que não move o array, como
-                // ocorre aqui para visualizar a estrutura circular).
-                printf("[-- -] ");
-            }
+#endif // TETRIS_INSTRUMENTACAO
 
-            // Verifica se a posição atual (i) é a anterior ao 'fim' da fila
-            if (i == (fila->fim - 1 + MAX_FILA) % MAX_FILA && fila->tamanho_atual > 0) {
-                printf(" <- "); // Indicador do "fim" (traseira)
-            }
-        }
-        printf("\n");
-    }
+// --- Funções de Peças e Inicialização ---
 
-    // --- Visualização da Pilha ---
-    printf("Pilha de reserva (Topo -> Base) (%d/%d): ", pilha->topo + 1, MAX_PILHA);
+// --- Gerador de Peças ---
 
-    if (pilha_vazia(pilha)) {
-        printf("Vazia\n");
-    } else {
-        // Percorre a pilha do topo (maior índice) até a base (índice 0)
-        for (i = pilha->topo; i >= 0; i--) {
-            printf("[%c %d] ", pilha->itens[i].nome, pilha->itens[i].id);
-        }
-        printf("\n");
-    }
+// Gerador usado quando nenhuma sessão define o seu (modo interativo e replay)
+GeradorPecas gerador_padrao;
 
-    printf("------------------------------------------------------\n");
-}
+// Gerador usado por gerarPeca()/gerarPecas() na thread atual; cada sessão pode apontá-lo
+// para o seu próprio gerador, sem estado compartilhado escondido entre threads.
+_Thread_local GeradorPecas *gerador_ativo = &gerador_padrao;
 
 /**
- * @brief Exibe o menu de opções disponíveis.
+ * @brief Avança um estado SplitMix64 e retorna o próximo valor (usado só para semear).
+ * @param x Ponteiro para o estado do SplitMix64.
+ * @return uint64_t O próximo valor pseudo-aleatório.
  */
-void exibir_menu() {
-    printf("\nOpcoes disponiveis:\n");
-    printf("Codigo | Acao\n");
-    printf("-------|----------------------------------------------\n");
-    printf("  1    | Jogar peca da frente da fila (Dequeue)\n");
-    printf("  2    | Enviar peca da fila para a pilha de reserva\n");
-    printf("  3    | Usar peca da pilha de reserva (Pop)\n");
-    printf("  4    | Trocar peca da frente da fila com o topo da pilha\n");
-    printf("  5    | Trocar os 3 primeiros da fila com as 3 da pilha\n");
-    printf("  0    | Sair do programa\n");
-    printf("------------------------------------------------------\n");
-    printf("Opcao: ");
+uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-// --- Funções de Ação e Manipulação ---
-
 /**
- * @brief Executa a ação 1: Jogar uma peça (dequeue da fila).
- * @param fila Ponteiro para a estrutura da fila.
+ * @brief Retorna o próximo valor de 64 bits do xoshiro256** de um gerador.
+ * @param gerador Ponteiro para o gerador.
+ * @return uint64_t O valor sorteado.
  */
-void acao_jogar_peca(FilaCircular *fila) {
-    Peca peca_jogada;
-    // Tenta remover a peça da frente da fila
-    if (dequeue(fila, &peca_jogada)) {
-        printf("\nACAO: Peca [%c %d] jogada (removida da fila).\n", peca_jogada.nome, peca_jogada.id);
+uint64_t gerador_proximo_u64(GeradorPecas *gerador) {
+    uint64_t *s = gerador->estado;
+    uint64_t x = s[1] * 5;
+    uint64_t resultado = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
 
-        // Gera uma nova peça para preencher a vaga, mantendo a fila cheia (se possível)
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    gerador->sorteios++;
+    return resultado;
+}
+
+/**
+ * @brief Desfaz um passo do xoshiro256** (a transição é invertível), voltando o gerador
+ * ao estado anterior à última chamada de gerador_proximo_u64.
+ * Com s = estado antigo: s3 ^ s1 sai da rotação de s[3]; s1 ^ (s1 << 17) sai de
+ * s[1] ^ s[2]; e x ^ (x << 17) se inverte com x = y ^ (y << 17) ^ (y << 34) ^ (y << 51).
+ * @param gerador Ponteiro para o gerador.
+ */
+void gerador_voltar_u64(GeradorPecas *gerador) {
+    uint64_t *s = gerador->estado;
+    uint64_t s3_s1 = (s[3] >> 45) | (s[3] << 19);
+    uint64_t y = s[1] ^ s[2];
+    uint64_t s1 = y ^ (y << 17) ^ (y << 34) ^ (y << 51);
+    uint64_t s0 = s[0] ^ s3_s1;
+
+    s[2] = s[1] ^ s1 ^ s0;
+    s[3] = s3_s1 ^ s1;
+    s[1] = s1;
+    s[0] = s0;
+    gerador->sorteios--;
+}
+
+/**
+ * @brief Inicializa um gerador a partir de uma semente e de um número de fluxo.
+ * A mesma (semente, fluxo) sempre produz a mesma sequência de peças; fluxos diferentes
+ * (por exemplo, o índice da sessão) produzem sequências independentes.
+ * @param gerador Ponteiro para o gerador.
+ * @param semente Semente do jogo.
+ * @param fluxo Identificador do fluxo (0 para o gerador padrão).
+ * @param modo Modo de sorteio (uniforme ou saco).
+ */
+void gerador_inicializar(GeradorPecas *gerador, uint64_t semente, uint64_t fluxo, ModoGerador modo) {
+    uint64_t x = semente ^ (fluxo * 0xD1B54A32D192ED03ULL);
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        gerador->estado[i] = splitmix64(&x);
+    }
+    gerador->sorteios = 0;
+    gerador->bits = 0;
+    gerador->bits_restantes = 0;
+    gerador->proximo_id = 0;
+    gerador->modo = modo;
+    gerador->restantes_saco = 0;
+}
+
+/**
+ * @brief Sorteia o código (0 a 3) do tipo da próxima peça de um gerador.
+ * @param gerador Ponteiro para o gerador.
+ * @return int Índice em TIPOS_PECA.
+ */
+int gerador_sortear_tipo(GeradorPecas *gerador) {
+    int tipo;
+
+    if (gerador->modo == GERADOR_ROTEIRO) {
+        return gerador->saco[0];
+    }
+
+    if (gerador->modo == GERADOR_SACO) {
+        if (gerador->restantes_saco == 0) {
+            int i;
+            // Embaralha um saco novo (Fisher-Yates) com sorteios sem viés via multiplicação
+            for (i = 0; i < NUM_TIPOS_PECA; i++) {
+                gerador->saco[i] = (char)i;
+            }
+            for (i = NUM_TIPOS_PECA - 1; i > 0; i--) {
+                int j = (int)(((unsigned __int128)gerador_proximo_u64(gerador) * (unsigned)(i + 1)) >> 64);
+                char temp = gerador->saco[i];
+                gerador->saco[i] = gerador->saco[j];
+                gerador->saco[j] = temp;
+            }
+            gerador->restantes_saco = NUM_TIPOS_PECA;
+        }
+        return gerador->saco[NUM_TIPOS_PECA - gerador->restantes_saco--];
+    }
+
+    // Modo uniforme: consome 2 bits do sorteio de 64 bits em cache
+    if (gerador->bits_restantes == 0) {
+        gerador->bits = gerador_proximo_u64(gerador);
+        gerador->bits_restantes = 64;
+    }
+    tipo = (int)(gerador->bits & (NUM_TIPOS_PECA - 1));
+    gerador->bits >>= 2;
+    gerador->bits_restantes -= 2;
+    return tipo;
+}
+
+/**
+ * @brief Gera uma nova peça a partir de um gerador específico.
+ * @param gerador Ponteiro para o gerador.
+ * @return Peca A nova peça gerada.
+ */
+Peca gerador_gerar_peca(GeradorPecas *gerador) {
+    Peca nova_peca;
+    nova_peca.nome = TIPOS_PECA[gerador_sortear_tipo(gerador)];
+    // Atribui o ID único da sessão e incrementa o contador do gerador
+    nova_peca.id = gerador->proximo_id++;
+    return nova_peca;
+}
+
+/**
+ * @brief Gera n peças de uma vez a partir de um gerador específico.
+ * Produz exatamente a mesma sequência que n chamadas a gerador_gerar_peca. No modo uniforme,
+ * o trecho principal decodifica 32 peças por sorteio de 64 bits em um laço sem desvios,
+ * que o compilador consegue vetorizar.
+ * @param gerador Ponteiro para o gerador.
+ * @param destino Buffer com espaço para n peças.
+ * @param n Número de peças a gerar.
+ */
+void gerador_gerar_pecas(GeradorPecas *gerador, Peca *destino, int n) {
+    int k = 0;
+
+    if (gerador->modo == GERADOR_UNIFORME) {
+        // 1. Esgota os bits que sobraram do último sorteio
+        while (k < n && gerador->bits_restantes > 0) {
+            destino[k++] = gerador_gerar_peca(gerador);
+        }
+        // 2. Blocos completos de 32 peças por sorteio
+        while (n - k >= 32) {
+            uint64_t bits = gerador_proximo_u64(gerador);
+            int id_base = gerador->proximo_id;
+            int j;
+            for (j = 0; j < 32; j++) {
+                destino[k + j].nome = TIPOS_PECA[(bits >> (2 * j)) & (NUM_TIPOS_PECA - 1)];
+                destino[k + j].id = id_base + j;
+            }
+            gerador->proximo_id += 32;
+            k += 32;
+        }
+    }
+    // 3. O restante (e todo o modo saco) peça a peça
+    while (k < n) {
+        destino[k++] = gerador_gerar_peca(gerador);
+    }
+}
+
+// --- Análise de Peças (Distribuição em Fluxo) ---
+//
+// Acompanha a sequência de peças geradas sem guardá-la: histograma dos tipos, intervalos
+// entre duas peças do mesmo tipo (um intervalo d é uma seca de d - 1 peças sem o tipo),
+// tamanhos das sequências de peças iguais e, nas ações de reservar, quantas peças foram
+// descartadas com a pilha cheia. A memória é fixa (histogramas com MAX_INTERVALO_ANALISE
+// baldes), não importa quantas peças passem.
+//
+// As peças são processadas em lotes de 64: com SSE2, cada tipo vira uma máscara de 64
+// bits (um bit por peça). A contagem de cada tipo é um popcount, e os intervalos e as
+// sequências curtas também: deslocando a máscara de k posições (com os bits do lote
+// anterior entrando pela direita), as peças cuja anterior do mesmo tipo está exatamente k
+// posições atrás são (ainda sem par) & (máscara << k). Só os intervalos e as sequências
+// maiores que LIMITE_CURTO_ANALISE, raros, são medidos um a um.
+
+// Peças processadas de uma vez (uma máscara de 64 bits por tipo)
+#define LOTE_ANALISE 64
+// Intervalos e sequências até este tamanho são contados com popcount
+#define LIMITE_CURTO_ANALISE 16
+// Baldes dos histogramas de intervalos e de sequências (o último junta os maiores)
+#define MAX_INTERVALO_ANALISE 256
+// Peças entre dois relatórios parciais do --analisar (e do --analise), por padrão
+#define RELATORIO_ANALISE_PADRAO (1LL << 28)
+
+/**
+ * @brief Estado da análise de um fluxo de peças.
+ */
+typedef struct {
+    long long pecas;
+    long long por_tipo[NUM_TIPOS_PECA];
+    long long intervalos[NUM_TIPOS_PECA][MAX_INTERVALO_ANALISE]; // intervalos[t][d]: d peças até o próximo t
+    long long sequencias[NUM_TIPOS_PECA][MAX_INTERVALO_ANALISE]; // sequencias[t][n]: n peças t seguidas
+    long long maior_intervalo[NUM_TIPOS_PECA]; // Só os medidos um a um (ver analise_maior)
+    long long maior_sequencia[NUM_TIPOS_PECA];
+    long long ultima[NUM_TIPOS_PECA];  // Posição da última peça de cada tipo (-1: nenhuma ainda)
+    uint64_t anteriores[NUM_TIPOS_PECA]; // Máscaras das últimas 64 peças (bit 63: a mais recente)
+    int tipo_sequencia;                // Tipo da sequência em andamento (-1: nenhuma)
+    long long inicio_sequencia;        // Posição em que ela começou
+    long long reservas;                // Ações de reservar que tiraram uma peça da fila
+    long long descartes;               // ... e a descartaram porque a pilha estava cheia
+    long long intervalo_relatorio;     // Peças entre relatórios parciais na stderr (0: nenhum)
+    long long proximo_relatorio;
+    int usar_simd;                     // 0 força as máscaras escalares (para comparação)
+    int no_lote;
+    char lote[LOTE_ANALISE];
+} AnalisePecas;
+
+// Análise alimentada por gerarPeca()/gerarPecas() na thread atual (NULL = desligada)
+_Thread_local AnalisePecas *analise_ativa = NULL;
+
+/**
+ * @brief Zera uma análise.
+ * @param analise Ponteiro para a análise.
+ * @param intervalo_relatorio Peças entre relatórios parciais (0 para nenhum).
+ */
+void analise_iniciar(AnalisePecas *analise, long long intervalo_relatorio) {
+    int t;
+    memset(analise, 0, sizeof(*analise));
+    for (t = 0; t < NUM_TIPOS_PECA; t++) analise->ultima[t] = -1;
+    analise->tipo_sequencia = -1;
+    analise->usar_simd = 1;
+    analise->intervalo_relatorio = intervalo_relatorio;
+    analise->proximo_relatorio = intervalo_relatorio;
+}
+
+/**
+ * @brief Máscaras de um lote sem SIMD: o bit i da máscara t diz se a peça i é do tipo t.
+ */
+void analise_mascaras_escalar(const char *lote, uint64_t mascaras[NUM_TIPOS_PECA]) {
+    int i, t;
+    for (t = 0; t < NUM_TIPOS_PECA; t++) mascaras[t] = 0;
+    for (i = 0; i < LOTE_ANALISE; i++) {
+        for (t = 0; t < NUM_TIPOS_PECA; t++) {
+            mascaras[t] |= (uint64_t)(lote[i] == TIPOS_PECA[t]) << i;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief Máscaras de um lote com SSE2: 16 peças por comparação e PMOVMSKB.
+ */
+void analise_mascaras(const char *lote, uint64_t mascaras[NUM_TIPOS_PECA]) {
+    __m128i pecas[LOTE_ANALISE / 16];
+    int b, t;
+
+    for (b = 0; b < LOTE_ANALISE / 16; b++) {
+        pecas[b] = _mm_loadu_si128((const __m128i *)(lote + 16 * b));
+    }
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        __m128i tipo = _mm_set1_epi8(TIPOS_PECA[t]);
+        uint64_t m = 0;
+        for (b = 0; b < LOTE_ANALISE / 16; b++) {
+            m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(pecas[b], tipo)) << (16 * b);
+        }
+        mascaras[t] = m;
+    }
+}
+
+#else
+
+void analise_mascaras(const char *lote, uint64_t mascaras[NUM_TIPOS_PECA]) {
+    analise_mascaras_escalar(lote, mascaras);
+}
+
+#endif // __SSE2__
+
+/**
+ * @brief Anota um intervalo (ou uma sequência) em um histograma com o balde final aberto.
+ */
+void analise_anotar(long long *histograma, long long *maior, long long valor) {
+    histograma[valor < MAX_INTERVALO_ANALISE ? valor : MAX_INTERVALO_ANALISE - 1]++;
+    *maior = valor > *maior ? valor : *maior;
+}
+
+/**
+ * @brief Maior valor anotado em um histograma: o maior dos longos (guardado à parte) ou
+ * o maior balde curto não vazio.
+ */
+long long analise_maior(const long long *histograma, long long maior_longo) {
+    int k;
+    if (maior_longo > 0) return maior_longo;
+    for (k = LIMITE_CURTO_ANALISE; k > 0 && histograma[k] == 0; k--) {
+    }
+    return k;
+}
+
+/**
+ * @brief Início da sequência que contém a peça 'i' do lote (do tipo da máscara 'm').
+ * @param outras Bits das peças de outros tipos no lote.
+ */
+long long analise_inicio_sequencia(const AnalisePecas *analise, uint64_t outras, int i, int t) {
+    uint64_t antes = outras & ((1ULL << i) - 1);
+    if (antes != 0) return analise->pecas + 64 - __builtin_clzll(antes);
+    // Sem outro tipo no lote antes dela: a sequência veio do lote anterior, se era deste tipo
+    return analise->tipo_sequencia == t ? analise->inicio_sequencia : analise->pecas;
+}
+
+/**
+ * @brief Processa as peças acumuladas no lote (até LOTE_ANALISE).
+ */
+void analise_processar_lote(AnalisePecas *analise) {
+    uint64_t mascaras[NUM_TIPOS_PECA];
+    uint64_t validas;
+    long long base = analise->pecas;
+    int n = analise->no_lote;
+    int ultimo_tipo = 0;
+    int t, k;
+
+    if (n == 0) return;
+    // O resto de um lote parcial nunca é um tipo de peça
+    memset(analise->lote + n, 0, LOTE_ANALISE - n);
+    validas = n == LOTE_ANALISE ? ~0ULL : (1ULL << n) - 1;
+    if (analise->usar_simd) {
+        analise_mascaras(analise->lote, mascaras);
+    } else {
+        analise_mascaras_escalar(analise->lote, mascaras);
+    }
+
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        uint64_t m = mascaras[t];
+        uint64_t anterior = analise->anteriores[t];
+        uint64_t outras = ~m & validas;
+        // Peças ainda sem o intervalo medido / peças que encerram uma sequência de t
+        uint64_t sem_par = m;
+        uint64_t fins = outras & ((m << 1) | (anterior >> 63));
+        long long *intervalos = analise->intervalos[t];
+        long long *sequencias = analise->sequencias[t];
+
+        analise->por_tipo[t] += __builtin_popcountll(m);
+        if (m >> (n - 1) & 1) ultimo_tipo = t;
+
+        // Os maiores intervalos e sequências curtos saem dos histogramas (analise_maior)
+        for (k = 1; k <= LIMITE_CURTO_ANALISE && (sem_par | fins) != 0; k++) {
+            uint64_t deslocada = (m << k) | (anterior >> (64 - k)); // bit i: peça i - k é do tipo t
+            intervalos[k] += __builtin_popcountll(sem_par & deslocada);
+            sem_par &= ~deslocada;
+            // Uma sequência de k - 1 peças termina em um fim sem peça do tipo k posições antes dele
+            sequencias[k - 1] += __builtin_popcountll(fins & ~deslocada);
+            fins &= deslocada;
+        }
+
+        // Os intervalos longos (e a primeira peça do tipo, que não tem intervalo)
+        while (sem_par != 0) {
+            int i = __builtin_ctzll(sem_par);
+            uint64_t antes = m & ((1ULL << i) - 1);
+            long long anterior_tipo = antes != 0 ? base + 63 - __builtin_clzll(antes) : analise->ultima[t];
+            if (anterior_tipo >= 0) {
+                analise_anotar(intervalos, &analise->maior_intervalo[t], base + i - anterior_tipo);
+            }
+            sem_par &= sem_par - 1;
+        }
+        // As sequências com LIMITE_CURTO_ANALISE peças ou mais
+        while (fins != 0) {
+            int i = __builtin_ctzll(fins);
+            analise_anotar(sequencias, &analise->maior_sequencia[t],
+                           base + i - analise_inicio_sequencia(analise, outras, i, t));
+            fins &= fins - 1;
+        }
+
+        if (m != 0) analise->ultima[t] = base + 63 - __builtin_clzll(m);
+        analise->anteriores[t] = n == LOTE_ANALISE ? m : (m << (64 - n)) | (anterior >> n);
+    }
+
+    // A sequência que fica aberta é a da última peça do lote
+    {
+        uint64_t outras = ~mascaras[ultimo_tipo] & validas;
+        long long inicio = analise_inicio_sequencia(analise, outras, n - 1, ultimo_tipo);
+        analise->tipo_sequencia = ultimo_tipo;
+        analise->inicio_sequencia = inicio;
+    }
+
+    analise->pecas += n;
+    analise->no_lote = 0;
+}
+
+void analise_imprimir_parcial(AnalisePecas *analise, FILE *saida);
+
+/**
+ * @brief Acrescenta peças à análise (em lotes de LOTE_ANALISE), com relatórios parciais
+ * na stderr a cada 'intervalo_relatorio' peças.
+ */
+void analise_consumir(AnalisePecas *analise, const Peca *pecas, int n) {
+    int k;
+    for (k = 0; k < n; k++) {
+        analise->lote[analise->no_lote++] = pecas[k].nome;
+        if (analise->no_lote == LOTE_ANALISE) {
+            analise_processar_lote(analise);
+            if (analise->intervalo_relatorio > 0 && analise->pecas >= analise->proximo_relatorio) {
+                analise->proximo_relatorio += analise->intervalo_relatorio;
+                analise_imprimir_parcial(analise, stderr);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Registra o resultado de uma ação de reservar que tirou uma peça da fila.
+ */
+void analise_registrar_reserva(AnalisePecas *analise, int descartada) {
+    analise->reservas++;
+    analise->descartes += descartada;
+}
+
+/**
+ * @brief Qui-quadrado das contagens por tipo contra a distribuição uniforme (3 graus de
+ * liberdade; acima de 7,81 a uniformidade é rejeitada a 5%, acima de 11,34 a 1%).
+ */
+double analise_qui_quadrado(const AnalisePecas *analise) {
+    double esperado = (double)analise->pecas / NUM_TIPOS_PECA;
+    double soma = 0.0;
+    int t;
+    if (analise->pecas == 0) return 0.0;
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        double d = analise->por_tipo[t] - esperado;
+        soma += d * d / esperado;
+    }
+    return soma;
+}
+
+/**
+ * @brief Menor valor v tal que a fração 'q' das entradas do histograma é <= v.
+ */
+long long analise_percentil(const long long *histograma, double q) {
+    long long total = 0, acumulado = 0;
+    int v;
+    for (v = 0; v < MAX_INTERVALO_ANALISE; v++) total += histograma[v];
+    for (v = 0; v < MAX_INTERVALO_ANALISE; v++) {
+        acumulado += histograma[v];
+        if (total > 0 && acumulado >= q * total) return v;
+    }
+    return 0;
+}
+
+/**
+ * @brief Maior seca de um tipo (peças seguidas sem ele), contando a que ainda está aberta.
+ */
+long long analise_maior_seca(const AnalisePecas *analise, int t) {
+    long long maior = analise_maior(analise->intervalos[t], analise->maior_intervalo[t]);
+    long long fechada = maior > 0 ? maior - 1 : 0;
+    long long aberta = analise->pecas - analise->ultima[t] - 1;
+    return aberta > fechada ? aberta : fechada;
+}
+
+/**
+ * @brief Imprime uma linha curta com o andamento da análise.
+ */
+void analise_imprimir_parcial(AnalisePecas *analise, FILE *saida) {
+    int t;
+    analise_processar_lote(analise);
+    fprintf(saida, "[analise] %lld pecas | qui-quadrado %.2f | maior seca:", analise->pecas,
+            analise_qui_quadrado(analise));
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        fprintf(saida, " %c=%lld", TIPOS_PECA[t], analise_maior_seca(analise, t));
+    }
+    if (analise->reservas > 0) {
+        fprintf(saida, " | descartes %lld/%lld", analise->descartes, analise->reservas);
+    }
+    fprintf(saida, "\n");
+}
+
+/**
+ * @brief Imprime o relatório completo da análise.
+ */
+void analise_imprimir(AnalisePecas *analise, FILE *saida) {
+    double qui;
+    int t;
+
+    analise_processar_lote(analise);
+    qui = analise_qui_quadrado(analise);
+    fprintf(saida, "--- Analise de Pecas ---\n");
+    fprintf(saida, "Pecas: %lld | Qui-quadrado (3 g.l.): %.3f (%s)\n", analise->pecas, qui,
+            qui < 7.815 ? "compativel com a distribuicao uniforme a 5%" : "uniformidade rejeitada a 5%");
+    fprintf(saida, "Tipo %14s %8s | %9s %5s %5s %5s | %10s %10s | %9s %6s\n", "pecas", "%", "intervalo", "p50",
+            "p99", "p99.9", "maior seca", "seca atual", "sequencia", "maior");
+    for (t = 0; t < NUM_TIPOS_PECA; t++) {
+        long long soma = 0, n = 0, soma_seq = 0, n_seq = 0;
+        int v;
+        for (v = 1; v < MAX_INTERVALO_ANALISE; v++) {
+            soma += v * analise->intervalos[t][v];
+            n += analise->intervalos[t][v];
+            soma_seq += v * analise->sequencias[t][v];
+            n_seq += analise->sequencias[t][v];
+        }
+        fprintf(saida, "  %c  %14lld %7.3f%% | %9.3f %5lld %5lld %5lld | %10lld %10lld | %9.3f %6lld\n",
+                TIPOS_PECA[t], analise->por_tipo[t],
+                analise->pecas ? 100.0 * analise->por_tipo[t] / analise->pecas : 0.0,
+                n ? (double)soma / n : 0.0, analise_percentil(analise->intervalos[t], 0.5),
+                analise_percentil(analise->intervalos[t], 0.99), analise_percentil(analise->intervalos[t], 0.999),
+                analise_maior_seca(analise, t), analise->pecas - analise->ultima[t] - 1,
+                n_seq ? (double)soma_seq / n_seq : 0.0, analise_maior(analise->sequencias[t], analise->maior_sequencia[t]));
+    }
+    fprintf(saida, "(intervalo: pecas ate a proxima do mesmo tipo; seca = intervalo - 1; "
+                   "valores a partir de %d contam no ultimo balde dos percentis)\n", MAX_INTERVALO_ANALISE - 1);
+    if (analise->reservas > 0) {
+        fprintf(saida, "Reservas: %lld | Descartes com a pilha cheia: %lld (%.2f%%)\n", analise->reservas,
+                analise->descartes, 100.0 * analise->descartes / analise->reservas);
+    }
+}
+
+// Peças geradas por vez no modo --analisar
+#define BLOCO_ANALISE 4096
+
+/**
+ * @brief Modo --analisar: gera N peças com o gerador padrão (sem fila, pilha nem tabuleiro)
+ * e imprime o relatório da distribuição, com relatórios parciais na stderr.
+ * @param num_pecas Peças a gerar.
+ * @param intervalo_relatorio Peças entre relatórios parciais (0 para nenhum).
+ * @return int 0 em caso de sucesso, 1 se faltar memória.
+ */
+int executar_analise(long long num_pecas, long long intervalo_relatorio) {
+    AnalisePecas *analise = malloc(sizeof(AnalisePecas));
+    Peca bloco[BLOCO_ANALISE];
+    long long k = 0;
+    struct timespec t_inicio, t_fim;
+
+    if (analise == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para a analise.\n");
+        return 1;
+    }
+    analise_iniciar(analise, intervalo_relatorio);
+
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    while (k < num_pecas) {
+        int n = num_pecas - k < BLOCO_ANALISE ? (int)(num_pecas - k) : BLOCO_ANALISE;
+        gerador_gerar_pecas(&gerador_padrao, bloco, n);
+        // Os IDs não interessam aqui e estourariam um int depois de alguns bilhões de peças
+        gerador_padrao.proximo_id = 0;
+        analise_consumir(analise, bloco, n);
+        k += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+
+    analise_imprimir(analise, stdout);
+    {
+        double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        fprintf(stderr, "Tempo: %.3f s (%.1f milhoes de pecas/s, geracao incluida)\n", segundos,
+                segundos > 0 ? num_pecas / segundos / 1e6 : 0.0);
+    }
+    free(analise);
+    return 0;
+}
+
+// --- Canal de Peças (Produtor/Consumidor sem Trava) ---
+
+// Capacidade do canal de peças (potência de 2: a posição é o contador com máscara)
+#define CAPACIDADE_CANAL 4096
+// Quantas peças o produtor gera de uma vez, no mínimo, antes de publicar
+#define LOTE_CANAL 256
+// Tamanho de uma linha de cache; cabeça e cauda ficam em linhas diferentes
+#define LINHA_CACHE 64
+
+/**
+ * @brief Canal de peças de um produtor para um consumidor (SPSC), sem trava.
+ *
+ * Segue a ideia da FilaCircular (array circular com início e fim), mas com contadores
+ * que só crescem: a posição no array é contador & (CAPACIDADE_CANAL - 1) e o tamanho
+ * é cauda - cabeca. A thread produtora gera peças em lotes (gerador_gerar_pecas) e
+ * publica a cauda com release; a thread do jogo consome e publica a cabeça com release.
+ * Cada lado guarda uma cópia do índice do outro lado e só a relê quando ela não basta,
+ * e cada índice fica em sua própria linha de cache para evitar falso compartilhamento.
+ *
+ * Como há um único produtor com um gerador semeado, a sequência recebida é exatamente
+ * a mesma que gerarPeca() produziria de forma síncrona com o mesmo gerador.
+ */
+typedef struct {
+    // Lado do consumidor
+    _Alignas(LINHA_CACHE) _Atomic size_t cabeca; // Próxima peça a consumir
+    size_t cauda_vista;                          // Última cauda lida pelo consumidor
+    // Lado do produtor
+    _Alignas(LINHA_CACHE) _Atomic size_t cauda;  // Próxima posição a preencher
+    size_t cabeca_vista;                         // Última cabeça lida pelo produtor
+    GeradorPecas gerador;                        // Gerador usado só pela thread produtora
+    // Controle
+    _Alignas(LINHA_CACHE) _Atomic int encerrar;  // Pedido de parada para o produtor
+    pthread_t thread;
+    _Alignas(LINHA_CACHE) Peca itens[CAPACIDADE_CANAL];
+} CanalPecas;
+
+// Canal consumido por gerarPeca() na thread atual (NULL = geração síncrona)
+_Thread_local CanalPecas *canal_ativo = NULL;
+
+/**
+ * @brief Laço da thread produtora: gera peças enquanto houver espaço no canal.
+ * @param arg Ponteiro para o CanalPecas.
+ * @return void* Sempre NULL.
+ */
+void *canal_produtor(void *arg) {
+    CanalPecas *canal = arg;
+    size_t cauda = atomic_load_explicit(&canal->cauda, memory_order_relaxed);
+
+    while (!atomic_load_explicit(&canal->encerrar, memory_order_relaxed)) {
+        size_t livres = CAPACIDADE_CANAL - (cauda - canal->cabeca_vista);
+        size_t posicao, n;
+
+        if (livres < LOTE_CANAL) {
+            // Relê a cabeça só quando a cópia local indica que falta espaço
+            canal->cabeca_vista = atomic_load_explicit(&canal->cabeca, memory_order_acquire);
+            livres = CAPACIDADE_CANAL - (cauda - canal->cabeca_vista);
+            if (livres < LOTE_CANAL) {
+                sched_yield();
+                continue;
+            }
+        }
+
+        // Gera um trecho contíguo (até o fim do array) e publica de uma vez
+        posicao = cauda & (CAPACIDADE_CANAL - 1);
+        n = CAPACIDADE_CANAL - posicao;
+        if (n > livres) n = livres;
+        gerador_gerar_pecas(&canal->gerador, &canal->itens[posicao], (int)n);
+        cauda += n;
+        atomic_store_explicit(&canal->cauda, cauda, memory_order_release);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Cria um canal e inicia a thread produtora a partir de uma cópia do gerador.
+ * @param origem Gerador cujo estado (semente, posição e IDs) o produtor continua.
+ * @return CanalPecas* O canal criado, ou NULL em caso de falha.
+ */
+CanalPecas *canal_criar(GeradorPecas *origem) {
+    CanalPecas *canal = aligned_alloc(LINHA_CACHE, sizeof(CanalPecas));
+    if (canal == NULL) return NULL;
+
+    atomic_init(&canal->cabeca, 0);
+    atomic_init(&canal->cauda, 0);
+    atomic_init(&canal->encerrar, 0);
+    canal->cauda_vista = 0;
+    canal->cabeca_vista = 0;
+    canal->gerador = *origem;
+
+    if (pthread_create(&canal->thread, NULL, canal_produtor, canal) != 0) {
+        free(canal);
+        return NULL;
+    }
+    return canal;
+}
+
+/**
+ * @brief Para a thread produtora e libera o canal.
+ * @param canal Ponteiro para o canal.
+ */
+void canal_destruir(CanalPecas *canal) {
+    atomic_store_explicit(&canal->encerrar, 1, memory_order_relaxed);
+    pthread_join(canal->thread, NULL);
+    free(canal);
+}
+
+/**
+ * @brief Retira a próxima peça do canal (lado do consumidor), esperando se estiver vazio.
+ * @param canal Ponteiro para o canal.
+ * @return Peca A próxima peça gerada.
+ */
+Peca canal_receber(CanalPecas *canal) {
+    size_t cabeca = atomic_load_explicit(&canal->cabeca, memory_order_relaxed);
+    Peca peca;
+
+    while (cabeca == canal->cauda_vista) {
+        // Relê a cauda só quando a cópia local indica que o canal está vazio
+        canal->cauda_vista = atomic_load_explicit(&canal->cauda, memory_order_acquire);
+        if (cabeca == canal->cauda_vista) sched_yield();
+    }
+    peca = canal->itens[cabeca & (CAPACIDADE_CANAL - 1)];
+    atomic_store_explicit(&canal->cabeca, cabeca + 1, memory_order_release);
+    return peca;
+}
+
+/**
+ * @brief Gera uma nova peça com um tipo aleatório e um ID único, usando o gerador ativo
+ * (ou retirando-a do canal ativo, quando a geração roda em uma thread produtora).
+ * @return Peca A nova peça gerada.
+ */
+Peca gerarPeca() {
+    Peca peca;
+    if (canal_ativo != NULL) {
+        // Peça já gerada pela thread produtora; o contador de IDs da sessão acompanha o consumo
+        peca = canal_receber(canal_ativo);
+        gerador_ativo->proximo_id = peca.id + 1;
+    } else {
+        peca = gerador_gerar_peca(gerador_ativo);
+    }
+    if (analise_ativa != NULL) analise_consumir(analise_ativa, &peca, 1);
+    return peca;
+}
+
+/**
+ * @brief Gera n peças de uma vez usando o gerador ativo.
+ * @param destino Buffer com espaço para n peças.
+ * @param n Número de peças a gerar.
+ */
+void gerarPecas(Peca *destino, int n) {
+    int k;
+    if (canal_ativo != NULL) {
+        for (k = 0; k < n; k++) {
+            destino[k] = gerarPeca();
+        }
+        return;
+    }
+    gerador_gerar_pecas(gerador_ativo, destino, n);
+    if (analise_ativa != NULL) analise_consumir(analise_ativa, destino, n);
+}
+
+/**
+ * @brief Inicializa a Fila Circular.
+ * @param fila Ponteiro para a estrutura da fila.
+ */
+void inicializar_fila(FilaCircular *fila) {
+    fila->inicio = 0;          // O início aponta para a posição 0
+    fila->fim = 0;             // O fim (próxima posição livre) aponta para a posição 0
+    fila->tamanho_atual = 0;   // A fila começa vazia
+    limpar_array_pecas(fila->itens, MAX_FILA); // Limpa o array de itens
+}
+
+/**
+ * @brief Inicializa a Pilha.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ */
+void inicializar_pilha(Pilha *pilha) {
+    pilha->topo = -1; // -1 indica que a pilha está vazia (o topo não aponta para nenhum elemento)
+    limpar_array_pecas(pilha->itens, MAX_PILHA); // Limpa o array de itens
+}
+
+/**
+ * @brief Exibe a tela de abertura do jogo (com as pausas de apresentação).
+ * Chamada apenas no modo interativo; o modo replay pula a abertura.
+ */
+void exibir_abertura() {
+    printf("\n------------------------------------------------------\n");
+    printf("\n               *****ByteBros*****\n");
+    printf("\n------------------------------------------------------\n");
+    sleep(2.5);
+    printf("\n------------------------------------------------------\n");
+    printf("\n            ##### Tetris Stack #####\n");
+    printf("\n------------------------------------------------------\n");
+    sleep(2);
+}
+
+/**
+ * @brief Preenche a fila com peças iniciais até a capacidade máxima.
+ * @param fila Ponteiro para a estrutura da fila.
+ */
+void preencher_fila_inicial(FilaCircular *fila) {
+    MENSAGEM("\n--- Inicializando a Fila de Pecas ---\n");
+    while (fila->tamanho_atual < MAX_FILA) {
+        Peca nova = gerarPeca();
+        // Simula o enqueue (inserir)
+        fila->itens[fila->fim] = nova;
+        fila->fim = INDICE_FILA(fila->fim + 1); // Move o 'fim' de forma circular
+        fila->tamanho_atual++;
+        MENSAGEM("Peca [%c %d] adicionada.\n", nova.nome, nova.id);
+    }
+}
+
+// --- Funções de Fila Circular (Queue) ---
+
+/**
+ * @brief Verifica se a fila está cheia.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @return int 1 se cheia, 0 caso contrário.
+ */
+int fila_cheia(FilaCircular *fila) {
+    // A fila está cheia se o tamanho atual for igual ao tamanho máximo
+    return fila->tamanho_atual == MAX_FILA;
+}
+
+/**
+ * @brief Verifica se a fila está vazia.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @return int 1 se vazia, 0 caso contrário.
+ */
+int fila_vazia(FilaCircular *fila) {
+    // A fila está vazia se o tamanho atual for zero
+    return fila->tamanho_atual == 0;
+}
+
+/**
+ * @brief Insere uma peça no final da fila (enqueue).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param peca A peça a ser inserida.
+ * @return int 1 se a inserção foi bem-sucedida, 0 caso contrário (fila cheia).
+ */
+int enqueue(FilaCircular *fila, Peca peca) {
+    if (fila_cheia(fila)) {
+        INSTRUMENTAR(enqueue_fila_cheia);
+        // Não deve ocorrer neste programa, pois a fila será sempre mantida cheia,
+        // mas é um bom princípio de programação.
+        // printf("ERRO: Fila cheia. Nao e possivel inserir a peca [%c %d].\n", peca.nome, peca.id);
+        return 0;
+    }
+
+    // Insere a peça na posição de 'fim'
+    fila->itens[fila->fim] = peca;
+    // Move o 'fim' para a próxima posição livre de forma circular
+    fila->fim = INDICE_FILA(fila->fim + 1);
+    // Incrementa o tamanho da fila
+    fila->tamanho_atual++;
+    return 1;
+}
+
+/**
+ * @brief Remove a peça da frente da fila (dequeue).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param peca_removida Ponteiro para onde a peça removida será copiada.
+ * @return int 1 se a remoção foi bem-sucedida, 0 caso contrário (fila vazia).
+ */
+int dequeue(FilaCircular *fila, Peca *peca_removida) {
+    if (fila_vazia(fila)) {
+        INSTRUMENTAR(dequeue_fila_vazia);
+        MENSAGEM("ERRO: Fila vazia. Nao e possivel remover pecas.\n");
+        return 0;
+    }
+
+    // Copia a peça da frente da fila
+    *peca_removida = fila->itens[fila->inicio];
+
+    // "Limpa" a posição de início (opcional, mas boa prática para visualização)
+    fila->itens[fila->inicio].nome = '\0';
+    fila->itens[fila->inicio].id = -1;
+
+    // Move o 'inicio' para a próxima peça de forma circular
+    fila->inicio = INDICE_FILA(fila->inicio + 1);
+    // Decrementa o tamanho da fila
+    fila->tamanho_atual--;
+    return 1;
+}
+
+/**
+ * @brief Retorna a peça da frente da fila sem removê-la (peek).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @return Peca A peça da frente. Retorna uma peça com nome '\0' se a fila estiver vazia.
+ */
+Peca frente_da_fila(FilaCircular *fila) {
+    if (fila_vazia(fila)) {
+        // Retorna uma peça vazia
+        Peca vazia = {'\0', -1};
+        return vazia;
+    }
+    // Retorna a peça no índice de 'inicio'
+    return fila->itens[fila->inicio];
+}
+
+// --- Funções de Pilha (Stack) ---
+
+/**
+ * @brief Verifica se a pilha está cheia.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return int 1 se cheia, 0 caso contrário.
+ */
+int pilha_cheia(Pilha *pilha) {
+    // A pilha está cheia se o topo for igual ao índice máximo (MAX_PILHA - 1)
+    return pilha->topo == MAX_PILHA - 1;
+}
+
+/**
+ * @brief Verifica se a pilha está vazia.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return int 1 se vazia, 0 caso contrário.
+ */
+int pilha_vazia(Pilha *pilha) {
+    // A pilha está vazia se o topo for -1
+    return pilha->topo == -1;
+}
+
+/**
+ * @brief Insere uma peça no topo da pilha (push).
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @param peca A peça a ser inserida.
+ * @return int 1 se a inserção foi bem-sucedida, 0 caso contrário (pilha cheia).
+ */
+int push(Pilha *pilha, Peca peca) {
+    if (pilha_cheia(pilha)) {
+        INSTRUMENTAR(push_pilha_cheia);
+        MENSAGEM("AVISO: Pilha de reserva cheia. Nao e possivel reservar a peca [%c %d].\n", peca.nome, peca.id);
+        return 0;
+    }
+
+    // Incrementa o topo
+    pilha->topo++;
+    // Insere a peça na nova posição do topo
+    pilha->itens[pilha->topo] = peca;
+    return 1;
+}
+
+/**
+ * @brief Remove a peça do topo da pilha (pop).
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @param peca_removida Ponteiro para onde a peça removida será copiada.
+ * @return int 1 se a remoção foi bem-sucedida, 0 caso contrário (pilha vazia).
+ */
+int pop(Pilha *pilha, Peca *peca_removida) {
+    if (pilha_vazia(pilha)) {
+        INSTRUMENTAR(pop_pilha_vazia);
+        MENSAGEM("AVISO: Pilha de reserva vazia. Nao ha pecas para usar.\n");
+        return 0;
+    }
+
+    // Copia a peça do topo da pilha
+    *peca_removida = pilha->itens[pilha->topo];
+
+    // "Limpa" a posição do topo (opcional, mas boa prática)
+    pilha->itens[pilha->topo].nome = '\0';
+    pilha->itens[pilha->topo].id = -1;
+
+    // Decrementa o topo
+    pilha->topo--;
+    return 1;
+}
+
+/**
+ * @brief Retorna a peça do topo da pilha sem removê-la (peek).
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return Peca A peça do topo. Retorna uma peça com nome '\0' se a pilha estiver vazia.
+ */
+Peca topo_da_pilha(Pilha *pilha) {
+    if (pilha_vazia(pilha)) {
+        // Retorna uma peça vazia
+        Peca vazia = {'\0', -1};
+        return vazia;
+    }
+    // Retorna a peça no índice de 'topo'
+    return pilha->itens[pilha->topo];
+}
+
+// --- Operações em Bloco (Troca de k Peças, Rotação e Inversão) ---
+//
+// Trocas entre a frente da fila e o topo da pilha com qualquer k, rotação da fila e
+// inversão da pilha, em blocos em vez de peça a peça. Um intervalo da fila circular tem
+// no máximo dois trechos contíguos no array (até o fim do array e, se der a volta, a
+// partir do início), e cada trecho é tratado de uma vez. As peças do topo da pilha
+// trocam com as da frente da fila em ordem inversa (a do topo vai para a frente), então
+// a troca inverte a ordem: com SSE2, duas peças (8 bytes cada) por registrador, trocando
+// as metades de 64 bits. A rotação copia os trechos com memcpy.
+
+_Static_assert(sizeof(Peca) == 8, "trocar_pecas_invertidas supoe pecas de 8 bytes");
+
+/**
+ * @brief Um intervalo da fila circular dividido em até dois trechos contíguos do array.
+ */
+typedef struct {
+    int posicao[2]; // Índice no array do início de cada trecho
+    int n[2];       // Peças em cada trecho (n[1] = 0 se o intervalo não dá a volta)
+} SegmentosFila;
+
+/**
+ * @brief Divide as k posições a partir de 'posicao' (já reduzida ao array) em trechos contíguos.
+ */
+void fila_segmentos(int posicao, int k, SegmentosFila *segmentos) {
+    int ate_o_fim = MAX_FILA - posicao;
+    segmentos->posicao[0] = posicao;
+    segmentos->n[0] = k < ate_o_fim ? k : ate_o_fim;
+    segmentos->posicao[1] = 0;
+    segmentos->n[1] = k - segmentos->n[0];
+}
+
+/**
+ * @brief Troca 'n' peças de 'a' com as de 'b' em ordem inversa (a[i] <-> b[n - 1 - i]), sem SIMD.
+ * Os dois intervalos não podem se sobrepor.
+ */
+void trocar_pecas_invertidas_escalar(Peca *a, Peca *b, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        Peca temp = a[i];
+        a[i] = b[n - 1 - i];
+        b[n - 1 - i] = temp;
+    }
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief Troca 'n' peças de 'a' com as de 'b' em ordem inversa, dois pares por vez com SSE2.
+ * Os dois intervalos não podem se sobrepor.
+ */
+void trocar_pecas_invertidas(Peca *a, Peca *b, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i par_a = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i par_b = _mm_loadu_si128((const __m128i *)(b + n - 2 - i));
+        _mm_storeu_si128((__m128i *)(a + i), _mm_shuffle_epi32(par_b, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_si128((__m128i *)(b + n - 2 - i), _mm_shuffle_epi32(par_a, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+    if (i < n) {
+        Peca temp = a[i];
+        a[i] = b[0];
+        b[0] = temp;
+    }
+}
+
+#else
+
+void trocar_pecas_invertidas(Peca *a, Peca *b, int n) {
+    trocar_pecas_invertidas_escalar(a, b, n);
+}
+
+#endif
+
+/**
+ * @brief Troca as k primeiras peças da fila com as k peças do topo da pilha: a i-ésima
+ * da fila (a partir da frente) troca de lugar com a i-ésima da pilha (a partir do topo).
+ * Com k = 3 é a troca múltipla (ação 5); com k = 1, a troca simples (ação 4).
+ * @return int 1 se a troca foi feita, 0 se a fila ou a pilha tem menos de k peças (ou k < 1).
+ */
+int fila_trocar_pilha(FilaCircular *fila, Pilha *pilha, int k) {
+    Peca *topo;
+    int n;
+
+    if (k < 1 || k > fila->tamanho_atual || k > pilha->topo + 1) return 0;
+    topo = &pilha->itens[pilha->topo - k + 1]; // As k peças do topo, da mais funda até o topo
+
+    // A peça i da fila troca com topo[k - 1 - i]: o primeiro trecho da fila com as n peças
+    // de cima da pilha e o segundo (se a fila dá a volta) com as k - n de baixo
+    n = MAX_FILA - fila->inicio;
+    if (k <= n) {
+        trocar_pecas_invertidas(fila->itens + fila->inicio, topo, k);
+    } else {
+        trocar_pecas_invertidas(fila->itens + fila->inicio, topo + (k - n), n);
+        trocar_pecas_invertidas(fila->itens, topo, k - n);
+    }
+    return 1;
+}
+
+/**
+ * @brief Rotaciona a fila: as r primeiras peças vão para o fim, na mesma ordem (como r
+ * dequeue seguidos de enqueue). Um r negativo rotaciona para o outro lado.
+ * Com a fila cheia, só inicio e fim andam; senão, as r peças são copiadas em até dois
+ * trechos para a posição depois do fim e as posições liberadas ficam vazias (como no dequeue).
+ * @return int 1 em caso de sucesso, 0 se a fila está vazia.
+ */
+int fila_rotacionar(FilaCircular *fila, int r) {
+    Peca primeiras[MAX_FILA];
+    SegmentosFila segmentos;
+    int n = fila->tamanho_atual;
+    int s, copiadas;
+
+    if (n == 0) return 0;
+    r %= n;
+    if (r < 0) r += n;
+    if (r == 0) return 1;
+    if (n == MAX_FILA) {
+        fila->inicio = INDICE_FILA(fila->inicio + r);
+        fila->fim = fila->inicio;
+        return 1;
+    }
+
+    // 1. Copia as r primeiras e libera as posições delas
+    fila_segmentos(fila->inicio, r, &segmentos);
+    for (s = 0, copiadas = 0; s < 2; s++) {
+        int j;
+        memcpy(primeiras + copiadas, fila->itens + segmentos.posicao[s], segmentos.n[s] * sizeof(Peca));
+        for (j = 0; j < segmentos.n[s]; j++) {
+            fila->itens[segmentos.posicao[s] + j].nome = '\0';
+            fila->itens[segmentos.posicao[s] + j].id = -1;
+        }
+        copiadas += segmentos.n[s];
+    }
+    // 2. Escreve-as depois do fim (o destino pode dar a volta sobre as posições liberadas)
+    fila_segmentos(fila->fim, r, &segmentos);
+    for (s = 0, copiadas = 0; s < 2; s++) {
+        memcpy(fila->itens + segmentos.posicao[s], primeiras + copiadas, segmentos.n[s] * sizeof(Peca));
+        copiadas += segmentos.n[s];
+    }
+    fila->inicio = INDICE_FILA(fila->inicio + r);
+    fila->fim = INDICE_FILA(fila->fim + r);
+    return 1;
+}
+
+/**
+ * @brief Inverte a pilha: a base vira o topo e o topo vira a base.
+ */
+void pilha_inverter(Pilha *pilha) {
+    int metade = (pilha->topo + 1) / 2;
+    // A metade de baixo troca com a de cima, invertida; a peça do meio (n ímpar) fica
+    trocar_pecas_invertidas(pilha->itens, pilha->itens + pilha->topo + 1 - metade, metade);
+}
+
+// --- Tabuleiro (Bitboard) ---
+//
+// O tabuleiro tem LARGURA_TABULEIRO colunas e ALTURA_TABULEIRO linhas; cada linha é uma
+// palavra de 16 bits (linha 0 = fundo). As colunas ocupam os bits 3 a 12 e os bits de fora
+// ficam sempre ligados como paredes, então uma linha completa vale 0xFFFF e sair pela lateral
+// é só mais uma colisão. Quatro linhas seguidas formam uma janela de 64 bits, e cada rotação
+// de peça é uma máscara de 4 linhas no mesmo formato: testar uma posição é um AND.
+
+#define LARGURA_TABULEIRO 10
+#define ALTURA_TABULEIRO 20
+// Bits de parede à esquerda das colunas (uma peça tem no máximo 4 colunas)
+#define PAREDE_TABULEIRO 3
+// Linha sem nenhum bloco (só as paredes) e linha completa
+#define LINHA_VAZIA ((uint16_t)~(((1u << LARGURA_TABULEIRO) - 1) << PAREDE_TABULEIRO))
+#define LINHA_CHEIA ((uint16_t)0xFFFF)
+// Rotações distintas de cada tipo, no máximo
+#define MAX_ROTACOES 4
+
+// Uma linha de peça, com as células da esquerda para a direita
+#define LINHA_PECA(a, b, c, d) ((uint64_t)((a) | (b) << 1 | (c) << 2 | (d) << 3) << PAREDE_TABULEIRO)
+// Uma rotação, com as linhas de baixo para cima
+#define MASCARA_PECA(l0, l1, l2, l3) \
+    ((uint64_t)(l0) | (uint64_t)(l1) << 16 | (uint64_t)(l2) << 32 | (uint64_t)(l3) << 48)
+
+/**
+ * @brief Uma rotação de peça: a máscara na coluna 0 (a linha de baixo nunca é vazia) e o
+ * tamanho da sua caixa.
+ */
+typedef struct {
+    uint64_t mascara;
+    int largura;
+    int altura;
+} RotacaoPeca;
+
+/**
+ * @brief Estado do tabuleiro de uma sessão.
+ * As 4 linhas extras acima do topo ficam sempre vazias, para que a janela de qualquer
+ * posição de queda caiba no vetor.
+ */
+typedef struct {
+    uint16_t linhas[ALTURA_TABULEIRO + 4];
+    int altura;                // Linhas ocupadas (a mais alta ocupada + 1)
+    long long pecas;           // Peças colocadas
+    long long linhas_limpas;   // Linhas completas removidas
+    long long fins_de_jogo;    // Vezes em que uma peça não coube e o tabuleiro recomeçou
+} Tabuleiro;
+
+// Rotações de cada tipo, na ordem de TIPOS_PECA ('I', 'O', 'T', 'L')
+const int NUM_ROTACOES[NUM_TIPOS_PECA] = {2, 1, 4, 4};
+const RotacaoPeca ROTACOES_PECA[NUM_TIPOS_PECA][MAX_ROTACOES] = {
+    { // I: deitada e em pé
+        {MASCARA_PECA(LINHA_PECA(1, 1, 1, 1), 0, 0, 0), 4, 1},
+        {MASCARA_PECA(LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 0, 0, 0)), 1, 4},
+    },
+    { // O
+        {MASCARA_PECA(LINHA_PECA(1, 1, 0, 0), LINHA_PECA(1, 1, 0, 0), 0, 0), 2, 2},
+    },
+    { // T: ponta para cima, direita, baixo e esquerda
+        {MASCARA_PECA(LINHA_PECA(1, 1, 1, 0), LINHA_PECA(0, 1, 0, 0), 0, 0), 3, 2},
+        {MASCARA_PECA(LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 1, 0, 0), LINHA_PECA(1, 0, 0, 0), 0), 2, 3},
+        {MASCARA_PECA(LINHA_PECA(0, 1, 0, 0), LINHA_PECA(1, 1, 1, 0), 0, 0), 3, 2},
+        {MASCARA_PECA(LINHA_PECA(0, 1, 0, 0), LINHA_PECA(1, 1, 0, 0), LINHA_PECA(0, 1, 0, 0), 0), 2, 3},
+    },
+    { // L: nas quatro rotações, no sentido horário
+        {MASCARA_PECA(LINHA_PECA(1, 1, 1, 0), LINHA_PECA(0, 0, 1, 0), 0, 0), 3, 2},
+        {MASCARA_PECA(LINHA_PECA(1, 1, 0, 0), LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 0, 0, 0), 0), 2, 3},
+        {MASCARA_PECA(LINHA_PECA(1, 0, 0, 0), LINHA_PECA(1, 1, 1, 0), 0, 0), 3, 2},
+        {MASCARA_PECA(LINHA_PECA(0, 1, 0, 0), LINHA_PECA(0, 1, 0, 0), LINHA_PECA(1, 1, 0, 0), 0), 2, 3},
+    },
+};
+
+// Tabuleiro que recebe as peças jogadas pela ação 1 (NULL = as peças só saem da fila)
+_Thread_local Tabuleiro *tabuleiro_ativo = NULL;
+
+/**
+ * @brief Esvazia o tabuleiro (as estatísticas são mantidas).
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ */
+void tabuleiro_limpar(Tabuleiro *tabuleiro) {
+    int i;
+    for (i = 0; i < ALTURA_TABULEIRO + 4; i++) {
+        tabuleiro->linhas[i] = LINHA_VAZIA;
+    }
+    tabuleiro->altura = 0;
+}
+
+/**
+ * @brief Inicializa um tabuleiro vazio, com as estatísticas zeradas.
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ */
+void inicializar_tabuleiro(Tabuleiro *tabuleiro) {
+    memset(tabuleiro, 0, sizeof(*tabuleiro));
+    tabuleiro_limpar(tabuleiro);
+}
+
+/**
+ * @brief Converte o nome de uma peça no índice do seu tipo (-1 se não for um tipo conhecido).
+ */
+int indice_tipo_peca(char nome) {
+    return CODIGO_TIPO_PECA[(unsigned char)nome] - 1;
+}
+
+/**
+ * @brief Lê as 4 linhas a partir de 'y' como uma janela de 64 bits (linha y nos bits baixos).
+ */
+uint64_t tabuleiro_janela(const Tabuleiro *tabuleiro, int y) {
+    const uint16_t *l = tabuleiro->linhas + y;
+    return (uint64_t)l[0] | (uint64_t)l[1] << 16 | (uint64_t)l[2] << 32 | (uint64_t)l[3] << 48;
+}
+
+/**
+ * @brief Calcula onde uma peça para ao cair na coluna x (queda direta, sem deslizar).
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ * @param rotacao Rotação da peça.
+ * @param x Coluna da borda esquerda da peça (0 a LARGURA_TABULEIRO - largura).
+ * @return int A linha da base da peça onde ela para.
+ */
+int tabuleiro_soltar(const Tabuleiro *tabuleiro, const RotacaoPeca *rotacao, int x) {
+    uint64_t mascara = rotacao->mascara << x;
+    int y = tabuleiro->altura; // Acima da linha mais alta ocupada, nada colide
+
+    while (y > 0 && (tabuleiro_janela(tabuleiro, y - 1) & mascara) == 0) {
+        y--;
+    }
+    return y;
+}
+
+/**
+ * @brief Fixa uma peça na posição (x, y) e remove as linhas que ela completar.
+ * Só as linhas da peça podem ter ficado completas; as de cima descem com uma cópia de
+ * linhas inteiras.
+ * @return int O número de linhas removidas, ou -1 se a peça não coube (fim de jogo:
+ * o tabuleiro recomeça vazio com a peça no fundo).
+ */
+int tabuleiro_colocar(Tabuleiro *tabuleiro, const RotacaoPeca *rotacao, int x, int y) {
+    uint64_t janela;
+    int completas = 0;
+    int k;
+
+    tabuleiro->pecas++;
+    if (y + rotacao->altura > ALTURA_TABULEIRO) {
+        tabuleiro->fins_de_jogo++;
+        tabuleiro_limpar(tabuleiro);
+        tabuleiro_colocar(tabuleiro, rotacao, x, 0);
+        tabuleiro->pecas--; // A peça já foi contada
+        return -1;
+    }
+
+    janela = tabuleiro_janela(tabuleiro, y) | (rotacao->mascara << x);
+    for (k = 0; k < rotacao->altura; k++) {
+        uint16_t linha = (uint16_t)(janela >> (16 * k));
+        tabuleiro->linhas[y + k] = linha;
+        completas += (linha == LINHA_CHEIA);
+    }
+    if (y + rotacao->altura > tabuleiro->altura) {
+        tabuleiro->altura = y + rotacao->altura;
+    }
+
+    if (completas > 0) {
+        int destino = y;
+        int origem;
+        for (origem = y; origem < tabuleiro->altura; origem++) {
+            if (tabuleiro->linhas[origem] != LINHA_CHEIA) {
+                tabuleiro->linhas[destino++] = tabuleiro->linhas[origem];
+            }
+        }
+        for (k = destino; k < tabuleiro->altura; k++) {
+            tabuleiro->linhas[k] = LINHA_VAZIA;
+        }
+        tabuleiro->altura = destino;
+        tabuleiro->linhas_limpas += completas;
+    }
+    return completas;
+}
+
+/**
+ * @brief Joga uma peça no tabuleiro: entre todas as rotações e colunas, usa a posição em
+ * que a peça fica mais baixa (empate: a de base mais baixa, depois a mais à esquerda).
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ * @param nome Tipo da peça ('I', 'O', 'T' ou 'L').
+ * @return int Linhas removidas, -1 em fim de jogo, -2 se o tipo é desconhecido.
+ */
+int tabuleiro_jogar(Tabuleiro *tabuleiro, char nome) {
+    int tipo = indice_tipo_peca(nome);
+    const RotacaoPeca *melhor = NULL;
+    int melhor_x = 0, melhor_y = 0;
+    int r, x;
+
+    if (tipo < 0) return -2;
+    for (r = 0; r < NUM_ROTACOES[tipo]; r++) {
+        const RotacaoPeca *rotacao = &ROTACOES_PECA[tipo][r];
+        for (x = 0; x + rotacao->largura <= LARGURA_TABULEIRO; x++) {
+            int y = tabuleiro_soltar(tabuleiro, rotacao, x);
+            if (melhor == NULL || y + rotacao->altura < melhor_y + melhor->altura ||
+                (y + rotacao->altura == melhor_y + melhor->altura && y < melhor_y)) {
+                melhor = rotacao;
+                melhor_x = x;
+                melhor_y = y;
+            }
+        }
+    }
+    return tabuleiro_colocar(tabuleiro, melhor, melhor_x, melhor_y);
+}
+
+/**
+ * @brief Formata o tabuleiro ('#' ocupado, '.' vazio), da linha de cima para a de baixo.
+ * @param buffer Buffer que recebe o texto.
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ */
+void formatar_tabuleiro(BufferSaida *buffer, const Tabuleiro *tabuleiro) {
+    char linha[LARGURA_TABULEIRO + 4];
+    int y, x;
+
+    buffer_printf(buffer, "Tabuleiro (%lld linhas removidas, %lld fins de jogo):\n",
+                  tabuleiro->linhas_limpas, tabuleiro->fins_de_jogo);
+    for (y = ALTURA_TABULEIRO - 1; y >= 0; y--) {
+        linha[0] = '|';
+        for (x = 0; x < LARGURA_TABULEIRO; x++) {
+            linha[1 + x] = (tabuleiro->linhas[y] >> (PAREDE_TABULEIRO + x)) & 1 ? '#' : '.';
+        }
+        linha[LARGURA_TABULEIRO + 1] = '|';
+        linha[LARGURA_TABULEIRO + 2] = '\n';
+        buffer_anexar(buffer, linha, LARGURA_TABULEIRO + 3);
+    }
+    buffer_printf(buffer, "+----------+\n");
+}
+
+// --- Histórico de Ações (Desfazer/Refazer) ---
+//
+// Cada sessão pode ter um anel com as últimas CAPACIDADE_HISTORICO ações. Em vez de copiar
+// o estado inteiro, cada entrada guarda só o que a ação mudou: as casas da fila e da pilha
+// que ela escreveu (no máximo 6, na troca múltipla), os índices antigos (inicio, fim,
+// tamanho_atual, topo) e a posição do gerador (proximo_id, bits em cache, saco e quantos
+// sorteios do xoshiro a ação consumiu, que gerador_voltar_u64 desfaz sem guardar o estado).
+// Desfazer e refazer são a mesma operação: trocar os valores guardados com os atuais.
+// Assim a entrada passa a guardar o lado oposto, e as duas custam O(1).
+
+// Entradas do anel de cada sessão (potência de 2). Pode ser trocada na compilação
+#ifndef CAPACIDADE_HISTORICO
+#define CAPACIDADE_HISTORICO 64
+#endif
+
+#if CAPACIDADE_HISTORICO < 1 || (CAPACIDADE_HISTORICO & (CAPACIDADE_HISTORICO - 1)) != 0
+#error "CAPACIDADE_HISTORICO deve ser uma potência de 2"
+#endif
+
+// Códigos de opção extras do modo interativo quando há um histórico ativo
+#define OPCAO_DESFAZER 6
+#define OPCAO_REFAZER 7
+// Casas que uma única ação pode escrever (troca múltipla: 3 da fila + 3 da pilha)
+#define MAX_CASAS_DELTA 6
+// Bit que marca uma casa da pilha no código da casa (sem ele, é um índice da fila)
+#define CASA_DA_PILHA 0x80
+
+/**
+ * @brief O que uma ação mudou (ou, depois de desfeita, o que ela deve mudar de novo).
+ */
+typedef struct {
+    Peca pecas[MAX_CASAS_DELTA];     // Valores das casas do outro lado (antes ou depois)
+    uint64_t bits;                   // Bits em cache do gerador
+    int32_t proximo_id;
+    char saco[NUM_TIPOS_PECA];       // Saco do gerador (uma ação pode embaralhar um novo)
+    uint8_t casas[MAX_CASAS_DELTA];  // Código de cada casa: índice, com CASA_DA_PILHA na pilha
+    uint8_t num_casas;
+    uint8_t opcao;
+    uint8_t sorteios;                // Valores de 64 bits que a ação tirou do xoshiro
+    uint8_t bits_restantes;
+    uint8_t restantes_saco;
+    uint8_t inicio;
+    uint8_t fim;
+    uint8_t tamanho_atual;
+    int8_t topo;
+    uint8_t com_tabuleiro;           // A entrada também guarda o tabuleiro (ação 1)
+} DeltaAcao;
+
+/**
+ * @brief Anel de deltas de uma sessão.
+ *
+ * Os contadores são números absolutos de ações: a entrada da ação n (a que leva do estado
+ * n ao n + 1) fica em deltas[n % CAPACIDADE_HISTORICO]. As ações [primeira, atual) podem
+ * ser desfeitas e as ações [atual, ultima) podem ser refeitas.
+ */
+typedef struct {
+    DeltaAcao deltas[CAPACIDADE_HISTORICO];
+    Tabuleiro *tabuleiros;           // Tabuleiros antes de cada ação 1 (NULL: sem tabuleiro)
+    long long primeira;
+    long long atual;
+    long long ultima;
+    uint64_t sorteios_antes;         // Sorteios do gerador antes da ação em andamento
+} HistoricoAcoes;
+
+// Histórico da sessão da thread atual; NULL desliga o registro (replay, servidor, simulador)
+_Thread_local HistoricoAcoes *historico_ativo = NULL;
+
+/**
+ * @brief Cria um histórico vazio.
+ * @param historico Ponteiro para o histórico.
+ * @param com_tabuleiro 1 para também desfazer as peças encaixadas no tabuleiro ativo.
+ * @return int 1 em caso de sucesso, 0 se faltou memória.
+ */
+int historico_criar(HistoricoAcoes *historico, int com_tabuleiro) {
+    memset(historico, 0, sizeof(*historico));
+    if (com_tabuleiro) {
+        historico->tabuleiros = malloc(CAPACIDADE_HISTORICO * sizeof(Tabuleiro));
+        if (historico->tabuleiros == NULL) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Libera a memória de um histórico.
+ */
+void historico_liberar(HistoricoAcoes *historico) {
+    free(historico->tabuleiros);
+    historico->tabuleiros = NULL;
+}
+
+/**
+ * @brief Retorna o endereço da peça de uma casa a partir do seu código.
+ */
+Peca *historico_casa(FilaCircular *fila, Pilha *pilha, uint8_t casa) {
+    return (casa & CASA_DA_PILHA) ? &pilha->itens[casa & (CASA_DA_PILHA - 1)] : &fila->itens[casa];
+}
+
+/**
+ * @brief Anota uma casa que a ação vai escrever, com o valor atual (sem repetir casas:
+ * com a fila cheia, o fim e o início da fila são a mesma casa).
+ */
+void historico_anotar(DeltaAcao *d, FilaCircular *fila, Pilha *pilha, uint8_t casa) {
+    int k;
+    for (k = 0; k < d->num_casas; k++) {
+        if (d->casas[k] == casa) return;
+    }
+    if (d->num_casas >= MAX_CASAS_DELTA) return; // Nenhuma ação escreve mais casas; só protege casas[]
+    d->casas[d->num_casas] = casa;
+    d->pecas[d->num_casas++] = *historico_casa(fila, pilha, casa);
+}
+
+/**
+ * @brief Prepara a entrada da ação que vai ser executada: guarda as casas que ela vai
+ * escrever, os índices e a posição do gerador ativo.
+ * Ações que não mudam o estado (rejeitadas, inválidas e a opção 0) são reconhecidas antes
+ * de tocar no anel, para não apagar a ação mais antiga nem o que ainda pode ser refeito.
+ * @param historico Ponteiro para o histórico.
+ * @param fila Ponteiro para a fila.
+ * @param pilha Ponteiro para a pilha.
+ * @param opcao Código da ação (0 a 5).
+ * @return int 1 se a ação vai mudar o estado (e deve ser confirmada), 0 caso contrário.
+ */
+int historico_preparar(HistoricoAcoes *historico, FilaCircular *fila, Pilha *pilha, int opcao) {
+    size_t indice = (size_t)(historico->atual & (CAPACIDADE_HISTORICO - 1));
+    DeltaAcao *d = &historico->deltas[indice];
+    GeradorPecas *gerador = gerador_ativo;
+    int muda, i;
+
+    // As mesmas condições de rejeição das funções de ação
+    switch (opcao) {
+        case 1:
+        case 2:
+            muda = fila->tamanho_atual > 0;
+            break;
+        case 3:
+            muda = pilha->topo >= 0;
+            break;
+        case 4:
+            muda = fila->tamanho_atual > 0 && pilha->topo >= 0;
+            break;
+        case 5:
+            muda = MAX_FILA >= 3 && MAX_PILHA >= 3 && fila->tamanho_atual >= 3 && pilha->topo >= 2;
+            break;
+        default:
+            muda = 0;
+            break;
+    }
+    if (!muda) return 0;
+
+    d->num_casas = 0;
+    d->opcao = (uint8_t)opcao;
+    d->inicio = (uint8_t)fila->inicio;
+    d->fim = (uint8_t)fila->fim;
+    d->tamanho_atual = (uint8_t)fila->tamanho_atual;
+    d->topo = (int8_t)pilha->topo;
+    d->proximo_id = gerador->proximo_id;
+    d->bits = gerador->bits;
+    d->bits_restantes = (uint8_t)gerador->bits_restantes;
+    d->restantes_saco = (uint8_t)gerador->restantes_saco;
+    memcpy(d->saco, gerador->saco, NUM_TIPOS_PECA);
+    d->com_tabuleiro = 0;
+    historico->sorteios_antes = gerador->sorteios;
+
+    switch (opcao) {
+        case 1:
+        case 2:
+            historico_anotar(d, fila, pilha, (uint8_t)fila->inicio);
+            historico_anotar(d, fila, pilha, (uint8_t)fila->fim);
+            if (opcao == 2 && pilha->topo < MAX_PILHA - 1) {
+                historico_anotar(d, fila, pilha, (uint8_t)(CASA_DA_PILHA | (pilha->topo + 1)));
+            }
+            if (opcao == 1 && tabuleiro_ativo != NULL && historico->tabuleiros != NULL) {
+                historico->tabuleiros[indice] = *tabuleiro_ativo;
+                d->com_tabuleiro = 1;
+            }
+            break;
+        case 3:
+            historico_anotar(d, fila, pilha, (uint8_t)(CASA_DA_PILHA | pilha->topo));
+            break;
+        case 4:
+            historico_anotar(d, fila, pilha, (uint8_t)fila->inicio);
+            historico_anotar(d, fila, pilha, (uint8_t)(CASA_DA_PILHA | pilha->topo));
+            break;
+        case 5:
+            for (i = 0; i < 3; i++) {
+                historico_anotar(d, fila, pilha, (uint8_t)INDICE_FILA(fila->inicio + i));
+                historico_anotar(d, fila, pilha, (uint8_t)(CASA_DA_PILHA | (pilha->topo - i)));
+            }
+            break;
+    }
+    return 1;
+}
+
+/**
+ * @brief Confirma a entrada preparada depois que a ação foi executada. Uma ação nova
+ * descarta o que podia ser refeito e, com o anel cheio, a ação mais antiga deixa de
+ * poder ser desfeita.
+ * @param historico Ponteiro para o histórico.
+ */
+void historico_confirmar(HistoricoAcoes *historico) {
+    DeltaAcao *d = &historico->deltas[historico->atual & (CAPACIDADE_HISTORICO - 1)];
+
+    d->sorteios = (uint8_t)(gerador_ativo->sorteios - historico->sorteios_antes);
+    historico->atual++;
+    historico->ultima = historico->atual;
+    if (historico->ultima - historico->primeira > CAPACIDADE_HISTORICO) historico->primeira++;
+}
+
+/**
+ * @brief Troca os valores guardados em uma entrada com os valores atuais da sessão.
+ * É o passo comum de desfazer e refazer; o xoshiro é ajustado por quem chama.
+ */
+void historico_trocar(HistoricoAcoes *historico, DeltaAcao *d, FilaCircular *fila, Pilha *pilha) {
+    GeradorPecas *gerador = gerador_ativo;
+    int k, t;
+    uint64_t bits;
+
+    for (k = 0; k < d->num_casas; k++) {
+        Peca *casa = historico_casa(fila, pilha, d->casas[k]);
+        Peca p = *casa;
+        *casa = d->pecas[k];
+        d->pecas[k] = p;
+    }
+    t = fila->inicio; fila->inicio = d->inicio; d->inicio = (uint8_t)t;
+    t = fila->fim; fila->fim = d->fim; d->fim = (uint8_t)t;
+    t = fila->tamanho_atual; fila->tamanho_atual = d->tamanho_atual; d->tamanho_atual = (uint8_t)t;
+    t = pilha->topo; pilha->topo = d->topo; d->topo = (int8_t)t;
+    t = gerador->proximo_id; gerador->proximo_id = d->proximo_id; d->proximo_id = t;
+    t = gerador->bits_restantes; gerador->bits_restantes = d->bits_restantes; d->bits_restantes = (uint8_t)t;
+    t = gerador->restantes_saco; gerador->restantes_saco = d->restantes_saco; d->restantes_saco = (uint8_t)t;
+    bits = gerador->bits; gerador->bits = d->bits; d->bits = bits;
+    for (k = 0; k < NUM_TIPOS_PECA; k++) {
+        char c = gerador->saco[k];
+        gerador->saco[k] = d->saco[k];
+        d->saco[k] = c;
+    }
+
+    if (d->com_tabuleiro && tabuleiro_ativo != NULL) {
+        Tabuleiro *guardado = &historico->tabuleiros[d - historico->deltas];
+        Tabuleiro atual = *tabuleiro_ativo;
+        *tabuleiro_ativo = *guardado;
+        *guardado = atual;
+    }
+}
+
+/**
+ * @brief Desfaz a última ação (O(1)).
+ * @param historico Ponteiro para o histórico.
+ * @param fila Ponteiro para a fila.
+ * @param pilha Ponteiro para a pilha.
+ * @return int 1 se uma ação foi desfeita, 0 se não há o que desfazer.
+ */
+int historico_desfazer(HistoricoAcoes *historico, FilaCircular *fila, Pilha *pilha) {
+    DeltaAcao *d;
+    int k;
+
+    if (historico->atual == historico->primeira) return 0;
+    historico->atual--;
+    d = &historico->deltas[historico->atual & (CAPACIDADE_HISTORICO - 1)];
+    historico_trocar(historico, d, fila, pilha);
+    for (k = 0; k < d->sorteios; k++) {
+        gerador_voltar_u64(gerador_ativo);
+    }
+    return 1;
+}
+
+/**
+ * @brief Refaz a última ação desfeita (O(1)); as peças geradas são as mesmas de antes.
+ * @param historico Ponteiro para o histórico.
+ * @param fila Ponteiro para a fila.
+ * @param pilha Ponteiro para a pilha.
+ * @return int 1 se uma ação foi refeita, 0 se não há o que refazer.
+ */
+int historico_refazer(HistoricoAcoes *historico, FilaCircular *fila, Pilha *pilha) {
+    DeltaAcao *d;
+    int k;
+
+    if (historico->atual == historico->ultima) return 0;
+    d = &historico->deltas[historico->atual & (CAPACIDADE_HISTORICO - 1)];
+    historico_trocar(historico, d, fila, pilha);
+    for (k = 0; k < d->sorteios; k++) {
+        gerador_proximo_u64(gerador_ativo);
+    }
+    historico->atual++;
+    return 1;
+}
+
+/**
+ * @brief Leva a sessão ao estado logo após a ação k (k = 0 é o estado antes da primeira
+ * ação registrada), desfazendo ou refazendo quantas ações forem precisas.
+ * @param historico Ponteiro para o histórico.
+ * @param fila Ponteiro para a fila.
+ * @param pilha Ponteiro para a pilha.
+ * @param k Número da ação.
+ * @return int 1 em caso de sucesso, 0 se k está fora do intervalo [primeira, ultima].
+ */
+int historico_voltar_ate(HistoricoAcoes *historico, FilaCircular *fila, Pilha *pilha, long long k) {
+    if (k < historico->primeira || k > historico->ultima) return 0;
+    while (historico->atual > k) historico_desfazer(historico, fila, pilha);
+    while (historico->atual < k) historico_refazer(historico, fila, pilha);
+    return 1;
+}
+
+// --- Funções de Visualização ---
+
+/**
+ * @brief Formata o estado atual da Fila Circular e da Pilha em um buffer.
+ * @param buffer Buffer que recebe o texto.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ */
+void formatar_estado_atual(BufferSaida *buffer, FilaCircular *fila, Pilha *pilha) {
+    int i;
+
+    buffer_printf(buffer, "\n------------------------------------------------------\n");
+    buffer_printf(buffer, "Estado Atual:\n");
+
+    // --- Visualização da Fila ---
+    buffer_printf(buffer, "Fila de pecas (%d/%d): ", fila->tamanho_atual, MAX_FILA);
+
+    if (fila_vazia(fila)) {
+        buffer_printf(buffer, "Vazia\n");
+    } else {
+        // Percorre o array da fila do início ao fim (índice a índice)
+        for (i = 0; i < MAX_FILA; i++) {
+            // Verifica se a posição atual (i) é a de início da fila
+            if (i == fila->inicio && fila->tamanho_atual > 0) {
+                buffer_printf(buffer, " -> "); // Indicador do "início" (frente)
+            }
+
+            // A forma mais correta de percorrer os elementos ativos da fila circular
+            // seria: (fila->inicio + k) % MAX_FILA, onde k vai de 0 a tamanho_atual - 1.
+            // Para simplificar a visualização do array subjacente (como no exemplo),
+            // percorreremos o array completo e mostraremos apenas as posições válidas
+            // (e a posição no array).
+
+            // Se o elemento na posição for válido (nome não é nulo)
+            if (fila->itens[i].nome != '\0') {
+                buffer_printf(buffer, "[%c %d] ", fila->itens[i].nome, fila->itens[i].id);
+            } else {
+                // Mostra um marcador de posição vazia (se houver, o que só deve ocorrer
+                // em casos extremos ou após uma limpeza que não move o array, como
+                // ocorre aqui para visualizar a estrutura circular).
+                buffer_printf(buffer, "[-- -] ");
+            }
+
+            // Verifica se a posição atual (i) é a anterior ao 'fim' da fila
+            if (i == INDICE_FILA(fila->fim - 1 + MAX_FILA) && fila->tamanho_atual > 0) {
+                buffer_printf(buffer, " <- "); // Indicador do "fim" (traseira)
+            }
+        }
+        buffer_printf(buffer, "\n");
+    }
+
+    // --- Visualização da Pilha ---
+    buffer_printf(buffer, "Pilha de reserva (Topo -> Base) (%d/%d): ", pilha->topo + 1, MAX_PILHA);
+
+    if (pilha_vazia(pilha)) {
+        buffer_printf(buffer, "Vazia\n");
+    } else {
+        // Percorre a pilha do topo (maior índice) até a base (índice 0)
+        for (i = pilha->topo; i >= 0; i--) {
+            buffer_printf(buffer, "[%c %d] ", pilha->itens[i].nome, pilha->itens[i].id);
+        }
+        buffer_printf(buffer, "\n");
+    }
+
+    buffer_printf(buffer, "------------------------------------------------------\n");
+
+    // --- Visualização do Tabuleiro (se as peças jogadas estiverem sendo encaixadas) ---
+    if (tabuleiro_ativo != NULL) {
+        formatar_tabuleiro(buffer, tabuleiro_ativo);
+    }
+}
+
+/**
+ * @brief Formata o menu de opções disponíveis em um buffer (sem a linha "Opcao: ").
+ * @param buffer Buffer que recebe o texto.
+ */
+void formatar_menu(BufferSaida *buffer) {
+    buffer_printf(buffer, "\nOpcoes disponiveis:\n");
+    buffer_printf(buffer, "Codigo | Acao\n");
+    buffer_printf(buffer, "-------|----------------------------------------------\n");
+    buffer_printf(buffer, "  1    | Jogar peca da frente da fila (Dequeue)\n");
+    buffer_printf(buffer, "  2    | Enviar peca da fila para a pilha de reserva\n");
+    buffer_printf(buffer, "  3    | Usar peca da pilha de reserva (Pop)\n");
+    buffer_printf(buffer, "  4    | Trocar peca da frente da fila com o topo da pilha\n");
+    buffer_printf(buffer, "  5    | Trocar os 3 primeiros da fila com as 3 da pilha\n");
+    if (historico_ativo != NULL) {
+        buffer_printf(buffer, "  6    | Desfazer a ultima acao\n");
+        buffer_printf(buffer, "  7    | Refazer a acao desfeita\n");
+    }
+    buffer_printf(buffer, "  0    | Sair do programa\n");
+    buffer_printf(buffer, "------------------------------------------------------\n");
+}
+
+// Buffer de exibir_estado_atual e exibir_menu (o modo --rolagem chama as duas a cada ação):
+// é só esvaziado entre um uso e outro, de modo que a memória é alocada uma vez. As duas
+// só são chamadas pela thread principal.
+BufferSaida buffer_exibicao = {NULL, 0, 0};
+
+/**
+ * @brief Exibe o estado atual da Fila Circular e da Pilha.
+ * O texto é montado em um buffer e enviado à stdout de uma só vez.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ */
+void exibir_estado_atual(FilaCircular *fila, Pilha *pilha) {
+    buffer_limpar(&buffer_exibicao);
+    formatar_estado_atual(&buffer_exibicao, fila, pilha);
+    fwrite(buffer_exibicao.dados, 1, buffer_exibicao.tamanho, stdout);
+}
+
+/**
+ * @brief Exibe o menu de opções disponíveis.
+ */
+void exibir_menu() {
+    buffer_limpar(&buffer_exibicao);
+    formatar_menu(&buffer_exibicao);
+    buffer_printf(&buffer_exibicao, "Opcao: ");
+    fwrite(buffer_exibicao.dados, 1, buffer_exibicao.tamanho, stdout);
+}
+
+// --- Renderizador de Tela (Quadros com Diferença) ---
+
+/**
+ * @brief Renderizador que desenha a tela inteira como um quadro e, a cada ação,
+ * reenvia apenas as linhas que mudaram em relação ao quadro anterior.
+ *
+ * O quadro é: estado atual + menu + mensagens da última ação + "Opcao: ".
+ * As linhas alteradas são posicionadas com sequências ANSI (ESC[linha;1H) e todo o
+ * quadro sai em um único write(). A linha do prompt é sempre redesenhada e, depois
+ * dela, ESC[J limpa o resto da tela (inclusive o eco do que o jogador digitou).
+ *
+ * quadro: Quadro sendo montado.
+ * anterior: Último quadro desenhado (para a comparação linha a linha).
+ * saida: Bytes enviados no write() do quadro atual.
+ * mensagens: Mensagens das ações acumuladas desde o último quadro (via MENSAGEM).
+ * quadros / bytes_escritos / bytes_ultimo_quadro: Contadores de saída.
+ */
+typedef struct {
+    BufferSaida quadro;
+    BufferSaida anterior;
+    BufferSaida saida;
+    BufferSaida mensagens;
+    int primeiro_quadro;
+    long long quadros;
+    long long bytes_escritos;
+    long long bytes_ultimo_quadro;
+} Renderizador;
+
+/**
+ * @brief Inicializa o renderizador e passa a capturar as mensagens das ações.
+ * @param r Ponteiro para o renderizador.
+ */
+void renderizador_iniciar(Renderizador *r) {
+    memset(r, 0, sizeof(*r));
+    r->primeiro_quadro = 1;
+    saida_mensagens = &r->mensagens;
+}
+
+/**
+ * @brief Desenha um quadro, enviando só as linhas que mudaram.
+ * @param r Ponteiro para o renderizador.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ */
+void renderizador_desenhar(Renderizador *r, FilaCircular *fila, Pilha *pilha) {
+    const char *q, *fim_q, *a, *fim_a;
+    int linha = 1;
+    BufferSaida temp;
+
+    // 1. Monta o quadro completo
+    buffer_limpar(&r->quadro);
+    formatar_estado_atual(&r->quadro, fila, pilha);
+    formatar_menu(&r->quadro);
+    buffer_anexar(&r->quadro, r->mensagens.dados ? r->mensagens.dados : "", r->mensagens.tamanho);
+    buffer_printf(&r->quadro, "Opcao: ");
+    buffer_limpar(&r->mensagens);
+
+    // 2. Compara com o quadro anterior, linha a linha
+    buffer_limpar(&r->saida);
+    if (r->primeiro_quadro) {
+        buffer_printf(&r->saida, "\x1b[H\x1b[2J"); // Cursor no topo e tela limpa
+    }
+
+    q = r->quadro.dados;
+    fim_q = q + r->quadro.tamanho;
+    a = r->anterior.dados ? r->anterior.dados : "";
+    fim_a = a + r->anterior.tamanho;
+
+    while (q < fim_q) {
+        const char *fim_linha_q = memchr(q, '\n', fim_q - q);
+        const char *fim_linha_a = (a < fim_a) ? memchr(a, '\n', fim_a - a) : NULL;
+        size_t tam_q, tam_a;
+        int ultima = (fim_linha_q == NULL); // A linha do prompt não termina em '\n'
+
+        if (fim_linha_q == NULL) fim_linha_q = fim_q;
+        if (a < fim_a && fim_linha_a == NULL) fim_linha_a = fim_a;
+        tam_q = fim_linha_q - q;
+        tam_a = (a < fim_a) ? (size_t)(fim_linha_a - a) : (size_t)-1;
+
+        if (r->primeiro_quadro || ultima || tam_q != tam_a || memcmp(q, a, tam_q) != 0) {
+            buffer_printf(&r->saida, "\x1b[%d;1H", linha);
+            buffer_anexar(&r->saida, q, tam_q);
+            // Limpa o que sobrou da linha antiga; no prompt, limpa o resto da tela
+            buffer_printf(&r->saida, ultima ? "\x1b[J" : "\x1b[K");
+        }
+
+        q = fim_linha_q + (ultima ? 0 : 1);
+        if (a < fim_a) a = fim_linha_a + 1;
+        linha++;
+    }
+
+    // 3. Envia tudo em um único write()
+    fflush(stdout); // Nada que foi para a stdout via printf pode sair depois do quadro
+    escrever_tudo(STDOUT_FILENO, r->saida.dados, r->saida.tamanho);
+    r->bytes_ultimo_quadro = (long long)r->saida.tamanho;
+    r->bytes_escritos += (long long)r->saida.tamanho;
+    r->quadros++;
+    r->primeiro_quadro = 0;
+
+    // 4. O quadro atual vira o anterior (troca os buffers para reaproveitar a memória)
+    temp = r->anterior;
+    r->anterior = r->quadro;
+    r->quadro = temp;
+}
+
+/**
+ * @brief Encerra o renderizador: imprime as mensagens pendentes, as estatísticas de
+ * bytes escritos (na stderr) e libera os buffers.
+ * @param r Ponteiro para o renderizador.
+ */
+void renderizador_finalizar(Renderizador *r) {
+    saida_mensagens = NULL;
+    if (r->mensagens.tamanho > 0) {
+        escrever_tudo(STDOUT_FILENO, r->mensagens.dados, r->mensagens.tamanho);
+    }
+    fprintf(stderr, "Renderizador: %lld quadros, %lld bytes escritos (%.1f bytes/acao, ultimo quadro: %lld bytes)\n",
+            r->quadros, r->bytes_escritos,
+            r->quadros > 0 ? (double)r->bytes_escritos / r->quadros : 0.0, r->bytes_ultimo_quadro);
+    buffer_liberar(&r->quadro);
+    buffer_liberar(&r->anterior);
+    buffer_liberar(&r->saida);
+    buffer_liberar(&r->mensagens);
+}
+
+// --- Diário de Ações (Gravação) ---
+
+// Identificação do formato do diário (cabeçalho) e do índice de snapshots (rodapé)
+#define MAGICO_DIARIO "TSJ1"
+#define MAGICO_INDICE_DIARIO "TSJF"
+#define VERSAO_DIARIO 1
+// Intervalo padrão, em ações, entre dois snapshots do estado
+#define INTERVALO_SNAPSHOT_PADRAO 4096
+// Tamanho do buffer de escrita do diário
+#define TAMANHO_BUFFER_DIARIO (64 * 1024)
+
+// Registros do diário: os 3 bits baixos do primeiro byte dizem o tipo do registro
+#define REGISTRO_SNAPSHOT 6  // Seguido do estado completo (ver diario_escrever_snapshot)
+#define REGISTRO_FIM 7       // Seguido do índice de snapshots
+// Bits do byte de uma ação (registros 0 a 5 = código da opção)
+#define DIARIO_GEROU_PECA 0x08   // A ação gerou uma peça nova
+#define DIARIO_DESLOCAMENTO_TIPO 4 // Bits 4-5: código do tipo da peça gerada
+#define DIARIO_ID_EXPLICITO 0x40 // O id da peça segue em 4 bytes (quando não é o próximo esperado)
+
+// Tamanho de um snapshot serializado (sem o byte do registro)
+#define TAMANHO_SNAPSHOT (8 + MAX_FILA * 5 + 3 * 4 + MAX_PILHA * 5 + 4 + 4)
+
+/**
+ * @brief Diário binário das ações de uma sessão, gravado com escritas em buffer.
+ *
+ * Formato (inteiros em little-endian):
+ *   Cabeçalho: "TSJ1", versão, MAX_FILA, MAX_PILHA, intervalo de snapshot (u32 cada), semente (u64).
+ *   Registros: 1 byte por ação (opção nos bits 0-2, bit 3 = gerou peça, bits 4-5 = tipo
+ *     da peça, bit 6 = id explícito em 4 bytes a seguir). O id normalmente é implícito:
+ *     é o contador de IDs da sessão no momento da ação.
+ *   Snapshots: a cada 'intervalo' ações (e na ação 0), o byte REGISTRO_SNAPSHOT e o
+ *     estado completo da fila, da pilha e do contador de IDs.
+ *   Rodapé: REGISTRO_FIM, número de snapshots (u32), pares (ação, deslocamento) (u64),
+ *     deslocamento do rodapé (u64) e "TSJF". Se o rodapé faltar (gravação interrompida),
+ *     o leitor reconstrói o índice percorrendo os registros.
+ */
+typedef struct {
+    FILE *arquivo;
+    unsigned char *buffer;
+    size_t usados;               // Bytes no buffer ainda não enviados ao arquivo
+    uint64_t deslocamento;       // Posição no arquivo do próximo byte gravado
+    uint64_t acoes;              // Ações gravadas até agora
+    int intervalo_snapshot;
+    uint64_t *snapshot_acoes;    // Índice: número da ação de cada snapshot
+    uint64_t *snapshot_posicoes; // Índice: deslocamento de cada snapshot no arquivo
+    int num_snapshots;
+    int capacidade_snapshots;
+} DiarioAcoes;
+
+// Diário em que executar_opcao grava cada ação da thread atual (NULL = sem gravação)
+_Thread_local DiarioAcoes *diario_ativo = NULL;
+
+/**
+ * @brief Envia ao arquivo o que estiver no buffer do diário.
+ */
+void diario_descarregar(DiarioAcoes *diario) {
+    if (diario->usados > 0) {
+        fwrite(diario->buffer, 1, diario->usados, diario->arquivo);
+        diario->usados = 0;
+    }
+}
+
+/**
+ * @brief Acrescenta bytes ao diário (passando pelo buffer).
+ */
+void diario_escrever(DiarioAcoes *diario, const void *dados, size_t n) {
+    if (diario->usados + n > TAMANHO_BUFFER_DIARIO) diario_descarregar(diario);
+    memcpy(diario->buffer + diario->usados, dados, n);
+    diario->usados += n;
+    diario->deslocamento += n;
+}
+
+/**
+ * @brief Grava um inteiro de 32 bits em little-endian.
+ */
+void diario_escrever_u32(DiarioAcoes *diario, uint32_t v) {
+    unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+    diario_escrever(diario, b, 4);
+}
+
+/**
+ * @brief Grava um inteiro de 64 bits em little-endian.
+ */
+void diario_escrever_u64(DiarioAcoes *diario, uint64_t v) {
+    diario_escrever_u32(diario, (uint32_t)v);
+    diario_escrever_u32(diario, (uint32_t)(v >> 32));
+}
+
+/**
+ * @brief Lê um inteiro de 32 bits em little-endian.
+ */
+uint32_t ler_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Lê um inteiro de 64 bits em little-endian.
+ */
+uint64_t ler_u64(const unsigned char *p) {
+    return (uint64_t)ler_u32(p) | ((uint64_t)ler_u32(p + 4) << 32);
+}
+
+/**
+ * @brief Grava um snapshot do estado atual (fila, pilha e contador de IDs) e o registra no índice.
+ */
+void diario_escrever_snapshot(DiarioAcoes *diario, FilaCircular *fila, Pilha *pilha) {
+    unsigned char registro = REGISTRO_SNAPSHOT;
+    int k;
+
+    if (diario->num_snapshots == diario->capacidade_snapshots) {
+        int nova = diario->capacidade_snapshots ? 2 * diario->capacidade_snapshots : 64;
+        uint64_t *acoes = realloc(diario->snapshot_acoes, nova * sizeof(uint64_t));
+        uint64_t *posicoes;
+        if (acoes == NULL) return;
+        diario->snapshot_acoes = acoes;
+        posicoes = realloc(diario->snapshot_posicoes, nova * sizeof(uint64_t));
+        if (posicoes == NULL) return;
+        diario->snapshot_posicoes = posicoes;
+        diario->capacidade_snapshots = nova;
+    }
+    diario->snapshot_acoes[diario->num_snapshots] = diario->acoes;
+    diario->snapshot_posicoes[diario->num_snapshots] = diario->deslocamento;
+    diario->num_snapshots++;
+
+    diario_escrever(diario, &registro, 1);
+    diario_escrever_u64(diario, diario->acoes);
+    for (k = 0; k < MAX_FILA; k++) {
+        diario_escrever(diario, &fila->itens[k].nome, 1);
+        diario_escrever_u32(diario, (uint32_t)fila->itens[k].id);
+    }
+    diario_escrever_u32(diario, (uint32_t)fila->inicio);
+    diario_escrever_u32(diario, (uint32_t)fila->fim);
+    diario_escrever_u32(diario, (uint32_t)fila->tamanho_atual);
+    for (k = 0; k < MAX_PILHA; k++) {
+        diario_escrever(diario, &pilha->itens[k].nome, 1);
+        diario_escrever_u32(diario, (uint32_t)pilha->itens[k].id);
+    }
+    diario_escrever_u32(diario, (uint32_t)pilha->topo);
+    diario_escrever_u32(diario, (uint32_t)gerador_ativo->proximo_id);
+}
+
+/**
+ * @brief Cria um diário novo e grava o cabeçalho. O snapshot do estado inicial (ação 0)
+ * é gravado antes da primeira ação registrada.
+ * @param diario Ponteiro para o diário.
+ * @param caminho Caminho do arquivo.
+ * @param semente Semente da sessão (apenas informativa).
+ * @param intervalo Intervalo, em ações, entre snapshots.
+ * @return int 1 em caso de sucesso, 0 caso contrário.
+ */
+int diario_abrir(DiarioAcoes *diario, const char *caminho, uint64_t semente, int intervalo) {
+    memset(diario, 0, sizeof(*diario));
+    diario->arquivo = fopen(caminho, "wb");
+    diario->buffer = malloc(TAMANHO_BUFFER_DIARIO);
+    if (diario->arquivo == NULL || diario->buffer == NULL) {
+        if (diario->arquivo != NULL) fclose(diario->arquivo);
+        free(diario->buffer);
+        return 0;
+    }
+    diario->intervalo_snapshot = intervalo > 0 ? intervalo : INTERVALO_SNAPSHOT_PADRAO;
+
+    diario_escrever(diario, MAGICO_DIARIO, 4);
+    diario_escrever_u32(diario, VERSAO_DIARIO);
+    diario_escrever_u32(diario, MAX_FILA);
+    diario_escrever_u32(diario, MAX_PILHA);
+    diario_escrever_u32(diario, (uint32_t)diario->intervalo_snapshot);
+    diario_escrever_u64(diario, semente);
+    return 1;
+}
+
+/**
+ * @brief Grava uma ação já executada (chamada por executar_opcao quando há um diário ativo).
+ * @param diario Ponteiro para o diário.
+ * @param fila Estado da fila após a ação.
+ * @param pilha Estado da pilha após a ação.
+ * @param opcao Código da ação executada (0 a 5).
+ * @param id_antes Contador de IDs da sessão antes da ação.
+ */
+void diario_registrar(DiarioAcoes *diario, FilaCircular *fila, Pilha *pilha, int opcao, int id_antes) {
+    unsigned char registro = (unsigned char)opcao;
+
+    if (gerador_ativo->proximo_id != id_antes) {
+        // A peça gerada foi a última inserida na fila
+        Peca nova = fila->itens[INDICE_FILA(fila->fim - 1 + MAX_FILA)];
+        int tipo = indice_tipo_peca(nova.nome);
+        // Um tipo desconhecido é gravado como o código 0
+        registro |= DIARIO_GEROU_PECA | ((tipo < 0 ? 0 : tipo) << DIARIO_DESLOCAMENTO_TIPO);
+        if (nova.id != id_antes) {
+            registro |= DIARIO_ID_EXPLICITO;
+            diario_escrever(diario, &registro, 1);
+            diario_escrever_u32(diario, (uint32_t)nova.id);
+        } else {
+            diario_escrever(diario, &registro, 1);
+        }
+    } else {
+        diario_escrever(diario, &registro, 1);
+    }
+
+    diario->acoes++;
+    if (diario->acoes % diario->intervalo_snapshot == 0) {
+        diario_escrever_snapshot(diario, fila, pilha);
+    }
+}
+
+/**
+ * @brief Grava o rodapé com o índice de snapshots e fecha o diário.
+ * @param diario Ponteiro para o diário.
+ * @return int 1 se tudo foi gravado, 0 em caso de erro de escrita.
+ */
+int diario_fechar(DiarioAcoes *diario) {
+    unsigned char registro = REGISTRO_FIM;
+    uint64_t posicao_rodape = diario->deslocamento;
+    int ok;
+    int k;
+
+    diario_escrever(diario, &registro, 1);
+    diario_escrever_u32(diario, (uint32_t)diario->num_snapshots);
+    for (k = 0; k < diario->num_snapshots; k++) {
+        diario_escrever_u64(diario, diario->snapshot_acoes[k]);
+        diario_escrever_u64(diario, diario->snapshot_posicoes[k]);
+    }
+    diario_escrever_u64(diario, posicao_rodape);
+    diario_escrever(diario, MAGICO_INDICE_DIARIO, 4);
+    diario_descarregar(diario);
+
+    ok = !ferror(diario->arquivo);
+    ok &= (fclose(diario->arquivo) == 0);
+    free(diario->buffer);
+    free(diario->snapshot_acoes);
+    free(diario->snapshot_posicoes);
+    memset(diario, 0, sizeof(*diario));
+    return ok;
+}
+
+// --- Funções de Ação e Manipulação ---
+
+/**
+ * @brief Executa a ação 1: Jogar uma peça (dequeue da fila).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @return ResultadoAcao ACAO_REALIZADA, ou ACAO_REJEITADA se a fila estava vazia.
+ */
+ResultadoAcao acao_jogar_peca(FilaCircular *fila) {
+    Peca peca_jogada;
+    // Tenta remover a peça da frente da fila
+    if (dequeue(fila, &peca_jogada)) {
+        MENSAGEM("\nACAO: Peca [%c %d] jogada (removida da fila).\n", peca_jogada.nome, peca_jogada.id);
+
+        // Com um tabuleiro ativo, a peça jogada cai no tabuleiro
+        if (tabuleiro_ativo != NULL) {
+            int linhas = tabuleiro_jogar(tabuleiro_ativo, peca_jogada.nome);
+            if (linhas > 0) {
+                MENSAGEM("TABULEIRO: %d linha(s) completa(s) removida(s)!\n", linhas);
+            } else if (linhas == -1) {
+                MENSAGEM("TABULEIRO: A peca nao coube. Fim de jogo; o tabuleiro recomeca vazio.\n");
+            }
+        }
+
+        // Gera uma nova peça para preencher a vaga, mantendo a fila cheia (se possível)
         Peca nova_peca = gerarPeca();
         if (enqueue(fila, nova_peca)) {
-            printf("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+            MENSAGEM("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+        }
+        return ACAO_REALIZADA;
+    }
+    return ACAO_REJEITADA;
+}
+
+/**
+ * @brief Executa a ação 2: Reservar uma peça (dequeue da fila, push na pilha).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return ResultadoAcao ACAO_REALIZADA, ACAO_DESCARTADA (pilha cheia) ou ACAO_REJEITADA (fila vazia).
+ */
+ResultadoAcao acao_reservar_peca(FilaCircular *fila, Pilha *pilha) {
+    Peca peca_removida;
+
+    // 1. Tenta remover a peça da frente da fila
+    if (dequeue(fila, &peca_removida)) {
+        // 2. Tenta inserir a peça removida no topo da pilha
+        if (push(pilha, peca_removida)) {
+            MENSAGEM("\nACAO: Peca [%c %d] movida da fila para a pilha de reserva.\n", peca_removida.nome, peca_removida.id);
+
+            // 3. Gera uma nova peça para preencher a vaga na fila
+            Peca nova_peca = gerarPeca();
+            if (enqueue(fila, nova_peca)) {
+                MENSAGEM("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+            }
+            if (analise_ativa != NULL) analise_registrar_reserva(analise_ativa, 0);
+            return ACAO_REALIZADA;
+        } else {
+            // Se o push falhou (pilha cheia), a peça precisa voltar para a fila.
+            // Isso complica a lógica. No cenário do Tetris, a peça simplesmente não
+            // é movida e permanece na fila, e a nova peça não é gerada.
+            // Para simplificar (e manter o requisito de 'manter a fila cheia' após ação),
+            // assumimos que a peça que falhou em ir para a pilha 'foi jogada'
+            // (ou seja, descartada) para permitir a entrada da nova peça na fila.
+            // No entanto, para ser estritamente correto:
+            MENSAGEM("AVISO: Pilha de reserva cheia. Peca [%c %d] nao reservada e descartada para manter a fila completa.\n", peca_removida.nome, peca_removida.id);
+            // Poderia-se reinserir a peça, mas o requisito diz que removidas não voltam.
+            // O requisito 'a cada ação, uma nova peça é gerada' sugere que a peça
+            // removida deve ser tratada como 'jogada' ou 'descartada' se a pilha falhar.
+            Peca nova_peca = gerarPeca();
+            if (enqueue(fila, nova_peca)) {
+                MENSAGEM("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+            }
+            if (analise_ativa != NULL) analise_registrar_reserva(analise_ativa, 1);
+            return ACAO_DESCARTADA;
+        }
+    }
+    return ACAO_REJEITADA;
+}
+
+/**
+ * @brief Executa a ação 3: Usar uma peça reservada (pop da pilha).
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return ResultadoAcao ACAO_REALIZADA, ou ACAO_REJEITADA se a pilha estava vazia.
+ */
+ResultadoAcao acao_usar_peca_reservada(Pilha *pilha) {
+    Peca peca_usada;
+
+    // Tenta remover a peça do topo da pilha
+    if (pop(pilha, &peca_usada)) {
+        MENSAGEM("\nACAO: Peca [%c %d] usada (removida do topo da pilha).\n", peca_usada.nome, peca_usada.id);
+        return ACAO_REALIZADA;
+    }
+    // Obs: Esta ação não gera uma nova peça na fila, pois não houve remoção da fila.
+    return ACAO_REJEITADA;
+}
+
+/**
+ * @brief Executa a ação 4: Trocar a peça da frente da fila com o topo da pilha.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return ResultadoAcao ACAO_REALIZADA, ou ACAO_REJEITADA se a fila ou a pilha estava vazia.
+ */
+ResultadoAcao acao_troca_simples(FilaCircular *fila, Pilha *pilha) {
+    // 1. Verifica se ambas as estruturas estão prontas para a troca
+    if (fila_vazia(fila)) {
+        INSTRUMENTAR(troca_simples_fila_vazia);
+        MENSAGEM("\nAVISO: Fila vazia. Nao e possivel realizar a troca.\n");
+        return ACAO_REJEITADA;
+    }
+    if (pilha_vazia(pilha)) {
+        INSTRUMENTAR(troca_simples_pilha_vazia);
+        MENSAGEM("\nAVISO: Pilha vazia. Nao e possivel realizar a troca.\n");
+        return ACAO_REJEITADA;
+    }
+
+    Peca peca_fila = frente_da_fila(fila);
+    Peca peca_pilha = topo_da_pilha(pilha);
+
+    // 2. Realiza a troca (substituição direta nos arrays)
+
+    // A peça da pilha vai para o início da fila
+    fila->itens[fila->inicio] = peca_pilha;
+    // A peça da fila vai para o topo da pilha
+    pilha->itens[pilha->topo] = peca_fila;
+
+    MENSAGEM("\nACAO: Troca simples realizada entre o topo da pilha ([%c %d]) e a frente da fila ([%c %d]).\n",
+           peca_pilha.nome, peca_pilha.id, peca_fila.nome, peca_fila.id);
+    return ACAO_REALIZADA;
+}
+
+/**
+ * @brief Executa a ação 5: Trocar as 3 primeiras peças da fila com as 3 peças da pilha.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return ResultadoAcao ACAO_REALIZADA, ou ACAO_REJEITADA se a fila ou a pilha tinha menos de 3 peças.
+ */
+ResultadoAcao acao_troca_multipla(FilaCircular *fila, Pilha *pilha) {
+    const int num_trocas = 3;
+
+    // 1. Verifica se ambas as estruturas têm capacidade mínima para a troca
+    // (com MAX_FILA ou MAX_PILHA configurados abaixo de 3, a troca nunca é possível)
+    if (fila->tamanho_atual < num_trocas || MAX_FILA < num_trocas) {
+        INSTRUMENTAR(troca_multipla_fila_curta);
+        MENSAGEM("\nAVISO: Fila tem menos de %d pecas. Nao e possivel realizar a troca multipla.\n", num_trocas);
+        return ACAO_REJEITADA;
+    }
+    // A Pilha tem capacidade MAX_PILHA=3, então verificamos se está cheia
+    if (pilha->topo + 1 < num_trocas || MAX_PILHA < num_trocas) {
+        INSTRUMENTAR(troca_multipla_pilha_curta);
+        MENSAGEM("\nAVISO: Pilha tem menos de %d pecas. Nao e possivel realizar a troca multipla.\n", num_trocas);
+        return ACAO_REJEITADA;
+    }
+
+    MENSAGEM("\nACAO: Iniciando a troca das %d primeiras pecas da fila com as %d pecas da pilha.\n", num_trocas, num_trocas);
+
+    // 2. Realiza a troca: a frente da fila (até dois trechos do array) com o topo da pilha
+    fila_trocar_pilha(fila, pilha, num_trocas);
+
+    MENSAGEM("Troca realizada com sucesso!\n");
+    return ACAO_REALIZADA;
+}
+
+/**
+ * @brief Chama a função de ação correspondente a um código de opção do menu.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @param opcao Código da ação (0 a 5).
+ * @return ResultadoAcao O resultado da ação, ou ACAO_INVALIDA se a opção não existe.
+ */
+ResultadoAcao despachar_opcao(FilaCircular *fila, Pilha *pilha, int opcao) {
+    switch (opcao) {
+        case 1:
+            return acao_jogar_peca(fila); // Dequeue e gera nova peça
+        case 2:
+            return acao_reservar_peca(fila, pilha); // Dequeue, Push, e gera nova peça
+        case 3:
+            return acao_usar_peca_reservada(pilha); // Pop da pilha
+        case 4:
+            return acao_troca_simples(fila, pilha); // Troca frente da fila com topo da pilha
+        case 5:
+            return acao_troca_multipla(fila, pilha); // Troca 3 da fila com 3 da pilha
+        case 0:
+            MENSAGEM("\nEncerrando o Gerenciador de Pecas. Ate logo!\n");
+            return ACAO_REALIZADA;
+        default:
+            MENSAGEM("\nAVISO: Opcao invalida. Por favor, escolha um numero entre 0 e 5.\n");
+            return ACAO_INVALIDA;
+    }
+}
+
+/**
+ * @brief Executa a ação correspondente a um código de opção do menu e, se houver um
+ * diário ativo, grava a ação (e a peça que ela gerou).
+ * É o mesmo despacho usado pelo loop interativo e pelo modo replay.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @param opcao Código da ação (0 a 5).
+ * @return ResultadoAcao O resultado da ação, ou ACAO_INVALIDA se a opção não existe.
+ */
+ResultadoAcao executar_opcao(FilaCircular *fila, Pilha *pilha, int opcao) {
+    ResultadoAcao resultado;
+    int id_antes, registrar;
+
+    // Com um histórico ativo (só sem diário), 6 e 7 desfazem e refazem e as ações entram no anel
+    if (historico_ativo != NULL && diario_ativo == NULL) {
+        if (opcao == OPCAO_DESFAZER || opcao == OPCAO_REFAZER) {
+            int feito = opcao == OPCAO_DESFAZER ? historico_desfazer(historico_ativo, fila, pilha)
+                                                : historico_refazer(historico_ativo, fila, pilha);
+            if (feito) {
+                MENSAGEM("\nACAO: Acao %s (%lld no historico).\n", opcao == OPCAO_DESFAZER ? "desfeita" : "refeita",
+                         historico_ativo->atual);
+                return ACAO_REALIZADA;
+            }
+            MENSAGEM("\nAVISO: Nao ha acao para %s.\n", opcao == OPCAO_DESFAZER ? "desfazer" : "refazer");
+            return ACAO_REJEITADA;
+        }
+        registrar = historico_preparar(historico_ativo, fila, pilha, opcao);
+        {
+            INSTRUMENTAR_INICIO(inicio);
+            resultado = despachar_opcao(fila, pilha, opcao);
+            INSTRUMENTAR_ACAO(opcao, resultado, inicio);
+        }
+        if (registrar) historico_confirmar(historico_ativo);
+        return resultado;
+    }
+
+    if (diario_ativo == NULL) {
+        INSTRUMENTAR_INICIO(inicio);
+        resultado = despachar_opcao(fila, pilha, opcao);
+        INSTRUMENTAR_ACAO(opcao, resultado, inicio);
+        return resultado;
+    }
+
+    // O primeiro snapshot guarda o estado inicial, antes de qualquer ação
+    if (diario_ativo->num_snapshots == 0) {
+        diario_escrever_snapshot(diario_ativo, fila, pilha);
+    }
+    id_antes = gerador_ativo->proximo_id;
+    {
+        INSTRUMENTAR_INICIO(inicio);
+        resultado = despachar_opcao(fila, pilha, opcao);
+        INSTRUMENTAR_ACAO(opcao, resultado, inicio);
+    }
+    if (resultado != ACAO_INVALIDA) {
+        diario_registrar(diario_ativo, fila, pilha, opcao, id_antes);
+    }
+    return resultado;
+}
+
+// --- Tabela de Sessões (Structure of Arrays) ---
+
+/**
+ * @brief Tabela com muitas sessões de jogo (fila + pilha por jogador), em layout SoA.
+ *
+ * Em vez de um FilaCircular e um Pilha por sessão (com Peca de 8 bytes por causa do
+ * preenchimento), cada campo fica em um array contíguo próprio. A sessão s ocupa:
+ *   fila_nome/fila_id:   posições [s * MAX_FILA, s * MAX_FILA + MAX_FILA)
+ *   pilha_nome/pilha_id: posições [s * MAX_PILHA, s * MAX_PILHA + MAX_PILHA)
+ *   inicio/fim/tamanho_atual/topo: posição [s]
+ * As regras das ações são exatamente as das funções acao_*, sem saída de console.
+ *
+ * Com um checkpoint ligado, cada ação anota em epoca_bloco a época em que o bloco de
+ * SESSOES_POR_BLOCO_CHECKPOINT sessões mudou, e só os blocos alterados são gravados.
+ */
+typedef struct {
+    int quantidade;          // Número de sessões na tabela
+    char *fila_nome;         // Tipos das peças das filas
+    int *fila_id;            // IDs das peças das filas
+    char *pilha_nome;        // Tipos das peças das pilhas
+    int *pilha_id;           // IDs das peças das pilhas
+    uint8_t *inicio;         // Índice do primeiro elemento de cada fila
+    uint8_t *fim;            // Próxima posição livre de cada fila
+    uint8_t *tamanho_atual;  // Número de elementos de cada fila
+    int8_t *topo;            // Topo de cada pilha (-1 = vazia)
+    uint32_t *epoca_bloco;   // Época da última alteração de cada bloco (NULL = sem checkpoint)
+    uint32_t epoca;          // Época atual (avança a cada checkpoint)
+    void *mapa;              // Arrays retomados de um checkpoint (mapeados, não alocados) ou NULL
+    size_t tamanho_mapa;
+} TabelaSessoes;
+
+// Sessões por bloco do controle de alterações do checkpoint
+#define SESSOES_POR_BLOCO_CHECKPOINT 64
+
+/**
+ * @brief Anota que uma sessão mudou na época atual (se houver um checkpoint ligado).
+ */
+void tabela_marcar_sessao(TabelaSessoes *tabela, int sessao) {
+    if (tabela->epoca_bloco != NULL) tabela->epoca_bloco[sessao / SESSOES_POR_BLOCO_CHECKPOINT] = tabela->epoca;
+}
+
+/**
+ * @brief Libera toda a memória de uma tabela de sessões.
+ * @param tabela Ponteiro para a tabela.
+ */
+void liberar_tabela_sessoes(TabelaSessoes *tabela) {
+    if (tabela->mapa != NULL) {
+        munmap(tabela->mapa, tabela->tamanho_mapa);
+    } else {
+        free(tabela->fila_nome);
+        free(tabela->fila_id);
+        free(tabela->pilha_nome);
+        free(tabela->pilha_id);
+        free(tabela->inicio);
+        free(tabela->fim);
+        free(tabela->tamanho_atual);
+        free(tabela->topo);
+    }
+    free(tabela->epoca_bloco);
+    memset(tabela, 0, sizeof(*tabela));
+}
+
+/**
+ * @brief Cria uma tabela de sessões e inicializa cada sessão como no início do jogo:
+ * pilha vazia e fila preenchida com MAX_FILA peças (sessão 0 primeiro, depois a 1, ...).
+ * @param tabela Ponteiro para a tabela a ser criada.
+ * @param quantidade Número de sessões.
+ * @return int 1 se a tabela foi criada, 0 caso contrário (falta de memória).
+ */
+int criar_tabela_sessoes(TabelaSessoes *tabela, int quantidade) {
+    size_t n = (size_t)quantidade;
+    int s, k;
+
+    memset(tabela, 0, sizeof(*tabela));
+    if (quantidade <= 0) return 0;
+
+    tabela->quantidade = quantidade;
+    tabela->fila_nome = malloc(n * MAX_FILA * sizeof(char));
+    tabela->fila_id = malloc(n * MAX_FILA * sizeof(int));
+    tabela->pilha_nome = malloc(n * MAX_PILHA * sizeof(char));
+    tabela->pilha_id = malloc(n * MAX_PILHA * sizeof(int));
+    tabela->inicio = malloc(n * sizeof(uint8_t));
+    tabela->fim = malloc(n * sizeof(uint8_t));
+    tabela->tamanho_atual = malloc(n * sizeof(uint8_t));
+    tabela->topo = malloc(n * sizeof(int8_t));
+
+    if (!tabela->fila_nome || !tabela->fila_id || !tabela->pilha_nome || !tabela->pilha_id ||
+        !tabela->inicio || !tabela->fim || !tabela->tamanho_atual || !tabela->topo) {
+        liberar_tabela_sessoes(tabela);
+        return 0;
+    }
+
+    // Posições vazias seguem a mesma convenção de limpar_array_pecas: nome '\0' e id -1
+    memset(tabela->pilha_nome, '\0', n * MAX_PILHA);
+    memset(tabela->pilha_id, 0xFF, n * MAX_PILHA * sizeof(int));
+    memset(tabela->topo, -1, n);
+
+    for (s = 0; s < quantidade; s++) {
+        size_t base = (size_t)s * MAX_FILA;
+        // Mesmo efeito de preencher_fila_inicial: a fila começa cheia
+        for (k = 0; k < MAX_FILA; k++) {
+            Peca nova = gerarPeca();
+            tabela->fila_nome[base + k] = nova.nome;
+            tabela->fila_id[base + k] = nova.id;
+        }
+        tabela->inicio[s] = 0;
+        tabela->fim[s] = 0; // (MAX_FILA) % MAX_FILA
+        tabela->tamanho_atual[s] = MAX_FILA;
+    }
+    return 1;
+}
+
+/**
+ * @brief Retorna quantos bytes cada sessão ocupa na tabela SoA.
+ * @return size_t Bytes por sessão.
+ */
+size_t tabela_bytes_por_sessao() {
+    return MAX_FILA * (sizeof(char) + sizeof(int)) +
+           MAX_PILHA * (sizeof(char) + sizeof(int)) +
+           3 * sizeof(uint8_t) + sizeof(int8_t);
+}
+
+/**
+ * @brief Copia uma sessão da tabela para as estruturas FilaCircular e Pilha.
+ * @param tabela Ponteiro para a tabela.
+ * @param sessao Índice da sessão.
+ * @param fila Ponteiro para a fila de destino.
+ * @param pilha Ponteiro para a pilha de destino.
+ */
+void tabela_carregar_sessao(TabelaSessoes *tabela, int sessao, FilaCircular *fila, Pilha *pilha) {
+    size_t base_fila = (size_t)sessao * MAX_FILA;
+    size_t base_pilha = (size_t)sessao * MAX_PILHA;
+    int k;
+
+    for (k = 0; k < MAX_FILA; k++) {
+        fila->itens[k].nome = tabela->fila_nome[base_fila + k];
+        fila->itens[k].id = tabela->fila_id[base_fila + k];
+    }
+    fila->inicio = tabela->inicio[sessao];
+    fila->fim = tabela->fim[sessao];
+    fila->tamanho_atual = tabela->tamanho_atual[sessao];
+
+    for (k = 0; k < MAX_PILHA; k++) {
+        pilha->itens[k].nome = tabela->pilha_nome[base_pilha + k];
+        pilha->itens[k].id = tabela->pilha_id[base_pilha + k];
+    }
+    pilha->topo = tabela->topo[sessao];
+}
+
+/**
+ * @brief Remove a peça da frente da fila de uma sessão (mesma regra de dequeue).
+ * Pré-condição: a fila da sessão não está vazia.
+ */
+Peca tabela_dequeue(TabelaSessoes *tabela, int sessao) {
+    size_t base = (size_t)sessao * MAX_FILA;
+    int inicio = tabela->inicio[sessao];
+    Peca removida;
+
+    removida.nome = tabela->fila_nome[base + inicio];
+    removida.id = tabela->fila_id[base + inicio];
+    tabela->fila_nome[base + inicio] = '\0';
+    tabela->fila_id[base + inicio] = -1;
+    tabela->inicio[sessao] = INDICE_FILA(inicio + 1);
+    tabela->tamanho_atual[sessao]--;
+    return removida;
+}
+
+/**
+ * @brief Gera uma peça nova e a insere no final da fila de uma sessão (mesma regra de enqueue).
+ * Pré-condição: a fila da sessão não está cheia.
+ */
+void tabela_enqueue_nova(TabelaSessoes *tabela, int sessao) {
+    size_t base = (size_t)sessao * MAX_FILA;
+    int fim = tabela->fim[sessao];
+    Peca nova = gerarPeca();
+
+    tabela->fila_nome[base + fim] = nova.nome;
+    tabela->fila_id[base + fim] = nova.id;
+    tabela->fim[sessao] = INDICE_FILA(fim + 1);
+    tabela->tamanho_atual[sessao]++;
+}
+
+/**
+ * @brief Executa uma ação (1 a 5) em uma sessão da tabela, sem saída de console.
+ * Produz o mesmo estado que executar_opcao produziria sobre o FilaCircular/Pilha equivalente.
+ * @param tabela Ponteiro para a tabela.
+ * @param sessao Índice da sessão.
+ * @param opcao Código da ação.
+ * @return ResultadoAcao O mesmo resultado que executar_opcao retornaria.
+ */
+ResultadoAcao tabela_executar_opcao(TabelaSessoes *tabela, int sessao, int opcao) {
+    size_t base_fila = (size_t)sessao * MAX_FILA;
+    size_t base_pilha = (size_t)sessao * MAX_PILHA;
+    int topo = tabela->topo[sessao];
+    int i;
+
+    // Só as ações que mudam a sessão a marcam para o checkpoint: as rejeitadas, a 0 e os
+    // códigos inválidos saem antes de tabela_marcar_sessao
+    switch (opcao) {
+        case 1: // Jogar peça
+            if (tabela->tamanho_atual[sessao] == 0) return ACAO_REJEITADA;
+            tabela_marcar_sessao(tabela, sessao);
+            tabela_dequeue(tabela, sessao);
+            tabela_enqueue_nova(tabela, sessao);
+            break;
+
+        case 2: { // Reservar peça (descartada se a pilha estiver cheia)
+            Peca removida;
+            if (tabela->tamanho_atual[sessao] == 0) return ACAO_REJEITADA;
+            tabela_marcar_sessao(tabela, sessao);
+            removida = tabela_dequeue(tabela, sessao);
+            if (topo < MAX_PILHA - 1) {
+                topo++;
+                tabela->pilha_nome[base_pilha + topo] = removida.nome;
+                tabela->pilha_id[base_pilha + topo] = removida.id;
+                tabela->topo[sessao] = topo;
+                tabela_enqueue_nova(tabela, sessao);
+                if (analise_ativa != NULL) analise_registrar_reserva(analise_ativa, 0);
+                break;
+            }
+            tabela_enqueue_nova(tabela, sessao);
+            if (analise_ativa != NULL) analise_registrar_reserva(analise_ativa, 1);
+            return ACAO_DESCARTADA;
+        }
+
+        case 3: // Usar peça reservada
+            if (topo == -1) return ACAO_REJEITADA;
+            tabela_marcar_sessao(tabela, sessao);
+            tabela->pilha_nome[base_pilha + topo] = '\0';
+            tabela->pilha_id[base_pilha + topo] = -1;
+            tabela->topo[sessao] = topo - 1;
+            break;
+
+        case 4: { // Troca simples
+            size_t f, p;
+            char nome;
+            int id;
+            if (tabela->tamanho_atual[sessao] == 0 || topo == -1) return ACAO_REJEITADA;
+            tabela_marcar_sessao(tabela, sessao);
+            f = base_fila + tabela->inicio[sessao];
+            p = base_pilha + topo;
+            nome = tabela->fila_nome[f];
+            id = tabela->fila_id[f];
+            tabela->fila_nome[f] = tabela->pilha_nome[p];
+            tabela->fila_id[f] = tabela->pilha_id[p];
+            tabela->pilha_nome[p] = nome;
+            tabela->pilha_id[p] = id;
+            break;
+        }
+
+        case 5: // Troca múltipla (3 da fila com 3 da pilha)
+            if (tabela->tamanho_atual[sessao] < 3 || topo + 1 < 3 || MAX_FILA < 3 || MAX_PILHA < 3) return ACAO_REJEITADA;
+            tabela_marcar_sessao(tabela, sessao);
+            for (i = 0; i < 3; i++) {
+                size_t f = base_fila + INDICE_FILA(tabela->inicio[sessao] + i);
+                size_t p = base_pilha + (topo - i);
+                char nome = tabela->fila_nome[f];
+                int id = tabela->fila_id[f];
+                tabela->fila_nome[f] = tabela->pilha_nome[p];
+                tabela->fila_id[f] = tabela->pilha_id[p];
+                tabela->pilha_nome[p] = nome;
+                tabela->pilha_id[p] = id;
+            }
+            break;
+
+        case 0:
+            break;
+
+        default:
+            return ACAO_INVALIDA;
+    }
+    return ACAO_REALIZADA;
+}
+
+// --- Ações em Lote na Tabela (Mesma Ação em Várias Sessões) ---
+//
+// Em uma simulação em passo único (lockstep), muitas sessões recebem a mesma ação no
+// mesmo instante. tabela_executar_lote aplica uma ação a um bloco contíguo de sessões em
+// duas fases, sem desvios por sessão:
+//  1. Contadores: inicio/fim/tamanho_atual/topo de 16 sessões por vez (um byte por
+//     sessão em um registrador SSE2); as pré-condições viram máscaras (0xFF ou 0x00),
+//     e cada contador novo é escolhido entre o antigo e o atualizado pela máscara.
+//  2. Posições: os índices das casas da fila e da pilha saem dos contadores antigos;
+//     como SSE2 não tem gather/scatter, as casas são lidas e escritas uma a uma, mas
+//     sempre (uma sessão sem a pré-condição escreve de volta o valor que já estava lá).
+// As peças novas das ações 1 e 2 vêm de uma só chamada a gerarPecas por bloco, na ordem
+// das sessões, e o resultado é o mesmo de chamar tabela_executar_opcao sessão a sessão.
+
+// Sessões tratadas por bloco (bytes em um registrador SSE2)
+#define SESSOES_POR_BLOCO_LOTE 16
+_Static_assert(SESSOES_POR_BLOCO_LOTE <= SESSOES_POR_BLOCO_CHECKPOINT,
+               "tabela_executar_lote marca no maximo dois blocos do checkpoint por bloco do lote");
+
+/**
+ * @brief Contadores antigos e máscaras de um bloco de sessões, entre as duas fases.
+ */
+typedef struct {
+    uint8_t inicio[SESSOES_POR_BLOCO_LOTE];
+    uint8_t fim[SESSOES_POR_BLOCO_LOTE];
+    int8_t topo[SESSOES_POR_BLOCO_LOTE];
+    uint8_t ativa[SESSOES_POR_BLOCO_LOTE];    // 0xFF: a pré-condição da ação foi atendida
+    uint8_t empilha[SESSOES_POR_BLOCO_LOTE];  // 0xFF: (reservar) a peça vai para a pilha
+    int8_t resultado[SESSOES_POR_BLOCO_LOTE]; // ResultadoAcao de cada sessão
+    unsigned mascara_ativa;                   // Bit j: ativa[j]
+    unsigned mascara_descarte;                // Bit j: (reservar) peça descartada com a pilha cheia
+} BlocoLote;
+
+/**
+ * @brief Fase 1 sem SIMD: máscaras e contadores novos de 'n' sessões a partir de 'primeira'.
+ */
+void lote_contadores_escalar(TabelaSessoes *tabela, int primeira, int n, int opcao, BlocoLote *bloco) {
+    int j;
+    bloco->mascara_ativa = bloco->mascara_descarte = 0;
+    for (j = 0; j < n; j++) {
+        int s = primeira + j;
+        int inicio = tabela->inicio[s], fim = tabela->fim[s], tamanho = tabela->tamanho_atual[s];
+        int topo = tabela->topo[s];
+        int ativa = 0, empilha = 0;
+
+        switch (opcao) {
+            case 1: case 2: ativa = tamanho > 0; empilha = ativa && topo < MAX_PILHA - 1; break;
+            case 3: ativa = topo >= 0; break;
+            case 4: ativa = tamanho > 0 && topo >= 0; break;
+            case 5: ativa = tamanho >= 3 && topo >= 2 && MAX_FILA >= 3 && MAX_PILHA >= 3; break;
+        }
+        bloco->inicio[j] = (uint8_t)inicio;
+        bloco->fim[j] = (uint8_t)fim;
+        bloco->topo[j] = (int8_t)topo;
+        bloco->ativa[j] = ativa ? 0xFF : 0;
+        bloco->empilha[j] = (opcao == 2 && empilha) ? 0xFF : 0;
+        bloco->mascara_ativa |= (unsigned)ativa << j;
+        bloco->mascara_descarte |= (unsigned)(opcao == 2 && ativa && !empilha) << j;
+        if (opcao == 1 || opcao == 2) {
+            tabela->inicio[s] = (uint8_t)(ativa ? INDICE_FILA(inicio + 1) : inicio);
+            tabela->fim[s] = (uint8_t)(ativa ? INDICE_FILA(fim + 1) : fim);
+        }
+        if (opcao == 2) tabela->topo[s] = (int8_t)(topo + empilha);
+        if (opcao == 3) tabela->topo[s] = (int8_t)(topo - ativa);
+        bloco->resultado[j] = (int8_t)(opcao == 0 ? ACAO_REALIZADA
+                                       : opcao == 2 && ativa && !empilha ? ACAO_DESCARTADA
+                                       : ativa ? ACAO_REALIZADA : ACAO_REJEITADA);
+    }
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief Fase 1 com SSE2 para um bloco completo de SESSOES_POR_BLOCO_LOTE sessões.
+ */
+void lote_contadores(TabelaSessoes *tabela, int primeira, int opcao, BlocoLote *bloco) {
+    const __m128i um = _mm_set1_epi8(1);
+    __m128i inicio = _mm_loadu_si128((const __m128i *)(tabela->inicio + primeira));
+    __m128i fim = _mm_loadu_si128((const __m128i *)(tabela->fim + primeira));
+    __m128i tamanho = _mm_loadu_si128((const __m128i *)(tabela->tamanho_atual + primeira));
+    __m128i topo = _mm_loadu_si128((const __m128i *)(tabela->topo + primeira));
+    __m128i nao_vazia = _mm_xor_si128(_mm_cmpeq_epi8(tamanho, _mm_setzero_si128()), _mm_set1_epi8(-1));
+    __m128i tem_reserva = _mm_cmpgt_epi8(topo, _mm_set1_epi8(-1)); // topo é int8 (-1 a MAX_PILHA - 1)
+    __m128i ativa = _mm_setzero_si128();
+    __m128i empilha = _mm_setzero_si128();
+    __m128i resultado;
+
+    _mm_storeu_si128((__m128i *)bloco->inicio, inicio);
+    _mm_storeu_si128((__m128i *)bloco->fim, fim);
+    _mm_storeu_si128((__m128i *)bloco->topo, topo);
+
+    switch (opcao) {
+        case 1:
+        case 2: {
+            // Avança inicio e fim de uma casa (voltando a 0 em MAX_FILA) nas sessões ativas
+            __m128i capacidade = _mm_set1_epi8((char)MAX_FILA);
+            __m128i inicio_novo = _mm_add_epi8(inicio, um);
+            __m128i fim_novo = _mm_add_epi8(fim, um);
+            inicio_novo = _mm_andnot_si128(_mm_cmpeq_epi8(inicio_novo, capacidade), inicio_novo);
+            fim_novo = _mm_andnot_si128(_mm_cmpeq_epi8(fim_novo, capacidade), fim_novo);
+            ativa = nao_vazia;
+            _mm_storeu_si128((__m128i *)(tabela->inicio + primeira),
+                             _mm_or_si128(_mm_and_si128(ativa, inicio_novo), _mm_andnot_si128(ativa, inicio)));
+            _mm_storeu_si128((__m128i *)(tabela->fim + primeira),
+                             _mm_or_si128(_mm_and_si128(ativa, fim_novo), _mm_andnot_si128(ativa, fim)));
+            if (opcao == 2) {
+                empilha = _mm_and_si128(ativa, _mm_cmpgt_epi8(_mm_set1_epi8(MAX_PILHA - 1), topo));
+                _mm_storeu_si128((__m128i *)(tabela->topo + primeira), _mm_sub_epi8(topo, empilha)); // -(-1)
+            }
+            break;
+        }
+        case 3:
+            ativa = tem_reserva;
+            _mm_storeu_si128((__m128i *)(tabela->topo + primeira), _mm_add_epi8(topo, ativa)); // + (-1)
+            break;
+        case 4:
+            ativa = _mm_and_si128(nao_vazia, tem_reserva);
+            break;
+        case 5:
+            if (MAX_FILA >= 3 && MAX_PILHA >= 3) {
+                // tamanho >= 3 (sem sinal: tamanho - 2 com saturação não é 0) e topo >= 2
+                __m128i tres_na_fila = _mm_xor_si128(
+                    _mm_cmpeq_epi8(_mm_subs_epu8(tamanho, _mm_set1_epi8(2)), _mm_setzero_si128()), _mm_set1_epi8(-1));
+                ativa = _mm_and_si128(tres_na_fila, _mm_cmpgt_epi8(topo, um));
+            }
+            break;
+    }
+
+    // REALIZADA (1) nas ativas, REJEITADA (0) nas demais e DESCARTADA (2) nas que reservaram sem empilhar
+    resultado = opcao == 0 ? um : _mm_and_si128(ativa, um);
+    resultado = _mm_add_epi8(resultado, _mm_and_si128(_mm_andnot_si128(empilha, ativa),
+                                                      opcao == 2 ? um : _mm_setzero_si128()));
+    _mm_storeu_si128((__m128i *)bloco->ativa, ativa);
+    _mm_storeu_si128((__m128i *)bloco->empilha, empilha);
+    _mm_storeu_si128((__m128i *)bloco->resultado, resultado);
+    bloco->mascara_ativa = (unsigned)_mm_movemask_epi8(ativa);
+    bloco->mascara_descarte = opcao == 2 ? (unsigned)_mm_movemask_epi8(_mm_andnot_si128(empilha, ativa)) : 0;
+}
+
+#else
+
+void lote_contadores(TabelaSessoes *tabela, int primeira, int opcao, BlocoLote *bloco) {
+    lote_contadores_escalar(tabela, primeira, SESSOES_POR_BLOCO_LOTE, opcao, bloco);
+}
+
+#endif // __SSE2__
+
+/**
+ * @brief Fase 2: lê e escreve as casas da fila e da pilha de 'n' sessões do bloco.
+ * Nas ações 1 e 2, quase todas as sessões estão ativas e todas são percorridas sem desvios;
+ * nas demais, só as ativas (os bits de 'ativas') são visitadas.
+ * @param ativas Máscara das sessões ativas (bit j: sessão primeira + j).
+ * @param novas Peças novas das sessões ativas, em ordem (ações 1 e 2), com uma casa a mais.
+ */
+void lote_posicoes(TabelaSessoes *tabela, int primeira, int n, int opcao, const BlocoLote *bloco,
+                   unsigned ativas, const Peca *novas) {
+    char *fila_nome = tabela->fila_nome + (size_t)primeira * MAX_FILA;
+    int *fila_id = tabela->fila_id + (size_t)primeira * MAX_FILA;
+    char *pilha_nome = tabela->pilha_nome + (size_t)primeira * MAX_PILHA;
+    int *pilha_id = tabela->pilha_id + (size_t)primeira * MAX_PILHA;
+    int proxima = 0;
+    int j, i;
+
+    switch (opcao) {
+        case 1:
+        case 2:
+            // Sai a peça da frente (para a pilha, se couber) e entra uma nova no fim
+            for (j = 0; j < n; j++) {
+                int ativa = bloco->ativa[j] & 1;
+                int empilha = bloco->empilha[j] & 1;
+                size_t f = (size_t)j * MAX_FILA + bloco->inicio[j];
+                size_t e = (size_t)j * MAX_FILA + bloco->fim[j];
+                size_t p = (size_t)j * MAX_PILHA + (empilha ? bloco->topo[j] + 1 : 0);
+                char nome = fila_nome[f];
+                int id = fila_id[f];
+                pilha_nome[p] = empilha ? nome : pilha_nome[p];
+                pilha_id[p] = empilha ? id : pilha_id[p];
+                fila_nome[f] = ativa ? '\0' : nome;
+                fila_id[f] = ativa ? -1 : id;
+                fila_nome[e] = ativa ? novas[proxima].nome : fila_nome[e];
+                fila_id[e] = ativa ? novas[proxima].id : fila_id[e];
+                proxima += ativa;
+            }
+            break;
+
+        case 3:
+        case 4:
+        case 5:
+            // Só as sessões ativas (os bits de 'ativas'): nas demais nada muda
+            while (ativas != 0) {
+                j = __builtin_ctz(ativas);
+                ativas &= ativas - 1;
+                if (opcao == 3) {
+                    size_t p = (size_t)j * MAX_PILHA + bloco->topo[j];
+                    pilha_nome[p] = '\0';
+                    pilha_id[p] = -1;
+                    continue;
+                }
+                // Troca 1 (ou 3) peças da frente da fila com as do topo da pilha
+                for (i = 0; i < (opcao == 4 ? 1 : 3); i++) {
+                    size_t f = (size_t)j * MAX_FILA + INDICE_FILA(bloco->inicio[j] + i);
+                    size_t p = (size_t)j * MAX_PILHA + bloco->topo[j] - i;
+                    char nome = fila_nome[f];
+                    int id = fila_id[f];
+                    fila_nome[f] = pilha_nome[p];
+                    fila_id[f] = pilha_id[p];
+                    pilha_nome[p] = nome;
+                    pilha_id[p] = id;
+                }
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Aplica a mesma ação às sessões [primeira, primeira + quantidade) da tabela.
+ * O estado final, as peças geradas e os resultados são os mesmos de chamar
+ * tabela_executar_opcao em cada sessão, em ordem.
+ * @param tabela Ponteiro para a tabela.
+ * @param primeira Primeira sessão do bloco.
+ * @param quantidade Número de sessões.
+ * @param opcao Código da ação (0 a 5).
+ * @param resultados Recebe o ResultadoAcao de cada sessão (pode ser NULL).
+ * @return int Sessões em que a ação teve efeito (REALIZADA ou DESCARTADA), ou -1 se a opção
+ * for inválida (nada muda, como ACAO_INVALIDA em tabela_executar_opcao).
+ */
+int tabela_executar_lote(TabelaSessoes *tabela, int primeira, int quantidade, int opcao, int8_t *resultados) {
+    BlocoLote bloco;
+    Peca novas[SESSOES_POR_BLOCO_LOTE + 1];
+    int efeito = 0;
+    int feitas;
+
+    if (opcao < 0 || opcao > 5) {
+        if (resultados != NULL) memset(resultados, ACAO_INVALIDA, quantidade);
+        return -1;
+    }
+    for (feitas = 0; feitas < quantidade; feitas += SESSOES_POR_BLOCO_LOTE) {
+        int n = quantidade - feitas < SESSOES_POR_BLOCO_LOTE ? quantidade - feitas : SESSOES_POR_BLOCO_LOTE;
+        int ativas;
+
+        if (n == SESSOES_POR_BLOCO_LOTE) {
+            lote_contadores(tabela, primeira + feitas, opcao, &bloco);
+        } else {
+            lote_contadores_escalar(tabela, primeira + feitas, n, opcao, &bloco);
+        }
+        ativas = __builtin_popcount(bloco.mascara_ativa);
+        if (opcao == 1 || opcao == 2) gerarPecas(novas, ativas);
+        // Um bloco sem nenhuma sessão ativa não toca nas casas (um desvio por bloco, não por
+        // sessão) nem é marcado para o checkpoint. O bloco de SESSOES_POR_BLOCO_LOTE sessões
+        // cabe em no máximo dois blocos do checkpoint: os da primeira e da última sessão.
+        if (opcao != 0 && ativas > 0) {
+            lote_posicoes(tabela, primeira + feitas, n, opcao, &bloco, bloco.mascara_ativa, novas);
+            tabela_marcar_sessao(tabela, primeira + feitas);
+            tabela_marcar_sessao(tabela, primeira + feitas + n - 1);
+        }
+        if (opcao == 2 && analise_ativa != NULL) {
+            analise_ativa->reservas += ativas;
+            analise_ativa->descartes += __builtin_popcount(bloco.mascara_descarte);
+        }
+        if (resultados != NULL) memcpy(resultados + feitas, bloco.resultado, n);
+        efeito += opcao == 0 ? n : ativas;
+    }
+    return efeito;
+}
+
+// --- Checkpoint da Tabela de Sessões (Blocos Alterados em Arquivo Mapeado) ---
+//
+// Recuperação depois de uma queda sem parar o jogo para serializar todas as sessões.
+// O arquivo é uma imagem dos arrays da TabelaSessoes, em dois slots alternados (A/B):
+//   [cabeçalho (4 KiB)] [slot 0: fila_nome, fila_id, ..., topo] [slot 1: idem]
+// Cada checkpoint grava o slot mais antigo, com só os blocos de sessões alterados desde
+// a versão que aquele slot guarda (épocas em TabelaSessoes.epoca_bloco):
+//  1. Corte (na thread do jogo): copia os blocos alterados para um buffer e anota o
+//     gerador e a posição do replay. É a única pausa, proporcional ao que mudou; blocos
+//     alterados vizinhos formam um trecho, copiado com um memcpy por array.
+//  2. Gravação (thread de fundo, enquanto as ações continuam): invalida o registro do
+//     slot, copia os blocos para o slot mapeado, msync, e só então grava o registro
+//     novo (versão, gerador, posição e soma de verificação) e faz msync do cabeçalho.
+// Uma queda no meio da gravação deixa o registro do slot inválido, e o outro slot (a
+// versão anterior) continua inteiro. Para retomar, o slot mais novo é mapeado com
+// MAP_PRIVATE e os arrays da tabela passam a apontar para dentro dele: nada é lido nem
+// convertido sessão a sessão (o arquivo é uma imagem da memória, válido só para os
+// mesmos MAX_FILA/MAX_PILHA e a mesma arquitetura, conferidos no cabeçalho).
+
+#define MAGICO_CHECKPOINT "TSCK"
+#define VERSAO_CHECKPOINT 1
+// Tamanho reservado para o cabeçalho (os slots começam em páginas próprias)
+#define TAMANHO_CABECALHO_CHECKPOINT 4096
+// Ações do replay entre dois checkpoints, por padrão
+#define INTERVALO_CHECKPOINT_PADRAO (1 << 20)
+// Arrays da tabela guardados em cada slot
+#define NUM_ARRAYS_CHECKPOINT 8
+
+// Bytes de cada sessão em cada array, na ordem de tabela_arrays
+static const size_t BYTES_SESSAO_CHECKPOINT[NUM_ARRAYS_CHECKPOINT] = {
+    MAX_FILA * sizeof(char), MAX_FILA * sizeof(int), MAX_PILHA * sizeof(char), MAX_PILHA * sizeof(int),
+    sizeof(uint8_t), sizeof(uint8_t), sizeof(uint8_t), sizeof(int8_t),
+};
+
+/**
+ * @brief Registro de um slot: a que ponto do replay os dados dele correspondem.
+ */
+typedef struct {
+    uint64_t versao;       // Época do checkpoint (0 = slot vazio ou sendo gravado)
+    uint64_t acoes;        // Ações do replay já aplicadas à tabela
+    int32_t sessao;        // Próxima sessão do rodízio
+    int32_t reservado;
+    GeradorPecas gerador;  // Gerador de peças logo após a última ação aplicada
+    uint64_t soma;         // FNV-1a dos campos acima
+} RegistroCheckpoint;
+
+/**
+ * @brief Cabeçalho do arquivo de checkpoint.
+ */
+typedef struct {
+    char magico[4];
+    uint32_t versao_formato;
+    uint32_t max_fila;
+    uint32_t max_pilha;
+    uint32_t quantidade;           // Sessões da tabela
+    uint32_t tamanho_gerador;      // sizeof(GeradorPecas), para recusar imagens de outra compilação
+    uint64_t tamanho_slot;
+    uint64_t deslocamentos[NUM_ARRAYS_CHECKPOINT]; // Posição de cada array dentro do slot
+    RegistroCheckpoint slots[2];
+} CabecalhoCheckpoint;
+
+/**
+ * @brief Estado do checkpoint de uma tabela (arquivo mapeado, buffer do corte e thread).
+ */
+typedef struct {
+    int fd;
+    unsigned char *mapa;             // Arquivo inteiro, MAP_SHARED (escrito só pela thread)
+    size_t tamanho_mapa;
+    CabecalhoCheckpoint *cabecalho;  // Início de 'mapa'
+    TabelaSessoes *tabela;
+    int num_blocos;
+    uint64_t versao_slot[2];         // Versão guardada em cada slot (cópia da thread do jogo)
+
+    // Corte pendente, preenchido pela thread do jogo e gravado pela thread de fundo
+    unsigned char *copia;            // Blocos alterados, na ordem de 'trechos'
+    int *trechos;                    // Pares (primeiro bloco, blocos) de blocos alterados vizinhos
+    int num_trechos;
+    int num_copiados;                // Blocos no corte pendente
+    int slot_pendente;
+    RegistroCheckpoint pendente;
+
+    pthread_t thread;
+    pthread_mutex_t trava;
+    pthread_cond_t sinal;
+    int ocupado;                     // Há um corte sendo gravado
+    int encerrar;
+    int erro;                        // msync falhou em alguma gravação
+
+    // Estatísticas
+    long long checkpoints;
+    long long pulados;               // Cortes adiados porque a gravação anterior não terminou
+    long long blocos_gravados;
+    long long bytes_gravados;
+    uint64_t ns_corte_total, ns_corte_max;
+    uint64_t ns_gravacao_total;
+} Checkpoint;
+
+/**
+ * @brief Soma de verificação (FNV-1a de 64 bits) de um registro, sem o campo 'soma'.
+ */
+uint64_t checkpoint_soma(const RegistroCheckpoint *registro) {
+    const unsigned char *p = (const unsigned char *)registro;
+    uint64_t hash = 1469598103934665603ULL;
+    size_t i;
+    for (i = 0; i < offsetof(RegistroCheckpoint, soma); i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Ponteiros para os arrays da tabela, na ordem de BYTES_SESSAO_CHECKPOINT.
+ */
+void tabela_arrays(TabelaSessoes *tabela, unsigned char *arrays[NUM_ARRAYS_CHECKPOINT]) {
+    arrays[0] = (unsigned char *)tabela->fila_nome;
+    arrays[1] = (unsigned char *)tabela->fila_id;
+    arrays[2] = (unsigned char *)tabela->pilha_nome;
+    arrays[3] = (unsigned char *)tabela->pilha_id;
+    arrays[4] = tabela->inicio;
+    arrays[5] = tabela->fim;
+    arrays[6] = tabela->tamanho_atual;
+    arrays[7] = (unsigned char *)tabela->topo;
+}
+
+/**
+ * @brief Posição de cada array dentro de um slot (alinhadas a 64 bytes) e o tamanho do
+ * slot (múltiplo de 4096, para que cada slot possa ser mapeado sozinho).
+ */
+uint64_t checkpoint_layout(int quantidade, uint64_t deslocamentos[NUM_ARRAYS_CHECKPOINT]) {
+    uint64_t posicao = 0;
+    int a;
+    for (a = 0; a < NUM_ARRAYS_CHECKPOINT; a++) {
+        deslocamentos[a] = posicao;
+        posicao += (uint64_t)quantidade * BYTES_SESSAO_CHECKPOINT[a];
+        posicao = (posicao + 63) & ~(uint64_t)63;
+    }
+    return (posicao + 4095) & ~(uint64_t)4095;
+}
+
+/**
+ * @brief Diz se um registro de slot está completo (versão não nula e soma conferida).
+ */
+int checkpoint_registro_valido(const RegistroCheckpoint *registro) {
+    return registro->versao != 0 && registro->soma == checkpoint_soma(registro);
+}
+
+/**
+ * @brief Sessões de um trecho de blocos, limitado ao fim da tabela.
+ */
+int checkpoint_sessoes_trecho(int quantidade, int primeiro_bloco, int num_blocos, int *primeira) {
+    int fim = (primeiro_bloco + num_blocos) * SESSOES_POR_BLOCO_CHECKPOINT;
+    *primeira = primeiro_bloco * SESSOES_POR_BLOCO_CHECKPOINT;
+    return (fim < quantidade ? fim : quantidade) - *primeira;
+}
+
+/**
+ * @brief Grava o corte pendente no slot (roda na thread de fundo, sem a trava).
+ */
+void checkpoint_gravar(Checkpoint *ck) {
+    CabecalhoCheckpoint *cab = ck->cabecalho;
+    unsigned char *slot = ck->mapa + TAMANHO_CABECALHO_CHECKPOINT + (size_t)ck->slot_pendente * cab->tamanho_slot;
+    const unsigned char *origem = ck->copia;
+    int quantidade = (int)cab->quantidade;
+    int k, a;
+
+    // 1. O registro antigo deixa de valer antes de qualquer dado mudar
+    memset(&cab->slots[ck->slot_pendente], 0, sizeof(RegistroCheckpoint));
+    if (msync(ck->mapa, TAMANHO_CABECALHO_CHECKPOINT, MS_SYNC) != 0) ck->erro = 1;
+
+    // 2. Os trechos, array por array, nas mesmas posições que ocupam na memória
+    for (k = 0; k < ck->num_trechos; k++) {
+        int primeira;
+        int n = checkpoint_sessoes_trecho(quantidade, ck->trechos[2 * k], ck->trechos[2 * k + 1], &primeira);
+        for (a = 0; a < NUM_ARRAYS_CHECKPOINT; a++) {
+            size_t bytes = (size_t)n * BYTES_SESSAO_CHECKPOINT[a];
+            memcpy(slot + cab->deslocamentos[a] + (size_t)primeira * BYTES_SESSAO_CHECKPOINT[a], origem, bytes);
+            origem += bytes;
+        }
+    }
+    if (msync(slot, cab->tamanho_slot, MS_SYNC) != 0) ck->erro = 1;
+
+    // 3. O registro novo, por último
+    cab->slots[ck->slot_pendente] = ck->pendente;
+    if (msync(ck->mapa, TAMANHO_CABECALHO_CHECKPOINT, MS_SYNC) != 0) ck->erro = 1;
+    ck->bytes_gravados += origem - ck->copia;
+    ck->blocos_gravados += ck->num_copiados;
+}
+
+/**
+ * @brief Thread de fundo: espera um corte, grava e volta a esperar.
+ */
+void *checkpoint_thread(void *arg) {
+    Checkpoint *ck = arg;
+
+    pthread_mutex_lock(&ck->trava);
+    for (;;) {
+        while (!ck->ocupado && !ck->encerrar) pthread_cond_wait(&ck->sinal, &ck->trava);
+        if (!ck->ocupado) break;
+        pthread_mutex_unlock(&ck->trava);
+
+        {
+            uint64_t inicio = ler_ns();
+            checkpoint_gravar(ck);
+            ck->ns_gravacao_total += ler_ns() - inicio;
+        }
+
+        pthread_mutex_lock(&ck->trava);
+        ck->ocupado = 0;
+        pthread_cond_broadcast(&ck->sinal);
+    }
+    pthread_mutex_unlock(&ck->trava);
+    return NULL;
+}
+
+/**
+ * @brief Abre (ou cria) o arquivo de checkpoint de uma tabela com 'quantidade' sessões.
+ * Um arquivo existente de outra configuração (sessões, MAX_FILA, MAX_PILHA) é recusado.
+ * @return int 1 em caso de sucesso, 0 em caso de erro (mensagem na stderr).
+ */
+int checkpoint_abrir(Checkpoint *ck, const char *caminho, int quantidade) {
+    CabecalhoCheckpoint novo;
+    struct stat info;
+
+    memset(ck, 0, sizeof(*ck));
+    memset(&novo, 0, sizeof(novo));
+    memcpy(novo.magico, MAGICO_CHECKPOINT, 4);
+    novo.versao_formato = VERSAO_CHECKPOINT;
+    novo.max_fila = MAX_FILA;
+    novo.max_pilha = MAX_PILHA;
+    novo.quantidade = (uint32_t)quantidade;
+    novo.tamanho_gerador = sizeof(GeradorPecas);
+    novo.tamanho_slot = checkpoint_layout(quantidade, novo.deslocamentos);
+
+    ck->fd = open(caminho, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (ck->fd < 0 || fstat(ck->fd, &info) != 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel abrir o checkpoint '%s'.\n", caminho);
+        if (ck->fd >= 0) close(ck->fd);
+        return 0;
+    }
+    ck->tamanho_mapa = TAMANHO_CABECALHO_CHECKPOINT + 2 * novo.tamanho_slot;
+
+    if (info.st_size == 0 && ftruncate(ck->fd, (off_t)ck->tamanho_mapa) != 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel criar o checkpoint '%s'.\n", caminho);
+        close(ck->fd);
+        return 0;
+    }
+    if (info.st_size != 0 && (size_t)info.st_size != ck->tamanho_mapa) {
+        fprintf(stderr, "ERRO: O checkpoint '%s' e de outra configuracao (tamanho diferente).\n", caminho);
+        close(ck->fd);
+        return 0;
+    }
+    ck->mapa = mmap(NULL, ck->tamanho_mapa, PROT_READ | PROT_WRITE, MAP_SHARED, ck->fd, 0);
+    if (ck->mapa == MAP_FAILED) {
+        fprintf(stderr, "ERRO: Nao foi possivel mapear o checkpoint '%s'.\n", caminho);
+        close(ck->fd);
+        return 0;
+    }
+    ck->cabecalho = (CabecalhoCheckpoint *)ck->mapa;
+
+    if (info.st_size == 0) {
+        *ck->cabecalho = novo;
+        msync(ck->mapa, TAMANHO_CABECALHO_CHECKPOINT, MS_SYNC);
+    } else if (memcmp(ck->cabecalho, &novo, offsetof(CabecalhoCheckpoint, slots)) != 0) {
+        fprintf(stderr, "ERRO: O checkpoint '%s' e de outra configuracao (sessoes, MAX_FILA ou MAX_PILHA).\n", caminho);
+        munmap(ck->mapa, ck->tamanho_mapa);
+        close(ck->fd);
+        return 0;
+    }
+    ck->versao_slot[0] = checkpoint_registro_valido(&ck->cabecalho->slots[0]) ? ck->cabecalho->slots[0].versao : 0;
+    ck->versao_slot[1] = checkpoint_registro_valido(&ck->cabecalho->slots[1]) ? ck->cabecalho->slots[1].versao : 0;
+    return 1;
+}
+
+/**
+ * @brief Retoma a tabela do slot mais novo: mapeia o slot (MAP_PRIVATE, as alterações
+ * seguintes não vão para o arquivo) e aponta os arrays da tabela para dentro dele.
+ * @param registro Recebe a posição do replay e o gerador do checkpoint.
+ * @return int 1 se a tabela foi retomada, 0 se não há checkpoint válido (ou erro).
+ */
+int checkpoint_retomar(Checkpoint *ck, TabelaSessoes *tabela, RegistroCheckpoint *registro) {
+    CabecalhoCheckpoint *cab = ck->cabecalho;
+    int slot = ck->versao_slot[1] > ck->versao_slot[0] ? 1 : 0;
+    unsigned char *base;
+
+    if (ck->versao_slot[slot] == 0) return 0;
+    base = mmap(NULL, cab->tamanho_slot, PROT_READ | PROT_WRITE, MAP_PRIVATE, ck->fd,
+                (off_t)(TAMANHO_CABECALHO_CHECKPOINT + (size_t)slot * cab->tamanho_slot));
+    if (base == MAP_FAILED) return 0;
+
+    memset(tabela, 0, sizeof(*tabela));
+    tabela->quantidade = (int)cab->quantidade;
+    tabela->fila_nome = (char *)(base + cab->deslocamentos[0]);
+    tabela->fila_id = (int *)(base + cab->deslocamentos[1]);
+    tabela->pilha_nome = (char *)(base + cab->deslocamentos[2]);
+    tabela->pilha_id = (int *)(base + cab->deslocamentos[3]);
+    tabela->inicio = base + cab->deslocamentos[4];
+    tabela->fim = base + cab->deslocamentos[5];
+    tabela->tamanho_atual = base + cab->deslocamentos[6];
+    tabela->topo = (int8_t *)(base + cab->deslocamentos[7]);
+    tabela->mapa = base;
+    tabela->tamanho_mapa = cab->tamanho_slot;
+    // Épocas continuam de onde o checkpoint parou (ver checkpoint_iniciar)
+    tabela->epoca = (uint32_t)ck->versao_slot[slot];
+    *registro = cab->slots[slot];
+    return 1;
+}
+
+/**
+ * @brief Liga o controle de blocos alterados da tabela e inicia a thread de gravação.
+ * Todos os blocos contam como alterados na época atual: o próximo corte para um slot
+ * mais antigo grava tudo (numa tabela retomada, o slot mais novo já tem esses dados).
+ * @return int 1 em caso de sucesso, 0 em caso de erro.
+ */
+int checkpoint_iniciar(Checkpoint *ck, TabelaSessoes *tabela) {
+    int b;
+
+    ck->tabela = tabela;
+    ck->num_blocos = (tabela->quantidade + SESSOES_POR_BLOCO_CHECKPOINT - 1) / SESSOES_POR_BLOCO_CHECKPOINT;
+    tabela->epoca_bloco = malloc(ck->num_blocos * sizeof(uint32_t));
+    ck->trechos = malloc(2 * ck->num_blocos * sizeof(int));
+    ck->copia = malloc(ck->cabecalho->tamanho_slot);
+    if (tabela->epoca_bloco == NULL || ck->trechos == NULL || ck->copia == NULL) {
+        munmap(ck->mapa, ck->tamanho_mapa);
+        close(ck->fd);
+        free(ck->copia);
+        free(ck->trechos);
+        return 0;
+    }
+    if (tabela->epoca == 0) tabela->epoca = 1;
+    for (b = 0; b < ck->num_blocos; b++) tabela->epoca_bloco[b] = tabela->epoca;
+    tabela->epoca++;
+
+    pthread_mutex_init(&ck->trava, NULL);
+    pthread_cond_init(&ck->sinal, NULL);
+    if (pthread_create(&ck->thread, NULL, checkpoint_thread, ck) != 0) {
+        pthread_mutex_destroy(&ck->trava);
+        pthread_cond_destroy(&ck->sinal);
+        munmap(ck->mapa, ck->tamanho_mapa);
+        close(ck->fd);
+        free(ck->copia);
+        free(ck->trechos);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Corta um checkpoint: copia os blocos alterados desde a versão do slot mais
+ * antigo e entrega a gravação à thread de fundo. Se a gravação anterior ainda não
+ * terminou, o corte é adiado (as alterações continuam anotadas).
+ * @param acoes Ações do replay aplicadas até aqui.
+ * @param sessao Próxima sessão do rodízio.
+ * @return int 1 se o corte foi feito, 0 se foi adiado.
+ */
+int checkpoint_cortar(Checkpoint *ck, uint64_t acoes, int sessao) {
+    TabelaSessoes *tabela = ck->tabela;
+    unsigned char *arrays[NUM_ARRAYS_CHECKPOINT];
+    unsigned char *destino = ck->copia;
+    uint64_t inicio = ler_ns(), gasto;
+    int slot = ck->versao_slot[1] < ck->versao_slot[0] ? 1 : 0;
+    uint32_t desde = (uint32_t)ck->versao_slot[slot];
+    int ocupado, b, a;
+
+    pthread_mutex_lock(&ck->trava);
+    ocupado = ck->ocupado;
+    pthread_mutex_unlock(&ck->trava);
+    if (ocupado) {
+        ck->pulados++;
+        return 0;
+    }
+
+    tabela_arrays(tabela, arrays);
+    ck->num_trechos = ck->num_copiados = 0;
+    for (b = 0; b < ck->num_blocos; b++) {
+        int fim = b, primeira, n;
+        if (tabela->epoca_bloco[b] <= desde) continue;
+        while (fim + 1 < ck->num_blocos && tabela->epoca_bloco[fim + 1] > desde) fim++;
+        n = checkpoint_sessoes_trecho(tabela->quantidade, b, fim - b + 1, &primeira);
+        for (a = 0; a < NUM_ARRAYS_CHECKPOINT; a++) {
+            size_t bytes = (size_t)n * BYTES_SESSAO_CHECKPOINT[a];
+            memcpy(destino, arrays[a] + (size_t)primeira * BYTES_SESSAO_CHECKPOINT[a], bytes);
+            destino += bytes;
+        }
+        ck->trechos[2 * ck->num_trechos] = b;
+        ck->trechos[2 * ck->num_trechos + 1] = fim - b + 1;
+        ck->num_trechos++;
+        ck->num_copiados += fim - b + 1;
+        b = fim;
+    }
+
+    memset(&ck->pendente, 0, sizeof(ck->pendente));
+    ck->pendente.versao = tabela->epoca;
+    ck->pendente.acoes = acoes;
+    ck->pendente.sessao = sessao;
+    ck->pendente.gerador = *gerador_ativo;
+    ck->pendente.soma = checkpoint_soma(&ck->pendente);
+    ck->slot_pendente = slot;
+    ck->versao_slot[slot] = tabela->epoca;
+    tabela->epoca++;
+    ck->checkpoints++;
+
+    pthread_mutex_lock(&ck->trava);
+    ck->ocupado = 1;
+    pthread_cond_signal(&ck->sinal);
+    pthread_mutex_unlock(&ck->trava);
+
+    gasto = ler_ns() - inicio;
+    ck->ns_corte_total += gasto;
+    if (gasto > ck->ns_corte_max) ck->ns_corte_max = gasto;
+    return 1;
+}
+
+/**
+ * @brief Espera a gravação em andamento (se houver) terminar.
+ */
+void checkpoint_esperar(Checkpoint *ck) {
+    pthread_mutex_lock(&ck->trava);
+    while (ck->ocupado) pthread_cond_wait(&ck->sinal, &ck->trava);
+    pthread_mutex_unlock(&ck->trava);
+}
+
+/**
+ * @brief Grava o checkpoint final, encerra a thread e fecha o arquivo.
+ * @return int 1 se todas as gravações foram confirmadas (msync), 0 caso contrário.
+ */
+int checkpoint_fechar(Checkpoint *ck, uint64_t acoes, int sessao) {
+    checkpoint_esperar(ck);
+    checkpoint_cortar(ck, acoes, sessao);
+    checkpoint_esperar(ck);
+
+    pthread_mutex_lock(&ck->trava);
+    ck->encerrar = 1;
+    pthread_cond_signal(&ck->sinal);
+    pthread_mutex_unlock(&ck->trava);
+    pthread_join(ck->thread, NULL);
+    pthread_mutex_destroy(&ck->trava);
+    pthread_cond_destroy(&ck->sinal);
+
+    munmap(ck->mapa, ck->tamanho_mapa);
+    close(ck->fd);
+    free(ck->copia);
+    free(ck->trechos);
+    return !ck->erro;
+}
+
+/**
+ * @brief Imprime as estatísticas do checkpoint.
+ */
+void checkpoint_imprimir(const Checkpoint *ck, FILE *saida) {
+    fprintf(saida, "Checkpoint: %lld gravados (versao %llu), %lld blocos de %d sessoes (%.1f MiB), "
+                   "%lld adiados com a gravacao anterior em andamento\n",
+            ck->checkpoints, (unsigned long long)(ck->versao_slot[0] > ck->versao_slot[1] ? ck->versao_slot[0] : ck->versao_slot[1]),
+            ck->blocos_gravados, SESSOES_POR_BLOCO_CHECKPOINT, ck->bytes_gravados / (1024.0 * 1024.0), ck->pulados);
+    if (ck->checkpoints > 0) {
+        fprintf(saida, "Pausa do corte: media %.1f us, max %.1f us | Gravacao em fundo: media %.2f ms\n",
+                ck->ns_corte_total / 1e3 / ck->checkpoints, ck->ns_corte_max / 1e3,
+                ck->ns_gravacao_total / 1e6 / ck->checkpoints);
+    }
+}
+
+// --- Estado Compacto (Sessão em 128 bits) ---
+//
+// Uma sessão inteira (fila + pilha + contador de IDs) em duas palavras de 64 bits, em vez
+// dos 80 bytes de FilaCircular + Pilha (Peca ocupa 8 bytes por causa do preenchimento).
+// As casas são numeradas em ordem lógica: casas 0 .. MAX_FILA - 1 são a fila (a frente
+// primeiro) e casas MAX_FILA .. MAX_FILA + MAX_PILHA - 1 são a pilha (a base primeiro).
+//
+// tipos:  bits 0-3   tamanho da fila
+//         bits 4-7   altura da pilha (topo + 1)
+//         bits 8-23  código do tipo (2 bits) da casa c nos bits 8 + 2c (0 nas casas vazias)
+//         bits 24-55 proximo_id do gerador da sessão
+// idades: byte c = idade da peça da casa c, proximo_id - id (0 nas casas vazias)
+//
+// Os IDs são sequenciais por sessão e as peças guardadas costumam ser recentes, então a
+// idade cabe em um byte. Uma peça com 255 gerações ou mais fica com a idade saturada
+// (IDADE_SATURADA): o tipo continua exato, mas o ID dela volta como -1 ao decodificar.
+// Com um gerador compartilhado por muitas sessões (como no replay com --sessoes) as
+// idades crescem depressa; o formato é pensado para sessões com gerador próprio.
+// compacto_envelhece_sem_perda avisa antes da saturação, e o simulador usa isso para
+// devolver a sessão à forma completa sem perder nenhum ID.
+
+#define CASAS_COMPACTAS (MAX_FILA + MAX_PILHA)
+
+#if CASAS_COMPACTAS <= 8
+#define ESTADO_COMPACTO_DISPONIVEL 1
+
+#define DESLOCAMENTO_TIPOS_COMPACTO 8
+#define DESLOCAMENTO_PROXIMO_ID_COMPACTO 24
+#define MASCARA_PROXIMO_ID_COMPACTO (0xFFFFFFFFULL << DESLOCAMENTO_PROXIMO_ID_COMPACTO)
+#define IDADE_SATURADA 0xFF
+// Bits dos tipos e bytes das idades que pertencem à fila
+#define MASCARA_TIPOS_FILA_COMPACTO (((1ULL << (2 * MAX_FILA)) - 1) << DESLOCAMENTO_TIPOS_COMPACTO)
+#define MASCARA_IDADES_FILA_COMPACTO ((1ULL << (8 * MAX_FILA)) - 1)
+// Constantes SWAR: por byte (01, 7F, 80) e por campo de 16 bits (0001, 00FF)
+#define BYTES_01 0x0101010101010101ULL
+#define BYTES_7F 0x7F7F7F7F7F7F7F7FULL
+#define BYTES_80 0x8080808080808080ULL
+#define CAMPOS_0001 0x0001000100010001ULL
+#define CAMPOS_00FF 0x00FF00FF00FF00FFULL
+
+/**
+ * @brief Uma sessão (fila + pilha + proximo_id) em duas palavras de 64 bits.
+ */
+typedef struct {
+    uint64_t tipos;
+    uint64_t idades;
+} EstadoCompacto;
+
+/**
+ * @brief Tamanho da fila de um estado compacto.
+ */
+int compacto_tamanho_fila(const EstadoCompacto *e) {
+    return (int)(e->tipos & 0xF);
+}
+
+/**
+ * @brief Altura da pilha (topo + 1) de um estado compacto.
+ */
+int compacto_altura_pilha(const EstadoCompacto *e) {
+    return (int)((e->tipos >> 4) & 0xF);
+}
+
+/**
+ * @brief proximo_id do gerador da sessão guardado no estado compacto.
+ */
+int compacto_proximo_id(const EstadoCompacto *e) {
+    return (int)(uint32_t)(e->tipos >> DESLOCAMENTO_PROXIMO_ID_COMPACTO);
+}
+
+/**
+ * @brief Código do tipo (0 a 3) da peça na casa c.
+ */
+int compacto_tipo(const EstadoCompacto *e, int c) {
+    return (int)((e->tipos >> (DESLOCAMENTO_TIPOS_COMPACTO + 2 * c)) & 3);
+}
+
+/**
+ * @brief Verifica se todos os IDs do estado são exatos (nenhuma idade saturada).
+ * @return int 1 se nenhum byte de idades vale IDADE_SATURADA, 0 caso contrário.
+ */
+int compacto_ids_exatos(const EstadoCompacto *e) {
+    uint64_t t = ~e->idades; // Bytes saturados viram bytes nulos
+    return ((t - BYTES_01) & ~t & BYTES_80) == 0;
+}
+
+/**
+ * @brief Verifica se a sessão pode gerar mais uma peça sem perder IDs, isto é, se
+ * nenhuma idade chegou a IDADE_SATURADA - 1 (bytes 0xFE ou 0xFF).
+ * @return int 1 se a próxima geração mantém os IDs exatos, 0 caso contrário.
+ */
+int compacto_envelhece_sem_perda(const EstadoCompacto *e) {
+    uint64_t t = ~(e->idades | BYTES_01);
+    return ((t - BYTES_01) & ~t & BYTES_80) == 0;
+}
+
+/**
+ * @brief Coloca uma peça (código do tipo e idade) em uma casa vazia.
+ */
+void compacto_colocar(EstadoCompacto *e, int c, int tipo, unsigned idade) {
+    e->tipos |= (uint64_t)tipo << (DESLOCAMENTO_TIPOS_COMPACTO + 2 * c);
+    e->idades |= (uint64_t)idade << (8 * c);
+}
+
+/**
+ * @brief Esvazia uma casa.
+ */
+void compacto_esvaziar(EstadoCompacto *e, int c) {
+    e->tipos &= ~(3ULL << (DESLOCAMENTO_TIPOS_COMPACTO + 2 * c));
+    e->idades &= ~(0xFFULL << (8 * c));
+}
+
+/**
+ * @brief Troca o conteúdo (tipo e idade) de duas casas.
+ */
+void compacto_trocar_casas(EstadoCompacto *e, int a, int b) {
+    uint64_t t = ((e->tipos >> (DESLOCAMENTO_TIPOS_COMPACTO + 2 * a)) ^
+                  (e->tipos >> (DESLOCAMENTO_TIPOS_COMPACTO + 2 * b))) & 3;
+    uint64_t i = ((e->idades >> (8 * a)) ^ (e->idades >> (8 * b))) & 0xFF;
+    e->tipos ^= (t << (DESLOCAMENTO_TIPOS_COMPACTO + 2 * a)) | (t << (DESLOCAMENTO_TIPOS_COMPACTO + 2 * b));
+    e->idades ^= (i << (8 * a)) | (i << (8 * b));
+}
+
+/**
+ * @brief Soma 'delta' a todas as idades não nulas de uma vez (SWAR), saturando em
+ * IDADE_SATURADA. Os bytes pares e ímpares são somados em campos de 16 bits, onde o
+ * transporte não invade o vizinho; o bit 8 de (campo + 1) indica um campo >= 0xFF.
+ */
+void compacto_envelhecer(EstadoCompacto *e, uint32_t delta) {
+    uint64_t x = e->idades;
+    // 0xFF nos bytes ocupados (idade != 0)
+    uint64_t ocupados = (((((x & BYTES_7F) + BYTES_7F) | x) & BYTES_80) >> 7) * 0xFF;
+    uint64_t d, pares, impares, saturados_pares, saturados_impares;
+
+    if (delta >= IDADE_SATURADA) {
+        e->idades = ocupados;
+        return;
+    }
+    d = delta * CAMPOS_0001;
+    pares = (x & CAMPOS_00FF) + d;
+    impares = ((x >> 8) & CAMPOS_00FF) + d;
+    saturados_pares = ((pares + CAMPOS_0001) >> 8) & CAMPOS_0001;
+    saturados_impares = ((impares + CAMPOS_0001) >> 8) & CAMPOS_0001;
+    pares = (pares | saturados_pares * 0xFF) & CAMPOS_00FF;
+    impares = (impares | saturados_impares * 0xFF) & CAMPOS_00FF;
+    e->idades = (pares | impares << 8) & ocupados;
+}
+
+/**
+ * @brief Remove a peça da frente da fila (a fila inteira anda uma casa, nos tipos e nas
+ * idades, com um deslocamento de cada palavra).
+ * Pré-condição: a fila não está vazia.
+ * @param idade Recebe a idade da peça removida.
+ * @return int O código do tipo da peça removida.
+ */
+int compacto_remover_frente(EstadoCompacto *e, unsigned *idade) {
+    int tipo = compacto_tipo(e, 0);
+    *idade = (unsigned)(e->idades & 0xFF);
+    e->tipos = (e->tipos & ~MASCARA_TIPOS_FILA_COMPACTO) |
+               (((e->tipos & MASCARA_TIPOS_FILA_COMPACTO) >> 2) & MASCARA_TIPOS_FILA_COMPACTO);
+    e->idades = (e->idades & ~MASCARA_IDADES_FILA_COMPACTO) | ((e->idades & MASCARA_IDADES_FILA_COMPACTO) >> 8);
+    e->tipos -= 1; // tamanho da fila
+    return tipo;
+}
+
+/**
+ * @brief Código do tipo de uma peça no formato compacto (um tipo desconhecido vira 0, como
+ * no diário).
+ */
+int tipo_compacto(char nome) {
+    int tipo = indice_tipo_peca(nome);
+    return tipo < 0 ? 0 : tipo;
+}
+
+/**
+ * @brief Gera uma peça nova e a insere no final da fila (as outras peças envelhecem
+ * tantas gerações quantas o gerador andou).
+ * Pré-condição: a fila não está cheia.
+ */
+void compacto_inserir_nova(EstadoCompacto *e) {
+    Peca nova = gerarPeca();
+    uint32_t proximo = (uint32_t)nova.id + 1;
+
+    compacto_envelhecer(e, proximo - (uint32_t)compacto_proximo_id(e));
+    compacto_colocar(e, compacto_tamanho_fila(e), tipo_compacto(nova.nome), 1);
+    e->tipos = ((e->tipos & ~MASCARA_PROXIMO_ID_COMPACTO) | (uint64_t)proximo << DESLOCAMENTO_PROXIMO_ID_COMPACTO) + 1;
+}
+
+/**
+ * @brief Idade de uma peça no formato compacto (IDADE_SATURADA se não cabe em um byte).
+ */
+unsigned idade_compacta(int proximo_id, int id) {
+    long long idade = (long long)proximo_id - id;
+    return (id < 0 || idade < 1 || idade >= IDADE_SATURADA) ? IDADE_SATURADA : (unsigned)idade;
+}
+
+/**
+ * @brief Codifica a fila, a pilha e o proximo_id de uma sessão no formato compacto.
+ * @param fila Ponteiro para a fila.
+ * @param pilha Ponteiro para a pilha.
+ * @param proximo_id proximo_id do gerador da sessão.
+ * @param e Recebe o estado compacto.
+ * @return int 1 se todos os IDs couberam exatamente, 0 se algum ficou saturado.
+ */
+int compactar_estado(const FilaCircular *fila, const Pilha *pilha, int proximo_id, EstadoCompacto *e) {
+    int i;
+
+    e->tipos = (uint64_t)fila->tamanho_atual | (uint64_t)(pilha->topo + 1) << 4 |
+               (uint64_t)(uint32_t)proximo_id << DESLOCAMENTO_PROXIMO_ID_COMPACTO;
+    e->idades = 0;
+    for (i = 0; i < fila->tamanho_atual; i++) {
+        Peca p = fila->itens[INDICE_FILA(fila->inicio + i)];
+        compacto_colocar(e, i, tipo_compacto(p.nome), idade_compacta(proximo_id, p.id));
+    }
+    for (i = 0; i <= pilha->topo; i++) {
+        compacto_colocar(e, MAX_FILA + i, tipo_compacto(pilha->itens[i].nome),
+                         idade_compacta(proximo_id, pilha->itens[i].id));
+    }
+    return compacto_ids_exatos(e);
+}
+
+/**
+ * @brief Decodifica um estado compacto em uma fila (com início na posição 0) e uma pilha,
+ * com as casas vazias limpas como em limpar_array_pecas.
+ * @param e Ponteiro para o estado compacto.
+ * @param fila Recebe a fila.
+ * @param pilha Recebe a pilha.
+ * @return int 1 se todos os IDs são exatos, 0 se algum voltou como -1 (idade saturada).
+ */
+int descompactar_estado(const EstadoCompacto *e, FilaCircular *fila, Pilha *pilha) {
+    int proximo_id = compacto_proximo_id(e);
+    int tamanho = compacto_tamanho_fila(e);
+    int altura = compacto_altura_pilha(e);
+    int i;
+
+    inicializar_fila(fila);
+    inicializar_pilha(pilha);
+    for (i = 0; i < tamanho; i++) {
+        unsigned idade = (unsigned)(e->idades >> (8 * i)) & 0xFF;
+        fila->itens[i].nome = TIPOS_PECA[compacto_tipo(e, i)];
+        fila->itens[i].id = idade == IDADE_SATURADA ? -1 : proximo_id - (int)idade;
+    }
+    for (i = 0; i < altura; i++) {
+        unsigned idade = (unsigned)(e->idades >> (8 * (MAX_FILA + i))) & 0xFF;
+        pilha->itens[i].nome = TIPOS_PECA[compacto_tipo(e, MAX_FILA + i)];
+        pilha->itens[i].id = idade == IDADE_SATURADA ? -1 : proximo_id - (int)idade;
+    }
+    fila->tamanho_atual = tamanho;
+    fila->fim = INDICE_FILA(tamanho);
+    pilha->topo = altura - 1;
+    return compacto_ids_exatos(e);
+}
+
+/**
+ * @brief Compara dois estados compactos (mesmas peças, mesmos IDs e mesmo proximo_id).
+ * @return int 1 se iguais, 0 caso contrário.
+ */
+int compactos_iguais(const EstadoCompacto *a, const EstadoCompacto *b) {
+    return a->tipos == b->tipos && a->idades == b->idades;
+}
+
+/**
+ * @brief Hash de 64 bits de um estado compacto (duas multiplicações e uma mistura final,
+ * sem percorrer as casas).
+ */
+uint64_t hash_compacto(const EstadoCompacto *e) {
+    uint64_t h = e->tipos * 0x9E3779B97F4A7C15ULL ^ e->idades * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * @brief Executa uma ação (1 a 5) direto no estado compacto, sem saída de console.
+ * Produz o mesmo estado (e o mesmo resultado) que tabela_executar_opcao produziria na
+ * sessão equivalente; as peças novas vêm de gerarPeca, como nas outras formas.
+ * @param e Ponteiro para o estado compacto.
+ * @param opcao Código da ação.
+ * @return ResultadoAcao O mesmo resultado que executar_opcao retornaria.
+ */
+ResultadoAcao compacto_executar_opcao(EstadoCompacto *e, int opcao) {
+    int tamanho = compacto_tamanho_fila(e);
+    int altura = compacto_altura_pilha(e);
+    unsigned idade;
+    int tipo, i;
+
+    switch (opcao) {
+        case 1: // Jogar peça
+            if (tamanho == 0) return ACAO_REJEITADA;
+            compacto_remover_frente(e, &idade);
+            compacto_inserir_nova(e);
+            break;
+
+        case 2: // Reservar peça (descartada se a pilha estiver cheia)
+            if (tamanho == 0) return ACAO_REJEITADA;
+            tipo = compacto_remover_frente(e, &idade);
+            if (altura < MAX_PILHA) {
+                compacto_colocar(e, MAX_FILA + altura, tipo, idade);
+                e->tipos += 1 << 4; // altura da pilha
+                compacto_inserir_nova(e);
+                break;
+            }
+            compacto_inserir_nova(e);
+            return ACAO_DESCARTADA;
+
+        case 3: // Usar peça reservada
+            if (altura == 0) return ACAO_REJEITADA;
+            compacto_esvaziar(e, MAX_FILA + altura - 1);
+            e->tipos -= 1 << 4;
+            break;
+
+        case 4: // Troca simples
+            if (tamanho == 0 || altura == 0) return ACAO_REJEITADA;
+            compacto_trocar_casas(e, 0, MAX_FILA + altura - 1);
+            break;
+
+        case 5: // Troca múltipla (3 da fila com 3 da pilha)
+            if (tamanho < 3 || altura < 3 || MAX_FILA < 3 || MAX_PILHA < 3) return ACAO_REJEITADA;
+            for (i = 0; i < 3; i++) {
+                compacto_trocar_casas(e, i, MAX_FILA + altura - 1 - i);
+            }
+            break;
+
+        case 0:
+            break;
+
+        default:
+            return ACAO_INVALIDA;
+    }
+    return ACAO_REALIZADA;
+}
+
+#else
+#define ESTADO_COMPACTO_DISPONIVEL 0
+#endif // CASAS_COMPACTAS <= 8
+
+// --- Modo Replay (Headless) ---
+
+/**
+ * @brief Calcula um hash (FNV-1a de 64 bits) do estado da fila, da pilha e do contador de IDs
+ * do gerador ativo.
+ * Dois replays com a mesma semente e as mesmas ações produzem o mesmo hash.
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return uint64_t O hash do estado.
+ */
+uint64_t hash_estado(FilaCircular *fila, Pilha *pilha) {
+    uint64_t hash = 1469598103934665603ULL; // Base de deslocamento do FNV-1a
+    int valores[2 * (MAX_FILA + MAX_PILHA) + 3];
+    int n = 0;
+    int i;
+
+    // Apenas as posições ocupadas entram no hash, na ordem lógica (frente -> fim, base -> topo)
+    valores[n++] = fila->tamanho_atual;
+    for (i = 0; i < fila->tamanho_atual; i++) {
+        Peca p = fila->itens[INDICE_FILA(fila->inicio + i)];
+        valores[n++] = p.nome;
+        valores[n++] = p.id;
+    }
+    valores[n++] = pilha->topo;
+    for (i = 0; i <= pilha->topo; i++) {
+        valores[n++] = pilha->itens[i].nome;
+        valores[n++] = pilha->itens[i].id;
+    }
+    valores[n++] = gerador_ativo->proximo_id;
+
+    for (i = 0; i < n; i++) {
+        uint32_t v = (uint32_t)valores[i];
+        int b;
+        for (b = 0; b < 4; b++) {
+            hash ^= (v >> (8 * b)) & 0xFF;
+            hash *= 1099511628211ULL; // Primo do FNV-1a
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Estados do leitor de opções do replay.
+ *
+ * O leitor reproduz, byte a byte, o comportamento do loop interativo:
+ * scanf("%d") ignora espaços e quebras de linha, lê um inteiro com sinal opcional,
+ * e limpar_buffer() descarta o resto da linha.
+ */
+typedef enum {
+    LEITOR_ESPERA,   // Ignorando espaços antes do próximo número
+    LEITOR_SINAL,    // Leu '+' ou '-', aguardando o primeiro dígito
+    LEITOR_DIGITOS,  // Acumulando os dígitos do número
+    LEITOR_DESCARTE  // Descartando o resto da linha (como limpar_buffer)
+} EstadoLeitor;
+
+/**
+ * @brief O que um byte fez o leitor encontrar.
+ */
+typedef enum {
+    PASSO_NADA,      // Nada completo ainda (espaço, sinal, dígito ou resto de linha descartado)
+    PASSO_COMANDO,   // Um número terminou; o valor, já com o sinal, está em *valor
+    PASSO_INVALIDO   // A linha não começa com um número (scanf falharia)
+} PassoLeitor;
+
+/**
+ * @brief Avança o leitor de opções em um byte.
+ *
+ * É o único lugar com as regras de scanf("%d") + limpar_buffer(): o replay, o leitor de
+ * comandos do loop interativo e o servidor só decidem o que fazer com o resultado.
+ * Roda uma vez por byte da entrada: o 'extern inline' (C99: inline, mas com a definição
+ * externa emitida aqui) deixa o gcc expandi-lo nos três laços, o que não faz por conta
+ * própria com uma função externa deste tamanho.
+ * @param estado Estado do leitor.
+ * @param negativo Sinal do número em andamento.
+ * @param valor Valor absoluto do número em andamento; em PASSO_COMANDO, o número lido.
+ * @param c Próximo byte da entrada.
+ * @return PassoLeitor PASSO_COMANDO, PASSO_INVALIDO ou PASSO_NADA.
+ */
+extern inline PassoLeitor leitor_consumir(EstadoLeitor *estado, int *negativo, int *valor, char c) {
+    int digito = (c >= '0' && c <= '9');
+
+    switch (*estado) {
+        case LEITOR_ESPERA:
+            if (digito) {
+                *negativo = 0;
+                *valor = c - '0';
+                *estado = LEITOR_DIGITOS;
+            } else if (c == '+' || c == '-') {
+                *negativo = (c == '-');
+                *valor = 0;
+                *estado = LEITOR_SINAL;
+            } else if (c != ' ' && (c < '\t' || c > '\r')) { // Espaços de isspace: ' ' e '\t' a '\r'
+                *estado = LEITOR_DESCARTE;
+                return PASSO_INVALIDO;
+            }
+            return PASSO_NADA;
+
+        case LEITOR_SINAL:
+            if (digito) {
+                *valor = c - '0';
+                *estado = LEITOR_DIGITOS;
+                return PASSO_NADA;
+            }
+            *estado = (c == '\n') ? LEITOR_ESPERA : LEITOR_DESCARTE;
+            return PASSO_INVALIDO;
+
+        case LEITOR_DIGITOS:
+            if (digito) {
+                // Satura para não estourar o int; qualquer valor grande já é opção inválida
+                if (*valor < 100000000) *valor = *valor * 10 + (c - '0');
+                return PASSO_NADA;
+            }
+            if (*negativo) *valor = -*valor;
+            *estado = (c == '\n') ? LEITOR_ESPERA : LEITOR_DESCARTE;
+            return PASSO_COMANDO;
+
+        case LEITOR_DESCARTE:
+            if (c == '\n') *estado = LEITOR_ESPERA;
+            return PASSO_NADA;
+    }
+    return PASSO_NADA;
+}
+
+/**
+ * @brief Contadores acumulados durante um replay.
+ */
+typedef struct {
+    long long acoes[6];            // Quantas vezes cada opção (0 a 5) foi executada
+    long long entradas_invalidas;  // Linhas que não começavam com um número (scanf falharia)
+    long long opcoes_invalidas;    // Números fora do intervalo 0 a 5
+} ResumoReplay;
+
+/**
+ * @brief Executa um replay headless: lê todas as ações de um arquivo (ou da stdin)
+ * em blocos grandes e aplica cada uma sem nenhuma saída de console.
+ * O replay termina na opção 0 ou no fim da entrada. Ao final, imprime apenas um resumo
+ * e o hash do estado; o tempo gasto vai para a stderr, para que a stdout possa ser comparada.
+ *
+ * Com num_sessoes > 0, as ações são distribuídas em rodízio (ação k -> sessão k % num_sessoes)
+ * sobre uma TabelaSessoes, e o hash final combina o hash de todas as sessões.
+ * Com uma única sessão, o hash é igual ao do replay sobre FilaCircular/Pilha.
+ *
+ * Com um arquivo de checkpoint (só com a tabela), a tabela é gravada a cada
+ * 'intervalo_checkpoint' ações em segundo plano. Se o arquivo já tem um checkpoint
+ * válido, o replay retoma dele: as ações já aplicadas são lidas mas não executadas, e o
+ * resumo e o hash finais são os mesmos de um replay sem interrupção.
+ * @param caminho Caminho do arquivo de ações, ou NULL / "-" para ler da stdin.
+ * @param num_sessoes Número de sessões da tabela SoA (0 = uma sessão FilaCircular/Pilha).
+ * @param arquivo_checkpoint Arquivo de checkpoint da tabela, ou NULL.
+ * @param intervalo_checkpoint Ações entre dois checkpoints.
+ * @return int 0 em caso de sucesso, 1 em caso de erro (arquivo ou memória).
+ */
+int executar_replay(const char *caminho, int num_sessoes, const char *arquivo_checkpoint, long long intervalo_checkpoint) {
+    FilaCircular fila;
+    Pilha pilha;
+    TabelaSessoes tabela;
+    ResumoReplay resumo;
+    EstadoLeitor estado = LEITOR_ESPERA;
+    FILE *entrada = stdin;
+    char *bloco;
+    size_t lidos;
+    int negativo = 0;
+    int valor = 0;
+    int encerrado = 0;
+    int fim_entrada = 0;
+    int sessao = 0;
+    long long total = 0;
+    uint64_t hash = 0;
+    Checkpoint checkpoint;
+    RegistroCheckpoint retomado;
+    long long acoes_retomadas = 0;
+    long long proximo_corte = intervalo_checkpoint;
+    struct timespec t_inicio, t_fim;
+    int i;
+
+    if (arquivo_checkpoint != NULL && !checkpoint_abrir(&checkpoint, arquivo_checkpoint, num_sessoes)) return 1;
+
+    if (caminho != NULL && strcmp(caminho, "-") != 0) {
+        entrada = fopen(caminho, "rb");
+        if (entrada == NULL) {
+            fprintf(stderr, "ERRO: Nao foi possivel abrir o arquivo de acoes '%s'.\n", caminho);
+            return 1;
+        }
+    }
+
+    bloco = malloc(TAMANHO_BLOCO_REPLAY);
+    if (bloco == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para o replay.\n");
+        if (entrada != stdin) fclose(entrada);
+        return 1;
+    }
+
+    memset(&resumo, 0, sizeof(resumo));
+    modo_silencioso = 1; // Nenhuma ação imprime nada a partir daqui
+
+    if (arquivo_checkpoint != NULL && checkpoint_retomar(&checkpoint, &tabela, &retomado)) {
+        // Retoma do checkpoint: a tabela já está mapeada, falta o gerador e a posição
+        *gerador_ativo = retomado.gerador;
+        acoes_retomadas = (long long)retomado.acoes;
+        sessao = retomado.sessao;
+        proximo_corte = acoes_retomadas + intervalo_checkpoint;
+        fprintf(stderr, "Checkpoint: retomando na acao %lld (versao %llu).\n", acoes_retomadas,
+                (unsigned long long)retomado.versao);
+    } else if (num_sessoes > 0) {
+        if (!criar_tabela_sessoes(&tabela, num_sessoes)) {
+            fprintf(stderr, "ERRO: Memoria insuficiente para %d sessoes.\n", num_sessoes);
+            free(bloco);
+            if (entrada != stdin) fclose(entrada);
+            modo_silencioso = 0;
+            return 1;
+        }
+    } else {
+        inicializar_fila(&fila);
+        inicializar_pilha(&pilha);
+        preencher_fila_inicial(&fila);
+    }
+    if (arquivo_checkpoint != NULL && !checkpoint_iniciar(&checkpoint, &tabela)) {
+        fprintf(stderr, "ERRO: Nao foi possivel iniciar o checkpoint.\n");
+        liberar_tabela_sessoes(&tabela);
+        free(bloco);
+        if (entrada != stdin) fclose(entrada);
+        modo_silencioso = 0;
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
+    while (!encerrado) {
+        size_t k;
+
+        lidos = fread(bloco, 1, TAMANHO_BLOCO_REPLAY, entrada);
+        if (lidos == 0) {
+            if (fim_entrada) break;
+            // No fim da entrada, uma quebra de linha virtual fecha o último número pendente
+            bloco[0] = '\n';
+            lidos = 1;
+            fim_entrada = 1;
+        }
+
+        for (k = 0; k < lidos && !encerrado; k++) {
+            PassoLeitor passo = leitor_consumir(&estado, &negativo, &valor, bloco[k]);
+
+            if (passo == PASSO_INVALIDO) {
+                resumo.entradas_invalidas++;
+            } else if (passo == PASSO_COMANDO) {
+                int opcao = valor;
+                if (opcao >= 0 && opcao <= 5) {
+                    resumo.acoes[opcao]++;
+                    total++;
+                    if (opcao == 0) {
+                        encerrado = 1;
+                    } else if (total <= acoes_retomadas) {
+                        // Já aplicada antes do checkpoint
+                    } else if (num_sessoes > 0) {
+                        INSTRUMENTAR_INICIO(inicio);
+                        ResultadoAcao resultado = tabela_executar_opcao(&tabela, sessao, opcao);
+                        INSTRUMENTAR_ACAO(opcao, resultado, inicio);
+                        (void)resultado;
+                        if (++sessao == num_sessoes) sessao = 0;
+                        // Com a gravação anterior ainda em andamento, tenta de novo logo adiante
+                        if (arquivo_checkpoint != NULL && total >= proximo_corte) {
+                            proximo_corte = total + (checkpoint_cortar(&checkpoint, (uint64_t)total, sessao)
+                                                         ? intervalo_checkpoint
+                                                         : intervalo_checkpoint / 16 + 1);
+                        }
+                    } else {
+                        executar_opcao(&fila, &pilha, opcao);
+                    }
+                } else {
+                    resumo.opcoes_invalidas++;
+                }
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+
+    free(bloco);
+    if (entrada != stdin) fclose(entrada);
+    modo_silencioso = 0;
+
+    if (arquivo_checkpoint != NULL) {
+        int gravado = checkpoint_fechar(&checkpoint, (uint64_t)total, sessao);
+        checkpoint_imprimir(&checkpoint, stderr);
+        if (!gravado) fprintf(stderr, "ERRO: Falha ao gravar o checkpoint '%s'.\n", arquivo_checkpoint);
+    }
+
+    printf("--- Resumo do Replay ---\n");
+    printf("Acoes executadas: %lld\n", total);
+    for (i = 0; i <= 5; i++) {
+        printf("  Opcao %d: %lld\n", i, resumo.acoes[i]);
+    }
+    printf("Entradas invalidas: %lld\n", resumo.entradas_invalidas);
+    printf("Opcoes invalidas: %lld\n", resumo.opcoes_invalidas);
+    if (tabuleiro_ativo != NULL) {
+        printf("Tabuleiro: %lld pecas colocadas, %lld linhas removidas, %lld fins de jogo\n",
+               tabuleiro_ativo->pecas, tabuleiro_ativo->linhas_limpas, tabuleiro_ativo->fins_de_jogo);
+    }
+
+    if (num_sessoes > 0) {
+        // Combina os hashes das sessões em ordem; com uma sessão, é o próprio hash dela
+        for (i = 0; i < num_sessoes; i++) {
+            tabela_carregar_sessao(&tabela, i, &fila, &pilha);
+            hash = (hash * 1099511628211ULL) ^ hash_estado(&fila, &pilha);
+        }
+        printf("Sessoes: %d (%zu bytes/sessao em SoA, %zu bytes/sessao em FilaCircular+Pilha)\n",
+               num_sessoes, tabela_bytes_por_sessao(), sizeof(FilaCircular) + sizeof(Pilha));
+        if (num_sessoes == 1) exibir_estado_atual(&fila, &pilha);
+        liberar_tabela_sessoes(&tabela);
+    } else {
+        exibir_estado_atual(&fila, &pilha);
+        hash = hash_estado(&fila, &pilha);
+    }
+    printf("Hash do estado: %016llx\n", (unsigned long long)hash);
+
+    {
+        double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        fprintf(stderr, "Tempo: %.3f s (%.1f milhoes de acoes/s)\n",
+                segundos, segundos > 0 ? total / segundos / 1e6 : 0.0);
+    }
+    return 0;
+}
+
+// --- Leitor de Comandos (Entrada em Blocos) ---
+//
+// O loop interativo lia cada opção com scanf("%d") e descartava o resto da linha com
+// limpar_buffer(), um getchar() por byte. Com a entrada vinda de um pipe ou de um
+// arquivo, quase todo o tempo ia para o stdio. O leitor abaixo lê blocos grandes com
+// read() em um buffer reaproveitado e interpreta os comandos com as mesmas regras do
+// replay (EstadoLeitor), que reproduzem scanf + limpar_buffer byte a byte.
+//
+// O caso comum, um dígito seguido de '\n', tem um caminho rápido: com SSE2, 16 bytes são
+// conferidos de uma vez e até 8 comandos desse formato são decodificados para uma fila
+// de pendentes. Qualquer outro formato (espaços, sinal, vários dígitos, lixo) passa pela
+// máquina de estados, e as linhas descartadas são puladas com memchr.
+
+// Bytes lidos de uma vez da entrada do loop interativo
+#define TAMANHO_LEITURA_COMANDOS 65536
+// Comandos "d\n" decodificados de uma vez (16 bytes)
+#define COMANDOS_POR_LOTE 8
+
+/**
+ * @brief Leitor de opções sobre um descritor de arquivo.
+ */
+typedef struct {
+    int fd;
+    char *dados;                             // Buffer de leitura (reaproveitado)
+    size_t inicio, fim;                      // Bytes ainda não interpretados: [inicio, fim)
+    int fim_entrada;                         // read() já devolveu 0
+    EstadoLeitor estado;
+    int negativo;
+    int valor;
+    int usar_simd;                           // 0 força o caminho escalar (para comparação)
+    unsigned char pendentes[COMANDOS_POR_LOTE]; // Opções já decodificadas pelo caminho rápido
+    int num_pendentes, proximo_pendente;
+} LeitorComandos;
+
+/**
+ * @brief Cria um leitor sobre um descritor (normalmente STDIN_FILENO).
+ * @return int 1 em caso de sucesso, 0 se faltou memória.
+ */
+int leitor_criar(LeitorComandos *leitor, int fd) {
+    memset(leitor, 0, sizeof(*leitor));
+    leitor->fd = fd;
+    leitor->estado = LEITOR_ESPERA;
+#if defined(__SSE2__)
+    leitor->usar_simd = 1;
+#endif
+    leitor->dados = malloc(TAMANHO_LEITURA_COMANDOS);
+    return leitor->dados != NULL;
+}
+
+/**
+ * @brief Libera o buffer do leitor.
+ */
+void leitor_liberar(LeitorComandos *leitor) {
+    free(leitor->dados);
+    leitor->dados = NULL;
+}
+
+/**
+ * @brief Decodifica os comandos "d\n" do início de um trecho, um par de bytes por vez.
+ * @param dados Início do trecho (ao menos 2 * COMANDOS_POR_LOTE bytes).
+ * @param opcoes Recebe as opções decodificadas.
+ * @return int Quantos comandos seguidos têm o formato (0 a COMANDOS_POR_LOTE).
+ */
+int decodificar_comandos_escalar(const char *dados, unsigned char *opcoes) {
+    int k;
+    for (k = 0; k < COMANDOS_POR_LOTE; k++) {
+        char c = dados[2 * k];
+        if (c < '0' || c > '9' || dados[2 * k + 1] != '\n') break;
+        opcoes[k] = (unsigned char)(c - '0');
+    }
+    return k;
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief Decodifica os comandos "d\n" do início de um trecho de 16 bytes com SSE2:
+ * os bytes pares devem ser dígitos e os ímpares '\n'; a máscara dos bytes válidos diz
+ * quantos pares seguidos estão no formato.
+ * @param dados Início do trecho (ao menos 16 bytes).
+ * @param opcoes Recebe as opções decodificadas.
+ * @return int Quantos comandos seguidos têm o formato (0 a COMANDOS_POR_LOTE).
+ */
+int decodificar_comandos(const char *dados, unsigned char *opcoes) {
+    const __m128i quebras = _mm_set1_epi16('\n' << 8);   // Byte ímpar '\n', byte par 0
+    const __m128i impares = _mm_set1_epi16((short)0xFF00);
+    __m128i bytes = _mm_loadu_si128((const __m128i *)dados);
+    __m128i digitos = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+    // Dígito: byte - '0' < 10 sem sinal (min(x, 9) == x)
+    __m128i eh_digito = _mm_cmpeq_epi8(_mm_min_epu8(digitos, _mm_set1_epi8(9)), digitos);
+    __m128i eh_quebra = _mm_cmpeq_epi8(bytes, quebras);
+    __m128i validos = _mm_or_si128(_mm_andnot_si128(impares, eh_digito), _mm_and_si128(impares, eh_quebra));
+    unsigned mascara = (unsigned)_mm_movemask_epi8(validos);
+    // Par k válido: bits 2k e 2k+1; o primeiro par inválido encerra o lote
+    unsigned pares = mascara & (mascara >> 1) & 0x5555u;
+    int n = __builtin_ctz(~pares & 0x15555u) / 2;
+
+    // Os bytes pares (os dígitos já sem '0') vão para os 8 bytes de 'opcoes'
+    _mm_storel_epi64((__m128i *)opcoes, _mm_packus_epi16(_mm_andnot_si128(impares, digitos), _mm_setzero_si128()));
+    return n;
+}
+
+#else
+
+int decodificar_comandos(const char *dados, unsigned char *opcoes) {
+    return decodificar_comandos_escalar(dados, opcoes);
+}
+
+#endif // __SSE2__
+
+/**
+ * @brief Lê mais um bloco da entrada para o buffer (que já foi todo interpretado: o número
+ * ou o sinal pendente fica no estado do leitor, não no buffer).
+ * A saída pendente é enviada antes, já que a leitura pode bloquear esperando o usuário
+ * (scanf fazia isso com a stdout de um terminal).
+ * @return int 1 se chegaram bytes, 0 no fim da entrada ou em erro.
+ */
+int leitor_encher(LeitorComandos *leitor) {
+    ssize_t n;
+
+    leitor->inicio = leitor->fim = 0;
+    if (leitor->fim_entrada) return 0;
+    fflush(stdout);
+    do {
+        n = read(leitor->fd, leitor->dados, TAMANHO_LEITURA_COMANDOS);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        leitor->fim_entrada = 1;
+        return 0;
+    }
+    leitor->fim = (size_t)n;
+    return 1;
+}
+
+/**
+ * @brief Lê a próxima opção, como scanf("%d", &opcao) seguido de limpar_buffer().
+ * @param leitor Ponteiro para o leitor.
+ * @param opcao Recebe a opção lida.
+ * @return int 1 se um número foi lido (scanf devolveria 1), 0 se a linha não começava
+ * com um número e -1 no fim da entrada (nos dois casos, scanf não devolveria 1).
+ */
+int leitor_proxima_opcao(LeitorComandos *leitor, int *opcao) {
+    if (leitor->proximo_pendente < leitor->num_pendentes) {
+        *opcao = leitor->pendentes[leitor->proximo_pendente++];
+        return 1;
+    }
+
+    for (;;) {
+        const char *dados = leitor->dados;
+        size_t k = leitor->inicio;
+        size_t fim = leitor->fim;
+
+        // Caminho rápido: comandos "d\n" no início de uma linha
+        if (leitor->estado == LEITOR_ESPERA && fim - k >= 2 * COMANDOS_POR_LOTE) {
+            int n = leitor->usar_simd ? decodificar_comandos(dados + k, leitor->pendentes)
+                                      : decodificar_comandos_escalar(dados + k, leitor->pendentes);
+            if (n > 0) {
+                leitor->inicio = k + 2 * (size_t)n;
+                leitor->num_pendentes = n;
+                leitor->proximo_pendente = 1;
+                *opcao = leitor->pendentes[0];
+                return 1;
+            }
+        }
+
+        // Máquina de estados do replay, até completar um comando ou esgotar o buffer
+        while (k < fim) {
+            PassoLeitor passo;
+
+            if (leitor->estado == LEITOR_DESCARTE) {
+                // Pula o resto da linha de uma vez
+                const char *quebra = memchr(dados + k, '\n', fim - k);
+                if (quebra == NULL) {
+                    k = fim;
+                } else {
+                    k = (size_t)(quebra - dados) + 1;
+                    leitor->estado = LEITOR_ESPERA;
+                }
+                continue;
+            }
+            passo = leitor_consumir(&leitor->estado, &leitor->negativo, &leitor->valor, dados[k++]);
+            if (passo != PASSO_NADA) {
+                leitor->inicio = k;
+                if (passo == PASSO_INVALIDO) return 0;
+                *opcao = leitor->valor;
+                return 1;
+            }
+        }
+
+        if (!leitor_encher(leitor)) {
+            // No fim da entrada, uma quebra de linha virtual fecha o número ou o sinal pendente
+            EstadoLeitor estado = leitor->estado;
+            leitor->estado = LEITOR_ESPERA;
+            if (estado == LEITOR_DIGITOS) {
+                *opcao = leitor->negativo ? -leitor->valor : leitor->valor;
+                return 1;
+            }
+            return estado == LEITOR_SINAL ? 0 : -1;
+        }
+    }
+}
+
+// --- Diário de Ações (Leitura com mmap) ---
+
+/**
+ * @brief Restaura a fila, a pilha e o contador de IDs a partir de um snapshot mapeado.
+ *
+ * Os índices vêm do arquivo e são conferidos antes de qualquer uso: um diário corrompido
+ * (ou forjado) com inicio, fim ou topo fora das capacidades levaria as ações seguintes a
+ * ler e escrever fora de itens[].
+ * @param p Ponteiro para os bytes do snapshot (logo após o byte do registro).
+ * @param acao Recebe o número da ação em que o snapshot foi tirado.
+ * @return int 1 em caso de sucesso, 0 se o snapshot é inconsistente.
+ */
+int diario_restaurar_snapshot(const unsigned char *p, FilaCircular *fila, Pilha *pilha, uint64_t *acao) {
+    int k;
+
+    *acao = ler_u64(p);
+    p += 8;
+    for (k = 0; k < MAX_FILA; k++) {
+        fila->itens[k].nome = (char)p[0];
+        fila->itens[k].id = (int)ler_u32(p + 1);
+        p += 5;
+    }
+    fila->inicio = (int)ler_u32(p);
+    fila->fim = (int)ler_u32(p + 4);
+    fila->tamanho_atual = (int)ler_u32(p + 8);
+    p += 12;
+    for (k = 0; k < MAX_PILHA; k++) {
+        pilha->itens[k].nome = (char)p[0];
+        pilha->itens[k].id = (int)ler_u32(p + 1);
+        p += 5;
+    }
+    pilha->topo = (int)ler_u32(p);
+    gerador_ativo->proximo_id = (int)ler_u32(p + 4);
+
+    return fila->inicio >= 0 && fila->inicio < MAX_FILA && fila->fim >= 0 && fila->fim < MAX_FILA &&
+           fila->tamanho_atual >= 0 && fila->tamanho_atual <= MAX_FILA &&
+           (fila->inicio + fila->tamanho_atual) % MAX_FILA == fila->fim &&
+           pilha->topo >= -1 && pilha->topo < MAX_PILHA;
+}
+
+/**
+ * @brief Reproduz um diário mapeado em memória até a ação 'ate' (ou até o fim, se ate < 0).
+ *
+ * Parte do último snapshot anterior ou igual a 'ate' (busca binária no índice), e aplica
+ * só as ações seguintes: o custo é O(intervalo de snapshot), não O(ate). As peças vêm do
+ * próprio diário (gerador em modo roteiro), então nenhuma semente é necessária.
+ * @param caminho Caminho do diário.
+ * @param ate Número de ações a reproduzir (-1 = todas).
+ * @return int 0 em caso de sucesso, 1 em caso de erro.
+ */
+int executar_leitura_diario(const char *caminho, long long ate) {
+    const unsigned char *dados, *p, *fim_registros;
+    uint64_t *snapshot_acoes = NULL, *snapshot_posicoes = NULL;
+    uint64_t num_snapshots = 0;
+    uint64_t acao_atual;
+    GeradorPecas roteiro;
+    GeradorPecas *gerador_anterior = gerador_ativo;
+    FilaCircular fila;
+    Pilha pilha;
+    struct stat info;
+    size_t tamanho;
+    long long aplicadas = 0;
+    int sem_memoria = 0;
+    int erro = 0;
+    int fd;
+    int escolhido;
+
+    fd = open(caminho, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel abrir o diario '%s'.\n", caminho);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    tamanho = (size_t)info.st_size;
+    if (tamanho < 28 + 1 + TAMANHO_SNAPSHOT) {
+        fprintf(stderr, "ERRO: Diario '%s' truncado.\n", caminho);
+        close(fd);
+        return 1;
+    }
+    dados = mmap(NULL, tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dados == MAP_FAILED) {
+        fprintf(stderr, "ERRO: Nao foi possivel mapear o diario '%s'.\n", caminho);
+        return 1;
+    }
+
+    // 1. Cabeçalho: o diário precisa ter sido gravado com as mesmas capacidades
+    if (memcmp(dados, MAGICO_DIARIO, 4) != 0 || ler_u32(dados + 4) != VERSAO_DIARIO ||
+        ler_u32(dados + 8) != MAX_FILA || ler_u32(dados + 12) != MAX_PILHA) {
+        fprintf(stderr, "ERRO: '%s' nao e um diario compativel (formato ou MAX_FILA/MAX_PILHA diferentes).\n", caminho);
+        munmap((void *)dados, tamanho);
+        return 1;
+    }
+
+    // 2. Índice de snapshots: do rodapé, ou reconstruído percorrendo os registros. Cada
+    //    entrada do rodapé precisa apontar para um registro de snapshot inteiro antes do
+    //    rodapé, em ordem de ação; senão o rodapé é descartado e o índice é reconstruído.
+    fim_registros = dados + tamanho;
+    if (memcmp(dados + tamanho - 4, MAGICO_INDICE_DIARIO, 4) == 0) {
+        uint64_t rodape = ler_u64(dados + tamanho - 12);
+        uint64_t k;
+        if (rodape >= 28 && rodape <= tamanho - 17 && dados[rodape] == REGISTRO_FIM) {
+            num_snapshots = ler_u32(dados + rodape + 1);
+            if (num_snapshots * 16 == tamanho - 17 - rodape) {
+                snapshot_acoes = malloc((num_snapshots + 1) * sizeof(uint64_t));
+                snapshot_posicoes = malloc((num_snapshots + 1) * sizeof(uint64_t));
+                sem_memoria = snapshot_acoes == NULL || snapshot_posicoes == NULL;
+                for (k = 0; !sem_memoria && k < num_snapshots; k++) {
+                    uint64_t pos = ler_u64(dados + rodape + 5 + 16 * k + 8);
+                    snapshot_acoes[k] = ler_u64(dados + rodape + 5 + 16 * k);
+                    snapshot_posicoes[k] = pos;
+                    if (pos < 28 || pos > rodape || rodape - pos < 1 + TAMANHO_SNAPSHOT ||
+                        (dados[pos] & 7) != REGISTRO_SNAPSHOT || (k > 0 && snapshot_acoes[k] < snapshot_acoes[k - 1])) {
+                        break;
+                    }
+                }
+                if (!sem_memoria && k == num_snapshots) {
+                    fim_registros = dados + rodape;
+                } else {
+                    free(snapshot_acoes);
+                    free(snapshot_posicoes);
+                    snapshot_acoes = snapshot_posicoes = NULL;
+                }
+            }
+        }
+    }
+    if (snapshot_acoes == NULL && !sem_memoria) {
+        uint64_t capacidade = 64;
+        uint64_t acoes = 0;
+        snapshot_acoes = malloc(capacidade * sizeof(uint64_t));
+        snapshot_posicoes = malloc(capacidade * sizeof(uint64_t));
+        sem_memoria = snapshot_acoes == NULL || snapshot_posicoes == NULL;
+        num_snapshots = 0;
+        p = dados + 28;
+        while (!sem_memoria && p < fim_registros) {
+            int tag = *p & 7;
+            if (tag == REGISTRO_SNAPSHOT) {
+                if (fim_registros - p < 1 + TAMANHO_SNAPSHOT) break; // Snapshot incompleto no fim
+                if (num_snapshots == capacidade) {
+                    uint64_t *maior;
+                    capacidade *= 2;
+                    maior = realloc(snapshot_acoes, capacidade * sizeof(uint64_t));
+                    if (maior != NULL) snapshot_acoes = maior;
+                    sem_memoria = maior == NULL;
+                    maior = realloc(snapshot_posicoes, capacidade * sizeof(uint64_t));
+                    if (maior != NULL) snapshot_posicoes = maior;
+                    sem_memoria |= maior == NULL;
+                    if (sem_memoria) break;
+                }
+                snapshot_acoes[num_snapshots] = acoes;
+                snapshot_posicoes[num_snapshots] = (uint64_t)(p - dados);
+                num_snapshots++;
+                p += 1 + TAMANHO_SNAPSHOT;
+            } else if (tag == REGISTRO_FIM) {
+                fim_registros = p;
+                break;
+            } else if ((*p & DIARIO_ID_EXPLICITO) && fim_registros - p < 5) {
+                fim_registros = p; // Registro final incompleto: é ignorado
+                break;
+            } else {
+                p += (*p & DIARIO_ID_EXPLICITO) ? 5 : 1;
+                acoes++;
+            }
+        }
+    }
+    if (sem_memoria || num_snapshots == 0) {
+        if (sem_memoria) {
+            fprintf(stderr, "ERRO: Memoria insuficiente para o indice do diario.\n");
+        } else {
+            fprintf(stderr, "ERRO: Diario '%s' sem snapshot inicial.\n", caminho);
+        }
+        free(snapshot_acoes);
+        free(snapshot_posicoes);
+        munmap((void *)dados, tamanho);
+        return 1;
+    }
+
+    // 3. Busca binária pelo último snapshot com ação <= ate
+    escolhido = 0;
+    if (ate < 0) {
+        escolhido = (int)num_snapshots - 1;
+    } else {
+        int baixo = 0, alto = (int)num_snapshots - 1;
+        while (baixo <= alto) {
+            int meio = (baixo + alto) / 2;
+            if (snapshot_acoes[meio] <= (uint64_t)ate) {
+                escolhido = meio;
+                baixo = meio + 1;
+            } else {
+                alto = meio - 1;
+            }
+        }
+    }
+
+    // 4. Restaura o snapshot e aplica as ações seguintes com as peças do diário
+    memset(&roteiro, 0, sizeof(roteiro));
+    roteiro.modo = GERADOR_ROTEIRO;
+    gerador_ativo = &roteiro;
+    modo_silencioso = 1;
+
+    p = dados + snapshot_posicoes[escolhido];
+    erro = !diario_restaurar_snapshot(p + 1, &fila, &pilha, &acao_atual);
+    p += 1 + TAMANHO_SNAPSHOT;
+
+    while (!erro && p < fim_registros && (ate < 0 || acao_atual < (uint64_t)ate)) {
+        unsigned char registro = *p;
+        int tag = registro & 7;
+        int id_antes;
+
+        if (tag == REGISTRO_SNAPSHOT) {
+            p += 1 + TAMANHO_SNAPSHOT;
+            continue;
+        }
+        if (tag == REGISTRO_FIM) break;
+        if ((registro & DIARIO_ID_EXPLICITO) && fim_registros - p < 5) break;
+
+        if (registro & DIARIO_GEROU_PECA) {
+            roteiro.saco[0] = (char)((registro >> DIARIO_DESLOCAMENTO_TIPO) & (NUM_TIPOS_PECA - 1));
+            if (registro & DIARIO_ID_EXPLICITO) roteiro.proximo_id = (int)ler_u32(p + 1);
+        }
+        id_antes = roteiro.proximo_id;
+        despachar_opcao(&fila, &pilha, tag);
+
+        // A ação precisa gerar peça exatamente quando o diário diz que gerou
+        if (((registro & DIARIO_GEROU_PECA) != 0) != (roteiro.proximo_id != id_antes)) {
+            erro = 1;
+            break;
+        }
+        p += (registro & DIARIO_ID_EXPLICITO) ? 5 : 1;
+        acao_atual++;
+        aplicadas++;
+    }
+
+    modo_silencioso = 0;
+
+    if (erro) {
+        fprintf(stderr, "ERRO: Diario inconsistente na acao %llu.\n", (unsigned long long)acao_atual);
+    } else {
+        if (ate >= 0 && acao_atual < (uint64_t)ate) {
+            fprintf(stderr, "AVISO: O diario tem apenas %llu acoes.\n", (unsigned long long)acao_atual);
+        }
+        printf("--- Diario de Acoes ---\n");
+        printf("Estado apos a acao %llu (snapshot da acao %llu + %lld acoes reproduzidas)\n",
+               (unsigned long long)acao_atual, (unsigned long long)snapshot_acoes[escolhido], aplicadas);
+        exibir_estado_atual(&fila, &pilha);
+        printf("Hash do estado: %016llx\n", (unsigned long long)hash_estado(&fila, &pilha));
+    }
+
+    gerador_ativo = gerador_anterior;
+    free(snapshot_acoes);
+    free(snapshot_posicoes);
+    munmap((void *)dados, tamanho);
+    return erro;
+}
+
+// --- Resolvedor de Sequências (Busca em Largura com Tabela de Transposição) ---
+//
+// Encontra a menor sequência de ações (1 a 5) que deixa a frente da fila na ordem pedida
+// (por exemplo "I", ou "TLI": T na frente, depois L, depois I).
+//
+// O estado inteiro cabe em uma palavra de 64 bits: 3 bits por casa, primeiro as casas da
+// fila (da frente para o fim) e depois as da pilha (da base para o topo). Cada casa vale
+// 0 (vazia), 1 a 4 (o tipo TIPOS_PECA[c - 1]) ou 5 (peça ainda não gerada). As peças que
+// as ações 1 e 2 geram entram como "desconhecidas" e nunca contam para o alvo, então a
+// sequência encontrada funciona para qualquer peça que o gerador venha a sortear.
+// Como as casas ocupadas são contíguas e nunca valem 0, os tamanhos da fila e da pilha
+// saem da posição do bit mais alto, e o teste do alvo é um AND e uma comparação.
+
+#define BITS_CASA_RESOLVEDOR 3
+#define CASA_VAZIA 0
+#define CASA_DESCONHECIDA 5
+#define BITS_ESTADO_RESOLVEDOR (BITS_CASA_RESOLVEDOR * (MAX_FILA + MAX_PILHA))
+#define DESLOCAMENTO_PILHA_RESOLVEDOR (BITS_CASA_RESOLVEDOR * MAX_FILA)
+
+// O estado precisa caber em 48 bits; os bits de cima de cada chave guardam a época da busca
+#if MAX_FILA + MAX_PILHA <= 16
+#define RESOLVEDOR_DISPONIVEL 1
+
+#define MASCARA_FILA_RESOLVEDOR ((1ULL << DESLOCAMENTO_PILHA_RESOLVEDOR) - 1)
+#define MASCARA_ESTADO_RESOLVEDOR ((1ULL << BITS_ESTADO_RESOLVEDOR) - 1)
+// Profundidade máxima de uma busca
+#define PROFUNDIDADE_MAXIMA_RESOLVEDOR 64
+// Entradas da tabela de transposição: começa pequena (cabe no cache) e dobra quando precisa
+#define ENTRADAS_INICIAIS_RESOLVEDOR (1u << 12)
+#define MAX_ENTRADAS_RESOLVEDOR (1u << 24)
+// Níveis com pelo menos tantos estados são expandidos em paralelo
+#define LIMIAR_PARALELO_RESOLVEDOR 4096
+// Limite de threads do resolvedor
+#define MAX_THREADS_RESOLVEDOR 64
+// Estados novos guardados por thread antes de reservar espaço na próxima fronteira
+#define LOTE_RESOLVEDOR 256
+// Origem do estado inicial (não existe estado com todos os bits ligados)
+#define ORIGEM_RAIZ UINT64_MAX
+
+/**
+ * @brief Tabela de transposição e fronteiras da busca, reaproveitadas entre buscas.
+ *
+ * chaves: (epoca << BITS_ESTADO_RESOLVEDOR) | estado. Uma entrada de outra época está vazia,
+ *   então começar uma busca nova é só incrementar a época (sem limpar a tabela).
+ * origens: (acao << 60) | estado anterior, para reconstruir a sequência.
+ */
+typedef struct {
+    _Atomic uint64_t *chaves;
+    uint64_t *origens;
+    size_t mascara;            // Entradas - 1 (potência de 2)
+    size_t limite;             // Estados que cabem antes de dobrar a tabela (3/4 das entradas)
+    uint64_t epoca;
+    uint64_t *fronteira;       // Estados do nível atual
+    uint64_t *proxima;         // Estados do próximo nível
+    _Atomic size_t tamanho_proxima;
+    _Atomic uint64_t encontrado; // Estado-alvo achado no nível (ORIGEM_RAIZ = nenhum)
+    _Atomic int estourou;      // A tabela encheu
+    int num_threads;
+    long long visitados;       // Estados visitados na última busca
+} Resolvedor;
+
+/**
+ * @brief Parte de um nível expandida por uma thread.
+ */
+typedef struct {
+    Resolvedor *resolvedor;
+    const uint64_t *estados;
+    size_t quantidade;
+    uint64_t mascara_alvo;
+    uint64_t valor_alvo;
+    int concorrente;           // Há outras tarefas no mesmo nível
+    pthread_t thread;
+} TarefaResolvedor;
+
+/**
+ * @brief Converte o tipo de uma peça no valor da sua casa (desconhecido se não for um tipo).
+ */
+int codigo_casa(char nome) {
+    int tipo = indice_tipo_peca(nome);
+    return tipo < 0 ? CASA_DESCONHECIDA : tipo + 1;
+}
+
+/**
+ * @brief Empacota a fila e a pilha em um estado de 64 bits (só os tipos; os IDs não importam).
+ * @param fila Ponteiro para a estrutura da fila.
+ * @param pilha Ponteiro para a estrutura da pilha.
+ * @return uint64_t O estado empacotado.
+ */
+uint64_t empacotar_estado(const FilaCircular *fila, const Pilha *pilha) {
+    uint64_t estado = 0;
+    int i;
+    for (i = 0; i < fila->tamanho_atual; i++) {
+        estado |= (uint64_t)codigo_casa(fila->itens[INDICE_FILA(fila->inicio + i)].nome) << (BITS_CASA_RESOLVEDOR * i);
+    }
+    for (i = 0; i <= pilha->topo; i++) {
+        estado |= (uint64_t)codigo_casa(pilha->itens[i].nome) << (DESLOCAMENTO_PILHA_RESOLVEDOR + BITS_CASA_RESOLVEDOR * i);
+    }
+    return estado;
+}
+
+/**
+ * @brief Número de casas ocupadas em uma sequência empacotada (contíguas a partir da casa 0).
+ */
+int casas_ocupadas(uint64_t casas) {
+    return casas ? (64 - __builtin_clzll(casas) + 2) / BITS_CASA_RESOLVEDOR : 0;
+}
+
+/**
+ * @brief Aplica uma ação a um estado empacotado, com as mesmas regras de despachar_opcao.
+ * @param estado Estado empacotado.
+ * @param acao Código da ação (1 a 5).
+ * @return uint64_t O novo estado, ou o próprio estado se a ação for rejeitada.
+ */
+uint64_t resolvedor_aplicar(uint64_t estado, int acao) {
+    uint64_t fila = estado & MASCARA_FILA_RESOLVEDOR;
+    uint64_t pilha = estado >> DESLOCAMENTO_PILHA_RESOLVEDOR;
+    int n = casas_ocupadas(fila);
+    int t = casas_ocupadas(pilha);
+    int i;
+
+    switch (acao) {
+        case 1: // Jogar: a frente sai e uma peça desconhecida entra no fim
+            if (n == 0) return estado;
+            fila = (fila >> BITS_CASA_RESOLVEDOR) | ((uint64_t)CASA_DESCONHECIDA << (BITS_CASA_RESOLVEDOR * (n - 1)));
+            break;
+
+        case 2: { // Reservar: a frente vai para a pilha (ou é descartada) e uma desconhecida entra
+            uint64_t frente = fila & 7;
+            if (n == 0) return estado;
+            fila = (fila >> BITS_CASA_RESOLVEDOR) | ((uint64_t)CASA_DESCONHECIDA << (BITS_CASA_RESOLVEDOR * (n - 1)));
+            if (t < MAX_PILHA) pilha |= frente << (BITS_CASA_RESOLVEDOR * t);
+            break;
+        }
+
+        case 3: // Usar a peça reservada
+            if (t == 0) return estado;
+            pilha &= ~(7ULL << (BITS_CASA_RESOLVEDOR * (t - 1)));
+            break;
+
+        case 4: { // Troca simples: frente da fila <-> topo da pilha
+            int d = BITS_CASA_RESOLVEDOR * (t - 1);
+            uint64_t x;
+            if (n == 0 || t == 0) return estado;
+            x = (fila ^ (pilha >> d)) & 7;
+            fila ^= x;
+            pilha ^= x << d;
+            break;
+        }
+
+        case 5: // Troca múltipla: casas 0, 1, 2 da fila <-> casas t-1, t-2, t-3 da pilha
+            if (n < 3 || t < 3 || MAX_FILA < 3 || MAX_PILHA < 3) return estado;
+            for (i = 0; i < 3; i++) {
+                int df = BITS_CASA_RESOLVEDOR * i;
+                int dp = BITS_CASA_RESOLVEDOR * (t - 1 - i);
+                uint64_t x = ((fila >> df) ^ (pilha >> dp)) & 7;
+                fila ^= x << df;
+                pilha ^= x << dp;
+            }
+            break;
+
+        default:
+            return estado;
+    }
+    return fila | (pilha << DESLOCAMENTO_PILHA_RESOLVEDOR);
+}
+
+/**
+ * @brief Espalha os bits de um estado para indexar a tabela (finalizador do SplitMix64).
+ */
+uint64_t misturar_estado(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Insere um estado na tabela de transposição.
+ * @param origem (acao << 60) | estado anterior, gravada só por quem insere.
+ * @param concorrente 1 se outras threads inserem ao mesmo tempo (ocupa a entrada com CAS).
+ * @return int 1 se o estado é novo, 0 se já estava na tabela, -1 se a tabela está cheia.
+ */
+int resolvedor_inserir(Resolvedor *r, uint64_t estado, uint64_t origem, int concorrente) {
+    uint64_t marcado = (r->epoca << BITS_ESTADO_RESOLVEDOR) | estado;
+    size_t i = misturar_estado(estado) & r->mascara;
+    size_t sondas = 0;
+
+    while (sondas <= r->mascara) {
+        uint64_t atual = atomic_load_explicit(&r->chaves[i], memory_order_relaxed);
+        if (atual == marcado) return 0;
+        if ((atual >> BITS_ESTADO_RESOLVEDOR) != r->epoca) {
+            // Entrada livre (de outra época): tenta ocupá-la
+            if (!concorrente) {
+                atomic_store_explicit(&r->chaves[i], marcado, memory_order_relaxed);
+                r->origens[i] = origem;
+                return 1;
+            }
+            if (atomic_compare_exchange_strong_explicit(&r->chaves[i], &atual, marcado,
+                                                        memory_order_relaxed, memory_order_relaxed)) {
+                r->origens[i] = origem;
+                return 1;
+            }
+            continue; // Outra thread ocupou a entrada: examina de novo
+        }
+        i = (i + 1) & r->mascara;
+        sondas++;
+    }
+    return -1;
+}
+
+/**
+ * @brief Procura a origem de um estado já inserido na busca atual.
+ */
+uint64_t resolvedor_origem(const Resolvedor *r, uint64_t estado) {
+    uint64_t marcado = (r->epoca << BITS_ESTADO_RESOLVEDOR) | estado;
+    size_t i = misturar_estado(estado) & r->mascara;
+    while (atomic_load_explicit(&r->chaves[i], memory_order_relaxed) != marcado) {
+        i = (i + 1) & r->mascara;
+    }
+    return r->origens[i];
+}
+
+/**
+ * @brief Expande uma parte do nível atual: insere os sucessores novos na próxima fronteira
+ * e para assim que algum sucessor atinge o alvo.
+ */
+void *resolvedor_expandir(void *arg) {
+    TarefaResolvedor *tarefa = arg;
+    Resolvedor *r = tarefa->resolvedor;
+    uint64_t lote[LOTE_RESOLVEDOR];
+    int no_lote = 0;
+    size_t k;
+    int acao;
+
+    for (k = 0; k < tarefa->quantidade; k++) {
+        uint64_t estado = tarefa->estados[k];
+        if ((k & 63) == 0 && (atomic_load_explicit(&r->encontrado, memory_order_relaxed) != ORIGEM_RAIZ ||
+                              atomic_load_explicit(&r->estourou, memory_order_relaxed))) {
+            break;
+        }
+        for (acao = 1; acao <= 5; acao++) {
+            uint64_t novo = resolvedor_aplicar(estado, acao);
+            int inserido;
+            if (novo == estado) continue; // Rejeitada (ou sem efeito)
+            inserido = resolvedor_inserir(r, novo, ((uint64_t)acao << 60) | estado, tarefa->concorrente);
+            if (inserido == 0) continue;
+            if (inserido < 0) {
+                atomic_store(&r->estourou, 1);
+                return NULL;
+            }
+            if ((novo & tarefa->mascara_alvo) == tarefa->valor_alvo) {
+                uint64_t nenhum = ORIGEM_RAIZ;
+                atomic_compare_exchange_strong(&r->encontrado, &nenhum, novo);
+                return NULL;
+            }
+            lote[no_lote++] = novo;
+            if (no_lote == LOTE_RESOLVEDOR) {
+                size_t pos = atomic_fetch_add_explicit(&r->tamanho_proxima, no_lote, memory_order_relaxed);
+                memcpy(r->proxima + pos, lote, no_lote * sizeof(uint64_t));
+                no_lote = 0;
+            }
+        }
+    }
+    if (no_lote > 0) {
+        size_t pos = atomic_fetch_add_explicit(&r->tamanho_proxima, no_lote, memory_order_relaxed);
+        memcpy(r->proxima + pos, lote, no_lote * sizeof(uint64_t));
+    }
+    return NULL;
+}
+
+/**
+ * @brief Aloca a tabela de transposição e as fronteiras com 'entradas' posições cada.
+ * @return int 1 em caso de sucesso, 0 se faltar memória.
+ */
+int resolvedor_alocar(Resolvedor *r, size_t entradas) {
+    r->chaves = calloc(entradas, sizeof(uint64_t)); // Época 0: tudo vazio
+    r->origens = malloc(entradas * sizeof(uint64_t));
+    r->fronteira = malloc(entradas * sizeof(uint64_t));
+    r->proxima = malloc(entradas * sizeof(uint64_t));
+    if (r->chaves == NULL || r->origens == NULL || r->fronteira == NULL || r->proxima == NULL) {
+        free((void *)r->chaves);
+        free(r->origens);
+        free(r->fronteira);
+        free(r->proxima);
+        return 0;
+    }
+    r->mascara = entradas - 1;
+    r->limite = entradas / 4 * 3;
+    return 1;
+}
+
+/**
+ * @brief Dobra a tabela de transposição (entre dois níveis da busca), reinserindo os
+ * estados da busca atual e preservando a fronteira.
+ * @param tamanho_fronteira Estados na fronteira atual.
+ * @return int 1 em caso de sucesso, 0 se faltar memória ou se a tabela já está no máximo.
+ */
+int resolvedor_crescer(Resolvedor *r, size_t tamanho_fronteira) {
+    Resolvedor antigo = *r;
+    size_t entradas = (r->mascara + 1) * 2;
+    size_t k;
+
+    if (entradas > MAX_ENTRADAS_RESOLVEDOR || !resolvedor_alocar(r, entradas)) {
+        *r = antigo;
+        return 0;
+    }
+    for (k = 0; k <= antigo.mascara; k++) {
+        uint64_t chave = atomic_load_explicit(&antigo.chaves[k], memory_order_relaxed);
+        if ((chave >> BITS_ESTADO_RESOLVEDOR) == r->epoca) {
+            resolvedor_inserir(r, chave & MASCARA_ESTADO_RESOLVEDOR, antigo.origens[k], 0);
+        }
+    }
+    memcpy(r->fronteira, antigo.fronteira, tamanho_fronteira * sizeof(uint64_t));
+    free((void *)antigo.chaves);
+    free(antigo.origens);
+    free(antigo.fronteira);
+    free(antigo.proxima);
+    return 1;
+}
+
+/**
+ * @brief Cria um resolvedor com uma tabela de transposição pequena, que cresce sob demanda.
+ * @param r Ponteiro para o resolvedor.
+ * @param num_threads Threads usadas nos níveis grandes da busca.
+ * @return int 1 em caso de sucesso, 0 se faltar memória.
+ */
+int resolvedor_criar(Resolvedor *r, int num_threads) {
+    memset(r, 0, sizeof(*r));
+    if (!resolvedor_alocar(r, ENTRADAS_INICIAIS_RESOLVEDOR)) return 0;
+    r->num_threads = num_threads < 1 ? 1 : (num_threads > MAX_THREADS_RESOLVEDOR ? MAX_THREADS_RESOLVEDOR : num_threads);
+    return 1;
+}
+
+/**
+ * @brief Libera a memória do resolvedor.
+ */
+void resolvedor_liberar(Resolvedor *r) {
+    free((void *)r->chaves);
+    free(r->origens);
+    free(r->fronteira);
+    free(r->proxima);
+}
+
+/**
+ * @brief Busca em largura da menor sequência de ações que põe 'alvo' na frente da fila.
+ * Níveis com LIMIAR_PARALELO_RESOLVEDOR estados ou mais são divididos entre as threads.
+ * @param r Resolvedor (criado com resolvedor_criar).
+ * @param inicio Estado inicial empacotado.
+ * @param alvo Tipos desejados, da frente para trás (por exemplo "TLI").
+ * @param acoes Recebe a sequência (até PROFUNDIDADE_MAXIMA_RESOLVEDOR ações).
+ * @return int O número de ações, -1 se o alvo é inalcançável ou inválido, -2 se a tabela encheu.
+ */
+int resolver_sequencia(Resolvedor *r, uint64_t inicio, const char *alvo, int *acoes) {
+    uint64_t mascara_alvo = 0, valor_alvo = 0;
+    size_t tamanho_fronteira = 1;
+    uint64_t estado;
+    int profundidade = 0;
+    int k, n;
+
+    n = (int)strlen(alvo);
+    if (n == 0 || n > MAX_FILA) return -1;
+    for (k = 0; k < n; k++) {
+        int codigo = codigo_casa(alvo[k]);
+        if (codigo == CASA_DESCONHECIDA) return -1;
+        mascara_alvo |= 7ULL << (BITS_CASA_RESOLVEDOR * k);
+        valor_alvo |= (uint64_t)codigo << (BITS_CASA_RESOLVEDOR * k);
+    }
+    r->visitados = 1;
+    if ((inicio & mascara_alvo) == valor_alvo) return 0;
+
+    // Nova época: as entradas da busca anterior passam a contar como vazias
+    if (++r->epoca >> (64 - BITS_ESTADO_RESOLVEDOR)) {
+        memset((void *)r->chaves, 0, (r->mascara + 1) * sizeof(uint64_t));
+        r->epoca = 1;
+    }
+    atomic_store(&r->encontrado, ORIGEM_RAIZ);
+    atomic_store(&r->estourou, 0);
+    resolvedor_inserir(r, inicio, ORIGEM_RAIZ, 0);
+    r->fronteira[0] = inicio;
+
+    while (tamanho_fronteira > 0 && profundidade < PROFUNDIDADE_MAXIMA_RESOLVEDOR) {
+        TarefaResolvedor tarefas[MAX_THREADS_RESOLVEDOR];
+        int num_tarefas = 1;
+        uint64_t *troca;
+
+        // Garante espaço para todos os sucessores possíveis do nível (5 por estado)
+        while ((size_t)r->visitados + 5 * tamanho_fronteira > r->limite) {
+            if (!resolvedor_crescer(r, tamanho_fronteira)) break;
+        }
+
+        if (r->num_threads > 1 && tamanho_fronteira >= LIMIAR_PARALELO_RESOLVEDOR) {
+            num_tarefas = r->num_threads;
+        }
+        atomic_store(&r->tamanho_proxima, 0);
+        for (k = 0; k < num_tarefas; k++) {
+            size_t a = tamanho_fronteira * k / num_tarefas;
+            size_t b = tamanho_fronteira * (k + 1) / num_tarefas;
+            tarefas[k].resolvedor = r;
+            tarefas[k].estados = r->fronteira + a;
+            tarefas[k].quantidade = b - a;
+            tarefas[k].mascara_alvo = mascara_alvo;
+            tarefas[k].valor_alvo = valor_alvo;
+            tarefas[k].concorrente = (num_tarefas > 1);
+        }
+        // A thread atual expande a primeira parte; as outras partes ganham uma thread cada
+        for (k = 1; k < num_tarefas; k++) {
+            if (pthread_create(&tarefas[k].thread, NULL, resolvedor_expandir, &tarefas[k]) != 0) {
+                resolvedor_expandir(&tarefas[k]);
+                tarefas[k].thread = 0;
+            }
+        }
+        resolvedor_expandir(&tarefas[0]);
+        for (k = 1; k < num_tarefas; k++) {
+            if (tarefas[k].thread != 0) pthread_join(tarefas[k].thread, NULL);
+        }
+
+        profundidade++;
+        tamanho_fronteira = atomic_load(&r->tamanho_proxima);
+        r->visitados += (long long)tamanho_fronteira;
+        if (atomic_load(&r->estourou) || (size_t)r->visitados > r->mascara) return -2;
+
+        estado = atomic_load(&r->encontrado);
+        if (estado != ORIGEM_RAIZ) {
+            // Reconstrói a sequência seguindo as origens até o estado inicial
+            for (k = profundidade - 1; k >= 0; k--) {
+                uint64_t origem = resolvedor_origem(r, estado);
+                acoes[k] = (int)(origem >> 60);
+                estado = origem & MASCARA_ESTADO_RESOLVEDOR;
+            }
+            return profundidade;
+        }
+
+        troca = r->fronteira;
+        r->fronteira = r->proxima;
+        r->proxima = troca;
+    }
+    return -1;
+}
+
+/**
+ * @brief Modo --resolver: monta o estado inicial do jogo (pela semente), procura a menor
+ * sequência até o alvo e a confere aplicando as ações de verdade.
+ * @param alvo Tipos desejados na frente da fila (por exemplo "TLI").
+ * @param num_threads Threads da busca.
+ * @return int 0 se o alvo foi alcançado, 1 caso contrário.
+ */
+int executar_resolvedor(const char *alvo, int num_threads) {
+    Resolvedor resolvedor;
+    FilaCircular fila;
+    Pilha pilha;
+    int acoes[PROFUNDIDADE_MAXIMA_RESOLVEDOR];
+    struct timespec t_inicio, t_fim;
+    int n, k, alcancado = 1;
+
+    if (!resolvedor_criar(&resolvedor, num_threads)) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para o resolvedor.\n");
+        return 1;
+    }
+
+    modo_silencioso = 1;
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+    modo_silencioso = 0;
+    printf("--- Estado Inicial ---");
+    exibir_estado_atual(&fila, &pilha);
+
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    n = resolver_sequencia(&resolvedor, empacotar_estado(&fila, &pilha), alvo, acoes);
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+
+    if (n == -2) {
+        printf("Busca interrompida: a tabela de transposicao encheu.\n");
+    } else if (n < 0) {
+        printf("Alvo '%s' inalcancavel (tipos validos: I, O, T, L; no maximo %d pecas).\n", alvo, MAX_FILA);
+    } else {
+        printf("Menor sequencia para '%s' na frente da fila (%d acoes):", alvo, n);
+        for (k = 0; k < n; k++) printf(" %d", acoes[k]);
+        printf("\n");
+
+        // Confere aplicando a sequência às estruturas reais
+        modo_silencioso = 1;
+        for (k = 0; k < n; k++) despachar_opcao(&fila, &pilha, acoes[k]);
+        modo_silencioso = 0;
+        for (k = 0; alvo[k] != '\0'; k++) {
+            alcancado &= (k < fila.tamanho_atual && fila.itens[INDICE_FILA(fila.inicio + k)].nome == alvo[k]);
+        }
+        printf("--- Estado Apos a Sequencia ---");
+        exibir_estado_atual(&fila, &pilha);
+        printf("Alvo alcancado: %s\n", alcancado ? "sim" : "NAO");
+    }
+    fprintf(stderr, "Busca: %lld estados visitados em %.1f us\n", resolvedor.visitados,
+            ((t_fim.tv_sec - t_inicio.tv_sec) * 1e9 + (t_fim.tv_nsec - t_inicio.tv_nsec)) / 1e3);
+
+    resolvedor_liberar(&resolvedor);
+    return (n >= 0 && alcancado) ? 0 : 1;
+}
+
+#else
+
+#define RESOLVEDOR_DISPONIVEL 0
+
+int executar_resolvedor(const char *alvo, int num_threads) {
+    (void)alvo;
+    (void)num_threads;
+    fprintf(stderr, "ERRO: O resolvedor exige MAX_FILA + MAX_PILHA <= 16.\n");
+    return 1;
+}
+
+#endif // MAX_FILA + MAX_PILHA <= 16
+
+// --- Avaliador de Jogadas (Heurística) ---
+//
+// Para a peça da frente da fila (ou a do topo da pilha, usada como "hold" com a ação 4)
+// e as próximas peças da prévia, testa cada rotação x coluna e pontua o tabuleiro final
+// com pesos configuráveis para a soma das alturas, os buracos, a irregularidade entre
+// colunas vizinhas e as linhas removidas. As alturas e os buracos de todas as colunas
+// saem juntos, uma coluna por byte de um registrador SSE2.
+
+// Pontuação de um tabuleiro em que alguma peça não coube
+#define PONTUACAO_FIM_DE_JOGO (-1e18)
+// Jogadas possíveis de uma peça, no máximo (todas as rotações x colunas)
+#define MAX_POSICOES_PECA (MAX_ROTACOES * LARGURA_TABULEIRO)
+// Limite de threads do avaliador
+#define MAX_THREADS_AVALIADOR 64
+
+/**
+ * @brief Pesos da heurística (os padrões favorecem tabuleiros baixos, lisos e sem buracos).
+ */
+typedef struct {
+    double altura;             // Soma das alturas das colunas
+    double buracos;            // Células vazias abaixo do topo de cada coluna
+    double irregularidade;     // Soma de |altura[c] - altura[c + 1]|
+    double linhas;             // Linhas removidas pelas peças da sequência
+} PesosHeuristica;
+
+const PesosHeuristica PESOS_PADRAO = {-0.510066, -0.35663, -0.184483, 0.760666};
+
+/**
+ * @brief Características de um tabuleiro usadas pela heurística.
+ */
+typedef struct {
+    int altura_total;
+    int buracos;
+    int irregularidade;
+} CaracteristicasTabuleiro;
+
+/**
+ * @brief A melhor jogada encontrada para a peça atual.
+ */
+typedef struct {
+    int usar_reserva;          // 1: troca a frente com o topo da pilha (ação 4) antes de jogar
+    char peca;                 // Tipo da peça jogada
+    int rotacao;               // Índice em ROTACOES_PECA
+    int coluna;                // Coluna da borda esquerda
+    double pontuacao;          // Pontuação da melhor sequência que começa com esta jogada
+    long long posicoes;        // Tabuleiros avaliados na busca inteira
+} JogadaAvaliada;
+
+/**
+ * @brief Calcula as características coluna a coluna (versão de referência, sem SIMD).
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ * @param c Recebe as características.
+ */
+void calcular_caracteristicas_escalar(const Tabuleiro *tabuleiro, CaracteristicasTabuleiro *c) {
+    int alturas[LARGURA_TABULEIRO];
+    int x, y;
+
+    c->altura_total = c->buracos = c->irregularidade = 0;
+    for (x = 0; x < LARGURA_TABULEIRO; x++) {
+        alturas[x] = 0;
+        for (y = tabuleiro->altura - 1; y >= 0; y--) {
+            if ((tabuleiro->linhas[y] >> (PAREDE_TABULEIRO + x)) & 1) {
+                if (alturas[x] == 0) alturas[x] = y + 1;
+            } else if (alturas[x] != 0) {
+                c->buracos++;
+            }
+        }
+        c->altura_total += alturas[x];
+        if (x > 0) c->irregularidade += abs(alturas[x] - alturas[x - 1]);
+    }
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief Calcula as características com SSE2: cada byte do registrador é uma coluna
+ * (o bit i da linha vira o byte i), e cada linha do tabuleiro custa poucas instruções
+ * para todas as colunas de uma vez.
+ * alturas[c] = maior (y + 1) com a célula ocupada; ocupadas[c] = células ocupadas;
+ * buracos = soma das alturas - soma das ocupadas. As somas e a irregularidade saem de
+ * PSADBW (soma das diferenças absolutas de bytes).
+ * @param tabuleiro Ponteiro para o tabuleiro.
+ * @param c Recebe as características.
+ */
+void calcular_caracteristicas(const Tabuleiro *tabuleiro, CaracteristicasTabuleiro *c) {
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    // Bytes das colunas (bits 3 a 12) e dos pares de vizinhas (colunas 3 a 11 com a seguinte)
+    const __m128i colunas = _mm_setr_epi8(0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0);
+    const __m128i vizinhas = _mm_setr_epi8(0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i alturas = zero;
+    __m128i ocupadas = zero;
+    __m128i soma_alturas, soma_ocupadas, irregularidade;
+    int y;
+
+    for (y = 0; y < tabuleiro->altura; y++) {
+        uint16_t linha = tabuleiro->linhas[y];
+        __m128i bytes = _mm_unpacklo_epi64(_mm_set1_epi8((char)(linha & 0xFF)), _mm_set1_epi8((char)(linha >> 8)));
+        __m128i cheias = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(bytes, bits), bits), colunas);
+        alturas = _mm_max_epu8(alturas, _mm_and_si128(cheias, _mm_set1_epi8((char)(y + 1))));
+        ocupadas = _mm_sub_epi8(ocupadas, cheias); // cheias vale -1 nas células ocupadas
+    }
+
+    soma_alturas = _mm_sad_epu8(alturas, zero);
+    soma_ocupadas = _mm_sad_epu8(ocupadas, zero);
+    irregularidade = _mm_sad_epu8(_mm_and_si128(alturas, vizinhas),
+                                  _mm_and_si128(_mm_srli_si128(alturas, 1), vizinhas));
+    c->altura_total = _mm_cvtsi128_si32(soma_alturas) + _mm_extract_epi16(soma_alturas, 4);
+    c->buracos = c->altura_total - (_mm_cvtsi128_si32(soma_ocupadas) + _mm_extract_epi16(soma_ocupadas, 4));
+    c->irregularidade = _mm_cvtsi128_si32(irregularidade) + _mm_extract_epi16(irregularidade, 4);
+}
+
+#else
+
+void calcular_caracteristicas(const Tabuleiro *tabuleiro, CaracteristicasTabuleiro *c) {
+    calcular_caracteristicas_escalar(tabuleiro, c);
+}
+
+#endif // __SSE2__
+
+/**
+ * @brief Pontua um tabuleiro com os pesos da heurística.
+ * @param linhas Linhas removidas pela sequência de peças que levou a este tabuleiro.
+ */
+double pontuar_tabuleiro(const Tabuleiro *tabuleiro, int linhas, const PesosHeuristica *pesos) {
+    CaracteristicasTabuleiro c;
+    calcular_caracteristicas(tabuleiro, &c);
+    return pesos->altura * c.altura_total + pesos->buracos * c.buracos +
+           pesos->irregularidade * c.irregularidade + pesos->linhas * linhas;
+}
+
+/**
+ * @brief Melhor pontuação alcançável jogando as peças 'tipos[0..n-1]' em ordem, em busca
+ * completa sobre todas as rotações x colunas de cada peça.
+ * @param posicoes Acumula o número de tabuleiros avaliados.
+ */
+double avaliador_buscar(const Tabuleiro *tabuleiro, const int *tipos, int n, int linhas,
+                        const PesosHeuristica *pesos, long long *posicoes) {
+    double melhor = PONTUACAO_FIM_DE_JOGO;
+    int r, x;
+
+    if (n == 0) return pontuar_tabuleiro(tabuleiro, linhas, pesos);
+    for (r = 0; r < NUM_ROTACOES[tipos[0]]; r++) {
+        const RotacaoPeca *rotacao = &ROTACOES_PECA[tipos[0]][r];
+        for (x = 0; x + rotacao->largura <= LARGURA_TABULEIRO; x++) {
+            Tabuleiro copia = *tabuleiro;
+            int removidas = tabuleiro_colocar(&copia, rotacao, x, tabuleiro_soltar(tabuleiro, rotacao, x));
+            double valor;
+            (*posicoes)++;
+            if (removidas < 0) continue; // A peça não coube
+            valor = avaliador_buscar(&copia, tipos + 1, n - 1, linhas + removidas, pesos, posicoes);
+            if (valor > melhor) melhor = valor;
+        }
+    }
+    return melhor;
+}
+
+/**
+ * @brief Uma primeira jogada candidata, avaliada por alguma thread.
+ */
+typedef struct {
+    int usar_reserva;
+    int tipo;
+    int rotacao;
+    int coluna;
+    double pontuacao;
+    long long posicoes;
+} CandidatoAvaliador;
+
+/**
+ * @brief Trabalho compartilhado pelas threads do avaliador: cada uma retira o próximo
+ * candidato com um contador atômico até acabarem.
+ */
+typedef struct {
+    const Tabuleiro *tabuleiro;
+    const int *seguintes;      // Tipos das peças da prévia depois da primeira
+    int num_seguintes;
+    const PesosHeuristica *pesos;
+    CandidatoAvaliador *candidatos;
+    int num_candidatos;
+    _Atomic int proximo;
+} TrabalhoAvaliador;
+
+/**
+ * @brief Avalia candidatos até não sobrar nenhum.
+ */
+void *avaliador_trabalhar(void *arg) {
+    TrabalhoAvaliador *trabalho = arg;
+    int i;
+
+    while ((i = atomic_fetch_add_explicit(&trabalho->proximo, 1, memory_order_relaxed)) < trabalho->num_candidatos) {
+        CandidatoAvaliador *c = &trabalho->candidatos[i];
+        const RotacaoPeca *rotacao = &ROTACOES_PECA[c->tipo][c->rotacao];
+        Tabuleiro copia = *trabalho->tabuleiro;
+        int removidas = tabuleiro_colocar(&copia, rotacao, c->coluna,
+                                          tabuleiro_soltar(trabalho->tabuleiro, rotacao, c->coluna));
+        c->posicoes = 1;
+        c->pontuacao = removidas < 0 ? PONTUACAO_FIM_DE_JOGO
+                                     : avaliador_buscar(&copia, trabalho->seguintes, trabalho->num_seguintes,
+                                                        removidas, trabalho->pesos, &c->posicoes);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Threads do avaliador, criadas uma vez por partida e reaproveitadas em todas as
+ * jogadas: criar e juntar threads a cada jogada custaria quase tanto quanto a jogada.
+ * A cada trabalho publicado a geração avança e as threads acordam para dividi-lo com a
+ * thread que chamou; a última a terminar avisa quem espera em 'sinal_fim'.
+ */
+typedef struct {
+    pthread_t threads[MAX_THREADS_AVALIADOR];
+    int num_threads;                 // Threads do pool (além da que chama)
+    pthread_mutex_t trava;
+    pthread_cond_t sinal_trabalho;   // Trabalho novo ou encerramento
+    pthread_cond_t sinal_fim;        // Todas as threads terminaram o trabalho atual
+    TrabalhoAvaliador *trabalho;     // Trabalho da geração atual
+    unsigned long geracao;
+    int pendentes;                   // Threads que ainda não terminaram a geração atual
+    int encerrar;
+} PoolAvaliador;
+
+/**
+ * @brief Thread do pool: espera uma geração nova, avalia candidatos e volta a esperar.
+ */
+void *avaliador_pool_thread(void *arg) {
+    PoolAvaliador *pool = arg;
+    unsigned long vista = 0;
+
+    pthread_mutex_lock(&pool->trava);
+    for (;;) {
+        TrabalhoAvaliador *trabalho;
+
+        while (pool->geracao == vista && !pool->encerrar) pthread_cond_wait(&pool->sinal_trabalho, &pool->trava);
+        if (pool->geracao == vista) break;
+        vista = pool->geracao;
+        trabalho = pool->trabalho;
+        pthread_mutex_unlock(&pool->trava);
+
+        avaliador_trabalhar(trabalho);
+
+        pthread_mutex_lock(&pool->trava);
+        if (--pool->pendentes == 0) pthread_cond_signal(&pool->sinal_fim);
+    }
+    pthread_mutex_unlock(&pool->trava);
+    return NULL;
+}
+
+/**
+ * @brief Cria as threads do pool. Uma thread que não pôde ser criada só deixa o pool menor.
+ * @param num_threads Threads da avaliação, contando a que chama avaliar_jogadas.
+ */
+void avaliador_pool_iniciar(PoolAvaliador *pool, int num_threads) {
+    if (num_threads > MAX_THREADS_AVALIADOR) num_threads = MAX_THREADS_AVALIADOR;
+    pool->trabalho = NULL;
+    pool->geracao = 0;
+    pool->pendentes = 0;
+    pool->encerrar = 0;
+    pthread_mutex_init(&pool->trava, NULL);
+    pthread_cond_init(&pool->sinal_trabalho, NULL);
+    pthread_cond_init(&pool->sinal_fim, NULL);
+    for (pool->num_threads = 0; pool->num_threads < num_threads - 1; pool->num_threads++) {
+        if (pthread_create(&pool->threads[pool->num_threads], NULL, avaliador_pool_thread, pool) != 0) break;
+    }
+}
+
+/**
+ * @brief Encerra e junta as threads do pool.
+ */
+void avaliador_pool_encerrar(PoolAvaliador *pool) {
+    int i;
+
+    pthread_mutex_lock(&pool->trava);
+    pool->encerrar = 1;
+    pthread_cond_broadcast(&pool->sinal_trabalho);
+    pthread_mutex_unlock(&pool->trava);
+    for (i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->trava);
+    pthread_cond_destroy(&pool->sinal_trabalho);
+    pthread_cond_destroy(&pool->sinal_fim);
+}
+
+/**
+ * @brief Divide um trabalho entre as threads do pool e a que chama, e volta quando
+ * todos os candidatos foram avaliados e nenhuma thread ainda o lê.
+ */
+void avaliador_pool_executar(PoolAvaliador *pool, TrabalhoAvaliador *trabalho) {
+    pthread_mutex_lock(&pool->trava);
+    pool->trabalho = trabalho;
+    pool->pendentes = pool->num_threads;
+    pool->geracao++;
+    pthread_cond_broadcast(&pool->sinal_trabalho);
+    pthread_mutex_unlock(&pool->trava);
+
+    avaliador_trabalhar(trabalho);
+
+    pthread_mutex_lock(&pool->trava);
+    while (pool->pendentes > 0) pthread_cond_wait(&pool->sinal_fim, &pool->trava);
+    pthread_mutex_unlock(&pool->trava);
+}
+
+/**
+ * @brief Escolhe a melhor jogada para a peça da frente da fila, olhando 'profundidade' peças
+ * à frente (a atual e as seguintes da prévia). Se a pilha tiver peças, também considera
+ * jogar a do topo no lugar da atual (ação 4 e depois ação 1).
+ * Com profundidade >= 2 e um pool, as primeiras jogadas são divididas entre as threads
+ * do pool e a que chama; empates ficam com o candidato de menor índice, então o resultado não
+ * depende do número de threads.
+ * @param tabuleiro Tabuleiro atual.
+ * @param fila Fila com a prévia.
+ * @param pilha Pilha de reserva.
+ * @param pesos Pesos da heurística.
+ * @param profundidade Peças consideradas (1 a MAX_FILA; limitada ao tamanho da fila).
+ * @param pool Threads da avaliação (NULL: só a thread que chama).
+ * @param melhor Recebe a melhor jogada.
+ * @return int 1 se há jogada (a fila não está vazia), 0 caso contrário.
+ */
+int avaliar_jogadas(const Tabuleiro *tabuleiro, const FilaCircular *fila, const Pilha *pilha,
+                    const PesosHeuristica *pesos, int profundidade, PoolAvaliador *pool, JogadaAvaliada *melhor) {
+    CandidatoAvaliador candidatos[2 * MAX_POSICOES_PECA];
+    int seguintes[MAX_FILA];
+    TrabalhoAvaliador trabalho;
+    int primeiros[2];
+    int num_primeiros = 0;
+    int i, p, r, x;
+
+    if (fila->tamanho_atual == 0) return 0;
+    if (profundidade > fila->tamanho_atual) profundidade = fila->tamanho_atual;
+    if (profundidade < 1) profundidade = 1;
+
+    primeiros[num_primeiros++] = indice_tipo_peca(fila->itens[fila->inicio].nome);
+    if (pilha->topo >= 0) primeiros[num_primeiros++] = indice_tipo_peca(pilha->itens[pilha->topo].nome);
+    for (i = 1; i < profundidade; i++) {
+        seguintes[i - 1] = indice_tipo_peca(fila->itens[INDICE_FILA(fila->inicio + i)].nome);
+    }
+
+    trabalho.tabuleiro = tabuleiro;
+    trabalho.seguintes = seguintes;
+    trabalho.num_seguintes = profundidade - 1;
+    trabalho.pesos = pesos;
+    trabalho.candidatos = candidatos;
+    trabalho.num_candidatos = 0;
+    atomic_init(&trabalho.proximo, 0);
+    for (p = 0; p < num_primeiros; p++) {
+        if (primeiros[p] < 0) continue;
+        for (r = 0; r < NUM_ROTACOES[primeiros[p]]; r++) {
+            for (x = 0; x + ROTACOES_PECA[primeiros[p]][r].largura <= LARGURA_TABULEIRO; x++) {
+                CandidatoAvaliador *c = &trabalho.candidatos[trabalho.num_candidatos++];
+                c->usar_reserva = p;
+                c->tipo = primeiros[p];
+                c->rotacao = r;
+                c->coluna = x;
+            }
+        }
+    }
+    if (trabalho.num_candidatos == 0) return 0;
+
+    // Com uma peça só, cada candidato é um tabuleiro: não compensa acordar o pool
+    if (profundidade >= 2 && pool != NULL && pool->num_threads > 0) {
+        avaliador_pool_executar(pool, &trabalho);
+    } else {
+        avaliador_trabalhar(&trabalho);
+    }
+
+    melhor->posicoes = 0;
+    p = 0;
+    for (i = 0; i < trabalho.num_candidatos; i++) {
+        melhor->posicoes += candidatos[i].posicoes;
+        if (candidatos[i].pontuacao > candidatos[p].pontuacao) p = i;
+    }
+    melhor->usar_reserva = candidatos[p].usar_reserva;
+    melhor->peca = TIPOS_PECA[candidatos[p].tipo];
+    melhor->rotacao = candidatos[p].rotacao;
+    melhor->coluna = candidatos[p].coluna;
+    melhor->pontuacao = candidatos[p].pontuacao;
+    return 1;
+}
+
+/**
+ * @brief Modo --avaliar: um bot joga N peças, escolhendo cada jogada com o avaliador, e
+ * imprime as linhas removidas, os fins de jogo e a vazão da avaliação.
+ * @param num_pecas Peças a jogar.
+ * @param profundidade Peças consideradas em cada jogada.
+ * @param num_threads Threads da avaliação.
+ * @param pesos Pesos da heurística.
+ * @return int 0 em caso de sucesso.
+ */
+int executar_avaliador(long long num_pecas, int profundidade, int num_threads, const PesosHeuristica *pesos) {
+    FilaCircular fila;
+    Pilha pilha;
+    Tabuleiro tabuleiro;
+    Tabuleiro *tabuleiro_anterior = tabuleiro_ativo;
+    PoolAvaliador pool;
+    long long posicoes = 0, reservas = 0, k;
+    struct timespec t_inicio, t_fim;
+
+    modo_silencioso = 1;
+    tabuleiro_ativo = NULL; // A peça é colocada pelo bot, na posição escolhida
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    inicializar_tabuleiro(&tabuleiro);
+    preencher_fila_inicial(&fila);
+    // Uma peça na reserva desde o início, para o bot poder usá-la como "hold"
+    despachar_opcao(&fila, &pilha, 2);
+    // As threads vivem a partida inteira; cada jogada só as acorda
+    avaliador_pool_iniciar(&pool, num_threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    for (k = 0; k < num_pecas; k++) {
+        JogadaAvaliada jogada;
+        const RotacaoPeca *rotacao;
+
+        if (!avaliar_jogadas(&tabuleiro, &fila, &pilha, pesos, profundidade, &pool, &jogada)) break;
+        posicoes += jogada.posicoes;
+        if (jogada.usar_reserva) {
+            despachar_opcao(&fila, &pilha, 4);
+            reservas++;
+        }
+        rotacao = &ROTACOES_PECA[indice_tipo_peca(jogada.peca)][jogada.rotacao];
+        tabuleiro_colocar(&tabuleiro, rotacao, jogada.coluna, tabuleiro_soltar(&tabuleiro, rotacao, jogada.coluna));
+        despachar_opcao(&fila, &pilha, 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+    avaliador_pool_encerrar(&pool);
+    modo_silencioso = 0;
+    tabuleiro_ativo = &tabuleiro;
+
+    printf("--- Resumo do Bot ---\n");
+    printf("Pecas jogadas: %lld (profundidade %d, %lld usando a reserva)\n", tabuleiro.pecas, profundidade, reservas);
+    printf("Linhas removidas: %lld | Fins de jogo: %lld\n", tabuleiro.linhas_limpas, tabuleiro.fins_de_jogo);
+    exibir_estado_atual(&fila, &pilha);
+    {
+        double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        fprintf(stderr, "Tempo: %.3f s, %lld posicoes avaliadas (%.1f milhoes/s, %.1f us por jogada)\n",
+                segundos, posicoes, segundos > 0 ? posicoes / segundos / 1e6 : 0.0,
+                k > 0 ? segundos * 1e6 / k : 0.0);
+    }
+    tabuleiro_ativo = tabuleiro_anterior;
+    return 0;
+}
+
+// --- Simulador em Lote (Paralelo) ---
+
+// Quantas sessões formam uma tarefa do pool (a unidade que pode ser roubada)
+#define SESSOES_POR_TAREFA 64
+// Limite de threads do simulador
+#define MAX_THREADS_SIMULACAO 256
+
+/**
+ * @brief Parâmetros de uma simulação em lote.
+ *
+ * Cada sessão i tem sua própria fila, pilha, gerador de peças (fluxo 2i + 2) e gerador
+ * da política (fluxo 2i + 3), derivados da mesma semente. Por isso o resultado de cada
+ * sessão, e a soma de todas, não depende de quantas threads existem nem de qual
+ * thread executou cada sessão.
+ */
+typedef struct {
+    int num_sessoes;           // N: número de sessões independentes
+    long long acoes_por_sessao; // M: ações aplicadas a cada sessão
+    uint64_t semente;          // Semente da simulação
+    ModoGerador modo;          // Modo do gerador de peças de cada sessão
+    int pesos[5];              // Pesos da política aleatória para as ações 1 a 5
+    int num_threads;           // Threads do pool
+    int compacto;              // 1: cada sessão roda no EstadoCompacto (128 bits)
+} ConfigSimulacao;
+
+/**
+ * @brief Estatísticas acumuladas (por thread, e depois somadas).
+ * Todos os campos são somas, então a ordem da junção não altera o resultado.
+ */
+typedef struct {
+    long long sessoes;         // Sessões simuladas
+    long long acoes[6];        // Ações executadas, por código
+    long long rejeitadas[6];   // Ações cuja pré-condição falhou, por código
+    long long descartes;       // Reservas com a pilha cheia (peça descartada)
+    long long pecas_geradas;   // Total de peças geradas por todas as sessões
+    uint64_t hash;             // Soma dos hashes dos estados finais das sessões
+    long long descompactadas;  // Sessões compactas que voltaram para FilaCircular/Pilha
+} EstatisticasSimulacao;
+
+struct Simulador;
+
+/**
+ * @brief Uma thread do pool, com sua fila de tarefas com roubo de trabalho.
+ *
+ * intervalo: As tarefas [inicio, fim) ainda não executadas, empacotadas em 64 bits
+ *   (inicio << 32 | fim). O dono retira do início e os ladrões retiram do fim, ambos
+ *   com compare-and-swap sobre a mesma palavra, sem trava.
+ */
+typedef struct {
+    _Alignas(LINHA_CACHE) _Atomic uint64_t intervalo;
+    EstatisticasSimulacao estatisticas;
+    long long tarefas_executadas;
+    long long tarefas_roubadas;
+    int indice;
+    pthread_t thread;
+    struct Simulador *simulador;
+} TrabalhadorSimulacao;
+
+/**
+ * @brief O pool de threads de uma simulação.
+ */
+typedef struct Simulador {
+    const ConfigSimulacao *config;
+    int acumulado[5];          // Pesos acumulados da política
+    int total_pesos;
+    int num_tarefas;
+    TrabalhadorSimulacao *trabalhadores;
+} Simulador;
+
+/**
+ * @brief Retira uma tarefa do início do próprio intervalo (lado do dono).
+ * @return int O índice da tarefa, ou -1 se o intervalo está vazio.
+ */
+int trabalhador_retirar(TrabalhadorSimulacao *t) {
+    uint64_t atual = atomic_load_explicit(&t->intervalo, memory_order_relaxed);
+    for (;;) {
+        uint32_t inicio = (uint32_t)(atual >> 32);
+        uint32_t fim = (uint32_t)atual;
+        if (inicio >= fim) return -1;
+        if (atomic_compare_exchange_weak_explicit(&t->intervalo, &atual,
+                ((uint64_t)(inicio + 1) << 32) | fim, memory_order_acq_rel, memory_order_relaxed)) {
+            return (int)inicio;
+        }
+    }
+}
+
+/**
+ * @brief Rouba uma tarefa do fim do intervalo de outro trabalhador (lado do ladrão).
+ * @return int O índice da tarefa, ou -1 se o intervalo está vazio.
+ */
+int trabalhador_roubar(TrabalhadorSimulacao *vitima) {
+    uint64_t atual = atomic_load_explicit(&vitima->intervalo, memory_order_relaxed);
+    for (;;) {
+        uint32_t inicio = (uint32_t)(atual >> 32);
+        uint32_t fim = (uint32_t)atual;
+        if (inicio >= fim) return -1;
+        if (atomic_compare_exchange_weak_explicit(&vitima->intervalo, &atual,
+                ((uint64_t)inicio << 32) | (fim - 1), memory_order_acq_rel, memory_order_relaxed)) {
+            return (int)(fim - 1);
+        }
+    }
+}
+
+/**
+ * @brief Sorteia a próxima ação (1 a 5) da política, segundo os pesos do simulador.
+ */
+int sortear_opcao(const Simulador *simulador, GeradorPecas *politica) {
+    int r = (int)(((unsigned __int128)gerador_proximo_u64(politica) * (unsigned)simulador->total_pesos) >> 64);
+    int opcao = 1;
+    while (r >= simulador->acumulado[opcao - 1]) opcao++;
+    return opcao;
+}
+
+/**
+ * @brief Simula uma sessão completa e acumula o resultado nas estatísticas.
+ * @param simulador Ponteiro para o simulador.
+ * @param sessao Índice da sessão.
+ * @param est Estatísticas da thread que executa a sessão.
+ */
+void simular_sessao(Simulador *simulador, int sessao, EstatisticasSimulacao *est) {
+    const ConfigSimulacao *config = simulador->config;
+    GeradorPecas gerador, politica;
+    GeradorPecas *gerador_anterior = gerador_ativo;
+    FilaCircular fila;
+    Pilha pilha;
+#if ESTADO_COMPACTO_DISPONIVEL
+    EstadoCompacto compacto;
+    int usar_compacto = config->compacto;
+#endif
+    long long k;
+
+    gerador_inicializar(&gerador, config->semente, 2 * (uint64_t)sessao + 2, config->modo);
+    gerador_inicializar(&politica, config->semente, 2 * (uint64_t)sessao + 3, GERADOR_UNIFORME);
+    gerador_ativo = &gerador; // As peças desta sessão vêm só do gerador dela
+
+    inicializar_fila(&fila);
+    inicializar_pilha(&pilha);
+    preencher_fila_inicial(&fila);
+#if ESTADO_COMPACTO_DISPONIVEL
+    if (usar_compacto) compactar_estado(&fila, &pilha, gerador.proximo_id, &compacto);
+#endif
+
+    for (k = 0; k < config->acoes_por_sessao; k++) {
+        // Sorteia a ação segundo os pesos da política
+        int opcao = sortear_opcao(simulador, &politica);
+        ResultadoAcao resultado;
+
+#if ESTADO_COMPACTO_DISPONIVEL
+        // Antes que uma peça guardada fique velha demais para a idade de um byte, a sessão
+        // volta para a forma completa (ainda com todos os IDs exatos) e segue nela
+        if (usar_compacto && opcao <= 2 && !compacto_envelhece_sem_perda(&compacto)) {
+            descompactar_estado(&compacto, &fila, &pilha);
+            usar_compacto = 0;
+            est->descompactadas++;
+        }
+        if (usar_compacto) {
+            resultado = compacto_executar_opcao(&compacto, opcao);
+        } else
+#endif
+        resultado = executar_opcao(&fila, &pilha, opcao);
+        est->acoes[opcao]++;
+        if (resultado == ACAO_REJEITADA) est->rejeitadas[opcao]++;
+        if (resultado == ACAO_DESCARTADA) est->descartes++;
+    }
+
+#if ESTADO_COMPACTO_DISPONIVEL
+    // O hash é o do estado decodificado, então as duas formas dão o mesmo resultado
+    if (usar_compacto) descompactar_estado(&compacto, &fila, &pilha);
+#endif
+
+    est->sessoes++;
+    est->pecas_geradas += gerador.proximo_id;
+    // Soma comutativa: o hash final não depende da ordem em que as sessões terminam
+    est->hash += hash_estado(&fila, &pilha) * (2 * (uint64_t)sessao + 1);
+    gerador_ativo = gerador_anterior;
+}
+
+/**
+ * @brief Laço de uma thread do pool: executa as próprias tarefas e depois rouba das outras.
+ * @param arg Ponteiro para o TrabalhadorSimulacao.
+ * @return void* Sempre NULL.
+ */
+void *trabalhador_simulacao(void *arg) {
+    TrabalhadorSimulacao *t = arg;
+    Simulador *simulador = t->simulador;
+    int num_threads = simulador->config->num_threads;
+    int tarefa;
+
+    for (;;) {
+        int roubada = 0;
+        tarefa = trabalhador_retirar(t);
+        if (tarefa < 0) {
+            // Sem tarefas próprias: procura uma vítima, começando pela vizinha
+            int v;
+            for (v = 1; v < num_threads && tarefa < 0; v++) {
+                tarefa = trabalhador_roubar(&simulador->trabalhadores[(t->indice + v) % num_threads]);
+            }
+            if (tarefa < 0) break; // Nenhuma tarefa em lugar nenhum: fim (não surgem tarefas novas)
+            roubada = 1;
+        }
+
+        {
+            int primeira = tarefa * SESSOES_POR_TAREFA;
+            int ultima = primeira + SESSOES_POR_TAREFA;
+            int sessao;
+            if (ultima > simulador->config->num_sessoes) ultima = simulador->config->num_sessoes;
+            for (sessao = primeira; sessao < ultima; sessao++) {
+                simular_sessao(simulador, sessao, &t->estatisticas);
+            }
+        }
+        t->tarefas_executadas++;
+        t->tarefas_roubadas += roubada;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Soma as estatísticas de uma thread no total.
+ */
+void somar_estatisticas(EstatisticasSimulacao *total, const EstatisticasSimulacao *parcial) {
+    int i;
+    total->sessoes += parcial->sessoes;
+    for (i = 0; i < 6; i++) {
+        total->acoes[i] += parcial->acoes[i];
+        total->rejeitadas[i] += parcial->rejeitadas[i];
+    }
+    total->descartes += parcial->descartes;
+    total->pecas_geradas += parcial->pecas_geradas;
+    total->hash += parcial->hash;
+    total->descompactadas += parcial->descompactadas;
+}
+
+/**
+ * @brief Prepara os pesos acumulados da política.
+ * @return int 1 em caso de sucesso, 0 se a soma dos pesos não é positiva.
+ */
+int simulador_preparar_pesos(Simulador *simulador, const ConfigSimulacao *config) {
+    int i;
+    simulador->config = config;
+    simulador->total_pesos = 0;
+    for (i = 0; i < 5; i++) {
+        simulador->total_pesos += config->pesos[i];
+        simulador->acumulado[i] = simulador->total_pesos;
+    }
+    if (simulador->total_pesos <= 0) {
+        fprintf(stderr, "ERRO: A soma dos pesos da politica deve ser positiva.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Imprime o resumo de uma simulação (stdout), igual para qualquer número de threads.
+ */
+void imprimir_resumo_simulacao(const ConfigSimulacao *config, const EstatisticasSimulacao *total) {
+    int i;
+    printf("--- Resumo da Simulacao ---\n");
+    printf("Sessoes: %lld x %lld acoes (semente %llu)\n", total->sessoes, config->acoes_por_sessao,
+           (unsigned long long)config->semente);
+    for (i = 1; i <= 5; i++) {
+        printf("  Opcao %d: %lld executadas, %lld rejeitadas\n", i, total->acoes[i], total->rejeitadas[i]);
+    }
+    printf("Descartes (pilha cheia): %lld\n", total->descartes);
+    printf("Pecas geradas: %lld\n", total->pecas_geradas);
+    printf("Hash combinado: %016llx\n", (unsigned long long)total->hash);
+}
+
+/**
+ * @brief Executa N sessões x M ações em um pool de threads com roubo de trabalho
+ * e imprime as estatísticas somadas. Os resultados (stdout) não dependem do número de
+ * threads; o tempo e a distribuição de tarefas entre as threads vão para a stderr.
+ * @param config Parâmetros da simulação.
+ * @return int 0 em caso de sucesso, 1 em caso de erro.
+ */
+int executar_simulacao(const ConfigSimulacao *config) {
+    Simulador simulador;
+    EstatisticasSimulacao total;
+    struct timespec t_inicio, t_fim;
+    int num_threads = config->num_threads;
+    int i, criadas;
+
+    if (config->num_sessoes <= 0 || config->acoes_por_sessao < 0 ||
+        num_threads <= 0 || num_threads > MAX_THREADS_SIMULACAO) {
+        fprintf(stderr, "ERRO: Parametros de simulacao invalidos.\n");
+        return 1;
+    }
+
+    memset(&simulador, 0, sizeof(simulador));
+    if (!simulador_preparar_pesos(&simulador, config)) return 1;
+    simulador.num_tarefas = (config->num_sessoes + SESSOES_POR_TAREFA - 1) / SESSOES_POR_TAREFA;
+    simulador.trabalhadores = aligned_alloc(LINHA_CACHE, num_threads * sizeof(TrabalhadorSimulacao));
+    if (simulador.trabalhadores == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para o simulador.\n");
+        return 1;
+    }
+
+    // Divide as tarefas em blocos contíguos, um por thread; o roubo equilibra o resto
+    for (i = 0; i < num_threads; i++) {
+        TrabalhadorSimulacao *t = &simulador.trabalhadores[i];
+        uint64_t inicio = (uint64_t)simulador.num_tarefas * i / num_threads;
+        uint64_t fim = (uint64_t)simulador.num_tarefas * (i + 1) / num_threads;
+        memset(t, 0, sizeof(*t));
+        atomic_init(&t->intervalo, (inicio << 32) | fim);
+        t->indice = i;
+        t->simulador = &simulador;
+    }
+
+    modo_silencioso = 1;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+
+    for (criadas = 0; criadas < num_threads; criadas++) {
+        if (pthread_create(&simulador.trabalhadores[criadas].thread, NULL, trabalhador_simulacao,
+                           &simulador.trabalhadores[criadas]) != 0) {
+            break; // As threads já criadas roubam o trabalho das que faltaram
+        }
+    }
+    if (criadas == 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel criar as threads do simulador.\n");
+        free(simulador.trabalhadores);
+        modo_silencioso = 0;
+        return 1;
+    }
+    for (i = 0; i < criadas; i++) {
+        pthread_join(simulador.trabalhadores[i].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+    modo_silencioso = 0;
+
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < num_threads; i++) {
+        somar_estatisticas(&total, &simulador.trabalhadores[i].estatisticas);
+    }
+
+    imprimir_resumo_simulacao(config, &total);
+
+    {
+        double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        long long acoes = total.sessoes * config->acoes_por_sessao;
+        fprintf(stderr, "Tempo: %.3f s com %d threads (%.1f milhoes de acoes/s)\n",
+                segundos, criadas, segundos > 0 ? acoes / segundos / 1e6 : 0.0);
+#if ESTADO_COMPACTO_DISPONIVEL
+        if (config->compacto) {
+            fprintf(stderr, "Estado compacto: %zu bytes por sessao (contra %zu); %lld sessoes voltaram a forma completa\n",
+                    sizeof(EstadoCompacto), sizeof(FilaCircular) + sizeof(Pilha), total.descompactadas);
+        }
+#endif
+        for (i = 0; i < criadas; i++) {
+            fprintf(stderr, "  Thread %d: %lld tarefas (%lld roubadas), %lld sessoes\n", i,
+                    simulador.trabalhadores[i].tarefas_executadas, simulador.trabalhadores[i].tarefas_roubadas,
+                    simulador.trabalhadores[i].estatisticas.sessoes);
+        }
+    }
+
+    free(simulador.trabalhadores);
+    return 0;
+}
+
+// --- Sessões em Corrotinas (Agendador com Espera por Entrada) ---
+//
+// O fluxo de uma sessão interativa (mostra o estado, espera a opção, executa, repete) é
+// um laço bloqueante em main(). Para hospedar milhares dessas sessões em poucas threads
+// sem reescrever o fluxo como máquina de estados, cada sessão roda como uma corrotina
+// (ucontext) com pilha própria: corrotina_aguardar_comando() suspende a sessão enquanto a
+// caixa de entrada está vazia, e o agendador a retoma quando chega um comando.
+//  - Cada thread do pool tem sua fila de sessões prontas e suas próprias sessões. Uma
+//    corrotina nunca muda de thread: os ganchos _Thread_local (gerador_ativo etc.) que ela
+//    usa continuam sendo os da thread em que foi criada.
+//  - A caixa de entrada é um anel SPSC (quem envia -> a corrotina). Quem envia só põe a
+//    sessão na fila de prontas se ela ainda não está lá (na_fila), então um comando nunca
+//    é perdido e uma sessão nunca entra duas vezes na fila.
+//  - Justiça: uma sessão com muitos comandos pendentes executa no máximo
+//    QUANTUM_CORROTINA deles e volta para o fim da fila de prontas.
+//  - A latência de cada comando (chegada na caixa -> início da execução) vai para um
+//    histograma por thread; a média por sessão mede a justiça (índice de Jain).
+// As pilhas de uma thread ficam em uma única região com MAP_NORESERVE: só as páginas que
+// a corrotina realmente tocou ocupam memória.
+
+// Pilha de cada corrotina (reservada; a memória ocupada é só a das páginas tocadas)
+#ifndef TAMANHO_PILHA_CORROTINA
+#define TAMANHO_PILHA_CORROTINA (32 * 1024)
+#endif
+// Comandos em espera na caixa de entrada de uma sessão (potência de 2)
+#define CAPACIDADE_CAIXA_CORROTINA 16
+// Comandos seguidos de uma sessão antes de ceder a vez às outras prontas
+#define QUANTUM_CORROTINA 8
+// Baldes do histograma de latência: 4 por potência de 2 de nanossegundos
+#define NUM_BALDES_CORROTINA 160
+
+/**
+ * @brief Estados de uma corrotina, vistos pelo agendador depois de cada troca.
+ */
+typedef enum {
+    CORROTINA_PRONTA,     // Cedeu a vez com comandos pendentes: volta para a fila
+    CORROTINA_SUSPENSA,   // Esperando comando (quem enviar o próximo a põe na fila)
+    CORROTINA_TERMINADA   // Recebeu 0: o fluxo da sessão acabou
+} EstadoCorrotina;
+
+struct AgendadorCorrotinas;
+
+/**
+ * @brief Uma sessão interativa executada como corrotina.
+ */
+typedef struct SessaoCorrotina {
+    ucontext_t contexto;
+    struct AgendadorCorrotinas *agendador;  // Thread dona (nunca muda)
+    struct SessaoCorrotina *proxima;        // Fila de prontas
+    EstadoCorrotina estado;
+    int indice;
+
+    // Caixa de entrada: escrita por quem envia, lida pela corrotina
+    _Atomic uint32_t escritos;
+    _Atomic uint32_t lidos;
+    _Atomic int na_fila;                    // 1: na fila de prontas ou executando
+    int8_t comandos[CAPACIDADE_CAIXA_CORROTINA];
+    uint64_t chegada[CAPACIDADE_CAIXA_CORROTINA]; // Instante de chegada de cada comando (ns)
+    int seguidos;                           // Comandos executados desde a última retomada
+
+    // A sessão de jogo
+    FilaCircular fila;
+    Pilha pilha;
+    GeradorPecas gerador;
+    BufferSaida saida;                      // Estado e menu desenhados (com 'verboso')
+
+    // Justiça
+    long long atendidos;
+    uint64_t espera_total;                  // Soma das latências dos comandos (ns)
+} SessaoCorrotina;
+
+/**
+ * @brief Uma thread do pool, com suas sessões e sua fila de prontas.
+ */
+typedef struct AgendadorCorrotinas {
+    pthread_t thread;
+    ucontext_t contexto;                    // Laço do agendador (para onde as corrotinas voltam)
+    pthread_mutex_t trava;                  // Protege a fila de prontas
+    pthread_cond_t sinal;
+    SessaoCorrotina *primeira, *ultima;     // Fila de prontas
+    SessaoCorrotina *sessoes;
+    int num_sessoes;
+    int vivas;                              // Sessões que ainda não terminaram
+    unsigned char *pilhas;                  // Região com as pilhas das sessões
+    size_t tamanho_pilhas;
+    struct PoolCorrotinas *pool;
+
+    // Estatísticas
+    EstatisticasSimulacao estatisticas;
+    long long trocas;                       // Trocas de contexto (entrada + saída)
+    long long cessoes;                      // Vezes em que o quantum acabou
+    long long latencia[NUM_BALDES_CORROTINA];
+    uint64_t latencia_max;
+} AgendadorCorrotinas;
+
+/**
+ * @brief O pool de threads e as sessões de uma simulação em corrotinas.
+ */
+typedef struct PoolCorrotinas {
+    Simulador simulador;                    // Configuração e pesos da política
+    AgendadorCorrotinas *agendadores;
+    int num_agendadores;
+    int verboso;                            // Desenha estado e menu antes de cada espera
+} PoolCorrotinas;
+
+// Sessão em execução na thread atual (lida pela função de entrada da corrotina)
+_Thread_local SessaoCorrotina *corrotina_ativa = NULL;
+
+/**
+ * @brief Balde do histograma para uma latência em ns: 4 baldes por potência de 2.
+ */
+int corrotina_balde(uint64_t ns) {
+    int b;
+    if (ns < 4) return (int)ns;
+    b = 63 - __builtin_clzll(ns);
+    b = 4 * (b - 1) + (int)((ns >> (b - 2)) & 3);
+    return b < NUM_BALDES_CORROTINA ? b : NUM_BALDES_CORROTINA - 1;
+}
+
+/**
+ * @brief Menor latência (ns) que cai no balde b (inverso de corrotina_balde).
+ */
+uint64_t corrotina_limite_balde(int b) {
+    if (b < 4) return (uint64_t)b;
+    return (uint64_t)(4 + (b & 3)) << (b / 4 - 1);
+}
+
+/**
+ * @brief Põe uma sessão no fim da fila de prontas da sua thread e acorda a thread.
+ */
+void agendador_enfileirar(AgendadorCorrotinas *a, SessaoCorrotina *s) {
+    pthread_mutex_lock(&a->trava);
+    s->proxima = NULL;
+    if (a->ultima != NULL) a->ultima->proxima = s;
+    else a->primeira = s;
+    a->ultima = s;
+    pthread_cond_signal(&a->sinal);
+    pthread_mutex_unlock(&a->trava);
+}
+
+/**
+ * @brief Entrega um comando a uma sessão, de qualquer thread (um único remetente por sessão).
+ * @return int 1 se o comando foi entregue, 0 se a caixa de entrada está cheia.
+ */
+int corrotina_enviar(SessaoCorrotina *s, int8_t opcao) {
+    uint32_t escritos = atomic_load_explicit(&s->escritos, memory_order_relaxed);
+    if (escritos - atomic_load_explicit(&s->lidos, memory_order_acquire) == CAPACIDADE_CAIXA_CORROTINA) return 0;
+    s->comandos[escritos % CAPACIDADE_CAIXA_CORROTINA] = opcao;
+    s->chegada[escritos % CAPACIDADE_CAIXA_CORROTINA] = ler_ns();
+    // seq_cst com a leitura de na_fila: ou a corrotina vê o comando antes de suspender,
+    // ou este lado vê na_fila = 0 e a põe na fila (ver corrotina_aguardar_comando)
+    atomic_store(&s->escritos, escritos + 1);
+    if (!atomic_load(&s->na_fila) && !atomic_exchange(&s->na_fila, 1)) {
+        agendador_enfileirar(s->agendador, s);
+    }
+    return 1;
+}
+
+/**
+ * @brief Volta para o agendador e, na retomada, restaura os ganchos da sessão.
+ */
+void corrotina_trocar(SessaoCorrotina *s, EstadoCorrotina estado) {
+    s->estado = estado;
+    swapcontext(&s->contexto, &s->agendador->contexto);
+    gerador_ativo = &s->gerador;
+    saida_mensagens = &s->saida;
+    s->seguidos = 0;
+}
+
+/**
+ * @brief Espera o próximo comando da sessão, suspendendo a corrotina se não houver nenhum.
+ * Depois de QUANTUM_CORROTINA comandos seguidos, cede a vez antes de continuar.
+ * @return int O código do comando.
+ */
+int corrotina_aguardar_comando(SessaoCorrotina *s) {
+    AgendadorCorrotinas *a = s->agendador;
+    uint32_t lidos = atomic_load_explicit(&s->lidos, memory_order_relaxed);
+    uint64_t espera;
+    int opcao, balde;
+
+    for (;;) {
+        if (atomic_load_explicit(&s->escritos, memory_order_acquire) != lidos) {
+            if (s->seguidos < QUANTUM_CORROTINA) break;
+            a->cessoes++;
+            corrotina_trocar(s, CORROTINA_PRONTA);
+            continue;
+        }
+        // Caixa vazia: sai da fila e confere de novo, porque um comando pode ter chegado
+        // entre as duas leituras (e quem o enviou viu na_fila = 1 e não enfileirou)
+        atomic_store(&s->na_fila, 0);
+        if (atomic_load(&s->escritos) != lidos && !atomic_exchange(&s->na_fila, 1)) continue;
+        corrotina_trocar(s, CORROTINA_SUSPENSA);
+    }
+
+    opcao = s->comandos[lidos % CAPACIDADE_CAIXA_CORROTINA];
+    espera = ler_ns() - s->chegada[lidos % CAPACIDADE_CAIXA_CORROTINA];
+    atomic_store_explicit(&s->lidos, lidos + 1, memory_order_release);
+    s->seguidos++;
+    s->atendidos++;
+    s->espera_total += espera;
+    balde = corrotina_balde(espera);
+    a->latencia[balde]++;
+    if (espera > a->latencia_max) a->latencia_max = espera;
+    return opcao;
+}
+
+/**
+ * @brief O fluxo de uma sessão, escrito como o laço do jogo interativo: mostra o estado,
+ * espera a opção, executa e repete até a opção 0.
+ */
+void corrotina_sessao() {
+    SessaoCorrotina *s = corrotina_ativa;
+    AgendadorCorrotinas *a = s->agendador;
+    EstatisticasSimulacao *est = &a->estatisticas;
+    int opcao = -1;
+
+    gerador_ativo = &s->gerador;
+    saida_mensagens = &s->saida;
+    inicializar_fila(&s->fila);
+    inicializar_pilha(&s->pilha);
+    preencher_fila_inicial(&s->fila);
+
+    while (opcao != 0) {
+        ResultadoAcao resultado;
+
+        // 1. Exibe o estado atual e o menu (no buffer da sessão)
+        if (a->pool->verboso) {
+            buffer_limpar(&s->saida);
+            formatar_estado_atual(&s->saida, &s->fila, &s->pilha);
+            formatar_menu(&s->saida);
+        }
+
+        // 2. Espera a opção (a corrotina fica suspensa até ela chegar)
+        opcao = corrotina_aguardar_comando(s);
+
+        // 3. Processa a opção escolhida
+        resultado = executar_opcao(&s->fila, &s->pilha, opcao);
+        if (opcao >= 1 && opcao <= 5) {
+            est->acoes[opcao]++;
+            if (resultado == ACAO_REJEITADA) est->rejeitadas[opcao]++;
+            if (resultado == ACAO_DESCARTADA) est->descartes++;
+        }
+    }
+
+    est->sessoes++;
+    est->pecas_geradas += s->gerador.proximo_id;
+    est->hash += hash_estado(&s->fila, &s->pilha) * (2 * (uint64_t)s->indice + 1);
+    s->estado = CORROTINA_TERMINADA; // Ao retornar, uc_link volta para o agendador
+}
+
+/**
+ * @brief Laço de uma thread do pool: retoma as sessões prontas, uma por vez, até todas terminarem.
+ */
+void *agendador_corrotinas(void *arg) {
+    AgendadorCorrotinas *a = arg;
+
+    for (;;) {
+        SessaoCorrotina *s;
+
+        pthread_mutex_lock(&a->trava);
+        while (a->primeira == NULL && a->vivas > 0) pthread_cond_wait(&a->sinal, &a->trava);
+        s = a->primeira;
+        if (s != NULL) {
+            a->primeira = s->proxima;
+            if (a->primeira == NULL) a->ultima = NULL;
+        }
+        pthread_mutex_unlock(&a->trava);
+        if (s == NULL) break;
+
+        corrotina_ativa = s;
+        swapcontext(&a->contexto, &s->contexto);
+        a->trocas += 2;
+
+        if (s->estado == CORROTINA_PRONTA) {
+            agendador_enfileirar(a, s);
+        } else if (s->estado == CORROTINA_TERMINADA) {
+            buffer_liberar(&s->saida);
+            a->vivas--;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Cria as sessões da thread 'k' (sessões k, k + T, k + 2T, ...) e suas corrotinas.
+ * Todas começam na fila de prontas, para montar a fila inicial e esperar o primeiro comando.
+ * @return int 1 em caso de sucesso, 0 em caso de erro.
+ */
+int agendador_criar(PoolCorrotinas *pool, int k) {
+    const ConfigSimulacao *config = pool->simulador.config;
+    AgendadorCorrotinas *a = &pool->agendadores[k];
+    int j;
+
+    memset(a, 0, sizeof(*a));
+    a->pool = pool;
+    a->num_sessoes = (config->num_sessoes - k + pool->num_agendadores - 1) / pool->num_agendadores;
+    a->vivas = a->num_sessoes;
+    pthread_mutex_init(&a->trava, NULL);
+    pthread_cond_init(&a->sinal, NULL);
+    if (a->num_sessoes == 0) return 1;
+
+    a->sessoes = aligned_alloc(LINHA_CACHE, ((a->num_sessoes * sizeof(SessaoCorrotina) + LINHA_CACHE - 1) /
+                                             LINHA_CACHE) * LINHA_CACHE);
+    a->tamanho_pilhas = (size_t)a->num_sessoes * TAMANHO_PILHA_CORROTINA;
+    a->pilhas = mmap(NULL, a->tamanho_pilhas, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (a->sessoes == NULL || a->pilhas == MAP_FAILED) {
+        free(a->sessoes);
+        a->sessoes = NULL;
+        if (a->pilhas != MAP_FAILED) munmap(a->pilhas, a->tamanho_pilhas);
+        a->pilhas = NULL;
+        return 0;
+    }
+
+    memset(a->sessoes, 0, a->num_sessoes * sizeof(SessaoCorrotina));
+    for (j = 0; j < a->num_sessoes; j++) {
+        SessaoCorrotina *s = &a->sessoes[j];
+        s->agendador = a;
+        s->indice = k + j * pool->num_agendadores;
+        gerador_inicializar(&s->gerador, config->semente, 2 * (uint64_t)s->indice + 2, config->modo);
+        getcontext(&s->contexto);
+        s->contexto.uc_stack.ss_sp = a->pilhas + (size_t)j * TAMANHO_PILHA_CORROTINA;
+        s->contexto.uc_stack.ss_size = TAMANHO_PILHA_CORROTINA;
+        s->contexto.uc_link = &a->contexto;
+        makecontext(&s->contexto, corrotina_sessao, 0);
+        atomic_init(&s->na_fila, 1);
+        s->proxima = NULL;
+        if (a->ultima != NULL) a->ultima->proxima = s;
+        else a->primeira = s;
+        a->ultima = s;
+    }
+    return 1;
+}
+
+/**
+ * @brief Libera as sessões e as pilhas de uma thread.
+ */
+void agendador_liberar(AgendadorCorrotinas *a) {
+    int j;
+    for (j = 0; a->sessoes != NULL && j < a->num_sessoes; j++) buffer_liberar(&a->sessoes[j].saida);
+    free(a->sessoes);
+    if (a->pilhas != NULL) munmap(a->pilhas, a->tamanho_pilhas);
+    pthread_mutex_destroy(&a->trava);
+    pthread_cond_destroy(&a->sinal);
+}
+
+/**
+ * @brief Bytes das pilhas das corrotinas que estão de fato na memória (páginas tocadas).
+ */
+size_t agendador_bytes_pilha_residentes(const AgendadorCorrotinas *a) {
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t paginas = (a->tamanho_pilhas + pagina - 1) / pagina;
+    unsigned char *residentes;
+    size_t p, total = 0;
+
+    if (a->pilhas == NULL) return 0;
+    residentes = malloc(paginas);
+    if (residentes == NULL) return 0;
+    if (mincore(a->pilhas, a->tamanho_pilhas, residentes) == 0) {
+        for (p = 0; p < paginas; p++) total += (residentes[p] & 1);
+    }
+    free(residentes);
+    return total * pagina;
+}
+
+/**
+ * @brief Cria o pool de corrotinas e inicia as threads (as sessões ficam esperando o
+ * primeiro comando).
+ * @return int 1 em caso de sucesso, 0 em caso de erro.
+ */
+int pool_corrotinas_iniciar(PoolCorrotinas *pool, const ConfigSimulacao *config, int verboso) {
+    int k;
+
+    memset(pool, 0, sizeof(*pool));
+    if (!simulador_preparar_pesos(&pool->simulador, config)) return 0;
+    pool->verboso = verboso;
+    pool->num_agendadores = config->num_threads < config->num_sessoes ? config->num_threads : config->num_sessoes;
+    pool->agendadores = aligned_alloc(LINHA_CACHE, pool->num_agendadores * sizeof(AgendadorCorrotinas));
+    if (pool->agendadores == NULL) return 0;
+    for (k = 0; k < pool->num_agendadores; k++) {
+        if (!agendador_criar(pool, k)) {
+            while (k >= 0) agendador_liberar(&pool->agendadores[k--]);
+            free(pool->agendadores);
+            return 0;
+        }
+    }
+    for (k = 0; k < pool->num_agendadores; k++) {
+        if (pthread_create(&pool->agendadores[k].thread, NULL, agendador_corrotinas, &pool->agendadores[k]) != 0) {
+            // As sessões de uma thread que faltou nunca rodariam: encerra as threads já
+            // criadas (opção 0 para todas as sessões delas) e desiste
+            int j, i;
+            for (j = 0; j < k; j++) {
+                AgendadorCorrotinas *a = &pool->agendadores[j];
+                for (i = 0; i < a->num_sessoes; i++) {
+                    while (!corrotina_enviar(&a->sessoes[i], 0)) sched_yield();
+                }
+                pthread_join(a->thread, NULL);
+            }
+            for (j = 0; j < pool->num_agendadores; j++) agendador_liberar(&pool->agendadores[j]);
+            free(pool->agendadores);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Sessão de índice i do pool (as sessões são distribuídas em rodízio entre as threads).
+ */
+SessaoCorrotina *pool_corrotinas_sessao(PoolCorrotinas *pool, int i) {
+    return &pool->agendadores[i % pool->num_agendadores].sessoes[i / pool->num_agendadores];
+}
+
+/**
+ * @brief Envia um comando a uma sessão, esperando se a caixa de entrada dela estiver cheia.
+ */
+void pool_corrotinas_enviar(PoolCorrotinas *pool, int i, int8_t opcao) {
+    SessaoCorrotina *s = pool_corrotinas_sessao(pool, i);
+    while (!corrotina_enviar(s, opcao)) sched_yield();
+}
+
+/**
+ * @brief Espera todas as sessões terminarem, soma as estatísticas e libera o pool.
+ * @param total Recebe as estatísticas somadas (como as do simulador).
+ * @param saida Onde imprimir as estatísticas do agendador (NULL = não imprime).
+ */
+void pool_corrotinas_encerrar(PoolCorrotinas *pool, EstatisticasSimulacao *total, FILE *saida) {
+    long long latencia[NUM_BALDES_CORROTINA] = {0};
+    long long trocas = 0, cessoes = 0, comandos = 0;
+    uint64_t latencia_max = 0;
+    size_t pilha_residente = 0;
+    double soma_medias = 0.0, soma_quadrados = 0.0, pior_media = 0.0;
+    int k, j, b;
+
+    memset(total, 0, sizeof(*total));
+    for (k = 0; k < pool->num_agendadores; k++) {
+        AgendadorCorrotinas *a = &pool->agendadores[k];
+        pthread_join(a->thread, NULL);
+        somar_estatisticas(total, &a->estatisticas);
+        trocas += a->trocas;
+        cessoes += a->cessoes;
+        if (a->latencia_max > latencia_max) latencia_max = a->latencia_max;
+        for (b = 0; b < NUM_BALDES_CORROTINA; b++) latencia[b] += a->latencia[b];
+        pilha_residente += agendador_bytes_pilha_residentes(a);
+        for (j = 0; j < a->num_sessoes; j++) {
+            const SessaoCorrotina *s = &a->sessoes[j];
+            double media = s->atendidos ? (double)s->espera_total / s->atendidos : 0.0;
+            comandos += s->atendidos;
+            soma_medias += media;
+            soma_quadrados += media * media;
+            if (media > pior_media) pior_media = media;
+        }
+    }
+
+    if (saida != NULL && comandos > 0) {
+        long long acumulado = 0;
+        uint64_t p50 = 0, p99 = 0;
+        int n = pool->simulador.config->num_sessoes;
+        for (b = 0; b < NUM_BALDES_CORROTINA; b++) {
+            acumulado += latencia[b];
+            if (p50 == 0 && acumulado * 2 >= comandos) p50 = corrotina_limite_balde(b + 1);
+            if (p99 == 0 && acumulado * 100 >= comandos * 99) p99 = corrotina_limite_balde(b + 1);
+        }
+        fprintf(saida, "Corrotinas: %d threads, %lld trocas de contexto (%.2f por comando), %lld cessoes de quantum\n",
+                pool->num_agendadores, trocas, (double)trocas / comandos, cessoes);
+        fprintf(saida, "Latencia do comando (chegada -> execucao): p50 < %.1f us | p99 < %.1f us | max %.1f us\n",
+                p50 / 1e3, p99 / 1e3, latencia_max / 1e3);
+        fprintf(saida, "Justica: indice de Jain das esperas medias por sessao %.3f (pior sessao %.1f us, media %.1f us)\n",
+                soma_quadrados > 0 ? soma_medias * soma_medias / (n * soma_quadrados) : 1.0, pior_media / 1e3,
+                soma_medias / n / 1e3);
+        fprintf(saida, "Memoria por sessao suspensa: %zu bytes de registro + %.0f bytes de pilha tocada "
+                       "(de %d reservados)\n", sizeof(SessaoCorrotina), (double)pilha_residente / n,
+                TAMANHO_PILHA_CORROTINA);
+    }
+
+    for (k = 0; k < pool->num_agendadores; k++) agendador_liberar(&pool->agendadores[k]);
+    free(pool->agendadores);
+}
+
+/**
+ * @brief Simulação com as sessões em corrotinas: a thread principal envia as ações
+ * sorteadas (as mesmas de executar_simulacao) rodada a rodada, uma ação para cada sessão,
+ * e termina cada sessão com a opção 0. O resumo (stdout) é igual ao de executar_simulacao;
+ * as estatísticas do agendador vão para a stderr.
+ * @param config Parâmetros da simulação (num_threads = threads do agendador).
+ * @param verboso 1 para desenhar estado e menu no buffer da sessão antes de cada espera.
+ * @return int 0 em caso de sucesso, 1 em caso de erro.
+ */
+int executar_simulacao_corrotinas(const ConfigSimulacao *config, int verboso) {
+    PoolCorrotinas pool;
+    GeradorPecas *politicas;
+    EstatisticasSimulacao total;
+    struct timespec t_inicio, t_fim;
+    long long rodada;
+    int i;
+
+    if (config->num_sessoes <= 0 || config->acoes_por_sessao < 0 || config->num_threads <= 0 ||
+        config->num_threads > MAX_THREADS_SIMULACAO) {
+        fprintf(stderr, "ERRO: Parametros de simulacao invalidos.\n");
+        return 1;
+    }
+    politicas = malloc(config->num_sessoes * sizeof(GeradorPecas));
+    if (politicas == NULL) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para as sessoes.\n");
+        return 1;
+    }
+    for (i = 0; i < config->num_sessoes; i++) {
+        gerador_inicializar(&politicas[i], config->semente, 2 * (uint64_t)i + 3, GERADOR_UNIFORME);
+    }
+
+    // Desligado aqui, antes das threads do agendador existirem, e religado depois que
+    // todas terminaram: modo_silencioso é global, e as threads só o leem
+    modo_silencioso = 1;
+    clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+    if (!pool_corrotinas_iniciar(&pool, config, verboso)) {
+        fprintf(stderr, "ERRO: Nao foi possivel criar as sessoes ou as threads do agendador.\n");
+        free(politicas);
+        modo_silencioso = 0;
+        return 1;
+    }
+    for (rodada = 0; rodada <= config->acoes_por_sessao; rodada++) {
+        for (i = 0; i < config->num_sessoes; i++) {
+            int opcao = rodada < config->acoes_por_sessao ? sortear_opcao(&pool.simulador, &politicas[i]) : 0;
+            pool_corrotinas_enviar(&pool, i, (int8_t)opcao);
+        }
+    }
+    pool_corrotinas_encerrar(&pool, &total, stderr);
+    clock_gettime(CLOCK_MONOTONIC, &t_fim);
+    modo_silencioso = 0;
+
+    imprimir_resumo_simulacao(config, &total);
+    {
+        double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+        long long acoes = total.sessoes * config->acoes_por_sessao;
+        fprintf(stderr, "Tempo: %.3f s com %d threads de corrotinas (%.1f milhoes de acoes/s)\n",
+                segundos, pool.num_agendadores, segundos > 0 ? acoes / segundos / 1e6 : 0.0);
+    }
+    free(politicas);
+    return 0;
+}
+
+// --- Arena de Sessões (Slab com Handles) ---
+//
+// Registros de sessão de tamanho fixo (as conexões do servidor) vêm de blocos grandes,
+// alocados uma vez e nunca devolvidos enquanto a arena existe: criar e destruir uma
+// sessão é tirar ou devolver um slot de uma lista livre (O(1), sem malloc/free), e a
+// memória fica estável mesmo com muitas conexões entrando e saindo.
+//
+// Cada slot ocupa um múltiplo de LINHA_CACHE bytes e começa em uma linha de cache, então
+// duas sessões nunca dividem uma linha. O slot tem uma geração: ímpar enquanto está em
+// uso, par quando livre. O handle de uma sessão é (geração << 32) | índice; depois que o
+// slot é liberado (ou reutilizado), o handle antigo não confere mais com a geração e
+// arena_obter devolve NULL em vez de outra sessão. A geração 0 nunca está em uso, então
+// os handles 0 e 1 (índices 0 e 1 na geração 0) servem como marcadores.
+
+// Slots criados de uma vez em cada bloco (potência de 2)
+#define SLOTS_POR_BLOCO_ARENA 256
+// Marca o fim da lista livre
+#define SEM_SLOT_ARENA UINT32_MAX
+
+typedef uint64_t HandleSessao;
+
+// Handle que nunca pertence a uma sessão
+#define HANDLE_NULO ((HandleSessao)0)
+
+/**
+ * @brief Contadores de uma arena.
+ */
+typedef struct {
+    long long alocacoes;          // Slots entregues
+    long long liberacoes;         // Slots devolvidos
+    long long reutilizacoes;      // Alocações em slots que já tinham sido usados
+    long long handles_invalidos;  // Handles antigos ou desconhecidos recusados
+    long long resets;             // Chamadas a arena_resetar
+    uint32_t em_uso;              // Slots em uso agora
+    uint32_t pico;                // Máximo de slots em uso ao mesmo tempo
+    uint32_t slots;               // Slots criados (blocos * SLOTS_POR_BLOCO_ARENA)
+    uint32_t blocos;
+    size_t bytes_reservados;      // Memória dos blocos e das gerações
+} EstatisticasArena;
+
+/**
+ * @brief Arena de registros de tamanho fixo com lista livre e handles com geração.
+ * Não é thread-safe: cada laço do servidor tem a sua.
+ */
+typedef struct {
+    size_t tamanho_slot;          // Tamanho do registro arredondado para LINHA_CACHE
+    unsigned char **blocos;       // Blocos de SLOTS_POR_BLOCO_ARENA slots alinhados
+    uint32_t *geracoes;           // Geração de cada slot (ímpar = em uso)
+    uint32_t capacidade_blocos;   // Entradas alocadas em 'blocos'
+    uint32_t livre;               // Primeiro slot da lista livre (o índice do próximo fica no slot)
+    uint32_t novos;               // Slots [novos, slots) nunca entregues desde a criação ou o reset
+    EstatisticasArena estatisticas;
+} ArenaSessoes;
+
+/**
+ * @brief Cria uma arena vazia (os blocos são criados sob demanda).
+ * @param arena Ponteiro para a arena.
+ * @param tamanho_registro Tamanho de cada registro em bytes.
+ */
+void arena_criar(ArenaSessoes *arena, size_t tamanho_registro) {
+    memset(arena, 0, sizeof(*arena));
+    if (tamanho_registro < sizeof(uint32_t)) tamanho_registro = sizeof(uint32_t);
+    arena->tamanho_slot = (tamanho_registro + LINHA_CACHE - 1) & ~(size_t)(LINHA_CACHE - 1);
+    arena->livre = SEM_SLOT_ARENA;
+}
+
+/**
+ * @brief Libera todos os blocos; handles e ponteiros da arena deixam de valer.
+ */
+void arena_destruir(ArenaSessoes *arena) {
+    uint32_t b;
+    for (b = 0; b < arena->estatisticas.blocos; b++) {
+        free(arena->blocos[b]);
+    }
+    free(arena->blocos);
+    free(arena->geracoes);
+    arena->blocos = NULL;
+    arena->geracoes = NULL;
+    arena->capacidade_blocos = 0;
+    arena->livre = SEM_SLOT_ARENA;
+    arena->novos = 0;
+    memset(&arena->estatisticas, 0, sizeof(arena->estatisticas));
+}
+
+/**
+ * @brief Endereço do slot de um índice.
+ */
+void *arena_slot(const ArenaSessoes *arena, uint32_t indice) {
+    return arena->blocos[indice / SLOTS_POR_BLOCO_ARENA] +
+           (size_t)(indice & (SLOTS_POR_BLOCO_ARENA - 1)) * arena->tamanho_slot;
+}
+
+/**
+ * @brief Cria um bloco novo; os seus slots passam a ser entregues em ordem por arena_alocar.
+ * @return int 1 em caso de sucesso, 0 se faltou memória.
+ */
+int arena_crescer(ArenaSessoes *arena) {
+    EstatisticasArena *e = &arena->estatisticas;
+    uint32_t primeiro = e->slots;
+    unsigned char *bloco;
+    uint32_t *geracoes;
+
+    if ((uint64_t)primeiro + SLOTS_POR_BLOCO_ARENA >= SEM_SLOT_ARENA) return 0;
+    // Os vetores de blocos e de gerações crescem dobrando, junto com a capacidade
+    if (e->blocos == arena->capacidade_blocos) {
+        uint32_t nova = arena->capacidade_blocos ? 2 * arena->capacidade_blocos : 8;
+        unsigned char **blocos = realloc(arena->blocos, nova * sizeof(unsigned char *));
+        if (blocos == NULL) return 0;
+        arena->blocos = blocos;
+        geracoes = realloc(arena->geracoes, (size_t)nova * SLOTS_POR_BLOCO_ARENA * sizeof(uint32_t));
+        if (geracoes == NULL) return 0;
+        arena->geracoes = geracoes;
+        e->bytes_reservados += (size_t)(nova - arena->capacidade_blocos) * SLOTS_POR_BLOCO_ARENA * sizeof(uint32_t);
+        arena->capacidade_blocos = nova;
+    }
+    bloco = aligned_alloc(LINHA_CACHE, SLOTS_POR_BLOCO_ARENA * arena->tamanho_slot);
+    if (bloco == NULL) return 0;
+
+    arena->blocos[e->blocos++] = bloco;
+    memset(arena->geracoes + primeiro, 0, SLOTS_POR_BLOCO_ARENA * sizeof(uint32_t));
+    e->slots += SLOTS_POR_BLOCO_ARENA;
+    e->bytes_reservados += SLOTS_POR_BLOCO_ARENA * arena->tamanho_slot;
+    return 1;
+}
+
+/**
+ * @brief Tira um slot da lista livre; com ela vazia, entrega o próximo slot ainda não
+ * usado (criando um bloco se preciso). O conteúdo do slot não é inicializado.
+ * @param arena Ponteiro para a arena.
+ * @param registro Recebe o endereço do slot.
+ * @return HandleSessao O handle do slot, ou HANDLE_NULO se faltou memória.
+ */
+HandleSessao arena_alocar(ArenaSessoes *arena, void **registro) {
+    EstatisticasArena *e = &arena->estatisticas;
+    uint32_t indice;
+    void *slot;
+
+    if (arena->livre != SEM_SLOT_ARENA) {
+        indice = arena->livre;
+        slot = arena_slot(arena, indice);
+        arena->livre = *(uint32_t *)slot;
+    } else {
+        if (arena->novos == e->slots && !arena_crescer(arena)) return HANDLE_NULO;
+        indice = arena->novos++;
+        slot = arena_slot(arena, indice);
+    }
+    if (arena->geracoes[indice] != 0) e->reutilizacoes++;
+    arena->geracoes[indice]++; // Par -> ímpar: em uso
+
+    e->alocacoes++;
+    if (++e->em_uso > e->pico) e->pico = e->em_uso;
+    *registro = slot;
+    return ((HandleSessao)arena->geracoes[indice] << 32) | indice;
+}
+
+/**
+ * @brief Confere um handle e devolve o slot correspondente.
+ * @return void* O registro, ou NULL se o handle é de um slot já liberado ou não existe.
+ */
+void *arena_obter(ArenaSessoes *arena, HandleSessao handle) {
+    uint32_t indice = (uint32_t)handle;
+    uint32_t geracao = (uint32_t)(handle >> 32);
+
+    if (indice >= arena->estatisticas.slots || arena->geracoes[indice] != geracao || !(geracao & 1)) {
+        arena->estatisticas.handles_invalidos++;
+        return NULL;
+    }
+    return arena_slot(arena, indice);
+}
+
+/**
+ * @brief Devolve um slot à lista livre; o handle (e qualquer cópia dele) deixa de valer.
+ * @return int 1 em caso de sucesso, 0 se o handle já não valia (liberação dupla).
+ */
+int arena_liberar(ArenaSessoes *arena, HandleSessao handle) {
+    uint32_t indice = (uint32_t)handle;
+    void *slot = arena_obter(arena, handle);
+
+    if (slot == NULL) return 0;
+    arena->geracoes[indice]++; // Ímpar -> par: livre
+    *(uint32_t *)slot = arena->livre;
+    arena->livre = indice;
+    arena->estatisticas.liberacoes++;
+    arena->estatisticas.em_uso--;
+    return 1;
+}
+
+/**
+ * @brief Libera todas as sessões de uma vez, mantendo os blocos para reutilização.
+ * Só o vetor de gerações é percorrido (os slots não são tocados): a lista livre volta a
+ * ficar vazia e os slots voltam a ser entregues em ordem. Todos os handles entregues até
+ * aqui deixam de valer. Quem guarda recursos fora da arena em cada registro deve
+ * liberá-los antes.
+ */
+void arena_resetar(ArenaSessoes *arena) {
+    EstatisticasArena *e = &arena->estatisticas;
+    uint32_t k;
+
+    for (k = 0; k < arena->novos; k++) {
+        arena->geracoes[k] += arena->geracoes[k] & 1; // Só os slots em uso mudam de geração
+    }
+    arena->livre = SEM_SLOT_ARENA;
+    arena->novos = 0;
+    e->liberacoes += e->em_uso;
+    e->em_uso = 0;
+    e->resets++;
+}
+
+// --- Modo Servidor (Unix Domain Socket + epoll) ---
+//
+// Protocolo (uma linha por comando, como na entrada interativa):
+//   cliente -> servidor: o código da ação ("1\n" ... "5\n"; "0\n" encerra a sessão).
+//   servidor -> cliente: para cada linha lida, uma resposta que termina com a linha
+//   "= R\n", onde R é o ResultadoAcao (-1 inválida, 0 rejeitada, 1 realizada, 2 descartada).
+// Sem --quieto, antes dessa linha vêm as mensagens da ação, o estado e o menu, exatamente
+// como no jogo interativo (e a conexão começa com a fila inicial e o menu). Com --quieto,
+// a resposta é só a linha "= R\n".
+
+// Eventos tratados por chamada a epoll_wait
+#define MAX_EVENTOS_SERVIDOR 512
+// Bytes lidos de uma vez de um cliente
+#define TAMANHO_LEITURA_SERVIDOR 16384
+// Leituras seguidas de um mesmo cliente antes de atender os outros
+#define LEITURAS_POR_EVENTO 4
+// Limite de laços epoll (threads) do servidor
+#define MAX_LACOS_SERVIDOR 64
+// Dados dos eventos que não são de clientes (a geração 0 nunca está em uso na arena)
+#define EVENTO_ESCUTA HANDLE_NULO
+#define EVENTO_PARADA ((HandleSessao)1)
+
+struct LacoServidor;
+
+/**
+ * @brief Uma conexão: a sessão de jogo do cliente e o estado da sua conexão.
+ *
+ * Cada sessão tem fila, pilha, gerador e tabuleiro próprios. O gerador da k-ésima conexão usa
+ * o fluxo k da semente do servidor, então a primeira conexão recebe as mesmas peças
+ * que o jogo interativo com a mesma semente. O registro vem da arena do laço, e o epoll
+ * guarda o handle (não o ponteiro), então um evento de uma conexão já fechada é ignorado.
+ */
+typedef struct ClienteServidor {
+    HandleSessao handle;       // Handle do registro na arena do laço
+    int fd;
+    FilaCircular fila;
+    Pilha pilha;
+    GeradorPecas gerador;
+    Tabuleiro tabuleiro;       // Recebe as peças jogadas, como no jogo interativo
+    EstadoLeitor estado;       // Leitor da entrada (mesmas regras do replay)
+    int negativo;
+    int valor;
+    BufferSaida saida;         // Respostas ainda não enviadas
+    size_t enviados;           // Bytes de 'saida' já enviados
+    int encerrar;              // Recebeu 0 ou EOF: fecha depois de enviar a saída
+    int aguardando_escrita;    // Registrado para EPOLLOUT (socket cheio)
+    struct ClienteServidor *anterior, *proximo; // Lista de conexões do laço
+} ClienteServidor;
+
+/**
+ * @brief Estado compartilhado por todos os laços do servidor.
+ */
+typedef struct {
+    int fd_escuta;             // Socket de escuta (não bloqueante)
+    int fd_parada;             // eventfd sinalizado para encerrar todos os laços
+    int verboso;               // Envia mensagens, estado e menu nas respostas
+    uint64_t semente;
+    ModoGerador modo;
+    _Atomic uint64_t proximo_fluxo; // Fluxo do gerador da próxima conexão
+} Servidor;
+
+/**
+ * @brief Um laço de eventos (uma thread com seu próprio epoll).
+ * Cada conexão pertence ao laço que a aceitou, então nenhuma sessão é compartilhada.
+ */
+typedef struct LacoServidor {
+    Servidor *servidor;
+    int epoll_fd;
+    pthread_t thread;
+    ClienteServidor *clientes; // Conexões abertas neste laço
+    ArenaSessoes arena;        // Registros das conexões deste laço
+    long long conexoes;        // Conexões aceitas
+    long long acoes;           // Comandos respondidos
+    int ativos;                // Conexões abertas agora
+    int pico;                  // Máximo de conexões abertas ao mesmo tempo
+} LacoServidor;
+
+// Respostas do modo quieto, indexadas por ResultadoAcao + 1
+static const char *const RESPOSTAS_SERVIDOR[] = {"= -1\n", "= 0\n", "= 1\n", "= 2\n"};
+
+/**
+ * @brief Fecha uma conexão e libera a sua sessão.
+ */
+void servidor_fechar_cliente(LacoServidor *laco, ClienteServidor *c) {
+    close(c->fd); // Também remove o fd do epoll
+    if (c->anterior != NULL) c->anterior->proximo = c->proximo;
+    else laco->clientes = c->proximo;
+    if (c->proximo != NULL) c->proximo->anterior = c->anterior;
+    buffer_liberar(&c->saida);
+    arena_liberar(&laco->arena, c->handle);
+    laco->ativos--;
+}
+
+/**
+ * @brief Envia o que der da saída pendente, sem bloquear.
+ * Se o socket encher, troca o interesse para EPOLLOUT e para de ler o cliente até a
+ * saída esvaziar (assim um cliente que não lê as respostas não acumula memória).
+ * @return int 1 se a conexão continua aberta, 0 se foi fechada.
+ */
+int servidor_enviar(LacoServidor *laco, ClienteServidor *c) {
+    while (c->enviados < c->saida.tamanho) {
+        ssize_t n = write(c->fd, c->saida.dados + c->enviados, c->saida.tamanho - c->enviados);
+        if (n > 0) {
+            c->enviados += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c->aguardando_escrita) {
+                struct epoll_event ev = {EPOLLOUT, {.u64 = c->handle}};
+                epoll_ctl(laco->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+                c->aguardando_escrita = 1;
+            }
+            return 1;
+        } else {
+            servidor_fechar_cliente(laco, c);
+            return 0;
+        }
+    }
+
+    buffer_limpar(&c->saida);
+    c->enviados = 0;
+    if (c->encerrar) {
+        servidor_fechar_cliente(laco, c);
+        return 0;
+    }
+    if (c->aguardando_escrita) {
+        struct epoll_event ev = {EPOLLIN, {.u64 = c->handle}};
+        epoll_ctl(laco->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->aguardando_escrita = 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Executa um comando lido de um cliente e anexa a resposta à sua saída.
+ * @param opcao Código lido, ou ACAO_INVALIDA para uma linha que não começa com um número.
+ * @param numero 1 se a linha continha um número (opcao é válida como entrada).
+ */
+void servidor_executar(LacoServidor *laco, ClienteServidor *c, int opcao, int numero) {
+    ResultadoAcao resultado;
+
+    // As ações usam o gerador, o tabuleiro e o buffer de mensagens da sessão do cliente
+    gerador_ativo = &c->gerador;
+    tabuleiro_ativo = &c->tabuleiro;
+    saida_mensagens = &c->saida;
+
+    if (numero) {
+        resultado = executar_opcao(&c->fila, &c->pilha, opcao);
+        if (opcao == 0) c->encerrar = 1;
+    } else {
+        MENSAGEM("\nERRO: Entrada invalida. Por favor, digite um numero.\n");
+        resultado = ACAO_INVALIDA;
+    }
+    if (laco->servidor->verboso && !c->encerrar) {
+        formatar_estado_atual(&c->saida, &c->fila, &c->pilha);
+        formatar_menu(&c->saida);
+    }
+    buffer_anexar(&c->saida, RESPOSTAS_SERVIDOR[resultado + 1], strlen(RESPOSTAS_SERVIDOR[resultado + 1]));
+    laco->acoes++;
+}
+
+/**
+ * @brief Interpreta os bytes recebidos de um cliente, executando cada comando completo.
+ * As regras são as do replay (e do scanf + limpar_buffer do jogo interativo): espaços
+ * iniciais são ignorados, um número com sinal opcional é lido e o resto da linha é descartado.
+ */
+void servidor_processar(LacoServidor *laco, ClienteServidor *c, const char *dados, size_t n) {
+    size_t k;
+
+    for (k = 0; k < n && !c->encerrar; k++) {
+        PassoLeitor passo = leitor_consumir(&c->estado, &c->negativo, &c->valor, dados[k]);
+
+        if (passo == PASSO_INVALIDO) {
+            servidor_executar(laco, c, ACAO_INVALIDA, 0);
+        } else if (passo == PASSO_COMANDO) {
+            servidor_executar(laco, c, c->valor, 1);
         }
     }
 }
 
 /**
- * @brief Executa a ação 2: Reservar uma peça (dequeue da fila, push na pilha).
- * @param fila Ponteiro para a estrutura da fila.
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Lê o que um cliente enviou e responde. Lê no máximo LEITURAS_POR_EVENTO blocos
+ * por evento, para que um cliente rápido não monopolize o laço.
  */
-void acao_reservar_peca(FilaCircular *fila, Pilha *pilha) {
-    Peca peca_removida;
+void servidor_ler(LacoServidor *laco, ClienteServidor *c, char *bloco) {
+    int leituras;
 
-    // 1. Tenta remover a peça da frente da fila
-    if (dequeue(fila, &peca_removida)) {
-        // 2. Tenta inserir a peça removida no topo da pilha
-        if (push(pilha, peca_removida)) {
-            printf("\nACAO: Peca [%c %d] movida da fila para a pilha de reserva.\n", peca_removida.nome, peca_removida.id);
+    for (leituras = 0; leituras < LEITURAS_POR_EVENTO && !c->encerrar; leituras++) {
+        ssize_t n = read(c->fd, bloco, TAMANHO_LEITURA_SERVIDOR);
+        if (n > 0) {
+            servidor_processar(laco, c, bloco, (size_t)n);
+            if ((size_t)n < TAMANHO_LEITURA_SERVIDOR) break;
+        } else if (n == 0) {
+            // No fim da entrada, uma quebra de linha virtual fecha o último número pendente
+            servidor_processar(laco, c, "\n", 1);
+            c->encerrar = 1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            servidor_fechar_cliente(laco, c);
+            return;
+        }
+    }
+    // Todas as respostas desta leitura saem em uma única escrita
+    servidor_enviar(laco, c);
+}
 
-            // 3. Gera uma nova peça para preencher a vaga na fila
-            Peca nova_peca = gerarPeca();
-            if (enqueue(fila, nova_peca)) {
-                printf("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+/**
+ * @brief Aceita todas as conexões pendentes e cria uma sessão para cada uma.
+ */
+void servidor_aceitar(LacoServidor *laco) {
+    Servidor *servidor = laco->servidor;
+
+    for (;;) {
+        ClienteServidor *c;
+        HandleSessao handle;
+        struct epoll_event ev;
+        int fd = accept4(servidor->fd_escuta, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE) {
+                fprintf(stderr, "AVISO: Limite de descritores atingido; conexoes pendentes aguardam.\n");
             }
-        } else {
-            // Se o push falhou (pilha cheia), a peça precisa voltar para a fila.
-            // Isso complica a lógica. No cenário do Tetris, a peça simplesmente não
-            // é movida e permanece na fila, e a nova peça não é gerada.
-            // Para simplificar (e manter o requisito de 'manter a fila cheia' após ação),
-            // assumimos que a peça que falhou em ir para a pilha 'foi jogada'
-            // (ou seja, descartada) para permitir a entrada da nova peça na fila.
-            // No entanto, para ser estritamente correto:
-            printf("AVISO: Pilha de reserva cheia. Peca [%c %d] nao reservada e descartada para manter a fila completa.\n", peca_removida.nome, peca_removida.id);
-            // Poderia-se reinserir a peça, mas o requisito diz que removidas não voltam.
-            // O requisito 'a cada ação, uma nova peça é gerada' sugere que a peça
-            // removida deve ser tratada como 'jogada' ou 'descartada' se a pilha falhar.
-            Peca nova_peca = gerarPeca();
-            if (enqueue(fila, nova_peca)) {
-                printf("PECA AUTOMATICA: Nova peca [%c %d] inserida no final da fila.\n", nova_peca.nome, nova_peca.id);
+            return; // EAGAIN: nada mais a aceitar (ou outro laço aceitou primeiro)
+        }
+
+        handle = arena_alocar(&laco->arena, (void **)&c);
+        if (handle == HANDLE_NULO) {
+            close(fd);
+            continue;
+        }
+        memset(c, 0, sizeof(*c));
+        c->handle = handle;
+        c->fd = fd;
+        c->estado = LEITOR_ESPERA;
+        inicializar_fila(&c->fila);
+        inicializar_pilha(&c->pilha);
+        inicializar_tabuleiro(&c->tabuleiro);
+        gerador_inicializar(&c->gerador, servidor->semente,
+                            atomic_fetch_add_explicit(&servidor->proximo_fluxo, 1, memory_order_relaxed),
+                            servidor->modo);
+
+        // A sessão começa como o jogo interativo: fila inicial, estado e menu
+        gerador_ativo = &c->gerador;
+        tabuleiro_ativo = &c->tabuleiro;
+        saida_mensagens = &c->saida;
+        preencher_fila_inicial(&c->fila);
+        if (servidor->verboso) {
+            formatar_estado_atual(&c->saida, &c->fila, &c->pilha);
+            formatar_menu(&c->saida);
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.u64 = handle;
+        if (epoll_ctl(laco->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            buffer_liberar(&c->saida);
+            arena_liberar(&laco->arena, handle);
+            continue;
+        }
+        c->proximo = laco->clientes;
+        if (laco->clientes != NULL) laco->clientes->anterior = c;
+        laco->clientes = c;
+        laco->conexoes++;
+        if (++laco->ativos > laco->pico) laco->pico = laco->ativos;
+        servidor_enviar(laco, c);
+    }
+}
+
+/**
+ * @brief Laço de eventos de uma thread do servidor.
+ * O socket de escuta é registrado com EPOLLEXCLUSIVE em todos os laços, então cada
+ * conexão nova acorda apenas um deles.
+ */
+void *laco_servidor(void *arg) {
+    LacoServidor *laco = arg;
+    struct epoll_event eventos[MAX_EVENTOS_SERVIDOR];
+    char *bloco = malloc(TAMANHO_LEITURA_SERVIDOR);
+    int rodando = (bloco != NULL);
+
+    while (rodando) {
+        int n = epoll_wait(laco->epoll_fd, eventos, MAX_EVENTOS_SERVIDOR, -1);
+        int k;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (k = 0; k < n; k++) {
+            HandleSessao origem = eventos[k].data.u64;
+            if (origem == EVENTO_ESCUTA) {
+                servidor_aceitar(laco);
+            } else if (origem == EVENTO_PARADA) {
+                rodando = 0; // eventfd de parada
+            } else {
+                ClienteServidor *c = arena_obter(&laco->arena, origem);
+                if (c == NULL) continue; // Conexão fechada depois que o evento foi entregue
+                if (c->aguardando_escrita) {
+                    if (eventos[k].events & (EPOLLERR | EPOLLHUP)) servidor_fechar_cliente(laco, c);
+                    else servidor_enviar(laco, c);
+                } else {
+                    servidor_ler(laco, c, bloco);
+                }
             }
         }
     }
+
+    while (laco->clientes != NULL) {
+        servidor_fechar_cliente(laco, laco->clientes);
+    }
+    free(bloco);
+    return NULL;
 }
 
 /**
- * @brief Executa a ação 3: Usar uma peça reservada (pop da pilha).
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Eleva o limite de descritores abertos até o máximo permitido (uma conexão = um fd).
  */
-void acao_usar_peca_reservada(Pilha *pilha) {
-    Peca peca_usada;
+void elevar_limite_descritores() {
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+}
 
-    // Tenta remover a peça do topo da pilha
-    if (pop(pilha, &peca_usada)) {
-        printf("\nACAO: Peca [%c %d] usada (removida do topo da pilha).\n", peca_usada.nome, peca_usada.id);
+/**
+ * @brief Executa o servidor até receber SIGINT ou SIGTERM.
+ * @param caminho Caminho do socket Unix (um socket antigo no mesmo caminho é substituído).
+ * @param num_lacos Número de laços epoll (threads).
+ * @param semente Semente dos geradores das sessões.
+ * @param modo Modo do gerador de peças.
+ * @param verboso 1 para enviar mensagens, estado e menu; 0 para respostas curtas.
+ * @return int 0 em caso de sucesso, 1 em caso de erro.
+ */
+int executar_servidor(const char *caminho, int num_lacos, uint64_t semente, ModoGerador modo, int verboso) {
+    Servidor servidor;
+    LacoServidor *lacos;
+    struct sockaddr_un endereco;
+    struct stat info;
+    struct timespec t_inicio, t_fim;
+    sigset_t sinais;
+    int sinal;
+    int criados = 0;
+    long long conexoes = 0, acoes = 0;
+    int pico = 0;
+    uint64_t slots = 0;
+    long long reutilizacoes = 0;
+    size_t bytes_arena = 0;
+    int i;
+
+    if (num_lacos < 1 || num_lacos > MAX_LACOS_SERVIDOR) {
+        fprintf(stderr, "ERRO: Numero de lacos do servidor invalido (1 a %d).\n", MAX_LACOS_SERVIDOR);
+        return 1;
     }
-    // Obs: Esta ação não gera uma nova peça na fila, pois não houve remoção da fila.
+    if (strlen(caminho) >= sizeof(endereco.sun_path)) {
+        fprintf(stderr, "ERRO: Caminho do socket muito longo: '%s'.\n", caminho);
+        return 1;
+    }
+
+    memset(&servidor, 0, sizeof(servidor));
+    servidor.semente = semente;
+    servidor.modo = modo;
+    servidor.verboso = verboso;
+    atomic_init(&servidor.proximo_fluxo, 0);
+    elevar_limite_descritores();
+
+    // Substitui apenas um socket antigo; qualquer outro tipo de arquivo é preservado
+    if (lstat(caminho, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(caminho);
+    }
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    strcpy(endereco.sun_path, caminho);
+
+    servidor.fd_escuta = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (servidor.fd_escuta < 0 ||
+        bind(servidor.fd_escuta, (struct sockaddr *)&endereco, sizeof(endereco)) != 0 ||
+        listen(servidor.fd_escuta, SOMAXCONN) != 0) {
+        fprintf(stderr, "ERRO: Nao foi possivel escutar em '%s': %s\n", caminho, strerror(errno));
+        if (servidor.fd_escuta >= 0) close(servidor.fd_escuta);
+        return 1;
+    }
+    servidor.fd_parada = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    lacos = calloc(num_lacos, sizeof(LacoServidor));
+    if (servidor.fd_parada < 0 || lacos == NULL) {
+        fprintf(stderr, "ERRO: Nao foi possivel iniciar o servidor.\n");
+        close(servidor.fd_escuta);
+        if (servidor.fd_parada >= 0) close(servidor.fd_parada);
+        free(lacos);
+        unlink(caminho);
+        return 1;
+    }
+
+    // SIGINT/SIGTERM são recebidos só por esta thread (com sigwait), nunca pelos laços
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sinais, NULL);
+    signal(SIGPIPE, SIG_IGN); // Cliente que fechou a conexão: write() falha com EPIPE
+
+    modo_silencioso = !verboso;
+    for (i = 0; i < num_lacos; i++) {
+        struct epoll_event escuta = {EPOLLIN | EPOLLEXCLUSIVE, {.u64 = EVENTO_ESCUTA}};
+        struct epoll_event parada = {EPOLLIN, {.u64 = EVENTO_PARADA}};
+        LacoServidor *laco = &lacos[i];
+        laco->servidor = &servidor;
+        arena_criar(&laco->arena, sizeof(ClienteServidor));
+        laco->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (laco->epoll_fd < 0 ||
+            epoll_ctl(laco->epoll_fd, EPOLL_CTL_ADD, servidor.fd_escuta, &escuta) != 0 ||
+            epoll_ctl(laco->epoll_fd, EPOLL_CTL_ADD, servidor.fd_parada, &parada) != 0 ||
+            pthread_create(&laco->thread, NULL, laco_servidor, laco) != 0) {
+            if (laco->epoll_fd >= 0) close(laco->epoll_fd);
+            break;
+        }
+        criados++;
+    }
+
+    if (criados > 0) {
+        fprintf(stderr, "Servidor escutando em '%s' com %d laco(s) epoll (Ctrl+C encerra).\n", caminho, criados);
+        clock_gettime(CLOCK_MONOTONIC, &t_inicio);
+        while (sigwait(&sinais, &sinal) != 0) {
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t_fim);
+
+        // O eventfd fica legível para sempre, então todos os laços acordam e saem
+        eventfd_write(servidor.fd_parada, 1);
+        for (i = 0; i < criados; i++) {
+            pthread_join(lacos[i].thread, NULL);
+            close(lacos[i].epoll_fd);
+            conexoes += lacos[i].conexoes;
+            acoes += lacos[i].acoes;
+            pico += lacos[i].pico;
+            slots += lacos[i].arena.estatisticas.slots;
+            reutilizacoes += lacos[i].arena.estatisticas.reutilizacoes;
+            bytes_arena += lacos[i].arena.estatisticas.bytes_reservados;
+            arena_destruir(&lacos[i].arena);
+        }
+
+        {
+            double segundos = (t_fim.tv_sec - t_inicio.tv_sec) + (t_fim.tv_nsec - t_inicio.tv_nsec) / 1e9;
+            fprintf(stderr, "\n--- Resumo do Servidor ---\n");
+            fprintf(stderr, "Conexoes aceitas: %lld (pico de %d simultaneas, somando os lacos)\n", conexoes, pico);
+            fprintf(stderr, "Comandos respondidos: %lld em %.3f s\n", acoes, segundos);
+            fprintf(stderr, "Arena de sessoes: %llu slots de %zu bytes (%.1f KiB), %lld sessoes em slots reutilizados\n",
+                    (unsigned long long)slots, lacos[0].arena.tamanho_slot, bytes_arena / 1024.0, reutilizacoes);
+        }
+    } else {
+        fprintf(stderr, "ERRO: Nao foi possivel criar os lacos do servidor.\n");
+    }
+
+    modo_silencioso = 0;
+    close(servidor.fd_parada);
+    close(servidor.fd_escuta);
+    unlink(caminho);
+    free(lacos);
+    return criados > 0 ? 0 : 1;
 }
 
+// --- API da Biblioteca (tetris.h) ---
+//
+// As funções declaradas em tetris.h, sobre as mesmas estruturas e ações do jogo. Um
+// TetrisJogo junta a fila, a pilha, o gerador e o histórico de uma sessão; cada chamada
+// aponta os ganchos da thread (gerador_ativo, historico_ativo, ...) para o jogo e os
+// devolve ao final, como o servidor faz com cada conexão. Na biblioteca, compilada com
+// TETRIS_SEM_MAIN, TETRIS_BIBLIOTECA e -fvisibility=hidden, só estas funções são exportadas.
+
+_Static_assert(sizeof(TetrisPeca) == sizeof(Peca) && offsetof(TetrisPeca, id) == offsetof(Peca, id),
+               "TetrisPeca deve ter o mesmo layout de Peca");
+_Static_assert((int)TETRIS_ACAO_INVALIDA == (int)ACAO_INVALIDA && (int)TETRIS_ACAO_REJEITADA == (int)ACAO_REJEITADA &&
+               (int)TETRIS_ACAO_REALIZADA == (int)ACAO_REALIZADA && (int)TETRIS_ACAO_DESCARTADA == (int)ACAO_DESCARTADA,
+               "TetrisResultado deve ter os valores de ResultadoAcao");
+_Static_assert(TETRIS_DESFAZER == OPCAO_DESFAZER && TETRIS_REFAZER == OPCAO_REFAZER,
+               "TetrisAcao deve ter os codigos de opcao do jogo");
+
+struct TetrisJogo {
+    FilaCircular fila;
+    Pilha pilha;
+    GeradorPecas gerador;
+    HistoricoAcoes *historico; // NULL: sem desfazer/refazer
+};
+
+struct TetrisGerador {
+    GeradorPecas gerador;
+};
+
 /**
- * @brief Executa a ação 4: Trocar a peça da frente da fila com o topo da pilha.
- * @param fila Ponteiro para a estrutura da fila.
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Ganchos da thread trocados durante uma chamada da API.
  */
-void acao_troca_simples(FilaCircular *fila, Pilha *pilha) {
-    // 1. Verifica se ambas as estruturas estão prontas para a troca
-    if (fila_vazia(fila)) {
-        printf("\nAVISO: Fila vazia. Nao e possivel realizar a troca.\n");
-        return;
+typedef struct {
+    GeradorPecas *gerador;
+    HistoricoAcoes *historico;
+    DiarioAcoes *diario;
+    Tabuleiro *tabuleiro;
+    CanalPecas *canal;
+    AnalisePecas *analise;
+} GanchosApi;
+
+/**
+ * @brief Aponta os ganchos da thread para o jogo, guardando os anteriores em 'salvos'.
+ */
+void api_ativar(TetrisJogo *jogo, GanchosApi *salvos) {
+    salvos->gerador = gerador_ativo;
+    salvos->historico = historico_ativo;
+    salvos->diario = diario_ativo;
+    salvos->tabuleiro = tabuleiro_ativo;
+    salvos->canal = canal_ativo;
+    salvos->analise = analise_ativa;
+    gerador_ativo = &jogo->gerador;
+    historico_ativo = jogo->historico;
+    diario_ativo = NULL;
+    tabuleiro_ativo = NULL;
+    canal_ativo = NULL;
+    analise_ativa = NULL;
+}
+
+/**
+ * @brief Devolve os ganchos da thread guardados por api_ativar.
+ */
+void api_restaurar(const GanchosApi *salvos) {
+    gerador_ativo = salvos->gerador;
+    historico_ativo = salvos->historico;
+    diario_ativo = salvos->diario;
+    tabuleiro_ativo = salvos->tabuleiro;
+    canal_ativo = salvos->canal;
+    analise_ativa = salvos->analise;
+}
+
+TETRIS_API int tetris_versao_api(void) {
+    return TETRIS_API_VERSAO;
+}
+
+TETRIS_API int tetris_capacidade_fila(void) {
+    return MAX_FILA;
+}
+
+TETRIS_API int tetris_capacidade_pilha(void) {
+    return MAX_PILHA;
+}
+
+TETRIS_API TetrisJogo *tetris_criar(uint64_t semente, TetrisModoGerador modo, int com_historico) {
+    TetrisJogo *jogo = malloc(sizeof(TetrisJogo));
+    GanchosApi salvos;
+
+    if (jogo == NULL) return NULL;
+    jogo->historico = NULL;
+    if (com_historico) {
+        jogo->historico = malloc(sizeof(HistoricoAcoes));
+        if (jogo->historico == NULL || !historico_criar(jogo->historico, 0)) {
+            free(jogo->historico);
+            free(jogo);
+            return NULL;
+        }
     }
-    if (pilha_vazia(pilha)) {
-        printf("\nAVISO: Pilha vazia. Nao e possivel realizar a troca.\n");
-        return;
+    // O gerador do jogo é o fluxo 0 da semente, como o gerador padrão do executável
+    gerador_inicializar(&jogo->gerador, semente, 0, modo == TETRIS_GERADOR_SACO ? GERADOR_SACO : GERADOR_UNIFORME);
+    inicializar_fila(&jogo->fila);
+    inicializar_pilha(&jogo->pilha);
+    api_ativar(jogo, &salvos);
+    preencher_fila_inicial(&jogo->fila);
+    api_restaurar(&salvos);
+    return jogo;
+}
+
+TETRIS_API void tetris_liberar(TetrisJogo *jogo) {
+    if (jogo == NULL) return;
+    if (jogo->historico != NULL) {
+        historico_liberar(jogo->historico);
+        free(jogo->historico);
     }
+    free(jogo);
+}
 
-    Peca peca_fila = frente_da_fila(fila);
-    Peca peca_pilha = topo_da_pilha(pilha);
+TETRIS_API TetrisResultado tetris_executar(TetrisJogo *jogo, int acao) {
+    GanchosApi salvos;
+    ResultadoAcao resultado;
 
-    // 2. Realiza a troca (substituição direta nos arrays)
+    // Sem histórico, 6 e 7 não existem (executar_opcao só os conhece com um histórico ativo)
+    if ((acao == TETRIS_DESFAZER || acao == TETRIS_REFAZER) && jogo->historico == NULL) return TETRIS_ACAO_INVALIDA;
+    api_ativar(jogo, &salvos);
+    resultado = executar_opcao(&jogo->fila, &jogo->pilha, acao);
+    api_restaurar(&salvos);
+    return (TetrisResultado)resultado;
+}
 
-    // A peça da pilha vai para o início da fila
-    fila->itens[fila->inicio] = peca_pilha;
-    // A peça da fila vai para o topo da pilha
-    pilha->itens[pilha->topo] = peca_fila;
+TETRIS_API int tetris_executar_varias(TetrisJogo *jogo, const int8_t *acoes, int n, int8_t *resultados) {
+    GanchosApi salvos;
+    int efeito = 0;
+    int k;
 
-    printf("\nACAO: Troca simples realizada entre o topo da pilha ([%c %d]) e a frente da fila ([%c %d]).\n",
-           peca_pilha.nome, peca_pilha.id, peca_fila.nome, peca_fila.id);
+    api_ativar(jogo, &salvos);
+    for (k = 0; k < n; k++) {
+        ResultadoAcao resultado;
+        if ((acoes[k] == TETRIS_DESFAZER || acoes[k] == TETRIS_REFAZER) && jogo->historico == NULL) {
+            resultado = ACAO_INVALIDA;
+        } else {
+            resultado = executar_opcao(&jogo->fila, &jogo->pilha, acoes[k]);
+        }
+        efeito += (resultado == ACAO_REALIZADA || resultado == ACAO_DESCARTADA);
+        if (resultados != NULL) resultados[k] = (int8_t)resultado;
+    }
+    api_restaurar(&salvos);
+    return efeito;
+}
+
+// As operações em bloco não passam por executar_opcao e não deixam registro no histórico:
+// um TETRIS_DESFAZER depois delas restauraria casas que já mudaram de lugar. Por isso são
+// recusadas nos jogos com histórico.
+
+TETRIS_API int tetris_trocar(TetrisJogo *jogo, int k) {
+    if (jogo->historico != NULL) return 0;
+    return fila_trocar_pilha(&jogo->fila, &jogo->pilha, k);
+}
+
+TETRIS_API int tetris_rotacionar_fila(TetrisJogo *jogo, int r) {
+    if (jogo->historico != NULL) return 0;
+    return fila_rotacionar(&jogo->fila, r);
+}
+
+TETRIS_API int tetris_inverter_pilha(TetrisJogo *jogo) {
+    if (jogo->historico != NULL) return 0;
+    pilha_inverter(&jogo->pilha);
+    return 1;
+}
+
+TETRIS_API int tetris_tamanho_fila(const TetrisJogo *jogo) {
+    return jogo->fila.tamanho_atual;
+}
+
+TETRIS_API int tetris_tamanho_pilha(const TetrisJogo *jogo) {
+    return jogo->pilha.topo + 1;
+}
+
+TETRIS_API int tetris_peca_fila(const TetrisJogo *jogo, int posicao, TetrisPeca *peca) {
+    Peca p;
+    if (posicao < 0 || posicao >= jogo->fila.tamanho_atual) return 0;
+    p = jogo->fila.itens[INDICE_FILA(jogo->fila.inicio + posicao)];
+    peca->nome = p.nome;
+    peca->id = p.id;
+    return 1;
+}
+
+TETRIS_API int tetris_peca_pilha(const TetrisJogo *jogo, int posicao, TetrisPeca *peca) {
+    Peca p;
+    if (posicao < 0 || posicao > jogo->pilha.topo) return 0;
+    p = jogo->pilha.itens[jogo->pilha.topo - posicao];
+    peca->nome = p.nome;
+    peca->id = p.id;
+    return 1;
+}
+
+TETRIS_API uint64_t tetris_hash(const TetrisJogo *jogo) {
+    TetrisJogo *j = (TetrisJogo *)jogo; // hash_estado não altera o estado
+    GanchosApi salvos;
+    uint64_t hash;
+
+    api_ativar(j, &salvos);
+    hash = hash_estado(&j->fila, &j->pilha);
+    api_restaurar(&salvos);
+    return hash;
+}
+
+TETRIS_API TetrisGerador *tetris_gerador_criar(uint64_t semente, uint64_t fluxo, TetrisModoGerador modo) {
+    TetrisGerador *gerador = malloc(sizeof(TetrisGerador));
+    if (gerador == NULL) return NULL;
+    gerador_inicializar(&gerador->gerador, semente, fluxo, modo == TETRIS_GERADOR_SACO ? GERADOR_SACO : GERADOR_UNIFORME);
+    return gerador;
+}
+
+TETRIS_API void tetris_gerador_liberar(TetrisGerador *gerador) {
+    free(gerador);
 }
 
+TETRIS_API void tetris_gerar_pecas(TetrisGerador *gerador, TetrisPeca *destino, int n) {
+    gerador_gerar_pecas(&gerador->gerador, (Peca *)destino, n);
+}
+
+// --- Função Principal ---
+
+// Os benchmarks incluem este arquivo com TETRIS_SEM_MAIN definido para reaproveitar
+// todas as estruturas e ações sem a função principal do jogo.
+#ifndef TETRIS_SEM_MAIN
+
 /**
- * @brief Executa a ação 5: Trocar as 3 primeiras peças da fila com as 3 peças da pilha.
- * @param fila Ponteiro para a estrutura da fila.
- * @param pilha Ponteiro para a estrutura da pilha.
+ * @brief Exibe as opções de linha de comando.
+ * @param programa Nome do executável (argv[0]).
  */
-void acao_troca_multipla(FilaCircular *fila, Pilha *pilha) {
-    const int num_trocas = 3;
+void exibir_uso(const char *programa) {
+    printf("Uso: %s [--semente N] [--saco] [--rolagem | --quieto] [--pipeline] [--gravar arquivo] [--replay [arquivo]] [--sessoes N] [--tabuleiro]\n"
+           "       %s [--semente N] [--saco] --replay [arquivo] --sessoes N --checkpoint arquivo [--intervalo-checkpoint K]\n"
+           "       %s [--semente N] [--saco] --simular N M [--threads T] [--pesos a,b,c,d,e] [--compacto | --corrotinas [--quieto]]\n"
+           "       %s --ler-diario arquivo [--ate K]\n"
+           "       %s [--semente N] [--saco] [--quieto] --servidor caminho [--threads T]\n"
+           "       %s [--semente N] [--saco] --resolver ALVO [--threads T]\n"
+           "       %s [--semente N] [--saco] --analisar N [--relatorio K]\n",
+           programa, programa, programa, programa, programa, programa, programa);
+    printf("  --semente N         Inicializa o gerador de pecas com a semente N (reprodutivel).\n");
+    printf("  --saco              Sorteia as pecas em sacos embaralhados com os 4 tipos.\n");
+    printf("  --rolagem           Imprime cada estado em sequencia (padrao quando a saida nao e um terminal),\n");
+    printf("                      em vez de redesenhar so as linhas alteradas da tela.\n");
+    printf("  --quieto            Nao desenha nada: nem estado, nem menu, nem mensagens.\n");
+    printf("  --pipeline          Gera as pecas em uma thread produtora, a frente do jogo\n");
+    printf("                      (mesma sequencia da geracao sincrona para a mesma semente).\n");
+    printf("  --replay [arquivo]  Executa as acoes do arquivo (ou da stdin, se omitido ou '-')\n");
+    printf("                      sem saida de console e imprime apenas um resumo final.\n");
+    printf("  --tabuleiro         No replay, encaixa as pecas jogadas em um tabuleiro 10x20\n");
+    printf("                      (o jogo interativo sempre usa o tabuleiro).\n");
+    printf("  --sessoes N         No replay, distribui as acoes em rodizio entre N sessoes\n");
+    printf("                      guardadas em uma tabela SoA (structure of arrays).\n");
+    printf("  --checkpoint arquivo  Com --sessoes, grava a tabela no arquivo em segundo plano (so os blocos\n");
+    printf("                      alterados) e, se ele ja tem um checkpoint, retoma o replay de onde parou.\n");
+    printf("  --intervalo-checkpoint K  Acoes do replay entre dois checkpoints (padrao: %d).\n", INTERVALO_CHECKPOINT_PADRAO);
+    printf("  --gravar arquivo    Grava um diario binario das acoes (e das pecas geradas) da sessao.\n");
+    printf("  --intervalo-snapshot K  Grava um snapshot do estado a cada K acoes (padrao: %d).\n", INTERVALO_SNAPSHOT_PADRAO);
+    printf("  --ler-diario arquivo    Reproduz um diario gravado e mostra o estado final.\n");
+    printf("  --ate K             Com --ler-diario, para na acao K (parte do snapshot mais proximo).\n");
+    printf("  --simular N M       Simula N sessoes independentes com M acoes aleatorias cada,\n");
+    printf("                      em paralelo, e imprime as estatisticas somadas.\n");
+    printf("  --compacto          Com --simular, cada sessao roda no estado compacto de 128 bits.\n");
+    printf("  --corrotinas        Com --simular, cada sessao roda como corrotina que espera seus comandos,\n");
+    printf("                      enviados rodada a rodada, em T threads (mostra latencia e justica).\n");
+    printf("  --threads T         Threads do simulador, do resolvedor ou lacos epoll do servidor (padrao: numero de nucleos).\n");
+    printf("  --pesos a,b,c,d,e   Pesos da politica aleatoria para as acoes 1 a 5 (padrao: 1,1,1,1,1).\n");
+    printf("  --resolver ALVO     Mostra a menor sequencia de acoes que deixa os tipos de ALVO\n");
+    printf("                      (por exemplo TLI) na frente da fila inicial.\n");
+    printf("  --avaliar N         Um bot joga N pecas no tabuleiro, escolhendo cada jogada pela heuristica\n");
+    printf("                      (alturas, buracos, irregularidade e linhas), e mostra a vazao da avaliacao.\n");
+    printf("  --profundidade D    Com --avaliar, pecas da previa consideradas em cada jogada (padrao: 2).\n");
+    printf("  --heuristica a,b,c,d  Pesos de altura, buracos, irregularidade e linhas do --avaliar.\n");
+    printf("  --analisar N        Gera N pecas (sem jogar) e mostra a distribuicao dos tipos: frequencias,\n");
+    printf("                      qui-quadrado, intervalos entre pecas do mesmo tipo, secas e sequencias.\n");
+    printf("  --relatorio K       Relatorio parcial na stderr a cada K pecas analisadas (padrao: %lld; 0 desliga).\n",
+           RELATORIO_ANALISE_PADRAO);
+    printf("  --analise           No jogo ou no replay, analisa as pecas geradas e os descartes da reserva\n");
+    printf("                      e imprime o relatorio na stderr ao final.\n");
+    printf("  --servidor caminho  Atende varios jogadores em um socket Unix, uma sessao por conexao\n");
+    printf("                      (com --quieto, cada comando recebe so a linha '= resultado').\n");
+    printf("  --estatisticas-json arquivo  Com -DTETRIS_INSTRUMENTACAO, grava as estatisticas das acoes\n");
+    printf("                      em JSON no arquivo (na saida e a cada SIGUSR1).\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *arquivo_replay = NULL;
+    int modo_replay = 0;
+    int num_sessoes = 0;
+    uint64_t semente = (uint64_t)time(NULL);
+    ModoGerador modo_gerador = GERADOR_UNIFORME;
+    int usar_renderizador = isatty(STDOUT_FILENO); // Quadros com diferença só em terminais
+    int modo_quieto = 0;
+    int usar_pipeline = 0;
+    int modo_simulacao = 0;
+    int usar_corrotinas = 0;
+    const char *arquivo_gravacao = NULL;
+    const char *arquivo_leitura = NULL;
+    int intervalo_snapshot = INTERVALO_SNAPSHOT_PADRAO;
+    long long ate = -1;
+    DiarioAcoes diario;
+    ConfigSimulacao simulacao = {0, 0, 0, GERADOR_UNIFORME, {1, 1, 1, 1, 1}, 1, 0};
+    const char *arquivo_estatisticas = NULL;
+    const char *caminho_servidor = NULL;
+    const char *alvo_resolvedor = NULL;
+    long long pecas_avaliador = 0;
+    int profundidade_avaliador = 2;
+    PesosHeuristica heuristica = PESOS_PADRAO;
+    int usar_tabuleiro_replay = 0;
+    long long pecas_analise = 0;
+    long long intervalo_relatorio = RELATORIO_ANALISE_PADRAO;
+    int usar_analise = 0;
+    const char *arquivo_checkpoint = NULL;
+    long long intervalo_checkpoint = INTERVALO_CHECKPOINT_PADRAO;
+    AnalisePecas *analise = NULL;
+    Tabuleiro tabuleiro;
+    int retorno;
+    Renderizador renderizador;
     int i;
 
-    // 1. Verifica se ambas as estruturas têm capacidade mínima para a troca
-    if (fila->tamanho_atual < num_trocas) {
-        printf("\nAVISO: Fila tem menos de %d pecas. Nao e possivel realizar a troca multipla.\n", num_trocas);
-        return;
+    // Por padrão, o simulador usa uma thread por núcleo disponível
+    simulacao.num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (simulacao.num_threads < 1) simulacao.num_threads = 1;
+
+    // Interpreta os argumentos de linha de comando
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--saco") == 0) {
+            modo_gerador = GERADOR_SACO;
+        } else if (strcmp(argv[i], "--rolagem") == 0) {
+            usar_renderizador = 0;
+        } else if (strcmp(argv[i], "--quieto") == 0) {
+            modo_quieto = 1;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            usar_pipeline = 1;
+        } else if (strcmp(argv[i], "--simular") == 0 && i + 2 < argc) {
+            modo_simulacao = 1;
+            simulacao.num_sessoes = atoi(argv[++i]);
+            simulacao.acoes_por_sessao = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--compacto") == 0) {
+            simulacao.compacto = 1;
+        } else if (strcmp(argv[i], "--corrotinas") == 0) {
+            usar_corrotinas = 1;
+        } else if (strcmp(argv[i], "--gravar") == 0 && i + 1 < argc) {
+            arquivo_gravacao = argv[++i];
+        } else if (strcmp(argv[i], "--intervalo-snapshot") == 0 && i + 1 < argc) {
+            intervalo_snapshot = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ler-diario") == 0 && i + 1 < argc) {
+            arquivo_leitura = argv[++i];
+        } else if (strcmp(argv[i], "--ate") == 0 && i + 1 < argc) {
+            ate = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            simulacao.num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pesos") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d,%d,%d", &simulacao.pesos[0], &simulacao.pesos[1],
+                       &simulacao.pesos[2], &simulacao.pesos[3], &simulacao.pesos[4]) != 5) {
+                exibir_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            num_sessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tabuleiro") == 0) {
+            usar_tabuleiro_replay = 1;
+        } else if (strcmp(argv[i], "--resolver") == 0 && i + 1 < argc) {
+            alvo_resolvedor = argv[++i];
+        } else if (strcmp(argv[i], "--avaliar") == 0 && i + 1 < argc) {
+            pecas_avaliador = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--profundidade") == 0 && i + 1 < argc) {
+            profundidade_avaliador = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--heuristica") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &heuristica.altura, &heuristica.buracos,
+                       &heuristica.irregularidade, &heuristica.linhas) != 4) {
+                exibir_uso(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--analisar") == 0 && i + 1 < argc) {
+            pecas_analise = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--relatorio") == 0 && i + 1 < argc) {
+            intervalo_relatorio = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--analise") == 0) {
+            usar_analise = 1;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            arquivo_checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "--intervalo-checkpoint") == 0 && i + 1 < argc) {
+            intervalo_checkpoint = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--servidor") == 0 && i + 1 < argc) {
+            caminho_servidor = argv[++i];
+        } else if (strcmp(argv[i], "--estatisticas-json") == 0 && i + 1 < argc) {
+            arquivo_estatisticas = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            modo_replay = 1;
+            // O arquivo é opcional: se o próximo argumento não for uma opção, é o caminho
+            if (i + 1 < argc && (argv[i + 1][0] != '-' || strcmp(argv[i + 1], "-") == 0)) {
+                arquivo_replay = argv[++i];
+            }
+        } else {
+            exibir_uso(argv[0]);
+            return 1;
+        }
     }
-    // A Pilha tem capacidade MAX_PILHA=3, então verificamos se está cheia
-    if (pilha->topo + 1 < num_trocas) {
-        printf("\nAVISO: Pilha tem menos de %d pecas. Nao e possivel realizar a troca multipla.\n", num_trocas);
-        return;
+
+    // Com -DTETRIS_INSTRUMENTACAO, SIGUSR1 despeja as estatísticas (antes de criar outras threads)
+    INSTRUMENTACAO_INICIAR(arquivo_estatisticas);
+
+    if (arquivo_leitura != NULL) {
+        return executar_leitura_diario(arquivo_leitura, ate);
     }
 
-    printf("\nACAO: Iniciando a troca das %d primeiras pecas da fila com as %d pecas da pilha.\n", num_trocas, num_trocas);
+    // Inicializa o gerador de peças (para gerarPeca)
+    gerador_inicializar(&gerador_padrao, semente, 0, modo_gerador);
 
-    // 2. Realiza a troca
-    for (i = 0; i < num_trocas; i++) {
-        // Calcula o índice circular na fila: inicio + i
-        int indice_fila = (fila->inicio + i) % MAX_FILA;
-        // O índice da pilha é Pilha.topo - i, o que corresponde aos 3 elementos
-        // Pilha.topo, Pilha.topo-1, Pilha.topo-2 (ou 2, 1, 0, se cheia)
-        int indice_pilha = pilha->topo - i;
+    if (pecas_analise > 0) {
+        return executar_analise(pecas_analise, intervalo_relatorio > 0 ? intervalo_relatorio : 0);
+    }
 
-        // Armazena temporariamente a peça da fila
-        Peca temp_peca_fila = fila->itens[indice_fila];
+    if (alvo_resolvedor != NULL) {
+        return executar_resolvedor(alvo_resolvedor, simulacao.num_threads);
+    }
 
-        // Troca 1: A peça da pilha vai para a fila
-        fila->itens[indice_fila] = pilha->itens[indice_pilha];
+    if (pecas_avaliador > 0) {
+        // Profundidades maiores que a fila são limitadas pelo avaliador
+        if (profundidade_avaliador < 1) {
+            fprintf(stderr, "ERRO: --profundidade deve ser positiva.\n");
+            return 1;
+        }
+        return executar_avaliador(pecas_avaliador, profundidade_avaliador, simulacao.num_threads, &heuristica);
+    }
 
-        // Troca 2: A peça original da fila vai para a pilha
-        pilha->itens[indice_pilha] = temp_peca_fila;
+    if (modo_simulacao) {
+        if (simulacao.compacto && !ESTADO_COMPACTO_DISPONIVEL) {
+            fprintf(stderr, "ERRO: --compacto exige MAX_FILA + MAX_PILHA <= 8.\n");
+            return 1;
+        }
+        if (simulacao.compacto && usar_corrotinas) {
+            fprintf(stderr, "ERRO: --compacto e --corrotinas nao podem ser usados juntos.\n");
+            return 1;
+        }
+        simulacao.semente = semente;
+        simulacao.modo = modo_gerador;
+        // Sem --quieto, cada sessão em corrotina desenha o estado e o menu antes de esperar
+        retorno = usar_corrotinas ? executar_simulacao_corrotinas(&simulacao, !modo_quieto)
+                                  : executar_simulacao(&simulacao);
+        INSTRUMENTACAO_DESPEJAR();
+        return retorno;
     }
 
-    printf("Troca realizada com sucesso!\n");
-}
+    // Com --servidor, cada conexão tem sua própria sessão (o canal e o diário são de uma sessão só)
+    if (caminho_servidor != NULL) {
+        if (usar_pipeline || arquivo_gravacao != NULL || modo_replay) {
+            fprintf(stderr, "ERRO: --servidor nao pode ser usado com --pipeline, --gravar ou --replay.\n");
+            return 1;
+        }
+        retorno = executar_servidor(caminho_servidor, simulacao.num_threads, semente, modo_gerador, !modo_quieto);
+        INSTRUMENTACAO_DESPEJAR();
+        return retorno;
+    }
 
-// --- Função Principal ---
+    // O checkpoint guarda a tabela e o gerador compartilhado dela, no replay
+    if (arquivo_checkpoint != NULL) {
+        if (!modo_replay || num_sessoes < 1 || usar_pipeline || arquivo_gravacao != NULL) {
+            fprintf(stderr, "ERRO: --checkpoint exige --replay com --sessoes, sem --pipeline nem --gravar.\n");
+            return 1;
+        }
+        if (intervalo_checkpoint < 1) {
+            fprintf(stderr, "ERRO: --intervalo-checkpoint deve ser positivo.\n");
+            return 1;
+        }
+    }
+
+    // Com --pipeline, as peças passam a vir de uma thread produtora
+    if (usar_pipeline) {
+        canal_ativo = canal_criar(&gerador_padrao);
+        if (canal_ativo == NULL) {
+            fprintf(stderr, "ERRO: Nao foi possivel iniciar a thread produtora de pecas.\n");
+            return 1;
+        }
+    }
+
+    // Com --gravar, executar_opcao grava cada ação da sessão no diário
+    if (arquivo_gravacao != NULL) {
+        if (modo_replay && num_sessoes > 0) {
+            fprintf(stderr, "ERRO: --gravar grava uma unica sessao e nao pode ser usado com --sessoes.\n");
+            return 1;
+        }
+        if (!diario_abrir(&diario, arquivo_gravacao, semente, intervalo_snapshot)) {
+            fprintf(stderr, "ERRO: Nao foi possivel criar o diario '%s'.\n", arquivo_gravacao);
+            return 1;
+        }
+        diario_ativo = &diario;
+    }
+
+    // O jogo interativo sempre encaixa as peças jogadas; no replay, só com --tabuleiro
+    inicializar_tabuleiro(&tabuleiro);
+    if (!modo_replay || usar_tabuleiro_replay) {
+        if (modo_replay && num_sessoes > 0) {
+            fprintf(stderr, "ERRO: --tabuleiro usa uma unica sessao e nao pode ser usado com --sessoes.\n");
+            return 1;
+        }
+        tabuleiro_ativo = &tabuleiro;
+    }
+
+    // Com --analise, gerarPeca() e a ação de reservar alimentam a análise desta sessão
+    if (usar_analise) {
+        analise = malloc(sizeof(AnalisePecas));
+        if (analise == NULL) {
+            fprintf(stderr, "ERRO: Memoria insuficiente para a analise.\n");
+            return 1;
+        }
+        analise_iniciar(analise, intervalo_relatorio > 0 ? intervalo_relatorio : 0);
+        analise_ativa = analise;
+    }
 
-int main() {
-    // Inicializa o gerador de números pseudo-aleatórios (para gerarPeca)
-    srand(time(NULL));
+    if (modo_replay) {
+        retorno = executar_replay(arquivo_replay, num_sessoes, arquivo_checkpoint, intervalo_checkpoint);
+        if (analise != NULL) analise_imprimir(analise, stderr);
+        if (canal_ativo != NULL) canal_destruir(canal_ativo);
+        if (diario_ativo != NULL && !diario_fechar(diario_ativo)) {
+            fprintf(stderr, "ERRO: Falha ao gravar o diario '%s'.\n", arquivo_gravacao);
+            retorno = 1;
+        }
+        INSTRUMENTACAO_DESPEJAR();
+        return retorno;
+    }
 
     // Declaração das estruturas de dados
     FilaCircular fila;
     Pilha pilha;
+    HistoricoAcoes historico;
+    LeitorComandos leitor;
     int opcao = -1;
 
+    if (!leitor_criar(&leitor, STDIN_FILENO)) {
+        fprintf(stderr, "ERRO: Memoria insuficiente para a entrada.\n");
+        return 1;
+    }
+
+    // Desfazer/refazer (opções 6 e 7): não com --gravar (o diário não registra o desfazer)
+    // nem com --pipeline (as peças já retiradas do canal não voltam para ele)
+    if (arquivo_gravacao == NULL && !usar_pipeline) {
+        if (!historico_criar(&historico, 1)) {
+            fprintf(stderr, "ERRO: Memoria insuficiente para o historico.\n");
+            return 1;
+        }
+        historico_ativo = &historico;
+    }
+
     // Inicializa as estruturas
     inicializar_fila(&fila);
     inicializar_pilha(&pilha);
 
+    // No modo quieto nada é desenhado; as ações também não imprimem mensagens
+    if (modo_quieto) {
+        modo_silencioso = 1;
+        usar_renderizador = 0;
+    } else {
+        exibir_abertura();
+    }
+    if (usar_renderizador) {
+        renderizador_iniciar(&renderizador);
+    }
+
     // Preenche a fila com 5 peças iniciais, como requerido
     preencher_fila_inicial(&fila);
 
     // Loop principal do programa
     while (opcao != 0) {
-        // 1. Exibe o estado atual antes de qualquer ação
-        exibir_estado_atual(&fila, &pilha);
+        // 1. Exibe o estado atual e o menu antes de qualquer ação
+        if (usar_renderizador) {
+            renderizador_desenhar(&renderizador, &fila, &pilha);
+        } else if (!modo_quieto) {
+            exibir_estado_atual(&fila, &pilha);
+            exibir_menu();
+        }
 
-        // 2. Exibe o menu e solicita a opção
-        exibir_menu();
-        // Leitura da opção do usuário
-        // O resultado do scanf é o número de itens lidos com sucesso
-        if (scanf("%d", &opcao) != 1) {
-            printf("\nERRO: Entrada invalida. Por favor, digite um numero.\n");
-            // Limpa o buffer de entrada para evitar loops infinitos de erro
-            limpar_buffer();
+        // 2. Leitura da opção do usuário
+        // O leitor devolve 1 quando leu um número, como scanf, e já descarta o resto da linha
+        if (leitor_proxima_opcao(&leitor, &opcao) != 1) {
+            MENSAGEM("\nERRO: Entrada invalida. Por favor, digite um numero.\n");
             opcao = -1; // Reinicia a opção para garantir que o loop continue
             continue;
         }
 
-        // Limpa o buffer após a leitura do inteiro
-        limpar_buffer();
-
         // 3. Processa a opção escolhida
-        switch (opcao) {
-            case 1:
-                acao_jogar_peca(&fila); // Dequeue e gera nova peça
-                break;
-            case 2:
-                acao_reservar_peca(&fila, &pilha); // Dequeue, Push, e gera nova peça
-                break;
-            case 3:
-                acao_usar_peca_reservada(&pilha); // Pop da pilha
-                break;
-            case 4:
-                acao_troca_simples(&fila, &pilha); // Troca frente da fila com topo da pilha
-                break;
-            case 5:
-                acao_troca_multipla(&fila, &pilha); // Troca 3 da fila com 3 da pilha
-                break;
-            case 0:
-                printf("\nEncerrando o Gerenciador de Pecas. Ate logo!\n");
-                break;
-            default:
-                printf("\nAVISO: Opcao invalida. Por favor, escolha um numero entre 0 e 5.\n");
-                break;
-        }
+        executar_opcao(&fila, &pilha, opcao);
+    }
+
+    if (usar_renderizador) {
+        renderizador_finalizar(&renderizador);
+    }
+    if (canal_ativo != NULL) {
+        canal_destruir(canal_ativo);
+    }
+    if (historico_ativo != NULL) {
+        historico_liberar(historico_ativo);
+        historico_ativo = NULL;
+    }
+    leitor_liberar(&leitor);
+    buffer_liberar(&buffer_exibicao);
+    if (analise != NULL) {
+        analise_imprimir(analise, stderr);
+        analise_ativa = NULL;
+        free(analise);
+    }
+    INSTRUMENTACAO_DESPEJAR();
+    if (diario_ativo != NULL && !diario_fechar(diario_ativo)) {
+        fprintf(stderr, "ERRO: Falha ao gravar o diario '%s'.\n", arquivo_gravacao);
+        return 1;
     }
 
     return 0; // Finaliza o programa
-}
\ No newline at end of file
+}
+
+#endif // TETRIS_SEM_MAIN
@@ -0,0 +1,194 @@
+// API pública da biblioteca do Tetris Stack (libtetris.a / libtetris.so).
+//
+// Expõe a fila de peças, a pilha de reserva, o gerador de peças e as ações do jogo sem
+// nenhuma saída de console: a biblioteca é compilada com as mensagens desligadas, e só
+// os símbolos declarados aqui são exportados. As estruturas internas (fila circular,
+// pilha, gerador, histórico) ficam escondidas atrás de ponteiros opacos, de modo que as
+// capacidades e o layout podem mudar sem quebrar quem usa a biblioteca; TETRIS_API_VERSAO
+// muda só quando uma função daqui muda de assinatura ou de comportamento.
+//
+// Cada TetrisJogo é independente (o seu próprio gerador e histórico); jogos diferentes
+// podem ser usados em threads diferentes ao mesmo tempo, mas um mesmo jogo não.
+//
+// Compilação: make (veja o README), e depois:
+//   gcc programa.c -Ibuild/release -Lbuild/release -ltetris -pthread
+
+#ifndef TETRIS_H
+#define TETRIS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Versão da API; tetris_versao_api() devolve a versão com que a biblioteca foi compilada
+#define TETRIS_API_VERSAO 1
+
+// Marca os símbolos exportados (a biblioteca é compilada com -fvisibility=hidden)
+#if defined(__GNUC__)
+#define TETRIS_API __attribute__((visibility("default")))
+#else
+#define TETRIS_API
+#endif
+
+/**
+ * @brief Um jogo: fila de peças, pilha de reserva, gerador e (opcionalmente) histórico.
+ */
+typedef struct TetrisJogo TetrisJogo;
+
+/**
+ * @brief Um gerador de peças independente de um jogo.
+ */
+typedef struct TetrisGerador TetrisGerador;
+
+/**
+ * @brief Uma peça: o tipo ('I', 'O', 'T' ou 'L') e o ID em ordem de criação.
+ */
+typedef struct {
+    char nome;
+    int id;
+} TetrisPeca;
+
+/**
+ * @brief Modos de sorteio do gerador de peças.
+ */
+typedef enum {
+    TETRIS_GERADOR_UNIFORME = 0, // Cada peça tem tipo independente e uniforme
+    TETRIS_GERADOR_SACO = 1      // Os 4 tipos embaralhados em sacos, entregues um a um
+} TetrisModoGerador;
+
+/**
+ * @brief Ações do jogo (os mesmos códigos do menu).
+ */
+typedef enum {
+    TETRIS_SAIR = 0,            // Não muda nada
+    TETRIS_JOGAR = 1,           // Joga a peça da frente da fila; uma nova entra no fim
+    TETRIS_RESERVAR = 2,        // Move a peça da frente da fila para a pilha
+    TETRIS_USAR_RESERVADA = 3,  // Remove a peça do topo da pilha
+    TETRIS_TROCAR = 4,          // Troca a frente da fila com o topo da pilha
+    TETRIS_TROCAR_MULTIPLA = 5, // Troca as 3 primeiras da fila com as 3 da pilha
+    TETRIS_DESFAZER = 6,        // Desfaz a última ação (só em jogos com histórico)
+    TETRIS_REFAZER = 7          // Refaz a última ação desfeita (só em jogos com histórico)
+} TetrisAcao;
+
+/**
+ * @brief Resultado de uma ação.
+ */
+typedef enum {
+    TETRIS_ACAO_INVALIDA = -1,  // Código de ação desconhecido
+    TETRIS_ACAO_REJEITADA = 0,  // Pré-condição não atendida (fila/pilha vazia ou curta); nada mudou
+    TETRIS_ACAO_REALIZADA = 1,  // Ação executada
+    TETRIS_ACAO_DESCARTADA = 2  // Reservar com a pilha cheia: a peça saiu da fila e foi descartada
+} TetrisResultado;
+
+/**
+ * @brief Versão da API com que a biblioteca foi compilada (compare com TETRIS_API_VERSAO).
+ */
+TETRIS_API int tetris_versao_api(void);
+
+/**
+ * @brief Capacidades da fila e da pilha com que a biblioteca foi compilada.
+ */
+TETRIS_API int tetris_capacidade_fila(void);
+TETRIS_API int tetris_capacidade_pilha(void);
+
+/**
+ * @brief Cria um jogo com a fila cheia e a pilha vazia.
+ * A mesma semente e o mesmo modo sempre produzem as mesmas peças (as mesmas do
+ * executável com --semente e, no modo saco, --saco).
+ * @param semente Semente do gerador de peças.
+ * @param modo Modo de sorteio.
+ * @param com_historico 1 para aceitar TETRIS_DESFAZER e TETRIS_REFAZER.
+ * @return TetrisJogo* O jogo, ou NULL se faltou memória.
+ */
+TETRIS_API TetrisJogo *tetris_criar(uint64_t semente, TetrisModoGerador modo, int com_historico);
+
+/**
+ * @brief Libera um jogo (NULL é aceito e ignorado).
+ */
+TETRIS_API void tetris_liberar(TetrisJogo *jogo);
+
+/**
+ * @brief Executa uma ação (TetrisAcao) no jogo.
+ * @return TetrisResultado O resultado; TETRIS_ACAO_INVALIDA para códigos desconhecidos
+ * (e para desfazer/refazer em um jogo sem histórico).
+ */
+TETRIS_API TetrisResultado tetris_executar(TetrisJogo *jogo, int acao);
+
+/**
+ * @brief Executa n ações em sequência.
+ * @param resultados Recebe o resultado de cada ação, ou NULL.
+ * @return int Quantas ações mudaram o estado (realizadas ou descartadas).
+ */
+TETRIS_API int tetris_executar_varias(TetrisJogo *jogo, const int8_t *acoes, int n, int8_t *resultados);
+
+// Operações em bloco. Não ficam no histórico (TETRIS_DESFAZER não as desfaz), então só
+// são aceitas em jogos criados sem histórico; nos outros devolvem 0 sem mudar nada.
+
+/**
+ * @brief Troca as k primeiras peças da fila com as k do topo da pilha (a i-ésima da
+ * frente com a i-ésima a partir do topo).
+ * @return int 1 se a troca foi feita, 0 se a fila ou a pilha tem menos de k peças ou o
+ * jogo tem histórico.
+ */
+TETRIS_API int tetris_trocar(TetrisJogo *jogo, int k);
+
+/**
+ * @brief Rotaciona a fila: as r primeiras peças vão para o fim (r negativo: o contrário).
+ * @return int 1 em caso de sucesso, 0 se a fila está vazia ou o jogo tem histórico.
+ */
+TETRIS_API int tetris_rotacionar_fila(TetrisJogo *jogo, int r);
+
+/**
+ * @brief Inverte a pilha: a base vira o topo.
+ * @return int 1 em caso de sucesso, 0 se o jogo tem histórico.
+ */
+TETRIS_API int tetris_inverter_pilha(TetrisJogo *jogo);
+
+/**
+ * @brief Número de peças na fila e na pilha.
+ */
+TETRIS_API int tetris_tamanho_fila(const TetrisJogo *jogo);
+TETRIS_API int tetris_tamanho_pilha(const TetrisJogo *jogo);
+
+/**
+ * @brief Lê uma peça da fila (posição 0 = a frente).
+ * @return int 1 em caso de sucesso, 0 se a posição não tem peça.
+ */
+TETRIS_API int tetris_peca_fila(const TetrisJogo *jogo, int posicao, TetrisPeca *peca);
+
+/**
+ * @brief Lê uma peça da pilha (posição 0 = o topo).
+ * @return int 1 em caso de sucesso, 0 se a posição não tem peça.
+ */
+TETRIS_API int tetris_peca_pilha(const TetrisJogo *jogo, int posicao, TetrisPeca *peca);
+
+/**
+ * @brief Hash do estado (fila, pilha e ID da próxima peça); é o mesmo "Hash do estado"
+ * que o executável imprime no fim de um --replay com as mesmas ações.
+ */
+TETRIS_API uint64_t tetris_hash(const TetrisJogo *jogo);
+
+/**
+ * @brief Cria um gerador de peças. Fluxos diferentes da mesma semente produzem
+ * sequências independentes; o fluxo 0 é o que tetris_criar usa.
+ * @return TetrisGerador* O gerador, ou NULL se faltou memória.
+ */
+TETRIS_API TetrisGerador *tetris_gerador_criar(uint64_t semente, uint64_t fluxo, TetrisModoGerador modo);
+
+/**
+ * @brief Libera um gerador (NULL é aceito e ignorado).
+ */
+TETRIS_API void tetris_gerador_liberar(TetrisGerador *gerador);
+
+/**
+ * @brief Gera as próximas n peças do gerador em 'destino'.
+ */
+TETRIS_API void tetris_gerar_pecas(TetrisGerador *gerador, TetrisPeca *destino, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TETRIS_H